@@ -0,0 +1,547 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Read odyssey shared memory statistics segment (stats_shm_path)
+ * and print it as a table, as per second route history or in OpenMetrics
+ * text format.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <sources/shm_stats.h>
+
+#define SHMSTAT_RETRY_MAX 1000
+
+typedef struct
+{
+	od_shm_stats_header_t header;
+	od_shm_stats_worker_t *workers;
+	od_shm_stats_route_t *routes;
+} shmstat_snapshot_t;
+
+static int
+shmstat_snapshot(od_shm_stats_header_t *shm, shmstat_snapshot_t *snapshot)
+{
+	uint32_t workers_max = shm->workers_max;
+	uint32_t routes_max  = shm->routes_max;
+	snapshot->workers = calloc(workers_max + 1, sizeof(od_shm_stats_worker_t));
+	snapshot->routes  = calloc(routes_max + 1, sizeof(od_shm_stats_route_t));
+	if (snapshot->workers == NULL || snapshot->routes == NULL)
+		return -1;
+
+	/* header, global and route counters */
+	int retry;
+	for (retry = 0; retry < SHMSTAT_RETRY_MAX; retry++) {
+		uint64_t seq = od_shm_stats_read_begin(&shm->seq);
+		memcpy(&snapshot->header, shm, sizeof(*shm));
+		uint32_t count = snapshot->header.routes_count;
+		if (count > routes_max)
+			count = routes_max;
+		memcpy(snapshot->routes,
+		       od_shm_stats_route_of(shm, 0),
+		       sizeof(od_shm_stats_route_t) * count);
+		if (!od_shm_stats_read_retry(&shm->seq, seq))
+			break;
+	}
+	if (retry == SHMSTAT_RETRY_MAX)
+		return -1;
+	if (snapshot->header.routes_count > routes_max)
+		snapshot->header.routes_count = routes_max;
+	if (snapshot->header.workers_count > workers_max)
+		snapshot->header.workers_count = workers_max;
+	uint32_t i;
+	for (i = 0; i < snapshot->header.routes_count; i++) {
+		od_shm_stats_route_t *route = &snapshot->routes[i];
+		if (route->top_count > OD_SHM_STATS_TOP_MAX * 2)
+			route->top_count = OD_SHM_STATS_TOP_MAX * 2;
+		if (route->history_count > OD_SHM_STATS_HISTORY_MAX)
+			route->history_count = OD_SHM_STATS_HISTORY_MAX;
+	}
+
+	/* per worker counters */
+	for (i = 0; i < snapshot->header.workers_count; i++) {
+		od_shm_stats_worker_t *slot = od_shm_stats_worker_of(shm, i);
+		for (retry = 0; retry < SHMSTAT_RETRY_MAX; retry++) {
+			uint64_t seq = od_shm_stats_read_begin(&slot->seq);
+			memcpy(&snapshot->workers[i], slot, sizeof(*slot));
+			if (!od_shm_stats_read_retry(&slot->seq, seq))
+				break;
+		}
+		if (retry == SHMSTAT_RETRY_MAX)
+			return -1;
+	}
+	return 0;
+}
+
+static inline const char *
+shmstat_top_type(od_shm_stats_top_t *top)
+{
+	if (top->type == OD_SHM_STATS_TOP_ADDR)
+		return "addr";
+	return "application_name";
+}
+
+static void
+shmstat_print_table(shmstat_snapshot_t *snapshot)
+{
+	od_shm_stats_header_t *header = &snapshot->header;
+	od_shm_stats_global_t *global = &header->global;
+
+	uint64_t now_us = (uint64_t)time(NULL) * 1000000;
+	uint64_t age    = 0;
+	if (header->update_time_us && now_us > header->update_time_us)
+		age = (now_us - header->update_time_us) / 1000000;
+
+	printf("pid %" PRId64 ", stats interval %" PRIu32
+	       " sec, updated %" PRIu64 " sec ago\n",
+	       header->pid,
+	       header->stats_interval,
+	       age);
+	printf("clients %" PRIu64 ", routes %" PRIu64 ", startup errors %" PRIu64
+	       "\n",
+	       global->clients,
+	       global->routes,
+	       global->startup_errors);
+	printf("system worker: msg (%" PRIu64 " allocated, %" PRIu64
+	       " cached, %" PRIu64 " freed, %" PRIu64 " cache_size), "
+	       "coroutines (%" PRIu64 " active, %" PRIu64 " cached)\n",
+	       global->msg_allocated,
+	       global->msg_cache_count,
+	       global->msg_cache_gc_count,
+	       global->msg_cache_size,
+	       global->count_coroutine,
+	       global->count_coroutine_cache);
+
+	uint32_t i;
+	for (i = 0; i < header->workers_count; i++) {
+		od_shm_stats_worker_t *worker = &snapshot->workers[i];
+		printf("worker[%" PRIu32 "]: msg (%" PRIu64 " allocated, %" PRIu64
+		       " cached, %" PRIu64 " freed, %" PRIu64 " cache_size), "
+		       "coroutines (%" PRIu64 " active, %" PRIu64
+		       " cached), clients_processed: %" PRIu64 "\n",
+		       i,
+		       worker->msg_allocated,
+		       worker->msg_cache_count,
+		       worker->msg_cache_gc_count,
+		       worker->msg_cache_size,
+		       worker->count_coroutine,
+		       worker->count_coroutine_cache,
+		       worker->clients_processed);
+	}
+
+	printf("\n%-20s %-20s %8s %8s %8s %10s %10s %10s %10s %12s %12s\n",
+	       "database",
+	       "user",
+	       "clients",
+	       "active",
+	       "idle",
+	       "tps",
+	       "tx_usec",
+	       "qps",
+	       "query_usec",
+	       "in_bytes/s",
+	       "out_bytes/s");
+	for (i = 0; i < header->routes_count; i++) {
+		od_shm_stats_route_t *route = &snapshot->routes[i];
+		printf("%-20s %-20s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %10" PRIu64
+		       " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %12" PRIu64
+		       " %12" PRIu64 "%s\n",
+		       route->database,
+		       route->user,
+		       route->client_pool_total,
+		       route->server_pool_active,
+		       route->server_pool_idle,
+		       route->avg_count_tx,
+		       route->avg_tx_time,
+		       route->avg_count_query,
+		       route->avg_query_time,
+		       route->avg_recv_client,
+		       route->avg_recv_server,
+		       route->obsolete ? " (obsolete)" : "");
+	}
+	if (global->routes > header->routes_count)
+		printf("(%" PRIu64 " routes are not shown, "
+		       "increase stats_shm_routes_max)\n",
+		       global->routes - header->routes_count);
+
+	/* top clients */
+	int top_header = 0;
+	for (i = 0; i < header->routes_count; i++) {
+		od_shm_stats_route_t *route = &snapshot->routes[i];
+		uint32_t j;
+		for (j = 0; j < route->top_count; j++) {
+			od_shm_stats_top_t *top = &route->top[j];
+			if (!top_header) {
+				printf("\n%-20s %-20s %-16s %-32s %12s %12s %14s\n",
+				       "database",
+				       "user",
+				       "type",
+				       "key",
+				       "connections",
+				       "queries",
+				       "bytes");
+				top_header = 1;
+			}
+			printf("%-20s %-20s %-16s %-32s %12" PRIu64 " %12" PRIu64
+			       " %14" PRIu64 "\n",
+			       route->database,
+			       route->user,
+			       shmstat_top_type(top),
+			       top->key,
+			       top->connections,
+			       top->queries,
+			       top->bytes);
+		}
+	}
+}
+
+static void
+shmstat_print_history(shmstat_snapshot_t *snapshot)
+{
+	printf("%-20s %-20s %-19s %8s %10s %8s %10s %8s %10s %10s\n",
+	       "database",
+	       "user",
+	       "time",
+	       "tps",
+	       "tx_usec",
+	       "qps",
+	       "query_usec",
+	       "queue",
+	       "tx_p99w",
+	       "query_p99w");
+	uint32_t i;
+	for (i = 0; i < snapshot->header.routes_count; i++) {
+		od_shm_stats_route_t *route = &snapshot->routes[i];
+		uint32_t j;
+		for (j = 0; j < route->history_count; j++) {
+			char date[32];
+			time_t tm = route->history_time[j];
+			struct tm tm_utc;
+			strftime(date,
+			         sizeof(date),
+			         "%Y-%m-%d %H:%M:%S",
+			         gmtime_r(&tm, &tm_utc));
+			printf("%-20s %-20s %-19s %8" PRIu32 " %10" PRIu32 " %8" PRIu32
+			       " %10" PRIu32 " %8" PRIu32 " %10" PRIu32 " %10" PRIu32
+			       "\n",
+			       route->database,
+			       route->user,
+			       date,
+			       route->history_tps[j],
+			       route->history_tx_time[j],
+			       route->history_qps[j],
+			       route->history_query_time[j],
+			       route->history_queue[j],
+			       route->history_tx_p99[j],
+			       route->history_query_p99[j]);
+		}
+	}
+}
+
+static void
+shmstat_print_label(const char *value)
+{
+	/* escape label value according to exposition format */
+	for (; *value; value++) {
+		switch (*value) {
+			case '\\':
+				fputs("\\\\", stdout);
+				break;
+			case '"':
+				fputs("\\\"", stdout);
+				break;
+			case '\n':
+				fputs("\\n", stdout);
+				break;
+			default:
+				putchar(*value);
+				break;
+		}
+	}
+}
+
+static void
+shmstat_print_route_metric(shmstat_snapshot_t *snapshot,
+                           const char *name,
+                           const char *type,
+                           const char *help,
+                           size_t offset,
+                           int is_u32)
+{
+	printf("# TYPE odyssey_route_%s %s\n", name, type);
+	printf("# HELP odyssey_route_%s %s\n", name, help);
+	uint32_t i;
+	for (i = 0; i < snapshot->header.routes_count; i++) {
+		od_shm_stats_route_t *route = &snapshot->routes[i];
+		uint64_t value;
+		if (is_u32)
+			value = *(uint32_t *)((char *)route + offset);
+		else
+			value = *(uint64_t *)((char *)route + offset);
+		printf("odyssey_route_%s%s{database=\"",
+		       name,
+		       strcmp(type, "counter") == 0 ? "_total" : "");
+		shmstat_print_label(route->database);
+		printf("\",user=\"");
+		shmstat_print_label(route->user);
+		printf("\"} %" PRIu64 "\n", value);
+	}
+}
+
+static void
+shmstat_print_top_metric(shmstat_snapshot_t *snapshot,
+                         const char *name,
+                         const char *help,
+                         size_t offset)
+{
+	printf("# TYPE odyssey_route_top_client_%s counter\n", name);
+	printf("# HELP odyssey_route_top_client_%s %s\n", name, help);
+	uint32_t i;
+	for (i = 0; i < snapshot->header.routes_count; i++) {
+		od_shm_stats_route_t *route = &snapshot->routes[i];
+		uint32_t j;
+		for (j = 0; j < route->top_count; j++) {
+			od_shm_stats_top_t *top = &route->top[j];
+			printf("odyssey_route_top_client_%s_total{database=\"", name);
+			shmstat_print_label(route->database);
+			printf("\",user=\"");
+			shmstat_print_label(route->user);
+			printf("\",type=\"%s\",key=\"", shmstat_top_type(top));
+			shmstat_print_label(top->key);
+			printf("\"} %" PRIu64 "\n", *(uint64_t *)((char *)top + offset));
+		}
+	}
+}
+
+static void
+shmstat_print_worker_metric(shmstat_snapshot_t *snapshot,
+                            const char *name,
+                            const char *type,
+                            const char *help,
+                            size_t offset)
+{
+	printf("# TYPE odyssey_worker_%s %s\n", name, type);
+	printf("# HELP odyssey_worker_%s %s\n", name, help);
+	uint32_t i;
+	for (i = 0; i < snapshot->header.workers_count; i++) {
+		od_shm_stats_worker_t *worker = &snapshot->workers[i];
+		printf("odyssey_worker_%s%s{worker=\"%" PRIu32 "\"} %" PRIu64 "\n",
+		       name,
+		       strcmp(type, "counter") == 0 ? "_total" : "",
+		       i,
+		       *(uint64_t *)((char *)worker + offset));
+	}
+}
+
+static void
+shmstat_print_openmetrics(shmstat_snapshot_t *snapshot)
+{
+	od_shm_stats_global_t *global = &snapshot->header.global;
+
+	printf("# TYPE odyssey_clients gauge\n"
+	       "odyssey_clients %" PRIu64 "\n",
+	       global->clients);
+	printf("# TYPE odyssey_routes gauge\n"
+	       "odyssey_routes %" PRIu64 "\n",
+	       global->routes);
+	printf("# TYPE odyssey_startup_errors counter\n"
+	       "odyssey_startup_errors_total %" PRIu64 "\n",
+	       global->startup_errors);
+	printf("# TYPE odyssey_msg_allocated gauge\n"
+	       "odyssey_msg_allocated %" PRIu64 "\n",
+	       global->msg_allocated);
+	printf("# TYPE odyssey_coroutines gauge\n"
+	       "odyssey_coroutines %" PRIu64 "\n",
+	       global->count_coroutine);
+	printf("# TYPE odyssey_last_update_seconds gauge\n"
+	       "odyssey_last_update_seconds %" PRIu64 ".%06" PRIu64 "\n",
+	       snapshot->header.update_time_us / 1000000,
+	       snapshot->header.update_time_us % 1000000);
+
+	shmstat_print_worker_metric(
+	  snapshot,
+	  "clients_processed",
+	  "counter",
+	  "Clients accepted by worker",
+	  offsetof(od_shm_stats_worker_t, clients_processed));
+	shmstat_print_worker_metric(snapshot,
+	                            "coroutines",
+	                            "gauge",
+	                            "Active coroutines",
+	                            offsetof(od_shm_stats_worker_t, count_coroutine));
+	shmstat_print_worker_metric(snapshot,
+	                            "msg_allocated",
+	                            "gauge",
+	                            "Allocated messages",
+	                            offsetof(od_shm_stats_worker_t, msg_allocated));
+
+	shmstat_print_route_metric(snapshot,
+	                           "clients",
+	                           "gauge",
+	                           "Clients attached to route",
+	                           offsetof(od_shm_stats_route_t, client_pool_total),
+	                           1);
+	shmstat_print_route_metric(
+	  snapshot,
+	  "servers_active",
+	  "gauge",
+	  "Active server connections",
+	  offsetof(od_shm_stats_route_t, server_pool_active),
+	  1);
+	shmstat_print_route_metric(snapshot,
+	                           "servers_idle",
+	                           "gauge",
+	                           "Idle server connections",
+	                           offsetof(od_shm_stats_route_t, server_pool_idle),
+	                           1);
+	shmstat_print_route_metric(snapshot,
+	                           "queries",
+	                           "counter",
+	                           "Queries processed",
+	                           offsetof(od_shm_stats_route_t, count_query),
+	                           0);
+	shmstat_print_route_metric(snapshot,
+	                           "transactions",
+	                           "counter",
+	                           "Transactions processed",
+	                           offsetof(od_shm_stats_route_t, count_tx),
+	                           0);
+	shmstat_print_route_metric(snapshot,
+	                           "query_time_us",
+	                           "counter",
+	                           "Total query time in microseconds",
+	                           offsetof(od_shm_stats_route_t, query_time),
+	                           0);
+	shmstat_print_route_metric(snapshot,
+	                           "transaction_time_us",
+	                           "counter",
+	                           "Total transaction time in microseconds",
+	                           offsetof(od_shm_stats_route_t, tx_time),
+	                           0);
+	shmstat_print_route_metric(snapshot,
+	                           "recv_client_bytes",
+	                           "counter",
+	                           "Bytes received from clients",
+	                           offsetof(od_shm_stats_route_t, recv_client),
+	                           0);
+	shmstat_print_route_metric(snapshot,
+	                           "recv_server_bytes",
+	                           "counter",
+	                           "Bytes received from servers",
+	                           offsetof(od_shm_stats_route_t, recv_server),
+	                           0);
+	shmstat_print_top_metric(snapshot,
+	                         "connections",
+	                         "Estimated connections of top client",
+	                         offsetof(od_shm_stats_top_t, connections));
+	shmstat_print_top_metric(snapshot,
+	                         "queries",
+	                         "Estimated queries of top client",
+	                         offsetof(od_shm_stats_top_t, queries));
+	shmstat_print_top_metric(snapshot,
+	                         "bytes",
+	                         "Estimated bytes received from top client",
+	                         offsetof(od_shm_stats_top_t, bytes));
+	printf("# EOF\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	int openmetrics = 0;
+	int history     = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "mH")) != -1) {
+		switch (opt) {
+			case 'm':
+				openmetrics = 1;
+				break;
+			case 'H':
+				history = 1;
+				break;
+			default:
+				printf("usage: %s [-m | -H] <stats_shm_path>\n", argv[0]);
+				return 1;
+		}
+	}
+	if (optind >= argc) {
+		printf("usage: %s [-m | -H] <stats_shm_path>\n", argv[0]);
+		return 1;
+	}
+	char *path = argv[optind];
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		fprintf(stderr, "failed to open '%s': %s\n", path, strerror(errno));
+		return 1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == -1 ||
+	    st.st_size < (off_t)sizeof(od_shm_stats_header_t)) {
+		fprintf(stderr, "'%s' is not a stats segment\n", path);
+		return 1;
+	}
+	od_shm_stats_header_t *shm;
+	shm = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		fprintf(stderr, "failed to map '%s': %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	if (shm->magic != OD_SHM_STATS_MAGIC) {
+		fprintf(stderr, "'%s' is not a stats segment\n", path);
+		return 1;
+	}
+	if (shm->version != OD_SHM_STATS_VERSION) {
+		fprintf(stderr,
+		        "unsupported stats segment version %" PRIu32 "\n",
+		        shm->version);
+		return 1;
+	}
+	if (shm->stopped) {
+		fprintf(stderr,
+		        "odyssey process %" PRId64 " owning '%s' is stopped\n",
+		        shm->pid,
+		        path);
+		return 1;
+	}
+	if (shm->size != (uint64_t)st.st_size ||
+	    od_shm_stats_size(shm->workers_max, shm->routes_max) != shm->size) {
+		fprintf(stderr, "stats segment size mismatch\n");
+		return 1;
+	}
+
+	shmstat_snapshot_t snapshot;
+	if (shmstat_snapshot(shm, &snapshot) == -1) {
+		fprintf(stderr, "failed to read consistent stats snapshot\n");
+		return 1;
+	}
+	munmap(shm, st.st_size);
+
+	if (openmetrics)
+		shmstat_print_openmetrics(&snapshot);
+	else if (history)
+		shmstat_print_history(&snapshot);
+	else
+		shmstat_print_table(&snapshot);
+
+	free(snapshot.workers);
+	free(snapshot.routes);
+	return 0;
+}
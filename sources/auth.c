@@ -87,7 +87,7 @@ od_auth_frontend_cleartext(od_client_t *client)
 		                      client_token.password);
 
 		rc = od_pam_auth(client->rule->auth_pam_service,
-		                 client->startup.user.value,
+		                 client->cold->startup.user.value,
 		                 client->rule->auth_pam_data,
 		                 client->io.io);
 		kiwi_password_free(&client_token);
@@ -107,7 +107,7 @@ od_auth_frontend_cleartext(od_client_t *client)
 		rc = od_auth_query(client->global,
 		                   client->rule,
 		                   peer,
-		                   &client->startup.user,
+		                   &client->cold->startup.user,
 		                   &client_password);
 		if (rc == -1) {
 			od_error(&instance->logger,
@@ -130,8 +130,8 @@ od_auth_frontend_cleartext(od_client_t *client)
 			       client,
 			       NULL,
 			       "user '%s.%s' incorrect user from %s",
-			       client->startup.database.value,
-			       client->startup.user.value,
+			       client->cold->startup.database.value,
+			       client->cold->startup.user.value,
 			       peer);
 			od_frontend_error(client, KIWI_INVALID_PASSWORD, "incorrect user");
 			kiwi_password_free(&client_token);
@@ -160,8 +160,8 @@ auth_failed:
 	       client,
 	       NULL,
 	       "user '%s.%s' incorrect password",
-	       client->startup.database.value,
-	       client->startup.user.value);
+	       client->cold->startup.database.value,
+	       client->cold->startup.user.value);
 	od_frontend_error(client, KIWI_INVALID_PASSWORD, "incorrect password");
 	return -1;
 }
@@ -244,7 +244,7 @@ od_auth_frontend_md5(od_client_t *client)
 		rc = od_auth_query(client->global,
 		                   client->rule,
 		                   peer,
-		                   &client->startup.user,
+		                   &client->cold->startup.user,
 		                   &query_password);
 		if (rc == -1) {
 			od_error(&instance->logger,
@@ -267,8 +267,8 @@ od_auth_frontend_md5(od_client_t *client)
 			       client,
 			       NULL,
 			       "user '%s.%s' incorrect user from %s",
-			       client->startup.database.value,
-			       client->startup.user.value,
+			       client->cold->startup.database.value,
+			       client->cold->startup.user.value,
 			       peer);
 			od_frontend_error(client, KIWI_INVALID_PASSWORD, "incorrect user");
 			kiwi_password_free(&client_token);
@@ -283,8 +283,8 @@ od_auth_frontend_md5(od_client_t *client)
 
 	/* prepare password hash */
 	rc = kiwi_password_md5(&client_password,
-	                       client->startup.user.value,
-	                       client->startup.user.value_len - 1,
+	                       client->cold->startup.user.value,
+	                       client->cold->startup.user.value_len - 1,
 	                       query_password.password,
 	                       query_password.password_len,
 	                       (char *)&salt);
@@ -313,8 +313,8 @@ od_auth_frontend_md5(od_client_t *client)
 		       client,
 		       NULL,
 		       "user '%s.%s' incorrect password",
-		       client->startup.database.value,
-		       client->startup.user.value);
+		       client->cold->startup.database.value,
+		       client->cold->startup.user.value);
 		od_frontend_error(client, KIWI_INVALID_PASSWORD, "incorrect password");
 		return -1;
 	}
@@ -409,7 +409,7 @@ od_auth_frontend_scram_sha_256(od_client_t *client)
 		rc = od_auth_query(client->global,
 		                   client->rule,
 		                   peer,
-		                   &client->startup.user,
+		                   &client->cold->startup.user,
 		                   &query_password);
 		if (rc == -1) {
 			od_error(&instance->logger,
@@ -431,8 +431,8 @@ od_auth_frontend_scram_sha_256(od_client_t *client)
 			       client,
 			       NULL,
 			       "user '%s.%s' incorrect user from %s",
-			       client->startup.database.value,
-			       client->startup.user.value,
+			       client->cold->startup.database.value,
+			       client->cold->startup.user.value,
 			       peer);
 			od_frontend_error(client, KIWI_INVALID_PASSWORD, "incorrect user");
 			machine_msg_free(msg);
@@ -485,10 +485,14 @@ od_auth_frontend_scram_sha_256(od_client_t *client)
 			return -1;
 	}
 
+	/* plain password salt depends on the route */
+	od_route_t *route = client->route;
 	rc = od_scram_parse_verifier(&scram_state, query_password.password);
 	if (rc == -1)
 		rc = od_scram_init_from_plain_password(&scram_state,
-		                                       query_password.password);
+		                                       query_password.password,
+		                                       route->id.user,
+		                                       route->id.database);
 
 	if (rc == -1) {
 		od_frontend_error(
@@ -634,7 +638,7 @@ static inline int
 od_auth_frontend_cert(od_client_t *client)
 {
 	od_instance_t *instance = client->global->instance;
-	if (!client->startup.is_ssl_request) {
+	if (!client->cold->startup.is_ssl_request) {
 		od_error(
 		  &instance->logger, "auth", client, NULL, "TLS connection required");
 		od_frontend_error(client,
@@ -683,8 +687,8 @@ od_auth_frontend_block(od_client_t *client)
 	       client,
 	       NULL,
 	       "user '%s.%s' is blocked",
-	       client->startup.database.value,
-	       client->startup.user.value);
+	       client->cold->startup.database.value,
+	       client->cold->startup.user.value);
 	od_frontend_error(client,
 	                  KIWI_INVALID_AUTHORIZATION_SPECIFICATION,
 	                  "user blocked%s%s",
@@ -889,7 +893,7 @@ od_auth_backend_sasl(od_server_t *server)
 
 	assert(route != NULL);
 
-	if (server->scram_state.client_nonce != NULL) {
+	if (server->cold->scram_state.client_nonce != NULL) {
 		od_error(&instance->logger,
 		         "auth",
 		         NULL,
@@ -916,7 +920,7 @@ od_auth_backend_sasl(od_server_t *server)
 
 	/* SASLInitialResponse Message */
 	machine_msg_t *msg =
-	  od_scram_create_client_first_message(&server->scram_state);
+	  od_scram_create_client_first_message(&server->cold->scram_state);
 	if (msg == NULL) {
 		od_error(
 		  &instance->logger, "auth", NULL, server, "memory allocation error");
@@ -949,7 +953,7 @@ od_auth_backend_sasl_continue(od_server_t *server,
 
 	assert(route != NULL);
 
-	if (server->scram_state.client_nonce == NULL) {
+	if (server->cold->scram_state.client_nonce == NULL) {
 		od_error(&instance->logger,
 		         "auth",
 		         NULL,
@@ -959,7 +963,7 @@ od_auth_backend_sasl_continue(od_server_t *server,
 		return -1;
 	}
 
-	if (server->scram_state.server_first_message != NULL) {
+	if (server->cold->scram_state.server_first_message != NULL) {
 		od_error(&instance->logger,
 		         "auth",
 		         NULL,
@@ -994,7 +998,7 @@ od_auth_backend_sasl_continue(od_server_t *server,
 
 	/* SASLResponse Message */
 	machine_msg_t *msg = od_scram_create_client_final_message(
-	  &server->scram_state, password, auth_data, auth_data_size);
+	  &server->cold->scram_state, password, auth_data, auth_data_size);
 	if (msg == NULL) {
 		od_error(&instance->logger,
 		         "auth",
@@ -1029,7 +1033,7 @@ od_auth_backend_sasl_final(od_server_t *server,
 
 	assert(server->route);
 
-	if (server->scram_state.server_first_message == NULL) {
+	if (server->cold->scram_state.server_first_message == NULL) {
 		od_error(&instance->logger,
 		         "auth",
 		         NULL,
@@ -1043,7 +1047,7 @@ od_auth_backend_sasl_final(od_server_t *server,
 	  &instance->logger, "auth", NULL, server, "finishing SASL authentication");
 
 	int rc = od_scram_verify_server_signature(
-	  &server->scram_state, auth_data, auth_data_size);
+	  &server->cold->scram_state, auth_data, auth_data_size);
 	if (rc == -1) {
 		od_error(&instance->logger,
 		         "auth",
@@ -1054,24 +1058,24 @@ od_auth_backend_sasl_final(od_server_t *server,
 		return -1;
 	}
 
-	od_scram_state_free(&server->scram_state);
+	od_scram_state_free(&server->cold->scram_state);
 
 	return 0;
 }
 
 int
-od_auth_backend(od_server_t *server, machine_msg_t *msg)
+od_auth_backend(od_server_t *server, char *data, uint32_t size)
 {
 	od_instance_t *instance = server->global->instance;
-	assert(*(char *)machine_msg_data(msg) == KIWI_BE_AUTHENTICATION);
+	assert(*data == KIWI_BE_AUTHENTICATION);
 
 	uint32_t auth_type;
 	char salt[4];
 	char *auth_data       = NULL;
 	size_t auth_data_size = 0;
 	int rc;
-	rc = kiwi_fe_read_auth(machine_msg_data(msg),
-	                       machine_msg_size(msg),
+	rc = kiwi_fe_read_auth(data,
+	                       size,
 	                       &auth_type,
 	                       salt,
 	                       &auth_data,
@@ -1084,7 +1088,6 @@ od_auth_backend(od_server_t *server, machine_msg_t *msg)
 		         "failed to parse authentication message");
 		return -1;
 	}
-	msg = NULL;
 
 	switch (auth_type) {
 		/* AuthenticationOk */
@@ -1125,8 +1128,9 @@ od_auth_backend(od_server_t *server, machine_msg_t *msg)
 
 	/* wait for authentication response */
 	while (1) {
-		msg = od_read(&server->io, UINT32_MAX);
-		if (msg == NULL) {
+		od_packet_t packet;
+		rc = od_read_packet(&server->io, &packet, UINT32_MAX);
+		if (rc == -1) {
 			od_error(&instance->logger,
 			         "auth",
 			         NULL,
@@ -1135,7 +1139,7 @@ od_auth_backend(od_server_t *server, machine_msg_t *msg)
 			         od_io_error(&server->io));
 			return -1;
 		}
-		kiwi_be_type_t type = *(char *)machine_msg_data(msg);
+		kiwi_be_type_t type = *packet.data;
 		od_debug(&instance->logger,
 		         "auth",
 		         NULL,
@@ -1143,16 +1147,11 @@ od_auth_backend(od_server_t *server, machine_msg_t *msg)
 		         "%s",
 		         kiwi_be_type_to_string(type));
 
-		int rc;
 		switch (type) {
 			case KIWI_BE_AUTHENTICATION:
-				rc = kiwi_fe_read_auth(machine_msg_data(msg),
-				                       machine_msg_size(msg),
-				                       &auth_type,
-				                       salt,
-				                       NULL,
-				                       NULL);
-				machine_msg_free(msg);
+				rc = kiwi_fe_read_auth(
+				  packet.data, packet.size, &auth_type, salt, NULL, NULL);
+				od_packet_free(&packet);
 				if (rc == -1) {
 					od_error(&instance->logger,
 					         "auth",
@@ -1171,12 +1170,12 @@ od_auth_backend(od_server_t *server, machine_msg_t *msg)
 				}
 				return 0;
 			case KIWI_BE_ERROR_RESPONSE:
-				od_backend_error(
-				  server, "auth", machine_msg_data(msg), machine_msg_size(msg));
-				server->error_connect = msg;
+				od_backend_error(server, "auth", packet.data, packet.size);
+				server->error_connect = od_packet_copy(&packet);
+				od_packet_free(&packet);
 				return -1;
 			default:
-				machine_msg_free(msg);
+				od_packet_free(&packet);
 				break;
 		}
 	}
@@ -10,6 +10,6 @@
 int
 od_auth_frontend(od_client_t *);
 int
-od_auth_backend(od_server_t *, machine_msg_t *);
+od_auth_backend(od_server_t *, char *, uint32_t);
 
 #endif /* ODYSSEY_AUTH_H */
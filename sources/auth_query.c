@@ -50,9 +50,10 @@ od_auth_query_do(od_server_t *server,
 
 	/* wait for response */
 	int has_result = 0;
+	od_packet_t packet;
 	while (1) {
-		msg = od_read(&server->io, UINT32_MAX);
-		if (msg == NULL) {
+		rc = od_read_packet(&server->io, &packet, UINT32_MAX);
+		if (rc == -1) {
 			if (!machine_timedout()) {
 				od_error(&instance->logger,
 				         "auth_query",
@@ -63,8 +64,7 @@ od_auth_query_do(od_server_t *server,
 			}
 			return -1;
 		}
-		kiwi_be_type_t type;
-		type = *(char *)machine_msg_data(msg);
+		kiwi_be_type_t type = *packet.data;
 
 		od_debug(&instance->logger,
 		         "auth_query",
@@ -75,18 +75,16 @@ od_auth_query_do(od_server_t *server,
 
 		switch (type) {
 			case KIWI_BE_ERROR_RESPONSE:
-				od_backend_error(server,
-				                 "auth_query",
-				                 machine_msg_data(msg),
-				                 machine_msg_size(msg));
+				od_backend_error(
+				  server, "auth_query", packet.data, packet.size);
 				goto error;
 			case KIWI_BE_ROW_DESCRIPTION:
 				break;
 			case KIWI_BE_DATA_ROW: {
 				if (has_result)
 					goto error;
-				char *pos         = (char *)machine_msg_data(msg) + 1;
-				uint32_t pos_size = machine_msg_size(msg) - 1;
+				char *pos         = packet.data + 1;
+				uint32_t pos_size = packet.size - 1;
 
 				/* size */
 				uint32_t size;
@@ -134,21 +132,19 @@ od_auth_query_do(od_server_t *server,
 				break;
 			}
 			case KIWI_BE_READY_FOR_QUERY:
-				od_backend_ready(
-				  server, machine_msg_data(msg), machine_msg_size(msg));
-
-				machine_msg_free(msg);
+				od_backend_ready(server, packet.data, packet.size);
+				od_packet_free(&packet);
 				return 0;
 			default:
 				break;
 		}
 
-		machine_msg_free(msg);
+		od_packet_free(&packet);
 	}
 	return 0;
 
 error:
-	machine_msg_free(msg);
+	od_packet_free(&packet);
 	return -1;
 }
 
@@ -221,12 +217,12 @@ od_auth_query(od_global_t *global,
 	od_id_generate(&auth_client->id, "a");
 
 	/* set auth query route user and database */
-	kiwi_var_set(&auth_client->startup.user,
+	kiwi_var_set(&auth_client->cold->startup.user,
 	             KIWI_VAR_UNDEF,
 	             rule->auth_query_user,
 	             strlen(rule->auth_query_user) + 1);
 
-	kiwi_var_set(&auth_client->startup.database,
+	kiwi_var_set(&auth_client->cold->startup.database,
 	             KIWI_VAR_UNDEF,
 	             rule->auth_query_db,
 	             strlen(rule->auth_query_db) + 1);
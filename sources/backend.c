@@ -13,7 +13,9 @@
 #include <ctype.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <errno.h>
 #include <arpa/inet.h>
+#include <sys/socket.h>
 
 #include <machinarium.h>
 #include <kiwi.h>
@@ -167,8 +169,9 @@ od_backend_startup(od_server_t *server, kiwi_params_t *route_params)
 	od_server_sync_request(server, 1);
 
 	while (1) {
-		msg = od_read(&server->io, UINT32_MAX);
-		if (msg == NULL) {
+		od_packet_t packet;
+		rc = od_read_packet(&server->io, &packet, UINT32_MAX);
+		if (rc == -1) {
 			od_error(&instance->logger,
 			         "startup",
 			         NULL,
@@ -177,7 +180,7 @@ od_backend_startup(od_server_t *server, kiwi_params_t *route_params)
 			         od_io_error(&server->io));
 			return -1;
 		}
-		kiwi_be_type_t type = *(char *)machine_msg_data(msg);
+		kiwi_be_type_t type = *packet.data;
 		od_debug(&instance->logger,
 		         "startup",
 		         NULL,
@@ -187,20 +190,18 @@ od_backend_startup(od_server_t *server, kiwi_params_t *route_params)
 
 		switch (type) {
 			case KIWI_BE_READY_FOR_QUERY:
-				od_backend_ready(
-				  server, machine_msg_data(msg), machine_msg_size(msg));
-				machine_msg_free(msg);
+				od_backend_ready(server, packet.data, packet.size);
+				od_packet_free(&packet);
 				return 0;
 			case KIWI_BE_AUTHENTICATION:
-				rc = od_auth_backend(server, msg);
-				machine_msg_free(msg);
+				rc = od_auth_backend(server, packet.data, packet.size);
+				od_packet_free(&packet);
 				if (rc == -1)
 					return -1;
 				break;
 			case KIWI_BE_BACKEND_KEY_DATA:
-				rc = kiwi_fe_read_key(
-				  machine_msg_data(msg), machine_msg_size(msg), &server->key);
-				machine_msg_free(msg);
+				rc = kiwi_fe_read_key(packet.data, packet.size, &server->key);
+				od_packet_free(&packet);
 				if (rc == -1) {
 					od_error(&instance->logger,
 					         "startup",
@@ -215,14 +216,14 @@ od_backend_startup(od_server_t *server, kiwi_params_t *route_params)
 				uint32_t name_len;
 				char *value;
 				uint32_t value_len;
-				rc = kiwi_fe_read_parameter(machine_msg_data(msg),
-				                            machine_msg_size(msg),
+				rc = kiwi_fe_read_parameter(packet.data,
+				                            packet.size,
 				                            &name,
 				                            &name_len,
 				                            &value,
 				                            &value_len);
 				if (rc == -1) {
-					machine_msg_free(msg);
+					od_packet_free(&packet);
 					od_error(&instance->logger,
 					         "startup",
 					         NULL,
@@ -233,7 +234,7 @@ od_backend_startup(od_server_t *server, kiwi_params_t *route_params)
 
 				/* set server parameters */
 				kiwi_vars_update(
-				  &server->vars, name, name_len, value, value_len);
+				  &server->cold->vars, name, name_len, value, value_len);
 
 				if (route_params) {
 					kiwi_param_t *param;
@@ -243,21 +244,20 @@ od_backend_startup(od_server_t *server, kiwi_params_t *route_params)
 						kiwi_params_add(route_params, param);
 				}
 
-				machine_msg_free(msg);
+				od_packet_free(&packet);
 				break;
 			}
 			case KIWI_BE_NOTICE_RESPONSE:
-				machine_msg_free(msg);
+				od_packet_free(&packet);
 				break;
 			case KIWI_BE_ERROR_RESPONSE:
-				od_backend_error(server,
-				                 "startup",
-				                 machine_msg_data(msg),
-				                 machine_msg_size(msg));
-				server->error_connect = msg;
+				od_backend_error(server, "startup", packet.data, packet.size);
+				/* error is forwarded to client later */
+				server->error_connect = od_packet_copy(&packet);
+				od_packet_free(&packet);
 				return -1;
 			default:
-				machine_msg_free(msg);
+				od_packet_free(&packet);
 				od_debug(&instance->logger,
 				         "startup",
 				         NULL,
@@ -273,7 +273,9 @@ od_backend_startup(od_server_t *server, kiwi_params_t *route_params)
 static inline int
 od_backend_connect_to(od_server_t *server,
                       char *context,
-                      od_rule_storage_t *storage)
+                      od_rule_storage_t *storage,
+                      char *host,
+                      int port)
 {
 	od_instance_t *instance = server->global->instance;
 	assert(server->io.io == NULL);
@@ -321,40 +323,39 @@ od_backend_connect_to(od_server_t *server,
 	struct addrinfo *ai = NULL;
 
 	/* resolve server address */
-	if (storage->host) {
+	if (host) {
 		/* assume IPv6 or IPv4 is specified */
 		int rc_resolve = -1;
-		if (strchr(storage->host, ':')) {
+		if (strchr(host, ':')) {
 			/* v6 */
 			memset(&saddr_v6, 0, sizeof(saddr_v6));
 			saddr_v6.sin6_family = AF_INET6;
-			saddr_v6.sin6_port   = htons(storage->port);
-			rc_resolve =
-			  inet_pton(AF_INET6, storage->host, &saddr_v6.sin6_addr);
-			saddr = (struct sockaddr *)&saddr_v6;
+			saddr_v6.sin6_port   = htons(port);
+			rc_resolve = inet_pton(AF_INET6, host, &saddr_v6.sin6_addr);
+			saddr      = (struct sockaddr *)&saddr_v6;
 		} else {
 			/* v4 or hostname */
 			memset(&saddr_v4, 0, sizeof(saddr_v4));
 			saddr_v4.sin_family = AF_INET;
-			saddr_v4.sin_port   = htons(storage->port);
-			rc_resolve = inet_pton(AF_INET, storage->host, &saddr_v4.sin_addr);
+			saddr_v4.sin_port   = htons(port);
+			rc_resolve = inet_pton(AF_INET, host, &saddr_v4.sin_addr);
 			saddr      = (struct sockaddr *)&saddr_v4;
 		}
 
 		/* schedule getaddrinfo() execution */
 		if (rc_resolve != 1) {
-			char port[16];
-			od_snprintf(port, sizeof(port), "%d", storage->port);
+			char service[16];
+			od_snprintf(service, sizeof(service), "%d", port);
 
-			rc = machine_getaddrinfo(storage->host, port, NULL, &ai, 0);
+			rc = machine_getaddrinfo(host, service, NULL, &ai, 0);
 			if (rc != 0) {
 				od_error(&instance->logger,
 				         context,
 				         NULL,
 				         server,
 				         "failed to resolve %s:%d",
-				         storage->host,
-				         storage->port);
+				         host,
+				         port);
 				return -1;
 			}
 			assert(ai != NULL);
@@ -369,7 +370,7 @@ od_backend_connect_to(od_server_t *server,
 		            sizeof(saddr_un.sun_path),
 		            "%s/.s.PGSQL.%d",
 		            instance->config.unix_socket_dir,
-		            storage->port);
+		            port);
 	}
 
 	if (instance->config.locks_dir) {
@@ -384,14 +385,14 @@ od_backend_connect_to(od_server_t *server,
 	if (ai)
 		freeaddrinfo(ai);
 	if (rc == -1) {
-		if (storage->host) {
+		if (host) {
 			od_error(&instance->logger,
 			         context,
 			         server->client,
 			         server,
 			         "failed to connect to %s:%d",
-			         storage->host,
-			         storage->port);
+			         host,
+			         port);
 		} else {
 			od_error(&instance->logger,
 			         context,
@@ -416,15 +417,15 @@ od_backend_connect_to(od_server_t *server,
 
 	/* log server connection */
 	if (instance->config.log_session) {
-		if (storage->host) {
+		if (host) {
 			od_log(&instance->logger,
 			       context,
 			       server->client,
 			       server,
 			       "new server connection %s:%d (connect time: %d usec, "
 			       "resolve time: %d usec)",
-			       storage->host,
-			       storage->port,
+			       host,
+			       port,
 			       (int)time_connect,
 			       (int)time_resolve);
 		} else {
@@ -451,17 +452,34 @@ od_backend_connect(od_server_t *server,
 	od_route_t *route = server->route;
 	assert(route != NULL);
 
-	od_rule_storage_t *storage;
-	storage = route->rule->storage;
-
-	/* connect to server */
+	/* storage can be retargeted by console, epoch is taken before the
+	 * host, so a server is never marked newer than its host */
+	uint32_t epoch = 0;
+	if (route->wait_queue)
+		epoch = od_wait_queue_epoch(route->wait_queue);
+	char *host;
+	int port;
 	int rc;
-	rc = od_backend_connect_to(server, context, storage);
+	rc = od_rules_storage_target(route->storage, &host, &port);
 	if (rc == -1)
 		return -1;
+	server->storage_epoch = epoch;
+
+	od_probe3(
+	  backend__connect__start, server->id.id, route->id.database, route->id.user);
+
+	/* connect to server */
+	rc = od_backend_connect_to(server, context, route->storage, host, port);
+	if (host)
+		free(host);
+	if (rc == -1) {
+		od_probe2(backend__connect__end, server->id.id, rc);
+		return -1;
+	}
 
 	/* send startup and do initial configuration */
 	rc = od_backend_startup(server, route_params);
+	od_probe2(backend__connect__end, server->id.id, rc);
 	return rc;
 }
 
@@ -473,7 +491,8 @@ od_backend_connect_cancel(od_server_t *server,
 	od_instance_t *instance = server->global->instance;
 	/* connect to server */
 	int rc;
-	rc = od_backend_connect_to(server, "cancel", storage);
+	rc = od_backend_connect_to(
+	  server, "cancel", storage, storage->host, storage->port);
 	if (rc == -1)
 		return -1;
 	/* send cancel request */
@@ -532,10 +551,14 @@ od_backend_update_parameter(od_server_t *server,
 	         value);
 
 	if (server_only)
-		kiwi_vars_update(&server->vars, name, name_len, value, value_len);
+		kiwi_vars_update(&server->cold->vars, name, name_len, value, value_len);
 	else
-		kiwi_vars_update_both(
-		  &client->vars, &server->vars, name, name_len, value, value_len);
+		kiwi_vars_update_both(&client->cold->vars,
+		                      &server->cold->vars,
+		                      name,
+		                      name_len,
+		                      value,
+		                      value_len);
 	return 0;
 }
 
@@ -548,9 +571,10 @@ od_backend_ready_wait(od_server_t *server,
 	od_instance_t *instance = server->global->instance;
 	int ready               = 0;
 	for (;;) {
-		machine_msg_t *msg;
-		msg = od_read(&server->io, time_ms);
-		if (msg == NULL) {
+		od_packet_t packet;
+		int rc;
+		rc = od_read_packet(&server->io, &packet, time_ms);
+		if (rc == -1) {
 			if (!machine_timedout()) {
 				od_error(&instance->logger,
 				         context,
@@ -561,7 +585,7 @@ od_backend_ready_wait(od_server_t *server,
 			}
 			return -1;
 		}
-		kiwi_be_type_t type = *(char *)machine_msg_data(msg);
+		kiwi_be_type_t type = *packet.data;
 		od_debug(&instance->logger,
 		         context,
 		         server->client,
@@ -571,28 +595,25 @@ od_backend_ready_wait(od_server_t *server,
 
 		if (type == KIWI_BE_PARAMETER_STATUS) {
 			/* update server parameter */
-			int rc;
 			rc = od_backend_update_parameter(
-			  server, context, machine_msg_data(msg), machine_msg_size(msg), 1);
+			  server, context, packet.data, packet.size, 1);
 			if (rc == -1) {
-				machine_msg_free(msg);
+				od_packet_free(&packet);
 				return -1;
 			}
 		} else if (type == KIWI_BE_ERROR_RESPONSE) {
-			od_backend_error(
-			  server, context, machine_msg_data(msg), machine_msg_size(msg));
-			machine_msg_free(msg);
+			od_backend_error(server, context, packet.data, packet.size);
+			od_packet_free(&packet);
 			continue;
 		} else if (type == KIWI_BE_READY_FOR_QUERY) {
-			od_backend_ready(
-			  server, machine_msg_data(msg), machine_msg_size(msg));
+			od_backend_ready(server, packet.data, packet.size);
 			ready++;
 			if (ready == count) {
-				machine_msg_free(msg);
+				od_packet_free(&packet);
 				break;
 			}
 		}
-		machine_msg_free(msg);
+		od_packet_free(&packet);
 	}
 	return 0;
 }
@@ -628,3 +649,19 @@ od_backend_query(od_server_t *server,
 	rc = od_backend_ready_wait(server, context, 1, timeout);
 	return rc;
 }
+
+int
+od_backend_alive(od_server_t *server)
+{
+	/* idle server is not expected to send anything, pending data is
+	 * usually a termination error followed by connection close */
+	if (od_readahead_unread(&server->io.readahead) > 0)
+		return 0;
+
+	char byte;
+	ssize_t rc;
+	rc = recv(machine_fd(server->io.io), &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+	if (rc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return 1;
+	return 0;
+}
@@ -25,5 +25,7 @@ int
 od_backend_ready_wait(od_server_t *, char *, int, uint32_t);
 int
 od_backend_query(od_server_t *, char *, char *, int, uint32_t);
+int
+od_backend_alive(od_server_t *);
 
 #endif /* ODYSSEY_BACKEND_H */
@@ -12,6 +12,7 @@
 #cmakedefine OD_DEVEL_LVL @OD_DEVEL_LVL@
 
 #cmakedefine PAM_FOUND 1
+#cmakedefine HAVE_SYS_SDT_H 1
 #cmakedefine PG_VERSION_NUM @PG_VERSION_NUM @
 
 #endif /* ODYSSEY_BUILD_H */
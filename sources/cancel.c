@@ -33,11 +33,13 @@ od_cancel(od_global_t *global,
 	       server_id->id_prefix,
 	       sizeof(server_id->id),
 	       server_id->id);
+	od_probe2(cancel, server_id->id, key->key_pid);
 	od_server_t server;
 	od_server_init(&server);
 	server.global = global;
-	od_backend_connect_cancel(&server, storage, key);
+	int rc;
+	rc = od_backend_connect_cancel(&server, storage, key);
 	od_backend_close_connection(&server);
 	od_backend_close(&server);
-	return 0;
+	return rc;
 }
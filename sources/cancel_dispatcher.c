@@ -0,0 +1,307 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+void
+od_cancel_dispatcher_init(od_cancel_dispatcher_t *dispatcher)
+{
+	dispatcher->machine = -1;
+	dispatcher->channel = NULL;
+	dispatcher->global  = NULL;
+	pthread_mutex_init(&dispatcher->lock, NULL);
+	od_list_init(&dispatcher->storages);
+	od_list_init(&dispatcher->recent);
+}
+
+static inline void
+od_cancel_request_free(od_cancel_request_t *request)
+{
+	od_rules_storage_free(request->storage);
+	free(request);
+}
+
+static inline od_cancel_storage_t *
+od_cancel_dispatcher_storage(od_cancel_dispatcher_t *dispatcher, char *name)
+{
+	od_list_t *i;
+	od_list_foreach(&dispatcher->storages, i)
+	{
+		od_cancel_storage_t *state;
+		state = od_container_of(i, od_cancel_storage_t, link);
+		if (strcmp(state->name, name) == 0)
+			return state;
+	}
+
+	od_cancel_storage_t *state = calloc(1, sizeof(od_cancel_storage_t));
+	if (state == NULL)
+		return NULL;
+	state->name = strdup(name);
+	if (state->name == NULL) {
+		free(state);
+		return NULL;
+	}
+	od_list_init(&state->queue);
+	od_list_init(&state->link);
+
+	pthread_mutex_lock(&dispatcher->lock);
+	od_list_append(&dispatcher->storages, &state->link);
+	pthread_mutex_unlock(&dispatcher->lock);
+	return state;
+}
+
+static inline void
+od_cancel_dispatcher_gc(od_cancel_dispatcher_t *dispatcher, uint64_t now_us)
+{
+	od_instance_t *instance = dispatcher->global->instance;
+	uint64_t window_us      = instance->config.cancel_dedup_window * 1000ull;
+	od_list_t *i, *n;
+	od_list_foreach_safe(&dispatcher->recent, i, n)
+	{
+		od_cancel_recent_t *recent;
+		recent = od_container_of(i, od_cancel_recent_t, link);
+		if (now_us - recent->time_us < window_us)
+			break;
+		od_list_unlink(&recent->link);
+		free(recent);
+	}
+}
+
+/* returns 1 if the same cancel was sent within dedup window */
+static inline int
+od_cancel_dispatcher_dedup(od_cancel_dispatcher_t *dispatcher,
+                           od_cancel_request_t *request)
+{
+	od_instance_t *instance = dispatcher->global->instance;
+	if (instance->config.cancel_dedup_window == 0)
+		return 0;
+
+	od_list_t *i;
+	od_list_foreach(&dispatcher->recent, i)
+	{
+		od_cancel_recent_t *recent;
+		recent = od_container_of(i, od_cancel_recent_t, link);
+		if (recent->state == request->state &&
+		    kiwi_key_cmp(&recent->key, &request->key))
+			return 1;
+	}
+
+	/* recent list is ordered by time */
+	od_cancel_recent_t *recent = malloc(sizeof(od_cancel_recent_t));
+	if (recent == NULL)
+		return 0;
+	recent->state   = request->state;
+	recent->key     = request->key;
+	recent->time_us = request->time_us;
+	od_list_init(&recent->link);
+	od_list_append(&dispatcher->recent, &recent->link);
+	return 0;
+}
+
+static void
+od_cancel_dispatcher_send(void *arg)
+{
+	od_cancel_request_t *request       = arg;
+	od_cancel_dispatcher_t *dispatcher = request->dispatcher;
+	od_cancel_storage_t *state         = request->state;
+
+	for (;;) {
+		int rc;
+		rc = od_cancel(dispatcher->global,
+		               request->storage,
+		               &request->key,
+		               &request->server_id);
+		if (rc == -1) {
+			od_atomic_u64_inc(&state->count_error);
+		} else {
+			uint64_t latency_us = machine_time_us() - request->time_us;
+			od_atomic_u64_inc(&state->count_sent);
+			od_atomic_u64_add(&state->latency_us, latency_us);
+			if (latency_us > od_atomic_u64_of(&state->latency_max_us))
+				state->latency_max_us = latency_us;
+		}
+		od_cancel_request_free(request);
+
+		/* continue with the storage queue */
+		if (od_list_empty(&state->queue))
+			break;
+		od_list_t *next = od_list_pop(&state->queue);
+		od_atomic_u32_dec(&state->queued);
+		request = od_container_of(next, od_cancel_request_t, link);
+	}
+
+	od_atomic_u32_dec(&state->active);
+}
+
+static inline void
+od_cancel_dispatcher_process(od_cancel_dispatcher_t *dispatcher,
+                             od_cancel_request_t *request)
+{
+	od_instance_t *instance = dispatcher->global->instance;
+
+	od_cancel_storage_t *state;
+	state = od_cancel_dispatcher_storage(dispatcher, request->storage->name);
+	if (state == NULL) {
+		od_cancel_request_free(request);
+		return;
+	}
+	request->state = state;
+	od_atomic_u64_inc(&state->count_request);
+
+	if (od_cancel_dispatcher_dedup(dispatcher, request)) {
+		od_atomic_u64_inc(&state->count_dedup);
+		od_debug(&instance->logger,
+		         "cancel",
+		         NULL,
+		         NULL,
+		         "duplicate cancel for %s%.*s skipped",
+		         request->server_id.id_prefix,
+		         (int)sizeof(request->server_id.id),
+		         request->server_id.id);
+		od_cancel_request_free(request);
+		return;
+	}
+
+	if (od_atomic_u32_of(&state->active) >=
+	    (uint32_t)instance->config.cancel_max_connections) {
+		od_list_append(&state->queue, &request->link);
+		od_atomic_u32_inc(&state->queued);
+		return;
+	}
+
+	od_atomic_u32_inc(&state->active);
+	int64_t coroutine_id;
+	coroutine_id = machine_coroutine_create(od_cancel_dispatcher_send, request);
+	if (coroutine_id == -1) {
+		od_error(&instance->logger,
+		         "cancel",
+		         NULL,
+		         NULL,
+		         "failed to create cancel coroutine");
+		od_atomic_u32_dec(&state->active);
+		od_atomic_u64_inc(&state->count_error);
+		od_cancel_request_free(request);
+	}
+}
+
+static inline void
+od_cancel_dispatcher_main(void *arg)
+{
+	od_cancel_dispatcher_t *dispatcher = arg;
+	for (;;) {
+		machine_msg_t *msg;
+		msg = machine_channel_read(dispatcher->channel, 1000);
+		od_cancel_dispatcher_gc(dispatcher, machine_time_us());
+		if (msg == NULL)
+			continue;
+		assert(machine_msg_type(msg) == OD_MSG_CANCEL);
+		od_cancel_request_t *request;
+		request = *(od_cancel_request_t **)machine_msg_data(msg);
+		machine_msg_free(msg);
+		od_cancel_dispatcher_process(dispatcher, request);
+	}
+}
+
+int
+od_cancel_dispatcher_start(od_cancel_dispatcher_t *dispatcher,
+                           od_global_t *global)
+{
+	od_instance_t *instance = global->instance;
+	dispatcher->global      = global;
+	dispatcher->channel     = machine_channel_create(1);
+	if (dispatcher->channel == NULL) {
+		od_error(&instance->logger,
+		         "cancel",
+		         NULL,
+		         NULL,
+		         "failed to create cancel channel");
+		return -1;
+	}
+	dispatcher->machine =
+	  machine_create("cancel", od_cancel_dispatcher_main, dispatcher);
+	if (dispatcher->machine == -1) {
+		machine_channel_free(dispatcher->channel);
+		dispatcher->channel = NULL;
+		od_error(&instance->logger,
+		         "cancel",
+		         NULL,
+		         NULL,
+		         "failed to start cancel dispatcher");
+		return -1;
+	}
+	return 0;
+}
+
+int
+od_cancel_dispatch(od_cancel_dispatcher_t *dispatcher,
+                   od_rule_storage_t *storage,
+                   kiwi_key_t *key,
+                   od_id_t *server_id)
+{
+	/* dispatcher is not running, cancel in place */
+	if (dispatcher->channel == NULL)
+		return od_cancel(dispatcher->global, storage, key, server_id);
+
+	od_cancel_request_t *request = malloc(sizeof(od_cancel_request_t));
+	if (request == NULL)
+		return -1;
+	request->storage = od_rules_storage_copy(storage);
+	if (request->storage == NULL) {
+		free(request);
+		return -1;
+	}
+	request->key        = *key;
+	request->server_id  = *server_id;
+	request->time_us    = machine_time_us();
+	request->state      = NULL;
+	request->dispatcher = dispatcher;
+	od_list_init(&request->link);
+
+	machine_msg_t *msg;
+	msg = machine_msg_create(sizeof(od_cancel_request_t *));
+	if (msg == NULL) {
+		od_cancel_request_free(request);
+		return -1;
+	}
+	machine_msg_set_type(msg, OD_MSG_CANCEL);
+	memcpy(machine_msg_data(msg), &request, sizeof(od_cancel_request_t *));
+	machine_channel_write(dispatcher->channel, msg);
+	return 0;
+}
+
+int
+od_cancel_dispatcher_foreach(od_cancel_dispatcher_t *dispatcher,
+                             od_cancel_storage_cb_t callback,
+                             void **argv)
+{
+	pthread_mutex_lock(&dispatcher->lock);
+	od_list_t *i;
+	od_list_foreach(&dispatcher->storages, i)
+	{
+		od_cancel_storage_t *state;
+		state = od_container_of(i, od_cancel_storage_t, link);
+		int rc;
+		rc = callback(state, argv);
+		if (rc == -1) {
+			pthread_mutex_unlock(&dispatcher->lock);
+			return -1;
+		}
+	}
+	pthread_mutex_unlock(&dispatcher->lock);
+	return 0;
+}
@@ -0,0 +1,84 @@
+#ifndef ODYSSEY_CANCEL_DISPATCHER_H
+#define ODYSSEY_CANCEL_DISPATCHER_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Cancel requests are sent to storages by a dedicated machine.
+ *
+ * Requests are queued per storage and sent by at most
+ * cancel_max_connections coroutines per storage. Repeated requests for
+ * the same backend key within cancel_dedup_window are dropped.
+ */
+
+typedef struct od_cancel_storage od_cancel_storage_t;
+typedef struct od_cancel_request od_cancel_request_t;
+typedef struct od_cancel_recent od_cancel_recent_t;
+typedef struct od_cancel_dispatcher od_cancel_dispatcher_t;
+
+struct od_cancel_storage
+{
+	char *name;
+	od_atomic_u32_t active;
+	od_atomic_u32_t queued;
+	od_atomic_u64_t count_request;
+	od_atomic_u64_t count_sent;
+	od_atomic_u64_t count_dedup;
+	od_atomic_u64_t count_error;
+	od_atomic_u64_t latency_us;
+	od_atomic_u64_t latency_max_us;
+	od_list_t queue;
+	od_list_t link;
+};
+
+struct od_cancel_request
+{
+	od_rule_storage_t *storage;
+	kiwi_key_t key;
+	od_id_t server_id;
+	uint64_t time_us;
+	od_cancel_storage_t *state;
+	od_cancel_dispatcher_t *dispatcher;
+	od_list_t link;
+};
+
+struct od_cancel_recent
+{
+	od_cancel_storage_t *state;
+	kiwi_key_t key;
+	uint64_t time_us;
+	od_list_t link;
+};
+
+struct od_cancel_dispatcher
+{
+	int64_t machine;
+	machine_channel_t *channel;
+	od_global_t *global;
+	pthread_mutex_t lock;
+	od_list_t storages;
+	od_list_t recent;
+};
+
+void
+od_cancel_dispatcher_init(od_cancel_dispatcher_t *);
+int
+od_cancel_dispatcher_start(od_cancel_dispatcher_t *, od_global_t *);
+int
+od_cancel_dispatch(od_cancel_dispatcher_t *,
+                   od_rule_storage_t *,
+                   kiwi_key_t *,
+                   od_id_t *);
+
+typedef int (*od_cancel_storage_cb_t)(od_cancel_storage_t *, void **);
+
+int
+od_cancel_dispatcher_foreach(od_cancel_dispatcher_t *,
+                             od_cancel_storage_cb_t,
+                             void **);
+
+#endif /* ODYSSEY_CANCEL_DISPATCHER_H */
@@ -8,8 +8,14 @@
  */
 
 #include "global.h"
+#include "sketch.h"
+#include "tracer.h"
+#include "slab.h"
+#include "registry.h"
+#include "notify_queue.h"
 
 typedef struct od_client_ctl od_client_ctl_t;
+typedef struct od_client_cold od_client_cold_t;
 typedef struct od_client od_client_t;
 
 typedef enum
@@ -23,7 +29,8 @@ typedef enum
 typedef enum
 {
 	OD_CLIENT_OP_NONE = 0,
-	OD_CLIENT_OP_KILL = 1
+	OD_CLIENT_OP_KILL   = 1,
+	OD_CLIENT_OP_NOTIFY = 2
 } od_clientop_t;
 
 struct od_client_ctl
@@ -31,6 +38,16 @@ struct od_client_ctl
 	od_atomic_u32_t op;
 };
 
+/* startup data, used only on login and server attach */
+struct od_client_cold
+{
+	kiwi_be_startup_t startup;
+	kiwi_vars_t vars;
+	machine_msg_t *startup_msg;
+	int shard;
+	od_spool_t spool;
+};
+
 struct od_client
 {
 	od_client_state_t state;
@@ -42,16 +59,25 @@ struct od_client
 	machine_cond_t *cond;
 	od_relay_t relay;
 	machine_io_t *notify_io;
+	od_notify_queue_t *notify_queue;
 	od_rule_t *rule;
 	od_config_listen_t *config_listen;
 	uint64_t time_accept;
 	uint64_t time_setup;
-	kiwi_be_startup_t startup;
-	kiwi_vars_t vars;
+	od_client_cold_t *cold;
 	kiwi_key_t key;
+	od_sketch_key_t top_addr;
+	od_sketch_key_t top_appname;
+	bool limit_tx;
+	bool limit_batch;
+	bool limit_skip;
+	bool limit_detach;
+	bool storage_slot;
+	od_trace_t trace;
 	od_server_t *server;
 	void *route;
 	od_global_t *global;
+	od_registry_node_t registry;
 	od_list_t link_pool;
 	od_list_t link;
 };
@@ -70,35 +96,67 @@ od_client_init(od_client_t *client)
 	client->global        = NULL;
 	client->time_accept   = 0;
 	client->time_setup    = 0;
+	client->limit_tx      = false;
+	client->limit_batch   = false;
+	client->limit_skip    = false;
+	client->limit_detach  = false;
+	client->storage_slot  = false;
+	od_trace_init(&client->trace);
 	client->notify_io     = NULL;
+	client->notify_queue  = NULL;
 	client->ctl.op        = OD_CLIENT_OP_NONE;
-	kiwi_be_startup_init(&client->startup);
-	kiwi_vars_init(&client->vars);
 	kiwi_key_init(&client->key);
+	od_sketch_key_init(&client->top_addr);
+	od_sketch_key_init(&client->top_appname);
 	od_io_init(&client->io);
-	od_relay_init(&client->relay, &client->io);
+	od_relay_init(&client->relay, &client->io, &client->id);
+	od_registry_node_init(&client->registry, &client->id);
 	od_list_init(&client->link_pool);
 	od_list_init(&client->link);
 }
 
+static inline void
+od_client_cold_init(od_client_cold_t *cold)
+{
+	kiwi_be_startup_init(&cold->startup);
+	kiwi_vars_init(&cold->vars);
+	cold->startup_msg = NULL;
+	cold->shard       = OD_SHARD_NONE;
+	od_spool_init(&cold->spool);
+}
+
 static inline od_client_t *
 od_client_allocate(void)
 {
-	od_client_t *client = malloc(sizeof(*client));
+	od_client_t *client = od_slab_alloc_id(OD_SLAB_CLIENT);
 	if (client == NULL)
 		return NULL;
+	od_client_cold_t *cold = od_slab_alloc_id(OD_SLAB_CLIENT_COLD);
+	if (cold == NULL) {
+		od_slab_release_id(OD_SLAB_CLIENT, client);
+		return NULL;
+	}
 	od_client_init(client);
+	od_client_cold_init(cold);
+	client->cold = cold;
 	return client;
 }
 
 static inline void
 od_client_free(od_client_t *client)
 {
+	od_registry_remove(&od_registry_clients, &client->registry);
 	od_relay_free(&client->relay);
 	od_io_free(&client->io);
 	if (client->cond)
 		machine_cond_free(client->cond);
-	free(client);
+	if (client->notify_queue)
+		od_notify_queue_free(client->notify_queue);
+	if (client->cold->startup_msg)
+		machine_msg_free(client->cold->startup_msg);
+	od_spool_free(&client->cold->spool);
+	od_slab_release_id(OD_SLAB_CLIENT_COLD, client->cold);
+	od_slab_release_id(OD_SLAB_CLIENT, client);
 }
 
 static inline void
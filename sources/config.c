@@ -31,10 +31,16 @@ od_config_init(od_config_t *config)
 	config->log_file                      = NULL;
 	config->log_stats                     = 1;
 	config->stats_interval                = 3;
+	config->stats_history                 = 0;
+	config->stats_shm_path                = NULL;
+	config->stats_shm_routes_max          = 1024;
+	config->trace_file                    = NULL;
+	config->trace_sample_rate             = 100;
 	config->log_format                    = NULL;
 	config->pid_file                      = NULL;
 	config->unix_socket_dir               = NULL;
 	config->locks_dir                     = NULL;
+	config->spool_dir                     = NULL;
 	config->enable_online_restart_feature = 0;
 	config->bindwith_reuseport            = 0;
 	config->graceful_die_on_errors        = 0;
@@ -48,14 +54,25 @@ od_config_init(od_config_t *config)
 	config->keepalive_keep_interval       = 5;
 	config->keepalive_probes              = 3;
 	config->workers                       = 1;
+	config->workers_min                   = 1;
+	config->workers_max                   = 0;
+	config->workers_auto                  = 0;
+	config->workers_scale_up              = 75;
+	config->workers_scale_down            = 25;
+	config->workers_scale_interval        = 10;
 	config->resolvers                     = 1;
 	config->client_max_set                = 0;
 	config->client_max                    = 0;
 	config->client_max_routing            = 0;
 	config->server_login_retry            = 1;
+	config->cancel_max_connections        = 8;
+	config->cancel_dedup_window           = 100;
 	config->cache_coroutine               = 0;
 	config->cache_msg_gc_size             = 0;
 	config->coroutine_stack_size          = 4;
+	config->huge_pages                    = 0;
+	config->huge_pages_stacks             = 0;
+	config->memory_limit                  = 0;
 	od_list_init(&config->listen);
 }
 
@@ -65,6 +82,21 @@ od_config_reload(od_config_t *current_config, od_config_t *new_config)
 	current_config->client_max         = new_config->client_max;
 	current_config->client_max_routing = new_config->client_max_routing;
 	current_config->server_login_retry = new_config->server_login_retry;
+	current_config->memory_limit       = new_config->memory_limit;
+	current_config->stats_history      = new_config->stats_history;
+
+	/* number of worker slots is fixed on start */
+	int workers_max = current_config->workers_max;
+	current_config->workers     = new_config->workers;
+	current_config->workers_min = new_config->workers_min;
+	if (current_config->workers > workers_max)
+		current_config->workers = workers_max;
+	if (current_config->workers_min > workers_max)
+		current_config->workers_min = workers_max;
+	current_config->workers_auto           = new_config->workers_auto;
+	current_config->workers_scale_up       = new_config->workers_scale_up;
+	current_config->workers_scale_down     = new_config->workers_scale_down;
+	current_config->workers_scale_interval = new_config->workers_scale_interval;
 }
 
 static void
@@ -88,6 +120,10 @@ od_config_free(od_config_t *config)
 		free(config->pid_file);
 	if (config->unix_socket_dir)
 		free(config->unix_socket_dir);
+	if (config->stats_shm_path)
+		free(config->stats_shm_path);
+	if (config->trace_file)
+		free(config->trace_file);
 	if (config->log_syslog_ident)
 		free(config->log_syslog_ident);
 	if (config->log_syslog_facility)
@@ -95,6 +131,8 @@ od_config_free(od_config_t *config)
 	if (config->locks_dir) {
 		free(config->locks_dir);
 	}
+	if (config->spool_dir)
+		free(config->spool_dir);
 }
 
 od_config_listen_t *
@@ -139,6 +177,31 @@ od_config_validate(od_config_t *config, od_logger_t *logger)
 		od_error(logger, "config", NULL, NULL, "bad workers number");
 		return -1;
 	}
+	if (config->workers_max == 0)
+		config->workers_max = config->workers;
+	if (config->workers_max < config->workers) {
+		od_error(logger, "config", NULL, NULL, "bad workers_max number");
+		return -1;
+	}
+	if (config->workers_min <= 0 || config->workers_min > config->workers_max) {
+		od_error(logger, "config", NULL, NULL, "bad workers_min number");
+		return -1;
+	}
+	if (config->workers_scale_up <= 0 || config->workers_scale_up > 100 ||
+	    config->workers_scale_down < 0 ||
+	    config->workers_scale_down >= config->workers_scale_up) {
+		od_error(logger,
+		         "config",
+		         NULL,
+		         NULL,
+		         "bad workers_scale_up or workers_scale_down percent");
+		return -1;
+	}
+	if (config->workers_scale_interval <= 0) {
+		od_error(
+		  logger, "config", NULL, NULL, "bad workers_scale_interval number");
+		return -1;
+	}
 
 	/* resolvers */
 	if (config->resolvers <= 0) {
@@ -153,6 +216,45 @@ od_config_validate(od_config_t *config, od_logger_t *logger)
 		return -1;
 	}
 
+	/* memory_limit */
+	if (config->memory_limit < 0) {
+		od_error(logger, "config", NULL, NULL, "bad memory_limit number");
+		return -1;
+	}
+
+	/* stats_history */
+	if (config->stats_history < 0) {
+		od_error(logger, "config", NULL, NULL, "bad stats_history number");
+		return -1;
+	}
+
+	/* stats_shm_routes_max */
+	if (config->stats_shm_path && config->stats_shm_routes_max <= 0) {
+		od_error(
+		  logger, "config", NULL, NULL, "bad stats_shm_routes_max number");
+		return -1;
+	}
+
+	/* cancel_max_connections */
+	if (config->cancel_max_connections <= 0) {
+		od_error(
+		  logger, "config", NULL, NULL, "bad cancel_max_connections number");
+		return -1;
+	}
+
+	/* cancel_dedup_window */
+	if (config->cancel_dedup_window < 0) {
+		od_error(
+		  logger, "config", NULL, NULL, "bad cancel_dedup_window number");
+		return -1;
+	}
+
+	/* trace_sample_rate */
+	if (config->trace_file && config->trace_sample_rate <= 0) {
+		od_error(logger, "config", NULL, NULL, "bad trace_sample_rate number");
+		return -1;
+	}
+
 	/* log format */
 	if (config->log_format == NULL) {
 		od_error(logger, "config", NULL, NULL, "log is not defined");
@@ -267,6 +369,13 @@ od_config_print(od_config_t *config, od_logger_t *logger)
 		       "unix_socket_mode        %s",
 		       config->unix_socket_mode);
 	}
+	if (config->spool_dir)
+		od_log(logger,
+		       "config",
+		       NULL,
+		       NULL,
+		       "spool_dir               %s",
+		       config->spool_dir);
 	if (config->log_format)
 		od_log(logger,
 		       "config",
@@ -343,6 +452,41 @@ od_config_print(od_config_t *config, od_logger_t *logger)
 	       NULL,
 	       "stats_interval          %d",
 	       config->stats_interval);
+	if (config->stats_history > 0)
+		od_log(logger,
+		       "config",
+		       NULL,
+		       NULL,
+		       "stats_history           %d",
+		       config->stats_history);
+	if (config->stats_shm_path) {
+		od_log(logger,
+		       "config",
+		       NULL,
+		       NULL,
+		       "stats_shm_path          %s",
+		       config->stats_shm_path);
+		od_log(logger,
+		       "config",
+		       NULL,
+		       NULL,
+		       "stats_shm_routes_max    %d",
+		       config->stats_shm_routes_max);
+	}
+	if (config->trace_file) {
+		od_log(logger,
+		       "config",
+		       NULL,
+		       NULL,
+		       "trace_file              %s",
+		       config->trace_file);
+		od_log(logger,
+		       "config",
+		       NULL,
+		       NULL,
+		       "trace_sample_rate       %d",
+		       config->trace_sample_rate);
+	}
 	od_log(logger,
 	       "config",
 	       NULL,
@@ -380,6 +524,18 @@ od_config_print(od_config_t *config, od_logger_t *logger)
 	       NULL,
 	       "server_login_retry      %d",
 	       config->server_login_retry);
+	od_log(logger,
+	       "config",
+	       NULL,
+	       NULL,
+	       "cancel_max_connections  %d",
+	       config->cancel_max_connections);
+	od_log(logger,
+	       "config",
+	       NULL,
+	       NULL,
+	       "cancel_dedup_window     %d",
+	       config->cancel_dedup_window);
 	od_log(logger,
 	       "config",
 	       NULL,
@@ -398,8 +554,44 @@ od_config_print(od_config_t *config, od_logger_t *logger)
 	       NULL,
 	       "coroutine_stack_size    %d",
 	       config->coroutine_stack_size);
+	od_log(logger,
+	       "config",
+	       NULL,
+	       NULL,
+	       "huge_pages              %s",
+	       od_config_yes_no(config->huge_pages));
+	od_log(logger,
+	       "config",
+	       NULL,
+	       NULL,
+	       "huge_pages_stacks       %s",
+	       od_config_yes_no(config->huge_pages_stacks));
+	if (config->memory_limit > 0)
+		od_log(logger,
+		       "config",
+		       NULL,
+		       NULL,
+		       "memory_limit            %d",
+		       config->memory_limit);
 	od_log(
 	  logger, "config", NULL, NULL, "workers              %d", config->workers);
+	if (config->workers_max > config->workers)
+		od_log(logger,
+		       "config",
+		       NULL,
+		       NULL,
+		       "workers_max             %d",
+		       config->workers_max);
+	if (config->workers_auto)
+		od_log(logger,
+		       "config",
+		       NULL,
+		       NULL,
+		       "workers_auto            %d-%d workers, %d-%d%% load",
+		       config->workers_min,
+		       config->workers_max,
+		       config->workers_scale_down,
+		       config->workers_scale_up);
 	od_log(logger,
 	       "config",
 	       NULL,
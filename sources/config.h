@@ -55,11 +55,17 @@ struct od_config
 	char *log_syslog_facility;
 	/*         */
 	int stats_interval;
+	int stats_history;
+	char *stats_shm_path;
+	int stats_shm_routes_max;
+	char *trace_file;
+	int trace_sample_rate;
 	/* system related settings */
 	char *pid_file;
 	char *unix_socket_dir;
 	char *unix_socket_mode;
 	char *locks_dir;
+	char *spool_dir;
 	/* sigusr2 etc */
 	int graceful_die_on_errors;
 	int enable_online_restart_feature;
@@ -76,21 +82,32 @@ struct od_config
 	/*                                */
 
 	int workers;
+	int workers_min;
+	int workers_max;
+	int workers_auto;
+	int workers_scale_up;
+	int workers_scale_down;
+	int workers_scale_interval;
 	int resolvers;
 	int client_max_set;
 	int client_max;
 	int client_max_routing;
 	int server_login_retry;
+	int cancel_max_connections;
+	int cancel_dedup_window;
 	int cache_coroutine;
 	int cache_msg_gc_size;
 	int coroutine_stack_size;
+	int huge_pages;
+	int huge_pages_stacks;
+	int memory_limit;
 	od_list_t listen;
 };
 
 static inline int
 od_config_is_multi_workers(od_config_t *config)
 {
-	return config->workers > 1;
+	return config->workers > 1 || config->workers_max > 1;
 }
 
 void
@@ -34,6 +34,7 @@ enum
 	OD_LUNIX_SOCKET_DIR,
 	OD_LUNIX_SOCKET_MODE,
 	OD_LLOCKS_DIR,
+	OD_LSPOOL_DIR,
 	OD_LENABLE_ONLINE_RESTART,
 	OD_LGRACEFUL_DIE_ON_ERRORS,
 	OD_LBINDWITH_REUSEPORT,
@@ -41,6 +42,11 @@ enum
 	OD_LLOG_SYSLOG_IDENT,
 	OD_LLOG_SYSLOG_FACILITY,
 	OD_LSTATS_INTERVAL,
+	OD_LSTATS_HISTORY,
+	OD_LSTATS_SHM_PATH,
+	OD_LSTATS_SHM_ROUTES_MAX,
+	OD_LTRACE_FILE,
+	OD_LTRACE_SAMPLE_RATE,
 	OD_LLISTEN,
 	OD_LHOST,
 	OD_LPORT,
@@ -52,6 +58,12 @@ enum
 	OD_LKEEPALIVE_USR_TIMEOUT,
 	OD_LREADAHEAD,
 	OD_LWORKERS,
+	OD_LWORKERS_MIN,
+	OD_LWORKERS_MAX,
+	OD_LWORKERS_AUTO,
+	OD_LWORKERS_SCALE_UP,
+	OD_LWORKERS_SCALE_DOWN,
+	OD_LWORKERS_SCALE_INTERVAL,
 	OD_LRESOLVERS,
 	OD_LPIPELINE,
 	OD_LPACKET_READ_SIZE,
@@ -61,9 +73,14 @@ enum
 	OD_LCACHE_MSG_GC_SIZE,
 	OD_LCACHE_COROUTINE,
 	OD_LCOROUTINE_STACK_SIZE,
+	OD_LHUGE_PAGES,
+	OD_LHUGE_PAGES_STACKS,
+	OD_LMEMORY_LIMIT,
 	OD_LCLIENT_MAX,
 	OD_LCLIENT_MAX_ROUTING,
 	OD_LSERVER_LOGIN_RETRY,
+	OD_LCANCEL_MAX_CONNECTIONS,
+	OD_LCANCEL_DEDUP_WINDOW,
 	OD_LCLIENT_LOGIN_TIMEOUT,
 	OD_LCLIENT_FWD_ERROR,
 	OD_LAPPLICATION_NAME_ADD_HOST,
@@ -76,6 +93,9 @@ enum
 	OD_LSTORAGE,
 	OD_LTYPE,
 	OD_LSERVERS_MAX_ROUTING,
+	OD_LSERVER_MAX_ACTIVE,
+	OD_LSERVER_QUEUE_TARGET,
+	OD_LSERVER_QUEUE_INTERVAL,
 	OD_LDEFAULT,
 	OD_LDATABASE,
 	OD_LUSER,
@@ -83,13 +103,25 @@ enum
 	OD_LPOOL,
 	OD_LPOOL_SIZE,
 	OD_LPOOL_TIMEOUT,
+	OD_LPOOL_PRIORITY,
+	OD_LQUERY_TIMEOUT,
+	OD_LTRANSACTION_TIMEOUT,
 	OD_LPOOL_TTL,
+	OD_LSERVER_CHECK_DELAY,
 	OD_LPOOL_DISCARD,
 	OD_LPOOL_CANCEL,
 	OD_LPOOL_ROLLBACK,
+	OD_LNOTIFY_RELAY,
+	OD_LPOOL_SPOOL,
+	OD_LPOOL_SPOOL_MEMORY,
+	OD_LPOOL_SPOOL_MAX,
 	OD_LSTORAGE_DB,
 	OD_LSTORAGE_USER,
 	OD_LSTORAGE_PASSWORD,
+	OD_LSHARDS,
+	OD_LSHARD_RANGES,
+	OD_LSHARD_KEY,
+	OD_LSHARD_HINT,
 	OD_LAUTHENTICATION,
 	OD_LAUTH_COMMON_NAME,
 	OD_LAUTH_PAM_SERVICE,
@@ -97,6 +129,13 @@ enum
 	OD_LAUTH_QUERY_DB,
 	OD_LAUTH_QUERY_USER,
 	OD_LQUANTILES,
+	OD_LTOP_CLIENTS,
+	OD_LLIMIT_QPS,
+	OD_LLIMIT_TPS,
+	OD_LLIMIT_BYTES_PER_SEC,
+	OD_LLIMIT_TX_MAX,
+	OD_LLIMIT_POLICY,
+	OD_LLIMIT_TIMEOUT,
 	OD_LMODULE,
 };
 
@@ -111,6 +150,7 @@ static od_keyword_t od_config_keywords[] = {
 	od_keyword("unix_socket_dir", OD_LUNIX_SOCKET_DIR),
 	od_keyword("unix_socket_mode", OD_LUNIX_SOCKET_MODE),
 	od_keyword("locks_dir", OD_LLOCKS_DIR),
+	od_keyword("spool_dir", OD_LSPOOL_DIR),
 	od_keyword("enable_online_restart", OD_LENABLE_ONLINE_RESTART),
 	od_keyword("graceful_die_on_errors", OD_LGRACEFUL_DIE_ON_ERRORS),
 	od_keyword("bindwith_reuseport", OD_LBINDWITH_REUSEPORT),
@@ -126,6 +166,11 @@ static od_keyword_t od_config_keywords[] = {
 	od_keyword("log_syslog_ident", OD_LLOG_SYSLOG_IDENT),
 	od_keyword("log_syslog_facility", OD_LLOG_SYSLOG_FACILITY),
 	od_keyword("stats_interval", OD_LSTATS_INTERVAL),
+	od_keyword("stats_history", OD_LSTATS_HISTORY),
+	od_keyword("stats_shm_path", OD_LSTATS_SHM_PATH),
+	od_keyword("stats_shm_routes_max", OD_LSTATS_SHM_ROUTES_MAX),
+	od_keyword("trace_file", OD_LTRACE_FILE),
+	od_keyword("trace_sample_rate", OD_LTRACE_SAMPLE_RATE),
 	/* listen */
 	od_keyword("listen", OD_LLISTEN),
 	od_keyword("host", OD_LHOST),
@@ -138,6 +183,12 @@ static od_keyword_t od_config_keywords[] = {
 	od_keyword("keepalive_usr_timeout", OD_LKEEPALIVE_USR_TIMEOUT),
 	od_keyword("readahead", OD_LREADAHEAD),
 	od_keyword("workers", OD_LWORKERS),
+	od_keyword("workers_min", OD_LWORKERS_MIN),
+	od_keyword("workers_max", OD_LWORKERS_MAX),
+	od_keyword("workers_auto", OD_LWORKERS_AUTO),
+	od_keyword("workers_scale_up", OD_LWORKERS_SCALE_UP),
+	od_keyword("workers_scale_down", OD_LWORKERS_SCALE_DOWN),
+	od_keyword("workers_scale_interval", OD_LWORKERS_SCALE_INTERVAL),
 	od_keyword("resolvers", OD_LRESOLVERS),
 	od_keyword("pipeline", OD_LPIPELINE),
 	od_keyword("packet_read_size", OD_LPACKET_READ_SIZE),
@@ -147,9 +198,14 @@ static od_keyword_t od_config_keywords[] = {
 	od_keyword("cache_msg_gc_size", OD_LCACHE_MSG_GC_SIZE),
 	od_keyword("cache_coroutine", OD_LCACHE_COROUTINE),
 	od_keyword("coroutine_stack_size", OD_LCOROUTINE_STACK_SIZE),
+	od_keyword("huge_pages", OD_LHUGE_PAGES),
+	od_keyword("huge_pages_stacks", OD_LHUGE_PAGES_STACKS),
+	od_keyword("memory_limit", OD_LMEMORY_LIMIT),
 	od_keyword("client_max", OD_LCLIENT_MAX),
 	od_keyword("client_max_routing", OD_LCLIENT_MAX_ROUTING),
 	od_keyword("server_login_retry", OD_LSERVER_LOGIN_RETRY),
+	od_keyword("cancel_max_connections", OD_LCANCEL_MAX_CONNECTIONS),
+	od_keyword("cancel_dedup_window", OD_LCANCEL_DEDUP_WINDOW),
 	od_keyword("client_login_timeout", OD_LCLIENT_LOGIN_TIMEOUT),
 	od_keyword("client_fwd_error", OD_LCLIENT_FWD_ERROR),
 	od_keyword("application_name_add_host", OD_LAPPLICATION_NAME_ADD_HOST),
@@ -163,6 +219,9 @@ static od_keyword_t od_config_keywords[] = {
 	od_keyword("storage", OD_LSTORAGE),
 	od_keyword("type", OD_LTYPE),
 	od_keyword("server_max_routing", OD_LSERVERS_MAX_ROUTING),
+	od_keyword("server_max_active", OD_LSERVER_MAX_ACTIVE),
+	od_keyword("server_queue_target", OD_LSERVER_QUEUE_TARGET),
+	od_keyword("server_queue_interval", OD_LSERVER_QUEUE_INTERVAL),
 	od_keyword("default", OD_LDEFAULT),
 	/* database */
 	od_keyword("database", OD_LDATABASE),
@@ -171,13 +230,25 @@ static od_keyword_t od_config_keywords[] = {
 	od_keyword("pool", OD_LPOOL),
 	od_keyword("pool_size", OD_LPOOL_SIZE),
 	od_keyword("pool_timeout", OD_LPOOL_TIMEOUT),
+	od_keyword("pool_priority", OD_LPOOL_PRIORITY),
+	od_keyword("query_timeout", OD_LQUERY_TIMEOUT),
+	od_keyword("transaction_timeout", OD_LTRANSACTION_TIMEOUT),
 	od_keyword("pool_ttl", OD_LPOOL_TTL),
+	od_keyword("server_check_delay", OD_LSERVER_CHECK_DELAY),
 	od_keyword("pool_discard", OD_LPOOL_DISCARD),
 	od_keyword("pool_cancel", OD_LPOOL_CANCEL),
 	od_keyword("pool_rollback", OD_LPOOL_ROLLBACK),
+	od_keyword("notify_relay", OD_LNOTIFY_RELAY),
+	od_keyword("pool_spool", OD_LPOOL_SPOOL),
+	od_keyword("pool_spool_memory", OD_LPOOL_SPOOL_MEMORY),
+	od_keyword("pool_spool_max", OD_LPOOL_SPOOL_MAX),
 	od_keyword("storage_db", OD_LSTORAGE_DB),
 	od_keyword("storage_user", OD_LSTORAGE_USER),
 	od_keyword("storage_password", OD_LSTORAGE_PASSWORD),
+	od_keyword("shards", OD_LSHARDS),
+	od_keyword("shard_ranges", OD_LSHARD_RANGES),
+	od_keyword("shard_key", OD_LSHARD_KEY),
+	od_keyword("shard_hint", OD_LSHARD_HINT),
 	od_keyword("authentication", OD_LAUTHENTICATION),
 	od_keyword("auth_common_name", OD_LAUTH_COMMON_NAME),
 	od_keyword("auth_query", OD_LAUTH_QUERY),
@@ -185,6 +256,13 @@ static od_keyword_t od_config_keywords[] = {
 	od_keyword("auth_query_user", OD_LAUTH_QUERY_USER),
 	od_keyword("auth_pam_service", OD_LAUTH_PAM_SERVICE),
 	od_keyword("quantiles", OD_LQUANTILES),
+	od_keyword("top_clients", OD_LTOP_CLIENTS),
+	od_keyword("limit_qps", OD_LLIMIT_QPS),
+	od_keyword("limit_tps", OD_LLIMIT_TPS),
+	od_keyword("limit_bytes_per_sec", OD_LLIMIT_BYTES_PER_SEC),
+	od_keyword("limit_tx_max", OD_LLIMIT_TX_MAX),
+	od_keyword("limit_policy", OD_LLIMIT_POLICY),
+	od_keyword("limit_timeout", OD_LLIMIT_TIMEOUT),
 	od_keyword("load_module", OD_LMODULE),
 	{ 0, 0, 0 }
 };
@@ -593,6 +671,24 @@ od_config_reader_storage(od_config_reader_t *reader)
 				                             &storage->server_max_routing))
 					return -1;
 				continue;
+			/* server_max_active */
+			case OD_LSERVER_MAX_ACTIVE:
+				if (!od_config_reader_number(reader,
+				                             &storage->server_max_active))
+					return -1;
+				continue;
+			/* server_queue_target */
+			case OD_LSERVER_QUEUE_TARGET:
+				if (!od_config_reader_number(reader,
+				                             &storage->server_queue_target))
+					return -1;
+				continue;
+			/* server_queue_interval */
+			case OD_LSERVER_QUEUE_INTERVAL:
+				if (!od_config_reader_number(reader,
+				                             &storage->server_queue_interval))
+					return -1;
+				continue;
 			default:
 				od_config_reader_error(reader, &token, "unexpected parameter");
 				return -1;
@@ -785,6 +881,42 @@ od_config_reader_route(od_config_reader_t *reader,
 				}
 				free(quantiles_str);
 			} break;
+			/* top_clients */
+			case OD_LTOP_CLIENTS:
+				if (!od_config_reader_number(reader, &route->top_clients))
+					return -1;
+				continue;
+			/* limit_qps */
+			case OD_LLIMIT_QPS:
+				if (!od_config_reader_number(reader, &route->limit_qps))
+					return -1;
+				continue;
+			/* limit_tps */
+			case OD_LLIMIT_TPS:
+				if (!od_config_reader_number(reader, &route->limit_tps))
+					return -1;
+				continue;
+			/* limit_bytes_per_sec */
+			case OD_LLIMIT_BYTES_PER_SEC:
+				if (!od_config_reader_number(reader,
+				                             &route->limit_bytes_per_sec))
+					return -1;
+				continue;
+			/* limit_tx_max */
+			case OD_LLIMIT_TX_MAX:
+				if (!od_config_reader_number(reader, &route->limit_tx_max))
+					return -1;
+				continue;
+			/* limit_policy */
+			case OD_LLIMIT_POLICY:
+				if (!od_config_reader_string(reader, &route->limit_policy_sz))
+					return -1;
+				continue;
+			/* limit_timeout */
+			case OD_LLIMIT_TIMEOUT:
+				if (!od_config_reader_number(reader, &route->limit_timeout))
+					return -1;
+				continue;
 			/* application_name_add_host */
 			case OD_LAPPLICATION_NAME_ADD_HOST:
 				if (!od_config_reader_yes_no(reader,
@@ -814,11 +946,33 @@ od_config_reader_route(od_config_reader_t *reader,
 				if (!od_config_reader_number(reader, &route->pool_timeout))
 					return -1;
 				continue;
+			/* pool_priority */
+			case OD_LPOOL_PRIORITY:
+				if (!od_config_reader_number(reader, &route->pool_priority))
+					return -1;
+				continue;
+			/* query_timeout */
+			case OD_LQUERY_TIMEOUT:
+				if (!od_config_reader_number(reader, &route->query_timeout))
+					return -1;
+				continue;
+			/* transaction_timeout */
+			case OD_LTRANSACTION_TIMEOUT:
+				if (!od_config_reader_number(reader,
+				                             &route->transaction_timeout))
+					return -1;
+				continue;
 			/* pool_ttl */
 			case OD_LPOOL_TTL:
 				if (!od_config_reader_number(reader, &route->pool_ttl))
 					return -1;
 				continue;
+			/* server_check_delay */
+			case OD_LSERVER_CHECK_DELAY:
+				if (!od_config_reader_number(reader,
+				                             &route->server_check_delay))
+					return -1;
+				continue;
 			/* storage_database */
 			case OD_LSTORAGE_DB:
 				if (!od_config_reader_string(reader, &route->storage_db))
@@ -836,6 +990,26 @@ od_config_reader_route(od_config_reader_t *reader,
 					return -1;
 				route->storage_password_len = strlen(route->storage_password);
 				continue;
+			/* shards */
+			case OD_LSHARDS:
+				if (!od_config_reader_string(reader, &route->shards))
+					return -1;
+				continue;
+			/* shard_ranges */
+			case OD_LSHARD_RANGES:
+				if (!od_config_reader_string(reader, &route->shard_ranges))
+					return -1;
+				continue;
+			/* shard_key */
+			case OD_LSHARD_KEY:
+				if (!od_config_reader_string(reader, &route->shard_key))
+					return -1;
+				continue;
+			/* shard_hint */
+			case OD_LSHARD_HINT:
+				if (!od_config_reader_yes_no(reader, &route->shard_hint))
+					return -1;
+				continue;
 			/* pool_discard */
 			case OD_LPOOL_DISCARD:
 				if (!od_config_reader_yes_no(reader, &route->pool_discard))
@@ -851,6 +1025,26 @@ od_config_reader_route(od_config_reader_t *reader,
 				if (!od_config_reader_yes_no(reader, &route->pool_rollback))
 					return -1;
 				continue;
+			/* notify_relay */
+			case OD_LNOTIFY_RELAY:
+				if (!od_config_reader_yes_no(reader, &route->notify_relay))
+					return -1;
+				continue;
+			/* pool_spool */
+			case OD_LPOOL_SPOOL:
+				if (!od_config_reader_yes_no(reader, &route->pool_spool))
+					return -1;
+				continue;
+			/* pool_spool_memory */
+			case OD_LPOOL_SPOOL_MEMORY:
+				if (!od_config_reader_number(reader, &route->pool_spool_memory))
+					return -1;
+				continue;
+			/* pool_spool_max */
+			case OD_LPOOL_SPOOL_MAX:
+				if (!od_config_reader_number(reader, &route->pool_spool_max))
+					return -1;
+				continue;
 			/* log_debug */
 			case OD_LLOG_DEBUG:
 				if (!od_config_reader_yes_no(reader, &route->log_debug))
@@ -1009,6 +1203,11 @@ od_config_reader_parse(od_config_reader_t *reader, od_module_t *modules)
 				if (!od_config_reader_string(reader, &config->locks_dir))
 					return -1;
 				continue;
+			/* spool_dir */
+			case OD_LSPOOL_DIR:
+				if (!od_config_reader_string(reader, &config->spool_dir))
+					return -1;
+				continue;
 			/* enable_online_restart */
 			case OD_LENABLE_ONLINE_RESTART:
 				if (!od_config_reader_yes_no(
@@ -1087,6 +1286,33 @@ od_config_reader_parse(od_config_reader_t *reader, od_module_t *modules)
 				if (!od_config_reader_number(reader, &config->stats_interval))
 					return -1;
 				continue;
+			/* stats_history */
+			case OD_LSTATS_HISTORY:
+				if (!od_config_reader_number(reader, &config->stats_history))
+					return -1;
+				continue;
+			/* stats_shm_path */
+			case OD_LSTATS_SHM_PATH:
+				if (!od_config_reader_string(reader, &config->stats_shm_path))
+					return -1;
+				continue;
+			/* stats_shm_routes_max */
+			case OD_LSTATS_SHM_ROUTES_MAX:
+				if (!od_config_reader_number(reader,
+				                             &config->stats_shm_routes_max))
+					return -1;
+				continue;
+			/* trace_file */
+			case OD_LTRACE_FILE:
+				if (!od_config_reader_string(reader, &config->trace_file))
+					return -1;
+				continue;
+			/* trace_sample_rate */
+			case OD_LTRACE_SAMPLE_RATE:
+				if (!od_config_reader_number(reader,
+				                             &config->trace_sample_rate))
+					return -1;
+				continue;
 			/* client_max */
 			case OD_LCLIENT_MAX:
 				if (!od_config_reader_number(reader, &config->client_max))
@@ -1105,6 +1331,18 @@ od_config_reader_parse(od_config_reader_t *reader, od_module_t *modules)
 				                             &config->server_login_retry))
 					return -1;
 				continue;
+			/* cancel_max_connections */
+			case OD_LCANCEL_MAX_CONNECTIONS:
+				if (!od_config_reader_number(
+				      reader, &config->cancel_max_connections))
+					return -1;
+				continue;
+			/* cancel_dedup_window */
+			case OD_LCANCEL_DEDUP_WINDOW:
+				if (!od_config_reader_number(reader,
+				                             &config->cancel_dedup_window))
+					return -1;
+				continue;
 			/* readahead */
 			case OD_LREADAHEAD:
 				if (!od_config_reader_number(reader, &config->readahead))
@@ -1143,6 +1381,39 @@ od_config_reader_parse(od_config_reader_t *reader, od_module_t *modules)
 				if (!od_config_reader_number(reader, &config->workers))
 					return -1;
 				continue;
+			/* workers_min */
+			case OD_LWORKERS_MIN:
+				if (!od_config_reader_number(reader, &config->workers_min))
+					return -1;
+				continue;
+			/* workers_max */
+			case OD_LWORKERS_MAX:
+				if (!od_config_reader_number(reader, &config->workers_max))
+					return -1;
+				continue;
+			/* workers_auto */
+			case OD_LWORKERS_AUTO:
+				if (!od_config_reader_yes_no(reader, &config->workers_auto))
+					return -1;
+				continue;
+			/* workers_scale_up */
+			case OD_LWORKERS_SCALE_UP:
+				if (!od_config_reader_number(reader,
+				                             &config->workers_scale_up))
+					return -1;
+				continue;
+			/* workers_scale_down */
+			case OD_LWORKERS_SCALE_DOWN:
+				if (!od_config_reader_number(reader,
+				                             &config->workers_scale_down))
+					return -1;
+				continue;
+			/* workers_scale_interval */
+			case OD_LWORKERS_SCALE_INTERVAL:
+				if (!od_config_reader_number(reader,
+				                             &config->workers_scale_interval))
+					return -1;
+				continue;
 			/* resolvers */
 			case OD_LRESOLVERS:
 				if (!od_config_reader_number(reader, &config->resolvers))
@@ -1179,6 +1450,22 @@ od_config_reader_parse(od_config_reader_t *reader, od_module_t *modules)
 				                             &config->coroutine_stack_size))
 					return -1;
 				continue;
+			/* huge_pages */
+			case OD_LHUGE_PAGES:
+				if (!od_config_reader_yes_no(reader, &config->huge_pages))
+					return -1;
+				continue;
+			/* huge_pages_stacks */
+			case OD_LHUGE_PAGES_STACKS:
+				if (!od_config_reader_yes_no(reader,
+				                             &config->huge_pages_stacks))
+					return -1;
+				continue;
+			/* memory_limit */
+			case OD_LMEMORY_LIMIT:
+				if (!od_config_reader_number(reader, &config->memory_limit))
+					return -1;
+				continue;
 			/* listen */
 			case OD_LLISTEN:
 				rc = od_config_reader_listen(reader);
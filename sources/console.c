@@ -39,6 +39,25 @@ enum
 	OD_LFRONTEND,
 	OD_LROUTER,
 	OD_LVERSION,
+	OD_LTOP,
+	OD_LLIMITS,
+	OD_LCANCELS,
+	OD_LCLIENT,
+	OD_LSERVER,
+	OD_LLISTENERS,
+	OD_LMEMORY,
+	OD_LHISTORY,
+	OD_LPAUSE,
+	OD_LRESUME,
+	OD_LRETARGET,
+	OD_LWHERE,
+	OD_LAND,
+	OD_LLIMIT,
+	OD_LDATABASE,
+	OD_LUSER,
+	OD_LSTATE,
+	OD_LWORKERS,
+	OD_LTO,
 };
 
 static od_keyword_t od_console_keywords[] = {
@@ -60,6 +79,25 @@ static od_keyword_t od_console_keywords[] = {
 	od_keyword("router", OD_LROUTER),
 	od_keyword("drop", OD_LDROP),
 	od_keyword("version", OD_LVERSION),
+	od_keyword("top", OD_LTOP),
+	od_keyword("limits", OD_LLIMITS),
+	od_keyword("cancels", OD_LCANCELS),
+	od_keyword("client", OD_LCLIENT),
+	od_keyword("server", OD_LSERVER),
+	od_keyword("listeners", OD_LLISTENERS),
+	od_keyword("memory", OD_LMEMORY),
+	od_keyword("history", OD_LHISTORY),
+	od_keyword("pause", OD_LPAUSE),
+	od_keyword("resume", OD_LRESUME),
+	od_keyword("retarget", OD_LRETARGET),
+	od_keyword("where", OD_LWHERE),
+	od_keyword("and", OD_LAND),
+	od_keyword("limit", OD_LLIMIT),
+	od_keyword("database", OD_LDATABASE),
+	od_keyword("user", OD_LUSER),
+	od_keyword("state", OD_LSTATE),
+	od_keyword("workers", OD_LWORKERS),
+	od_keyword("to", OD_LTO),
 	{ 0, 0, 0 }
 };
 
@@ -310,6 +348,86 @@ od_console_show_stats(od_client_t *client, machine_msg_t *stream)
 	return rc;
 }
 
+static inline int
+od_console_show_stats_history_cb(od_route_t *route, void **argv)
+{
+	machine_msg_t *stream       = argv[0];
+	od_stats_history_t *history = route->history;
+	if (history == NULL)
+		return 0;
+
+	uint32_t n;
+	for (n = 0; n < history->count; n++) {
+		int offset;
+		machine_msg_t *msg;
+		msg = kiwi_be_write_data_row(stream, &offset);
+		if (msg == NULL)
+			return -1;
+		int rc;
+		/* database */
+		rc = kiwi_be_write_data_row_add(
+		  stream, offset, route->id.database, route->id.database_len - 1);
+		if (rc == -1)
+			return -1;
+		/* user */
+		rc = kiwi_be_write_data_row_add(
+		  stream, offset, route->id.user, route->id.user_len - 1);
+		if (rc == -1)
+			return -1;
+		char data[64];
+		int data_len;
+		int i;
+		for (i = 0; i < OD_STATS_HISTORY_MAX; i++) {
+			data_len = od_snprintf(data,
+			                       sizeof(data),
+			                       "%" PRIu32,
+			                       od_stats_history_of(history, i, n));
+			rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+			if (rc == -1)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+static inline int
+od_console_show_stats_history(od_client_t *client, machine_msg_t *stream)
+{
+	assert(stream);
+	od_router_t *router = client->global->router;
+
+	machine_msg_t *msg;
+	msg = kiwi_be_write_row_descriptionf(stream,
+	                                     "sslllllllllllllll",
+	                                     "database",
+	                                     "user",
+	                                     "time",
+	                                     "xact_per_sec",
+	                                     "query_per_sec",
+	                                     "avg_xact_time",
+	                                     "avg_query_time",
+	                                     "recv_per_sec",
+	                                     "sent_per_sec",
+	                                     "clients",
+	                                     "servers_active",
+	                                     "servers_idle",
+	                                     "queue",
+	                                     "xact_p50_window",
+	                                     "xact_p99_window",
+	                                     "query_p50_window",
+	                                     "query_p99_window");
+	if (msg == NULL)
+		return -1;
+
+	void *argv[] = { stream };
+	int rc;
+	rc = od_router_foreach(router, od_console_show_stats_history_cb, argv);
+	if (rc == -1)
+		return -1;
+
+	return kiwi_be_write_complete(stream, "SHOW", 5);
+}
+
 static inline od_retcode_t
 od_console_show_errors(od_client_t *client, machine_msg_t *stream)
 {
@@ -374,153 +492,453 @@ od_console_show_version(machine_msg_t *stream)
 	return rc;
 }
 
+/*
+ * SHOW POOLS, SERVERS and CLIENTS take a snapshot of matching rows
+ * under the router and route locks first, then format and write the
+ * rows to the console client in bounded chunks with locks released.
+ */
+
+#define OD_CONSOLE_CHUNK (64 * 1024)
+
+typedef struct
+{
+	char database[KIWI_MAX_VAR_SIZE];
+	char user[KIWI_MAX_VAR_SIZE];
+	char state[16];
+	int64_t limit;
+} od_console_filter_t;
+
+typedef struct
+{
+	od_console_filter_t *filter;
+	char *rows;
+	int row_size;
+	int count;
+	int allocated;
+	char *names;
+	int names_size;
+	int names_allocated;
+	int last_database;
+	int last_user;
+	bool oom;
+} od_console_snapshot_t;
+
+static inline int
+od_console_parse_name(od_parser_t *parser, char *name, int size)
+{
+	od_token_t token;
+	int rc;
+	rc = od_parser_next(parser, &token);
+	if (rc != OD_PARSER_KEYWORD && rc != OD_PARSER_STRING)
+		return -1;
+	if (token.value.string.size >= size)
+		return -1;
+	od_token_to_string_dest(&token, name);
+	return 0;
+}
+
+static inline int
+od_console_parse_condition(od_parser_t *parser,
+                           od_console_filter_t *filter,
+                           bool states)
+{
+	od_token_t token;
+	int rc;
+	rc = od_parser_next(parser, &token);
+	if (rc != OD_PARSER_KEYWORD)
+		return -1;
+	od_keyword_t *keyword;
+	keyword = od_keyword_match(od_console_keywords, &token);
+	if (keyword == NULL)
+		return -1;
+	char *value;
+	int size;
+	switch (keyword->id) {
+		case OD_LDATABASE:
+			value = filter->database;
+			size  = sizeof(filter->database);
+			break;
+		case OD_LUSER:
+			value = filter->user;
+			size  = sizeof(filter->user);
+			break;
+		case OD_LSTATE:
+			if (!states)
+				return -1;
+			value = filter->state;
+			size  = sizeof(filter->state);
+			break;
+		default:
+			return -1;
+	}
+	rc = od_parser_next(parser, &token);
+	if (rc != OD_PARSER_SYMBOL || token.value.num != '=')
+		return -1;
+	return od_console_parse_name(parser, value, size);
+}
+
+/* [WHERE field = "value" [AND ...]] [LIMIT n] */
+static inline int
+od_console_parse_filter(od_parser_t *parser,
+                        od_console_filter_t *filter,
+                        bool states)
+{
+	memset(filter, 0, sizeof(od_console_filter_t));
+	filter->limit = -1;
+
+	od_token_t token;
+	od_keyword_t *keyword = NULL;
+	int rc;
+	rc = od_parser_next(parser, &token);
+	if (rc == OD_PARSER_KEYWORD)
+		keyword = od_keyword_match(od_console_keywords, &token);
+	if (keyword && keyword->id == OD_LWHERE) {
+		do {
+			rc = od_console_parse_condition(parser, filter, states);
+			if (rc == -1)
+				return -1;
+			keyword = NULL;
+			rc      = od_parser_next(parser, &token);
+			if (rc == OD_PARSER_KEYWORD)
+				keyword = od_keyword_match(od_console_keywords, &token);
+		} while (keyword && keyword->id == OD_LAND);
+	}
+	if (keyword && keyword->id == OD_LLIMIT) {
+		rc = od_parser_next(parser, &token);
+		if (rc != OD_PARSER_NUM || token.value.num < 0)
+			return -1;
+		filter->limit = token.value.num;
+		rc            = od_parser_next(parser, &token);
+	}
+	if (rc == OD_PARSER_SYMBOL && token.value.num == ';')
+		rc = od_parser_next(parser, &token);
+	return rc == OD_PARSER_EOF ? 0 : -1;
+}
+
+static inline bool
+od_console_filter_match(od_console_filter_t *filter,
+                        char *database,
+                        char *user,
+                        char *state)
+{
+	if (*filter->database && strcmp(filter->database, database) != 0)
+		return false;
+	if (*filter->user && strcmp(filter->user, user) != 0)
+		return false;
+	if (*filter->state && strcmp(filter->state, state) != 0)
+		return false;
+	return true;
+}
+
+static inline void
+od_console_snapshot_init(od_console_snapshot_t *snapshot,
+                         od_console_filter_t *filter,
+                         int row_size)
+{
+	memset(snapshot, 0, sizeof(od_console_snapshot_t));
+	snapshot->filter        = filter;
+	snapshot->row_size      = row_size;
+	snapshot->last_database = -1;
+	snapshot->last_user     = -1;
+}
+
+static inline void
+od_console_snapshot_free(od_console_snapshot_t *snapshot)
+{
+	if (snapshot->rows)
+		free(snapshot->rows);
+	if (snapshot->names)
+		free(snapshot->names);
+}
+
+/* -1 on error, 1 when the limit is reached */
+static inline int
+od_console_snapshot_status(od_console_snapshot_t *snapshot)
+{
+	if (snapshot->oom)
+		return -1;
+	if (snapshot->filter->limit != -1 &&
+	    snapshot->count >= snapshot->filter->limit)
+		return 1;
+	return 0;
+}
+
+static inline void *
+od_console_snapshot_row(od_console_snapshot_t *snapshot, int pos)
+{
+	return snapshot->rows + (size_t)pos * snapshot->row_size;
+}
+
+static inline void *
+od_console_snapshot_add(od_console_snapshot_t *snapshot)
+{
+	if (snapshot->count == snapshot->allocated) {
+		int allocated = snapshot->allocated ? snapshot->allocated * 2 : 64;
+		char *rows;
+		rows = realloc(snapshot->rows, (size_t)allocated * snapshot->row_size);
+		if (rows == NULL) {
+			snapshot->oom = true;
+			return NULL;
+		}
+		snapshot->rows      = rows;
+		snapshot->allocated = allocated;
+	}
+	void *row = od_console_snapshot_row(snapshot, snapshot->count);
+	memset(row, 0, snapshot->row_size);
+	snapshot->count++;
+	return row;
+}
+
+/* rows of the same route usually repeat names, keep one copy */
+static inline int
+od_console_snapshot_name(od_console_snapshot_t *snapshot, char *name, int *last)
+{
+	if (*last != -1 && strcmp(snapshot->names + *last, name) == 0)
+		return *last;
+	int len = strlen(name) + 1;
+	if (snapshot->names_size + len > snapshot->names_allocated) {
+		int allocated = snapshot->names_allocated * 2 + len + 1024;
+		char *names   = realloc(snapshot->names, allocated);
+		if (names == NULL) {
+			snapshot->oom = true;
+			return -1;
+		}
+		snapshot->names           = names;
+		snapshot->names_allocated = allocated;
+	}
+	*last = snapshot->names_size;
+	memcpy(snapshot->names + *last, name, len);
+	snapshot->names_size += len;
+	return *last;
+}
+
+static inline int
+od_console_snapshot_names(od_console_snapshot_t *snapshot,
+                          char *database,
+                          char *user,
+                          int *database_pos,
+                          int *user_pos)
+{
+	*database_pos =
+	  od_console_snapshot_name(snapshot, database, &snapshot->last_database);
+	if (*database_pos == -1)
+		return -1;
+	*user_pos = od_console_snapshot_name(snapshot, user, &snapshot->last_user);
+	if (*user_pos == -1)
+		return -1;
+	return 0;
+}
+
+/* write out the chunk once it is big enough, waiting for the client
+ * to read it, and continue with a new one */
+static inline int
+od_console_write_chunk(od_client_t *client, machine_msg_t **chunk, bool last)
+{
+	machine_msg_t *msg = *chunk;
+	if (!last && machine_msg_size(msg) < OD_CONSOLE_CHUNK)
+		return 0;
+	*chunk = NULL;
+	if (machine_msg_size(msg) == 0) {
+		machine_msg_free(msg);
+		return 0;
+	}
+	int rc;
+	rc = od_write(&client->io, msg);
+	if (rc == -1)
+		return -1;
+	if (last)
+		return 0;
+	*chunk = machine_msg_create(0);
+	if (*chunk == NULL)
+		return -1;
+	return 0;
+}
+typedef struct
+{
+	int database;
+	int user;
+	int client_active;
+	int client_pending;
+	int server_active;
+	int server_idle;
+	od_rule_pool_type_t pool;
+	uint64_t recv_client;
+	uint64_t recv_server;
+	double quantiles[];
+} od_console_pool_t;
+
 static inline int
 od_console_show_pools_add_cb(od_route_t *route, void **argv)
+{
+	od_console_snapshot_t *snapshot = argv[0];
+	bool *extended                  = argv[1];
+	double *quantiles               = argv[2];
+	int *quantiles_count            = argv[3];
+
+	int rc = od_console_snapshot_status(snapshot);
+	if (rc != 0)
+		return rc;
+	if (!od_console_filter_match(
+	      snapshot->filter, route->id.database, route->id.user, ""))
+		return 0;
+
+	od_console_pool_t *row;
+	row = od_console_snapshot_add(snapshot);
+	if (row == NULL)
+		return -1;
+	rc = od_console_snapshot_names(
+	  snapshot, route->id.database, route->id.user, &row->database, &row->user);
+	if (rc == -1)
+		return -1;
+
+	od_route_lock(route);
+	row->client_active  = route->client_pool.count_active;
+	row->client_pending = route->client_pool.count_pending;
+	row->server_active  = route->server_pool.count_active;
+	row->server_idle    = route->server_pool.count_idle;
+	row->pool           = route->rule->pool;
+	if (!*extended) {
+		od_route_unlock(route);
+		return 0;
+	}
+	row->recv_client = route->stats.recv_client;
+	row->recv_server = route->stats.recv_server;
+
+	td_histogram_t *transactions_hgram = td_new(QUANTILES_COMPRESSION);
+	td_histogram_t *queries_hgram      = td_new(QUANTILES_COMPRESSION);
+	td_histogram_t *freeze_hgram       = td_new(QUANTILES_COMPRESSION);
+	if (route->stats.enable_quantiles) {
+		for (size_t i = 0; i < QUANTILES_WINDOW; ++i) {
+			td_copy(freeze_hgram, route->stats.transaction_hgram[i]);
+			td_merge(transactions_hgram, freeze_hgram);
+			td_copy(freeze_hgram, route->stats.query_hgram[i]);
+			td_merge(queries_hgram, freeze_hgram);
+		}
+	}
+	od_route_unlock(route);
+
+	for (int i = 0; i < *quantiles_count; i++) {
+		double q = quantiles[i];
+		/* query quantile */
+		double query_quantile       = td_value_at(queries_hgram, q);
+		double transaction_quantile = td_value_at(transactions_hgram, q);
+		if (isnan(query_quantile)) {
+			query_quantile = 0;
+		}
+		if (isnan(transaction_quantile)) {
+			transaction_quantile = 0;
+		}
+		row->quantiles[i * 2]     = query_quantile;
+		row->quantiles[i * 2 + 1] = transaction_quantile;
+	}
+	td_safe_free(transactions_hgram);
+	td_safe_free(queries_hgram);
+	td_safe_free(freeze_hgram);
+	return 0;
+}
+
+static inline int
+od_console_show_pools_row(machine_msg_t *stream,
+                          od_console_snapshot_t *snapshot,
+                          od_console_pool_t *row,
+                          bool extended,
+                          int quantiles_count)
 {
 	int offset;
-	machine_msg_t *stream = argv[0];
-	bool *extended        = argv[1];
-	double *quantiles     = argv[2];
-	int *quantiles_count  = argv[3];
 	machine_msg_t *msg;
-	td_histogram_t *transactions_hgram = NULL;
-	td_histogram_t *queries_hgram      = NULL;
-	td_histogram_t *freeze_hgram       = NULL;
 	msg = kiwi_be_write_data_row(stream, &offset);
 	if (msg == NULL)
 		return -1;
-
-	od_route_lock(route);
+	char *name;
 	int rc;
-	rc = kiwi_be_write_data_row_add(
-	  stream, offset, route->id.database, route->id.database_len - 1);
+	name = snapshot->names + row->database;
+	rc   = kiwi_be_write_data_row_add(stream, offset, name, strlen(name));
 	if (rc == -1)
-		goto error;
-	rc = kiwi_be_write_data_row_add(
-	  stream, offset, route->id.user, route->id.user_len - 1);
+		return -1;
+	name = snapshot->names + row->user;
+	rc   = kiwi_be_write_data_row_add(stream, offset, name, strlen(name));
 	if (rc == -1)
-		goto error;
+		return -1;
 	char data[64];
 	int data_len;
 
 	/* cl_active */
-	data_len =
-	  od_snprintf(data, sizeof(data), "%d", route->client_pool.count_active);
-	rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+	data_len = od_snprintf(data, sizeof(data), "%d", row->client_active);
+	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
-		goto error;
+		return -1;
 	/* cl_waiting */
-	data_len =
-	  od_snprintf(data, sizeof(data), "%d", route->client_pool.count_pending);
-	rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+	data_len = od_snprintf(data, sizeof(data), "%d", row->client_pending);
+	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
-		goto error;
+		return -1;
 	/* sv_active */
-	data_len =
-	  od_snprintf(data, sizeof(data), "%d", route->server_pool.count_active);
-	rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+	data_len = od_snprintf(data, sizeof(data), "%d", row->server_active);
+	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
-		goto error;
+		return -1;
 	/* sv_idle */
-	data_len =
-	  od_snprintf(data, sizeof(data), "%d", route->server_pool.count_idle);
-	rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+	data_len = od_snprintf(data, sizeof(data), "%d", row->server_idle);
+	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
-		goto error;
+		return -1;
 	/* sv_used */
 	data_len = od_snprintf(data, sizeof(data), "%" PRIu64, 0UL);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
-		goto error;
+		return -1;
 	/* sv_tested */
 	data_len = od_snprintf(data, sizeof(data), "%" PRIu64, 0UL);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
-		goto error;
+		return -1;
 	/* sv_login */
 	data_len = od_snprintf(data, sizeof(data), "%" PRIu64, 0UL);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
-		goto error;
+		return -1;
 	/* maxwait */
 	data_len = od_snprintf(data, sizeof(data), "%" PRIu64, 0UL);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
-		goto error;
+		return -1;
 	/* maxwait_us */
 	data_len = od_snprintf(data, sizeof(data), "%" PRIu64, 0UL);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
-		goto error;
+		return -1;
 
 	/* pool_mode */
 	rc = -1;
-	if (route->rule->pool == OD_RULE_POOL_SESSION)
+	if (row->pool == OD_RULE_POOL_SESSION)
 		rc = kiwi_be_write_data_row_add(stream, offset, "session", 7);
-	if (route->rule->pool == OD_RULE_POOL_TRANSACTION)
+	if (row->pool == OD_RULE_POOL_TRANSACTION)
 		rc = kiwi_be_write_data_row_add(stream, offset, "transaction", 11);
 	if (rc == -1)
-		goto error;
+		return -1;
 
-	if (*extended) {
-		/* bytes recived */
-		data_len =
-		  od_snprintf(data, sizeof(data), "%" PRIu64, route->stats.recv_client);
-		rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
-		if (rc == -1)
-			goto error;
-		/* bytes sent */
-		data_len =
-		  od_snprintf(data, sizeof(data), "%" PRIu64, route->stats.recv_server);
+	if (!extended)
+		return 0;
+
+	/* bytes recived */
+	data_len = od_snprintf(data, sizeof(data), "%" PRIu64, row->recv_client);
+	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+	if (rc == -1)
+		return -1;
+	/* bytes sent */
+	data_len = od_snprintf(data, sizeof(data), "%" PRIu64, row->recv_server);
+	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+	if (rc == -1)
+		return -1;
+	/* query and transaction quantiles */
+	for (int i = 0; i < quantiles_count * 2; i++) {
+		data_len = od_snprintf(
+		  data, sizeof(data), "%" PRIu64, (uint64_t)row->quantiles[i]);
 		rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 		if (rc == -1)
-			goto error;
-		transactions_hgram = td_new(QUANTILES_COMPRESSION);
-		queries_hgram      = td_new(QUANTILES_COMPRESSION);
-		freeze_hgram       = td_new(QUANTILES_COMPRESSION);
-		if (route->stats.enable_quantiles) {
-			for (size_t i = 0; i < QUANTILES_WINDOW; ++i) {
-				td_copy(freeze_hgram, route->stats.transaction_hgram[i]);
-				td_merge(transactions_hgram, freeze_hgram);
-				td_copy(freeze_hgram, route->stats.query_hgram[i]);
-				td_merge(queries_hgram, freeze_hgram);
-			}
-		}
-		for (int i = 0; i < *quantiles_count; i++) {
-			double q = quantiles[i];
-			/* query quantile */
-			double query_quantile       = td_value_at(queries_hgram, q);
-			double transaction_quantile = td_value_at(transactions_hgram, q);
-			if (isnan(query_quantile)) {
-				query_quantile = 0;
-			}
-			if (isnan(transaction_quantile)) {
-				transaction_quantile = 0;
-			}
-			data_len = od_snprintf(
-			  data, sizeof(data), "%" PRIu64, (uint64_t)query_quantile);
-			rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
-			if (rc == -1)
-				goto error;
-			/* transaction quantile */
-			data_len = od_snprintf(
-			  data, sizeof(data), "%" PRIu64, (uint64_t)transaction_quantile);
-			rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
-			if (rc == -1)
-				goto error;
-		}
+			return -1;
 	}
-	td_safe_free(transactions_hgram);
-	td_safe_free(queries_hgram);
-	td_safe_free(freeze_hgram);
-	od_route_unlock(route);
 	return 0;
-error:
-	td_safe_free(transactions_hgram);
-	td_safe_free(queries_hgram);
-	td_safe_free(freeze_hgram);
-	od_route_unlock(route);
-	return -1;
 }
 
 static inline int
@@ -540,7 +958,7 @@ od_console_show_databases_add_cb(od_route_t *route, void **argv)
 	if (rc == -1)
 		goto error;
 	od_rule_t *rule            = route->rule;
-	od_rule_storage_t *storage = rule->storage;
+	od_rule_storage_t *storage = route->storage;
 
 	char *host = storage->host;
 	if (!host)
@@ -659,19 +1077,42 @@ od_console_show_databases(od_client_t *client, machine_msg_t *stream)
 }
 
 static inline int
-od_console_show_pools(od_client_t *client, machine_msg_t *stream, bool extended)
+od_console_show_pools(od_client_t *client,
+                      machine_msg_t *stream,
+                      od_parser_t *parser,
+                      bool extended)
 {
 	assert(stream);
 	int rc;
 	od_router_t *router = client->global->router;
 	od_route_t *route   = client->route;
 	double *quantiles   = route->rule->quantiles;
-	int quantiles_count = route->rule->quantiles_count;
+	int quantiles_count = extended ? route->rule->quantiles_count : 0;
 
-	machine_msg_t *msg;
-	msg = kiwi_be_write_row_descriptionf(stream,
-	                                     "ssllllllllls",
-	                                     "database",
+	od_console_filter_t filter;
+	rc = od_console_parse_filter(parser, &filter, false);
+	if (rc == -1)
+		return -1;
+
+	od_console_snapshot_t snapshot;
+	od_console_snapshot_init(&snapshot,
+	                         &filter,
+	                         sizeof(od_console_pool_t) +
+	                           sizeof(double) * quantiles_count * 2);
+	void *argv[] = { &snapshot, &extended, quantiles, &quantiles_count };
+	rc = od_router_foreach(router, od_console_show_pools_add_cb, argv);
+	if (rc == -1 || snapshot.oom) {
+		od_console_snapshot_free(&snapshot);
+		return -1;
+	}
+
+	machine_msg_t *chunk = machine_msg_create(0);
+	if (chunk == NULL)
+		goto error;
+	machine_msg_t *msg;
+	msg = kiwi_be_write_row_descriptionf(chunk,
+	                                     "ssllllllllls",
+	                                     "database",
 	                                     "user",
 	                                     "cl_active",
 	                                     "cl_waiting",
@@ -684,7 +1125,7 @@ od_console_show_pools(od_client_t *client, machine_msg_t *stream, bool extended)
 	                                     "maxwait_us",
 	                                     "pool_mode");
 	if (msg == NULL)
-		return -1;
+		goto error;
 
 	if (extended) {
 		char *bytes_rcv = "bytes_recieved";
@@ -699,7 +1140,7 @@ od_console_show_pools(od_client_t *client, machine_msg_t *stream, bool extended)
                                                0,
                                                0);
 		if (rc == -1)
-			return -1;
+			goto error;
 		char *bytes_sent = "bytes_sent";
 		rc               = kiwi_be_write_row_description_add(msg,
                                                0,
@@ -712,7 +1153,7 @@ od_console_show_pools(od_client_t *client, machine_msg_t *stream, bool extended)
                                                0,
                                                0);
 		if (rc == -1)
-			return -1;
+			goto error;
 
 		for (int i = 0; i < quantiles_count; i++) {
 			char caption[KIWI_MAX_VAR_SIZE];
@@ -722,130 +1163,150 @@ od_console_show_pools(od_client_t *client, machine_msg_t *stream, bool extended)
 			rc = kiwi_be_write_row_description_add(
 			  msg, 0, caption, caption_len, 0, 0, 23 /* INT4OID */, 4, 0, 0);
 			if (rc == -1)
-				return -1;
+				goto error;
 			caption_len = od_snprintf(
 			  caption, sizeof(caption), "transaction_%.6g", quantiles[i]);
 			rc = kiwi_be_write_row_description_add(
 			  msg, 0, caption, caption_len, 0, 0, 23 /* INT4OID */, 4, 0, 0);
 			if (rc == -1)
-				return -1;
+				goto error;
 		}
 	}
 
-	void *argv[] = { stream, &extended, quantiles, &quantiles_count };
-	rc = od_router_foreach(router, od_console_show_pools_add_cb, argv);
+	for (int i = 0; i < snapshot.count; i++) {
+		od_console_pool_t *row = od_console_snapshot_row(&snapshot, i);
+		rc = od_console_show_pools_row(
+		  chunk, &snapshot, row, extended, quantiles_count);
+		if (rc == -1)
+			goto error;
+		rc = od_console_write_chunk(client, &chunk, false);
+		if (rc == -1)
+			goto error;
+	}
+	rc = od_console_write_chunk(client, &chunk, true);
 	if (rc == -1)
-		return -1;
+		goto error;
+	od_console_snapshot_free(&snapshot);
 
 	return kiwi_be_write_complete(stream, "SHOW", 5);
+error:
+	if (chunk)
+		machine_msg_free(chunk);
+	od_console_snapshot_free(&snapshot);
+	return -1;
 }
 
 static inline int
-od_console_show_servers_server_cb(od_server_t *server, void **argv)
+od_console_link_id(char *data, int size, od_id_t *id)
 {
-	od_route_t *route = server->route;
+	if (id->id_prefix == NULL)
+		return od_snprintf(data, size, "%s", "");
+	return od_snprintf(
+	  data, size, "%s%.*s", id->id_prefix, (signed)sizeof(id->id), id->id);
+}
 
-	int offset;
-	machine_msg_t *stream = argv[0];
-	machine_msg_t *msg;
-	msg = kiwi_be_write_data_row(stream, &offset);
-	if (msg == NULL)
-		return -1;
-	/* type */
-	char data[64];
-	size_t data_len;
-	data_len = od_snprintf(data, sizeof(data), "S");
+static inline int
+od_console_parse_id(od_parser_t *parser, od_id_t *id)
+{
+	od_token_t token;
 	int rc;
-	rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
-	if (rc == -1)
+	rc = od_parser_next(parser, &token);
+	if (rc != OD_PARSER_KEYWORD)
 		return -1;
-	/* user */
-	rc = kiwi_be_write_data_row_add(
-	  stream, offset, route->id.user, route->id.user_len - 1);
-	if (rc == -1)
+	/* skip id prefix */
+	if (token.value.string.size != (sizeof(id->id) + 1))
 		return -1;
-	/* database */
-	rc = kiwi_be_write_data_row_add(
-	  stream, offset, route->id.database, route->id.database_len - 1);
+	memcpy(id->id, token.value.string.pointer + 1, sizeof(id->id));
+	return 0;
+}
+
+typedef union
+{
+	struct sockaddr sa;
+	struct sockaddr_in in;
+	struct sockaddr_in6 in6;
+} od_console_addr_t;
+
+typedef struct
+{
+	char type;
+	char *state;
+	int database;
+	int user;
+	od_console_addr_t addr;
+	od_console_addr_t local_addr;
+	od_id_t id;
+	od_id_t link_id;
+} od_console_session_t;
+
+static inline void
+od_console_session_addr(machine_io_t *io, od_console_addr_t *addr, bool local)
+{
+	struct sockaddr_storage sa;
+	int salen = sizeof(sa);
+	int rc;
+	if (local)
+		rc = machine_getsockname(io, (struct sockaddr *)&sa, &salen);
+	else
+		rc = machine_getpeername(io, (struct sockaddr *)&sa, &salen);
+	if (rc < 0) {
+		addr->sa.sa_family = AF_UNSPEC;
+		return;
+	}
+	if (salen > (int)sizeof(od_console_addr_t))
+		salen = sizeof(od_console_addr_t);
+	memcpy(addr, &sa, salen);
+}
+
+static inline int
+od_console_session_add(od_console_snapshot_t *snapshot,
+                       char type,
+                       char *state,
+                       char *database,
+                       char *user,
+                       machine_io_t *io,
+                       od_id_t *id,
+                       od_registry_node_t *registry)
+{
+	int rc = od_console_snapshot_status(snapshot);
+	if (rc != 0)
+		return rc;
+	if (!od_console_filter_match(snapshot->filter, database, user, state))
+		return 0;
+	od_console_session_t *row;
+	row = od_console_snapshot_add(snapshot);
+	if (row == NULL)
+		return -1;
+	rc = od_console_snapshot_names(
+	  snapshot, database, user, &row->database, &row->user);
 	if (rc == -1)
 		return -1;
-	/* state */
-	char *state = "";
+	row->type  = type;
+	row->state = state;
+	od_console_session_addr(io, &row->addr, false);
+	od_console_session_addr(io, &row->local_addr, true);
+	row->id      = *id;
+	row->link_id = registry->link_id;
+	return 0;
+}
+
+static inline int
+od_console_show_servers_server_cb(od_server_t *server, void **argv)
+{
+	od_route_t *route = server->route;
+	char *state       = "";
 	if (server->state == OD_SERVER_IDLE)
 		state = "idle";
 	else if (server->state == OD_SERVER_ACTIVE)
 		state = "active";
-	rc = kiwi_be_write_data_row_add(stream, offset, state, strlen(state));
-	if (rc == -1)
-		return -1;
-	/* addr */
-	od_getpeername(server->io.io, data, sizeof(data), 1, 0);
-	data_len = strlen(data);
-	rc       = kiwi_be_write_data_row_add(msg, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	/* port */
-	od_getpeername(server->io.io, data, sizeof(data), 0, 1);
-	data_len = strlen(data);
-	rc       = kiwi_be_write_data_row_add(msg, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	/* local_addr */
-	od_getsockname(server->io.io, data, sizeof(data), 1, 0);
-	data_len = strlen(data);
-	rc       = kiwi_be_write_data_row_add(msg, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	/* local_port */
-	od_getsockname(server->io.io, data, sizeof(data), 0, 1);
-	data_len = strlen(data);
-	rc       = kiwi_be_write_data_row_add(msg, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	/* connect_time */
-	rc = kiwi_be_write_data_row_add(msg, offset, NULL, -1);
-	if (rc == -1)
-		return -1;
-	/* request_time */
-	rc = kiwi_be_write_data_row_add(msg, offset, NULL, -1);
-	if (rc == -1)
-		return -1;
-	/* wait */
-	data_len = od_snprintf(data, sizeof(data), "0");
-	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	/* wait_us */
-	data_len = od_snprintf(data, sizeof(data), "0");
-	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	/* ptr */
-	data_len = od_snprintf(data,
-	                       sizeof(data),
-	                       "%s%.*s",
-	                       server->id.id_prefix,
-	                       (signed)sizeof(server->id.id),
-	                       server->id.id);
-	rc       = kiwi_be_write_data_row_add(msg, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	/* link */
-	data_len = od_snprintf(data, sizeof(data), "%s", "");
-	rc       = kiwi_be_write_data_row_add(msg, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	/* remote_pid */
-	data_len = od_snprintf(data, sizeof(data), "0");
-	rc       = kiwi_be_write_data_row_add(msg, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	/* tls */
-	data_len = od_snprintf(data, sizeof(data), "%s", "");
-	rc       = kiwi_be_write_data_row_add(msg, offset, data, data_len);
-	if (rc == -1)
-		return -1;
-	return 0;
+	return od_console_session_add(argv[0],
+	                              'S',
+	                              state,
+	                              route->id.database,
+	                              route->id.user,
+	                              server->io.io,
+	                              &server->id,
+	                              &server->registry);
 }
 
 static inline int
@@ -864,15 +1325,12 @@ od_console_show_servers_cb(od_route_t *route, void **argv)
 	                       argv);
 
 	od_route_unlock(route);
-	return 0;
+	return od_console_snapshot_status(argv[0]);
 }
 
 static inline int
-od_console_show_servers(od_client_t *client, machine_msg_t *stream)
+od_console_show_sessions_header(machine_msg_t *stream)
 {
-	assert(stream);
-	od_router_t *router = client->global->router;
-
 	machine_msg_t *msg;
 	msg = kiwi_be_write_row_descriptionf(stream,
 	                                     "sssssdsdssddssds",
@@ -894,18 +1352,15 @@ od_console_show_servers(od_client_t *client, machine_msg_t *stream)
 	                                     "tls");
 	if (msg == NULL)
 		return -1;
-
-	void *argv[] = { stream };
-	od_router_foreach(router, od_console_show_servers_cb, argv);
-
-	return kiwi_be_write_complete(stream, "SHOW", 5);
+	return 0;
 }
 
 static inline int
-od_console_show_clients_callback(od_client_t *client, void **argv)
+od_console_show_sessions_row(machine_msg_t *stream,
+                             od_console_snapshot_t *snapshot,
+                             od_console_session_t *row)
 {
 	int offset;
-	machine_msg_t *stream = argv[0];
 	machine_msg_t *msg;
 	msg = kiwi_be_write_data_row(stream, &offset);
 	if (msg == NULL)
@@ -913,56 +1368,45 @@ od_console_show_clients_callback(od_client_t *client, void **argv)
 	char data[64];
 	size_t data_len;
 	/* type */
-	data_len = od_snprintf(data, sizeof(data), "C");
 	int rc;
-	rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+	rc = kiwi_be_write_data_row_add(stream, offset, &row->type, 1);
 	if (rc == -1)
 		return -1;
 	/* user */
-	rc = kiwi_be_write_data_row_add(stream,
-	                                offset,
-	                                client->startup.user.value,
-	                                client->startup.user.value_len - 1);
+	char *name = snapshot->names + row->user;
+	rc         = kiwi_be_write_data_row_add(stream, offset, name, strlen(name));
 	if (rc == -1)
 		return -1;
 	/* database */
-	rc = kiwi_be_write_data_row_add(stream,
-	                                offset,
-	                                client->startup.database.value,
-	                                client->startup.database.value_len - 1);
+	name = snapshot->names + row->database;
+	rc   = kiwi_be_write_data_row_add(stream, offset, name, strlen(name));
 	if (rc == -1)
 		return -1;
 	/* state */
-	char *state = "";
-	if (client->state == OD_CLIENT_ACTIVE)
-		state = "active";
-	else if (client->state == OD_CLIENT_PENDING)
-		state = "pending";
-	else if (client->state == OD_CLIENT_QUEUE)
-		state = "queue";
-	rc = kiwi_be_write_data_row_add(stream, offset, state, strlen(state));
+	rc = kiwi_be_write_data_row_add(
+	  stream, offset, row->state, strlen(row->state));
 	if (rc == -1)
 		return -1;
 	/* addr */
-	od_getpeername(client->io.io, data, sizeof(data), 1, 0);
+	od_getsockaddrname(&row->addr.sa, data, sizeof(data), 1, 0);
 	data_len = strlen(data);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
 		return -1;
 	/* port */
-	od_getpeername(client->io.io, data, sizeof(data), 0, 1);
+	od_getsockaddrname(&row->addr.sa, data, sizeof(data), 0, 1);
 	data_len = strlen(data);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
 		return -1;
 	/* local_addr */
-	od_getsockname(client->io.io, data, sizeof(data), 1, 0);
+	od_getsockaddrname(&row->local_addr.sa, data, sizeof(data), 1, 0);
 	data_len = strlen(data);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
 		return -1;
 	/* local_port */
-	od_getsockname(client->io.io, data, sizeof(data), 0, 1);
+	od_getsockaddrname(&row->local_addr.sa, data, sizeof(data), 0, 1);
 	data_len = strlen(data);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
@@ -989,14 +1433,14 @@ od_console_show_clients_callback(od_client_t *client, void **argv)
 	data_len = od_snprintf(data,
 	                       sizeof(data),
 	                       "%s%.*s",
-	                       client->id.id_prefix,
-	                       (signed)sizeof(client->id.id),
-	                       client->id.id);
+	                       row->id.id_prefix,
+	                       (signed)sizeof(row->id.id),
+	                       row->id.id);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
 		return -1;
 	/* link */
-	data_len = od_snprintf(data, sizeof(data), "%s", "");
+	data_len = od_console_link_id(data, sizeof(data), &row->link_id);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
 		return -1;
@@ -1013,6 +1457,115 @@ od_console_show_clients_callback(od_client_t *client, void **argv)
 	return 0;
 }
 
+static inline int
+od_console_show_sessions(od_client_t *client,
+                         machine_msg_t *stream,
+                         od_console_snapshot_t *snapshot)
+{
+	machine_msg_t *chunk = machine_msg_create(0);
+	if (chunk == NULL)
+		return -1;
+	int rc;
+	rc = od_console_show_sessions_header(chunk);
+	if (rc == -1)
+		goto error;
+	for (int i = 0; i < snapshot->count; i++) {
+		od_console_session_t *row = od_console_snapshot_row(snapshot, i);
+		rc = od_console_show_sessions_row(chunk, snapshot, row);
+		if (rc == -1)
+			goto error;
+		rc = od_console_write_chunk(client, &chunk, false);
+		if (rc == -1)
+			goto error;
+	}
+	rc = od_console_write_chunk(client, &chunk, true);
+	if (rc == -1)
+		goto error;
+	return kiwi_be_write_complete(stream, "SHOW", 5);
+error:
+	if (chunk)
+		machine_msg_free(chunk);
+	return -1;
+}
+
+static inline int
+od_console_show_servers(od_client_t *client,
+                        machine_msg_t *stream,
+                        od_parser_t *parser)
+{
+	assert(stream);
+	od_router_t *router = client->global->router;
+
+	od_console_filter_t filter;
+	int rc;
+	rc = od_console_parse_filter(parser, &filter, true);
+	if (rc == -1)
+		return -1;
+
+	od_console_snapshot_t snapshot;
+	od_console_snapshot_init(&snapshot, &filter, sizeof(od_console_session_t));
+	void *argv[] = { &snapshot };
+	rc = od_router_foreach(router, od_console_show_servers_cb, argv);
+	if (rc != -1)
+		rc = od_console_show_sessions(client, stream, &snapshot);
+	od_console_snapshot_free(&snapshot);
+	return rc;
+}
+
+static inline int
+od_console_show_server_cb(od_registry_node_t *node, void **argv)
+{
+	od_server_t *server;
+	server = od_container_of(node, od_server_t, registry);
+	return od_console_show_servers_server_cb(server, argv);
+}
+
+static inline int
+od_console_show_server(od_client_t *client,
+                       machine_msg_t *stream,
+                       od_parser_t *parser)
+{
+	assert(stream);
+	od_id_t id;
+	int rc;
+	rc = od_console_parse_id(parser, &id);
+	if (rc == -1)
+		return -1;
+
+	od_console_filter_t filter;
+	memset(&filter, 0, sizeof(filter));
+	filter.limit = -1;
+	od_console_snapshot_t snapshot;
+	od_console_snapshot_init(&snapshot, &filter, sizeof(od_console_session_t));
+	void *argv[] = { &snapshot };
+	rc = od_registry_find(
+	  &od_registry_servers, &id, od_console_show_server_cb, argv);
+	if (rc != -1)
+		rc = od_console_show_sessions(client, stream, &snapshot);
+	od_console_snapshot_free(&snapshot);
+	return rc;
+}
+
+static inline int
+od_console_show_clients_callback(od_client_t *client, void **argv)
+{
+	char *state = "";
+	if (client->state == OD_CLIENT_ACTIVE)
+		state = "active";
+	else if (client->state == OD_CLIENT_PENDING)
+		state = "pending";
+	else if (client->state == OD_CLIENT_QUEUE)
+		state = "queue";
+	return od_console_session_add(argv[0],
+	                              'C',
+	                              state,
+	                              client->cold->startup.database.value,
+	                              client->cold->startup.user.value,
+	                              client->io.io,
+	                              &client->id,
+	                              &client->registry);
+}
+
 static inline int
 od_console_show_clients_cb(od_route_t *route, void **argv)
 {
@@ -1034,60 +1587,547 @@ od_console_show_clients_cb(od_route_t *route, void **argv)
 	                       argv);
 
 	od_route_unlock(route);
-	return 0;
+	return od_console_snapshot_status(argv[0]);
 }
 
 static inline int
-od_console_show_clients(od_client_t *client, machine_msg_t *stream)
+od_console_show_clients(od_client_t *client,
+                        machine_msg_t *stream,
+                        od_parser_t *parser)
 {
 	assert(stream);
 	od_router_t *router = client->global->router;
 
+	od_console_filter_t filter;
+	int rc;
+	rc = od_console_parse_filter(parser, &filter, true);
+	if (rc == -1)
+		return -1;
+
+	od_console_snapshot_t snapshot;
+	od_console_snapshot_init(&snapshot, &filter, sizeof(od_console_session_t));
+	void *argv[] = { &snapshot };
+	rc = od_router_foreach(router, od_console_show_clients_cb, argv);
+	if (rc != -1)
+		rc = od_console_show_sessions(client, stream, &snapshot);
+	od_console_snapshot_free(&snapshot);
+	return rc;
+}
+
+static inline int
+od_console_show_client_cb(od_registry_node_t *node, void **argv)
+{
+	od_client_t *client;
+	client = od_container_of(node, od_client_t, registry);
+	return od_console_show_clients_callback(client, argv);
+}
+
+static inline int
+od_console_show_client(od_client_t *client,
+                       machine_msg_t *stream,
+                       od_parser_t *parser)
+{
+	assert(stream);
+	od_id_t id;
+	int rc;
+	rc = od_console_parse_id(parser, &id);
+	if (rc == -1)
+		return -1;
+
+	od_console_filter_t filter;
+	memset(&filter, 0, sizeof(filter));
+	filter.limit = -1;
+	od_console_snapshot_t snapshot;
+	od_console_snapshot_init(&snapshot, &filter, sizeof(od_console_session_t));
+	void *argv[] = { &snapshot };
+	rc = od_registry_find(
+	  &od_registry_clients, &id, od_console_show_client_cb, argv);
+	if (rc != -1)
+		rc = od_console_show_sessions(client, stream, &snapshot);
+	od_console_snapshot_free(&snapshot);
+	return rc;
+}
+
+static inline int
+od_console_show_lists_add(machine_msg_t *stream, char *list, int items)
+{
+	int offset;
+	machine_msg_t *msg;
+	msg = kiwi_be_write_data_row(stream, &offset);
+	if (msg == NULL)
+		return -1;
+	/* list */
+	int rc;
+	rc = kiwi_be_write_data_row_add(stream, offset, list, strlen(list));
+	if (rc == -1)
+		return -1;
+	/* items */
+	char data[64];
+	int data_len;
+	data_len = od_snprintf(data, sizeof(data), "%d", items);
+	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+	if (rc == -1)
+		return -1;
+	return 0;
+}
+
+static inline int
+od_console_show_lists_cb(od_route_t *route, void **argv)
+{
+	od_route_lock(route);
+
+	int *used_servers = argv[0];
+	int *free_servers = argv[1];
+	(*used_servers) += route->server_pool.count_active;
+	(*free_servers) += route->server_pool.count_idle;
+
+	od_route_unlock(route);
+	return 0;
+}
+
+static inline int
+od_console_show_lists(od_client_t *client, machine_msg_t *stream)
+{
+	assert(stream);
+	od_router_t *router = client->global->router;
+
+	/* Gather router information.
+
+	   router_used_servers can be inconsistent here, since it depends on
+	   separate route locks.
+	*/
+	od_router_lock(router);
+
+	int router_used_servers = 0;
+	int router_free_servers = 0;
+	int router_pools        = router->route_pool.count;
+	int router_clients      = od_atomic_u32_of(&router->clients);
+
+	void *argv[] = { &router_used_servers, &router_free_servers };
+	od_route_pool_foreach(&router->route_pool, od_console_show_lists_cb, argv);
+
+	od_router_unlock(router);
+
+	machine_msg_t *msg;
+	msg = kiwi_be_write_row_descriptionf(stream, "sd", "list", "items");
+	if (msg == NULL)
+		return -1;
+	int rc;
+	/* databases */
+	rc = od_console_show_lists_add(stream, "databases", 0);
+	if (rc == -1)
+		return -1;
+	/* users */
+	rc = od_console_show_lists_add(stream, "users", 0);
+	if (rc == -1)
+		return -1;
+	/* pools */
+	rc = od_console_show_lists_add(stream, "pools", router_pools);
+	if (rc == -1)
+		return -1;
+	/* free_clients */
+	rc = od_console_show_lists_add(stream, "free_clients", 0);
+	if (rc == -1)
+		return -1;
+	/* used_clients */
+	rc = od_console_show_lists_add(stream, "used_clients", router_clients);
+	if (rc == -1)
+		return -1;
+	/* login_clients */
+	rc = od_console_show_lists_add(stream, "login_clients", 0);
+	if (rc == -1)
+		return -1;
+	/* free_servers */
+	rc = od_console_show_lists_add(stream, "free_servers", router_free_servers);
+	if (rc == -1)
+		return -1;
+	/* used_servers */
+	rc = od_console_show_lists_add(stream, "used_servers", router_used_servers);
+	if (rc == -1)
+		return -1;
+	/* dns_names */
+	rc = od_console_show_lists_add(stream, "dns_names", 0);
+	if (rc == -1)
+		return -1;
+	/* dns_zones */
+	rc = od_console_show_lists_add(stream, "dns_zones", 0);
+	if (rc == -1)
+		return -1;
+	/* dns_queries */
+	rc = od_console_show_lists_add(stream, "dns_queries", 0);
+	if (rc == -1)
+		return -1;
+	/* dns_pending */
+	rc = od_console_show_lists_add(stream, "dns_pending", 0);
+	if (rc == -1)
+		return -1;
+	return kiwi_be_write_complete(stream, "SHOW", 5);
+}
+
+static inline int
+od_console_show_top_clients_add(machine_msg_t *stream,
+                                od_route_t *route,
+                                char *type,
+                                od_sketch_report_t *report)
+{
+	int offset;
+	machine_msg_t *msg;
+	msg = kiwi_be_write_data_row(stream, &offset);
+	if (msg == NULL)
+		return -1;
+	int rc;
+	/* database */
+	rc = kiwi_be_write_data_row_add(
+	  stream, offset, route->id.database, route->id.database_len - 1);
+	if (rc == -1)
+		return -1;
+	/* user */
+	rc = kiwi_be_write_data_row_add(
+	  stream, offset, route->id.user, route->id.user_len - 1);
+	if (rc == -1)
+		return -1;
+	/* type */
+	rc = kiwi_be_write_data_row_add(stream, offset, type, strlen(type));
+	if (rc == -1)
+		return -1;
+	/* key */
+	rc = kiwi_be_write_data_row_add(
+	  stream, offset, report->key.value, report->key.len);
+	if (rc == -1)
+		return -1;
+	/* connections, queries, bytes */
+	char data[64];
+	int data_len;
+	int metric;
+	for (metric = 0; metric < OD_SKETCH_METRIC_MAX; metric++) {
+		data_len =
+		  od_snprintf(data, sizeof(data), "%" PRIu64, report->values[metric]);
+		rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+		if (rc == -1)
+			return -1;
+	}
+	return 0;
+}
+
+static inline int
+od_console_show_top_clients_cb(od_route_t *route, void **argv)
+{
+	machine_msg_t *stream = argv[0];
+	if (route->top_addr == NULL)
+		return 0;
+
+	od_sketch_report_t *report;
+	report = malloc(sizeof(od_sketch_report_t) *
+	                od_sketch_report_max(route->top_addr));
+	if (report == NULL)
+		return -1;
+
+	int rc = 0;
+	int count;
+	int i;
+	count = od_sketch_report(route->top_addr, report);
+	for (i = 0; i < count && rc == 0; i++)
+		rc = od_console_show_top_clients_add(stream, route, "addr", &report[i]);
+
+	count = od_sketch_report(route->top_appname, report);
+	for (i = 0; i < count && rc == 0; i++)
+		rc = od_console_show_top_clients_add(
+		  stream, route, "application_name", &report[i]);
+
+	free(report);
+	return rc;
+}
+
+static inline int
+od_console_show_top_clients(od_client_t *client, machine_msg_t *stream)
+{
+	assert(stream);
+	od_router_t *router = client->global->router;
+
+	machine_msg_t *msg;
+	msg = kiwi_be_write_row_descriptionf(stream,
+	                                     "sssslll",
+	                                     "database",
+	                                     "user",
+	                                     "type",
+	                                     "key",
+	                                     "connections",
+	                                     "queries",
+	                                     "bytes");
+	if (msg == NULL)
+		return -1;
+
+	void *argv[] = { stream };
+	int rc;
+	rc = od_router_foreach(router, od_console_show_top_clients_cb, argv);
+	if (rc == -1)
+		return -1;
+
+	return kiwi_be_write_complete(stream, "SHOW", 5);
+}
+
+static inline int
+od_console_show_limits_cb(od_route_t *route, void **argv)
+{
+	machine_msg_t *stream = argv[0];
+	od_limit_t *limit          = &route->limit;
+	od_rule_t *rule            = route->rule;
+	od_rule_storage_t *storage = route->storage;
+	if (!limit->enabled && storage->server_max_active == 0 &&
+	    storage->server_queue_target == 0 && rule->query_timeout == 0 &&
+	    rule->transaction_timeout == 0 && rule->server_check_delay == 0)
+		return 0;
+
+	int offset;
+	machine_msg_t *msg;
+	msg = kiwi_be_write_data_row(stream, &offset);
+	if (msg == NULL)
+		return -1;
+	int rc;
+	/* database */
+	rc = kiwi_be_write_data_row_add(
+	  stream, offset, route->id.database, route->id.database_len - 1);
+	if (rc == -1)
+		return -1;
+	/* user */
+	rc = kiwi_be_write_data_row_add(
+	  stream, offset, route->id.user, route->id.user_len - 1);
+	if (rc == -1)
+		return -1;
+
+	uint64_t values[] = {
+		route->rule->limit_qps,
+		route->rule->limit_tps,
+		route->rule->limit_bytes_per_sec,
+		route->rule->limit_tx_max,
+		od_atomic_u32_of(&limit->tx_active),
+		od_atomic_u64_of(&limit->delayed[OD_LIMIT_QUERIES]),
+		od_atomic_u64_of(&limit->delayed[OD_LIMIT_TRANSACTIONS]),
+		od_atomic_u64_of(&limit->delayed[OD_LIMIT_BYTES]),
+		od_atomic_u64_of(&limit->delayed[OD_LIMIT_CONCURRENCY]),
+		od_atomic_u64_of(&limit->rejected[OD_LIMIT_QUERIES]),
+		od_atomic_u64_of(&limit->rejected[OD_LIMIT_TRANSACTIONS]),
+		od_atomic_u64_of(&limit->rejected[OD_LIMIT_BYTES]),
+		od_atomic_u64_of(&limit->rejected[OD_LIMIT_CONCURRENCY]),
+		od_atomic_u64_of(&route->count_shed),
+		od_atomic_u64_of(&route->count_query_timeout),
+		od_atomic_u64_of(&route->count_transaction_timeout),
+		od_atomic_u64_of(&route->count_check_failed),
+	};
+	char data[64];
+	int data_len;
+	size_t i;
+	for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		data_len = od_snprintf(data, sizeof(data), "%" PRIu64, values[i]);
+		rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+		if (rc == -1)
+			return -1;
+	}
+	return 0;
+}
+
+static inline int
+od_console_show_limits(od_client_t *client, machine_msg_t *stream)
+{
+	assert(stream);
+	od_router_t *router = client->global->router;
+
+	machine_msg_t *msg;
+	msg = kiwi_be_write_row_descriptionf(stream,
+	                                     "sslllllllllllllllll",
+	                                     "database",
+	                                     "user",
+	                                     "qps",
+	                                     "tps",
+	                                     "bytes_per_sec",
+	                                     "tx_max",
+	                                     "tx_active",
+	                                     "delayed_queries",
+	                                     "delayed_transactions",
+	                                     "delayed_bytes",
+	                                     "delayed_concurrency",
+	                                     "rejected_queries",
+	                                     "rejected_transactions",
+	                                     "rejected_bytes",
+	                                     "rejected_concurrency",
+	                                     "shed",
+	                                     "query_timeouts",
+	                                     "transaction_timeouts",
+	                                     "check_failures");
+	if (msg == NULL)
+		return -1;
+
+	void *argv[] = { stream };
+	int rc;
+	rc = od_router_foreach(router, od_console_show_limits_cb, argv);
+	if (rc == -1)
+		return -1;
+
+	return kiwi_be_write_complete(stream, "SHOW", 5);
+}
+
+static inline int
+od_console_show_cancels_cb(od_cancel_storage_t *state, void **argv)
+{
+	machine_msg_t *stream = argv[0];
+
+	int offset;
+	machine_msg_t *msg;
+	msg = kiwi_be_write_data_row(stream, &offset);
+	if (msg == NULL)
+		return -1;
+	int rc;
+	/* storage */
+	rc = kiwi_be_write_data_row_add(
+	  stream, offset, state->name, strlen(state->name));
+	if (rc == -1)
+		return -1;
+
+	uint64_t count_sent     = od_atomic_u64_of(&state->count_sent);
+	uint64_t latency_avg_us = 0;
+	if (count_sent > 0)
+		latency_avg_us = od_atomic_u64_of(&state->latency_us) / count_sent;
+	uint64_t values[] = {
+		od_atomic_u32_of(&state->active),
+		od_atomic_u32_of(&state->queued),
+		od_atomic_u64_of(&state->count_request),
+		count_sent,
+		od_atomic_u64_of(&state->count_dedup),
+		od_atomic_u64_of(&state->count_error),
+		latency_avg_us,
+		od_atomic_u64_of(&state->latency_max_us),
+	};
+	char data[64];
+	int data_len;
+	size_t i;
+	for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		data_len = od_snprintf(data, sizeof(data), "%" PRIu64, values[i]);
+		rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+		if (rc == -1)
+			return -1;
+	}
+	return 0;
+}
+
+static inline int
+od_console_show_cancels(od_client_t *client, machine_msg_t *stream)
+{
+	assert(stream);
+	od_cancel_dispatcher_t *dispatcher = client->global->cancel_dispatcher;
+
+	machine_msg_t *msg;
+	msg = kiwi_be_write_row_descriptionf(stream,
+	                                     "sllllllll",
+	                                     "storage",
+	                                     "active",
+	                                     "queued",
+	                                     "requests",
+	                                     "sent",
+	                                     "deduplicated",
+	                                     "errors",
+	                                     "avg_latency_us",
+	                                     "max_latency_us");
+	if (msg == NULL)
+		return -1;
+
+	void *argv[] = { stream };
+	int rc;
+	rc = od_cancel_dispatcher_foreach(
+	  dispatcher, od_console_show_cancels_cb, argv);
+	if (rc == -1)
+		return -1;
+
+	return kiwi_be_write_complete(stream, "SHOW", 5);
+}
+
+static inline int
+od_console_show_listeners_cb(od_notify_listener_t *listener, void **argv)
+{
+	machine_msg_t *stream = argv[0];
+
+	int offset;
+	machine_msg_t *msg;
+	msg = kiwi_be_write_data_row(stream, &offset);
+	if (msg == NULL)
+		return -1;
+	int rc;
+	/* storage */
+	rc = kiwi_be_write_data_row_add(
+	  stream, offset, listener->storage, strlen(listener->storage));
+	if (rc == -1)
+		return -1;
+	/* database */
+	rc = kiwi_be_write_data_row_add(
+	  stream, offset, listener->database, strlen(listener->database));
+	if (rc == -1)
+		return -1;
+
+	uint64_t values[] = {
+		listener->connected,
+		od_atomic_u32_of(&listener->count_channel),
+		od_atomic_u32_of(&listener->count_subscription),
+		od_atomic_u64_of(&listener->count_notify),
+		od_atomic_u64_of(&listener->count_delivered),
+		od_atomic_u64_of(&listener->count_dropped),
+	};
+	char data[64];
+	int data_len;
+	size_t i;
+	for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		data_len = od_snprintf(data, sizeof(data), "%" PRIu64, values[i]);
+		rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+		if (rc == -1)
+			return -1;
+	}
+	return 0;
+}
+
+static inline int
+od_console_show_listeners(od_client_t *client, machine_msg_t *stream)
+{
+	assert(stream);
+	od_notify_relay_t *relay = client->global->notify_relay;
+
 	machine_msg_t *msg;
 	msg = kiwi_be_write_row_descriptionf(stream,
-	                                     "sssssdsdssddssds",
-	                                     "type",
-	                                     "user",
+	                                     "ssllllll",
+	                                     "storage",
 	                                     "database",
-	                                     "state",
-	                                     "addr",
-	                                     "port",
-	                                     "local_addr",
-	                                     "local_port",
-	                                     "connect_time",
-	                                     "request_time",
-	                                     "wait",
-	                                     "wait_us",
-	                                     "ptr",
-	                                     "link",
-	                                     "remote_pid",
-	                                     "tls");
+	                                     "connected",
+	                                     "channels",
+	                                     "subscriptions",
+	                                     "notifications",
+	                                     "delivered",
+	                                     "dropped");
 	if (msg == NULL)
 		return -1;
 
 	void *argv[] = { stream };
-	od_router_foreach(router, od_console_show_clients_cb, argv);
+	int rc;
+	rc = od_notify_relay_foreach(relay, od_console_show_listeners_cb, argv);
+	if (rc == -1)
+		return -1;
 
 	return kiwi_be_write_complete(stream, "SHOW", 5);
 }
 
 static inline int
-od_console_show_lists_add(machine_msg_t *stream, char *list, int items)
+od_console_show_memory_add(machine_msg_t *stream, char *name, uint64_t value)
 {
 	int offset;
 	machine_msg_t *msg;
 	msg = kiwi_be_write_data_row(stream, &offset);
 	if (msg == NULL)
 		return -1;
-	/* list */
+	/* name */
 	int rc;
-	rc = kiwi_be_write_data_row_add(stream, offset, list, strlen(list));
+	rc = kiwi_be_write_data_row_add(stream, offset, name, strlen(name));
 	if (rc == -1)
 		return -1;
-	/* items */
+	/* value */
 	char data[64];
 	int data_len;
-	data_len = od_snprintf(data, sizeof(data), "%d", items);
+	data_len = od_snprintf(data, sizeof(data), "%" PRIu64, value);
 	rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
 	if (rc == -1)
 		return -1;
@@ -1095,96 +2135,139 @@ od_console_show_lists_add(machine_msg_t *stream, char *list, int items)
 }
 
 static inline int
-od_console_show_lists_cb(od_route_t *route, void **argv)
+od_console_show_memory(machine_msg_t *stream)
 {
-	od_route_lock(route);
+	assert(stream);
 
-	int *used_servers = argv[0];
-	int *free_servers = argv[1];
-	(*used_servers) += route->server_pool.count_active;
-	(*free_servers) += route->server_pool.count_idle;
+	od_memory_usage_t usage;
+	od_memory_usage(&usage);
+
+	od_counter_t *counter = &od_memory.counter;
+	struct
+	{
+		char *name;
+		uint64_t value;
+	} rows[] = {
+		{ "msg", usage.msg },
+		{ "iov", usage.iov },
+		{ "stack", usage.stack },
+		{ "readahead", usage.readahead },
+		{ "total", usage.total },
+		{ "limit", od_memory.limit },
+		{ "pressure", od_memory_pressure() },
+		{ "logins_rejected",
+		  od_counter_get_count(counter, OD_MEMORY_LOGIN_REJECTED) },
+		{ "reads_paused",
+		  od_counter_get_count(counter, OD_MEMORY_READ_PAUSED) },
+		{ "packets_rejected",
+		  od_counter_get_count(counter, OD_MEMORY_PACKET_REJECTED) },
+		{ "spool", od_atomic_u64_of(&od_spool_stat.memory) },
+		{ "spool_file", od_atomic_u64_of(&od_spool_stat.file) },
+		{ "spooled", od_atomic_u64_of(&od_spool_stat.spooled) },
+		{ "spool_releases", od_atomic_u64_of(&od_spool_stat.released) },
+	};
 
-	od_route_unlock(route);
-	return 0;
+	machine_msg_t *msg;
+	msg = kiwi_be_write_row_descriptionf(stream, "sl", "name", "value");
+	if (msg == NULL)
+		return -1;
+
+	size_t i;
+	for (i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+		int rc;
+		rc = od_console_show_memory_add(stream, rows[i].name, rows[i].value);
+		if (rc == -1)
+			return -1;
+	}
+
+	return kiwi_be_write_complete(stream, "SHOW", 5);
 }
 
 static inline int
-od_console_show_lists(od_client_t *client, machine_msg_t *stream)
+od_console_show_workers(od_client_t *client, machine_msg_t *stream)
 {
 	assert(stream);
-	od_router_t *router = client->global->router;
-
-	/* Gather router information.
-
-	   router_used_servers can be inconsistent here, since it depends on
-	   separate route locks.
-	*/
-	od_router_lock(router);
-
-	int router_used_servers = 0;
-	int router_free_servers = 0;
-	int router_pools        = router->route_pool.count;
-	int router_clients      = od_atomic_u32_of(&router->clients);
-
-	void *argv[] = { &router_used_servers, &router_free_servers };
-	od_route_pool_foreach(&router->route_pool, od_console_show_lists_cb, argv);
-
-	od_router_unlock(router);
+	od_worker_pool_t *worker_pool = client->global->worker_pool;
 
 	machine_msg_t *msg;
-	msg = kiwi_be_write_row_descriptionf(stream, "sd", "list", "items");
+	msg = kiwi_be_write_row_descriptionf(stream,
+	                                     "dsdddl",
+	                                     "id",
+	                                     "state",
+	                                     "target",
+	                                     "clients",
+	                                     "load",
+	                                     "clients_processed");
 	if (msg == NULL)
 		return -1;
+
+	int target = od_atomic_u32_of(&worker_pool->target);
+	int i;
+	for (i = 0; i < worker_pool->count; i++) {
+		od_worker_t *worker     = &worker_pool->pool[i];
+		od_worker_state_t state = od_worker_state(worker);
+		if (state == OD_WORKER_IDLE)
+			continue;
+		int offset;
+		msg = kiwi_be_write_data_row(stream, &offset);
+		if (msg == NULL)
+			return -1;
+		char data[64];
+		int data_len;
+		/* id */
+		data_len = od_snprintf(data, sizeof(data), "%d", worker->id);
+		int rc;
+		rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+		if (rc == -1)
+			return -1;
+		/* state */
+		char *name = od_worker_state_name(state);
+		rc = kiwi_be_write_data_row_add(stream, offset, name, strlen(name));
+		if (rc == -1)
+			return -1;
+		/* target */
+		data_len = od_snprintf(data, sizeof(data), "%d", target);
+		rc       = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+		if (rc == -1)
+			return -1;
+		/* clients */
+		data_len = od_snprintf(
+		  data, sizeof(data), "%" PRIu32, od_atomic_u32_of(&worker->clients));
+		rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+		if (rc == -1)
+			return -1;
+		/* load */
+		data_len = od_snprintf(
+		  data, sizeof(data), "%" PRIu32, od_atomic_u32_of(&worker->load));
+		rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+		if (rc == -1)
+			return -1;
+		/* clients_processed */
+		data_len = od_snprintf(
+		  data, sizeof(data), "%" PRIu64, worker->clients_processed);
+		rc = kiwi_be_write_data_row_add(stream, offset, data, data_len);
+		if (rc == -1)
+			return -1;
+	}
+
+	return kiwi_be_write_complete(stream, "SHOW", 5);
+}
+
+static inline int
+od_console_show_top(od_client_t *client,
+                    machine_msg_t *stream,
+                    od_parser_t *parser)
+{
+	od_token_t token;
 	int rc;
-	/* databases */
-	rc = od_console_show_lists_add(stream, "databases", 0);
-	if (rc == -1)
-		return -1;
-	/* users */
-	rc = od_console_show_lists_add(stream, "users", 0);
-	if (rc == -1)
-		return -1;
-	/* pools */
-	rc = od_console_show_lists_add(stream, "pools", router_pools);
-	if (rc == -1)
-		return -1;
-	/* free_clients */
-	rc = od_console_show_lists_add(stream, "free_clients", 0);
-	if (rc == -1)
-		return -1;
-	/* used_clients */
-	rc = od_console_show_lists_add(stream, "used_clients", router_clients);
-	if (rc == -1)
-		return -1;
-	/* login_clients */
-	rc = od_console_show_lists_add(stream, "login_clients", 0);
-	if (rc == -1)
-		return -1;
-	/* free_servers */
-	rc = od_console_show_lists_add(stream, "free_servers", router_free_servers);
-	if (rc == -1)
-		return -1;
-	/* used_servers */
-	rc = od_console_show_lists_add(stream, "used_servers", router_used_servers);
-	if (rc == -1)
-		return -1;
-	/* dns_names */
-	rc = od_console_show_lists_add(stream, "dns_names", 0);
-	if (rc == -1)
-		return -1;
-	/* dns_zones */
-	rc = od_console_show_lists_add(stream, "dns_zones", 0);
-	if (rc == -1)
-		return -1;
-	/* dns_queries */
-	rc = od_console_show_lists_add(stream, "dns_queries", 0);
-	if (rc == -1)
+	rc = od_parser_next(parser, &token);
+	if (rc != OD_PARSER_KEYWORD)
 		return -1;
-	/* dns_pending */
-	rc = od_console_show_lists_add(stream, "dns_pending", 0);
-	if (rc == -1)
+	od_keyword_t *keyword;
+	keyword = od_keyword_match(od_console_keywords, &token);
+	if (keyword == NULL || keyword->id != OD_LCLIENTS)
 		return -1;
-	return kiwi_be_write_complete(stream, "SHOW", 5);
+	return od_console_show_top_clients(client, stream);
 }
 
 static inline int
@@ -1207,23 +2290,45 @@ od_console_show(od_client_t *client, machine_msg_t *stream, od_parser_t *parser)
 		return -1;
 	switch (keyword->id) {
 		case OD_LSTATS:
+			rc = od_parser_next(parser, &token);
+			if (rc == OD_PARSER_KEYWORD) {
+				keyword = od_keyword_match(od_console_keywords, &token);
+				if (keyword && keyword->id == OD_LHISTORY)
+					return od_console_show_stats_history(client, stream);
+			}
 			return od_console_show_stats(client, stream);
 		case OD_LPOOLS:
-			return od_console_show_pools(client, stream, false);
+			return od_console_show_pools(client, stream, parser, false);
 		case OD_LPOOLS_EXTENDED:
-			return od_console_show_pools(client, stream, true);
+			return od_console_show_pools(client, stream, parser, true);
 		case OD_LDATABASES:
 			return od_console_show_databases(client, stream);
 		case OD_LSERVERS:
-			return od_console_show_servers(client, stream);
+			return od_console_show_servers(client, stream, parser);
 		case OD_LCLIENTS:
-			return od_console_show_clients(client, stream);
+			return od_console_show_clients(client, stream, parser);
 		case OD_LLISTS:
 			return od_console_show_lists(client, stream);
 		case OD_LERRORS:
 			return od_console_show_errors(client, stream);
 		case OD_LVERSION:
 			return od_console_show_version(stream);
+		case OD_LTOP:
+			return od_console_show_top(client, stream, parser);
+		case OD_LLIMITS:
+			return od_console_show_limits(client, stream);
+		case OD_LCANCELS:
+			return od_console_show_cancels(client, stream);
+		case OD_LCLIENT:
+			return od_console_show_client(client, stream, parser);
+		case OD_LSERVER:
+			return od_console_show_server(client, stream, parser);
+		case OD_LLISTENERS:
+			return od_console_show_listeners(client, stream);
+		case OD_LMEMORY:
+			return od_console_show_memory(stream);
+		case OD_LWORKERS:
+			return od_console_show_workers(client, stream);
 	}
 	return -1;
 }
@@ -1234,15 +2339,11 @@ od_console_kill_client(od_client_t *client,
                        od_parser_t *parser)
 {
 	(void)stream;
-	od_token_t token;
-	int rc;
-	rc = od_parser_next(parser, &token);
-	if (rc != OD_PARSER_KEYWORD)
-		return -1;
 	od_id_t id;
-	if (token.value.string.size != (sizeof(id.id) + 1))
+	int rc;
+	rc = od_console_parse_id(parser, &id);
+	if (rc == -1)
 		return -1;
-	memcpy(id.id, token.value.string.pointer + 1, sizeof(id.id));
 
 	od_router_kill(client->global->router, &id);
 	return 0;
@@ -1259,10 +2360,226 @@ od_console_reload(od_client_t *client, machine_msg_t *stream)
 }
 
 static inline int
-od_console_set(od_client_t *client, machine_msg_t *stream)
+od_console_storage_servers_cb(od_route_t *route, void **argv)
+{
+	char *name  = argv[0];
+	int *active = argv[1];
+	int *idle   = argv[2];
+
+	od_route_lock(route);
+	if (strcmp(route->storage->name, name) == 0) {
+		*active += route->server_pool.count_active;
+		*idle += route->server_pool.count_idle;
+	}
+	od_route_unlock(route);
+	return 0;
+}
+
+static inline int
+od_console_storage_wait(od_router_t *router, char *name, bool active)
+{
+	/* idle servers of paused storage are closed by cron */
+	int waited = 0;
+	for (;;) {
+		int count_active = 0;
+		int count_idle   = 0;
+		void *argv[]     = { name, &count_active, &count_idle };
+		od_router_foreach(router, od_console_storage_servers_cb, argv);
+		int left = count_idle;
+		if (active)
+			left += count_active;
+		if (left == 0 || waited >= OD_CONSOLE_PAUSE_WAIT_MS)
+			return left;
+		machine_sleep(100);
+		waited += 100;
+	}
+}
+
+static inline int
+od_console_storage_error(od_client_t *client,
+                         machine_msg_t *stream,
+                         od_router_status_t status,
+                         char *name)
+{
+	machine_msg_t *msg;
+	switch (status) {
+		case OD_ROUTER_ERROR_NOT_FOUND:
+			msg = od_frontend_errorf(client,
+			                         stream,
+			                         KIWI_UNDEFINED_OBJECT,
+			                         "storage \"%s\" not found",
+			                         name);
+			break;
+		case OD_ROUTER_ERROR:
+			msg = od_frontend_errorf(client,
+			                         stream,
+			                         KIWI_OBJECT_NOT_IN_PREREQUISITE_STATE,
+			                         "storage \"%s\" is not paused",
+			                         name);
+			break;
+		default:
+			return -1;
+	}
+	if (msg == NULL)
+		return -1;
+	return 0;
+}
+
+static inline int
+od_console_pause(od_client_t *client,
+                 machine_msg_t *stream,
+                 od_parser_t *parser)
+{
+	od_instance_t *instance = client->global->instance;
+	od_router_t *router     = client->global->router;
+
+	char name[OD_CONSOLE_NAME_MAX];
+	int rc;
+	rc = od_console_parse_name(parser, name, sizeof(name));
+	if (rc == -1)
+		return -1;
+
+	od_router_status_t status;
+	status = od_router_pause(router, name);
+	if (status == OD_ROUTER_ERROR_NOT_FOUND)
+		return od_console_storage_error(client, stream, status, name);
+	if (status != OD_ROUTER_OK)
+		return -1;
+	od_log(&instance->logger, "console", NULL, NULL, "storage %s paused", name);
+
+	/* let in-flight transactions finish */
+	int left;
+	left = od_console_storage_wait(router, name, true);
+	if (left > 0) {
+		machine_msg_t *msg;
+		msg = od_frontend_infof(client,
+		                        stream,
+		                        "%d server connections of storage \"%s\" "
+		                        "are still in use",
+		                        left,
+		                        name);
+		if (msg == NULL)
+			return -1;
+	}
+	return kiwi_be_write_complete(stream, "PAUSE", 6);
+}
+
+static inline int
+od_console_resume(od_client_t *client,
+                  machine_msg_t *stream,
+                  od_parser_t *parser)
+{
+	od_instance_t *instance = client->global->instance;
+	od_router_t *router     = client->global->router;
+
+	char name[OD_CONSOLE_NAME_MAX];
+	int rc;
+	rc = od_console_parse_name(parser, name, sizeof(name));
+	if (rc == -1)
+		return -1;
+
+	/* do not hand out servers released during pause */
+	od_console_storage_wait(router, name, false);
+
+	od_router_status_t status;
+	status = od_router_resume(router, name);
+	if (status == OD_ROUTER_ERROR_NOT_FOUND)
+		return od_console_storage_error(client, stream, status, name);
+	if (status != OD_ROUTER_OK)
+		return -1;
+	od_log(
+	  &instance->logger, "console", NULL, NULL, "storage %s resumed", name);
+	return kiwi_be_write_complete(stream, "RESUME", 7);
+}
+
+static inline int
+od_console_retarget(od_client_t *client,
+                    machine_msg_t *stream,
+                    od_parser_t *parser)
+{
+	od_instance_t *instance = client->global->instance;
+	od_router_t *router     = client->global->router;
+
+	char name[OD_CONSOLE_NAME_MAX];
+	char host[OD_CONSOLE_NAME_MAX];
+	int rc;
+	rc = od_console_parse_name(parser, name, sizeof(name));
+	if (rc == -1)
+		return -1;
+	rc = od_console_parse_name(parser, host, sizeof(host));
+	if (rc == -1)
+		return -1;
+	od_token_t token;
+	rc = od_parser_next(parser, &token);
+	if (rc != OD_PARSER_NUM)
+		return -1;
+	if (token.value.num <= 0 || token.value.num > 65535)
+		return -1;
+	int port = token.value.num;
+
+	od_router_status_t status;
+	status = od_router_retarget(router, name, host, port);
+	if (status != OD_ROUTER_OK)
+		return od_console_storage_error(client, stream, status, name);
+	od_log(&instance->logger,
+	       "console",
+	       NULL,
+	       NULL,
+	       "storage %s retargeted to %s:%d",
+	       name,
+	       host,
+	       port);
+	return kiwi_be_write_complete(stream, "RETARGET", 9);
+}
+
+static inline int
+od_console_set(od_client_t *client, machine_msg_t *stream, od_parser_t *parser)
 {
-	(void)client;
-	/* reply success */
+	/* parameters other than workers are ignored */
+	od_token_t token;
+	int rc;
+	rc = od_parser_next(parser, &token);
+	if (rc != OD_PARSER_KEYWORD)
+		return kiwi_be_write_complete(stream, "SET", 4);
+	od_keyword_t *keyword;
+	keyword = od_keyword_match(od_console_keywords, &token);
+	if (keyword == NULL || keyword->id != OD_LWORKERS)
+		return kiwi_be_write_complete(stream, "SET", 4);
+
+	/* SET workers = n | SET workers TO n */
+	rc = od_parser_next(parser, &token);
+	if (rc == OD_PARSER_KEYWORD) {
+		keyword = od_keyword_match(od_console_keywords, &token);
+		if (keyword == NULL || keyword->id != OD_LTO)
+			return -1;
+	} else if (rc != OD_PARSER_SYMBOL || token.value.num != '=') {
+		return -1;
+	}
+	rc = od_parser_next(parser, &token);
+	if (rc != OD_PARSER_NUM)
+		return -1;
+	int64_t count = token.value.num;
+
+	od_instance_t *instance       = client->global->instance;
+	od_worker_pool_t *worker_pool = client->global->worker_pool;
+	if (count > INT32_MAX || od_worker_pool_resize(worker_pool, count) == -1) {
+		machine_msg_t *msg;
+		msg = od_frontend_errorf(client,
+		                         stream,
+		                         KIWI_INVALID_PARAMETER_VALUE,
+		                         "workers must be between 1 and workers_max "
+		                         "(%d)",
+		                         instance->config.workers_max);
+		if (msg == NULL)
+			return -1;
+		return 0;
+	}
+	od_log(&instance->logger,
+	       "console",
+	       NULL,
+	       NULL,
+	       "scaling to %d workers",
+	       (int)count);
 	return kiwi_be_write_complete(stream, "SET", 4);
 }
 
@@ -1429,6 +2746,9 @@ od_console_query(od_client_t *client,
 
 		return 0;
 	}
+	/* query string is zero-terminated */
+	if (query_len > 0 && query[query_len - 1] == 0)
+		query_len--;
 
 	if (instance->config.log_query)
 		od_debug(
@@ -1467,7 +2787,22 @@ od_console_query(od_client_t *client,
 				goto bad_query;
 			break;
 		case OD_LSET:
-			rc = od_console_set(client, stream);
+			rc = od_console_set(client, stream, &parser);
+			if (rc == -1)
+				goto bad_query;
+			break;
+		case OD_LPAUSE:
+			rc = od_console_pause(client, stream, &parser);
+			if (rc == -1)
+				goto bad_query;
+			break;
+		case OD_LRESUME:
+			rc = od_console_resume(client, stream, &parser);
+			if (rc == -1)
+				goto bad_query;
+			break;
+		case OD_LRETARGET:
+			rc = od_console_retarget(client, stream, &parser);
 			if (rc == -1)
 				goto bad_query;
 			break;
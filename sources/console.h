@@ -7,6 +7,9 @@
  * Scalable PostgreSQL connection pooler.
  */
 
+#define OD_CONSOLE_NAME_MAX 256
+#define OD_CONSOLE_PAUSE_WAIT_MS 10000
+
 int
 od_console_query(od_client_t *, machine_msg_t *, char *, uint32_t);
 
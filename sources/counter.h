@@ -1,4 +1,3 @@
-
 #ifndef ODYSSEY_COUNTER_H
 #define ODYSSEY_COUNTER_H
 
@@ -10,93 +9,56 @@
 
 #include <kiwi.h>
 #include "macro.h"
+#include "atomic.h"
+#include "status.h"
 
-/* llist stands for linked list */
-typedef struct od_hash_litem od_counter_litem_t;
-typedef struct od_hash_llist od_counter_llist_t;
-
-typedef size_t od_hash_table_key_t;
-/* support only int values for now */
-/* TODO: change value type to (void *) */
-typedef size_t od_counter_item_t;
-typedef size_t od_count_t;
+/*
+ * Per-thread event counter.
+ *
+ * Counted items are small dense enums (frontend and router statuses,
+ * memory events), the counter is sized by the frontend statuses. Each
+ * thread increments its own cache line aligned slot, so counting does
+ * not take locks and does not bounce cache lines between workers.
+ * Slots are drained by cron.
+ */
 
-struct od_hash_litem
-{
-	od_counter_item_t value;
-	od_count_t cnt;
+#define OD_COUNTER_ALIGN 64
+#define OD_COUNTER_SLOTS 32
+#define OD_COUNTER_MAX OD_FRONTEND_STATUS_MAX
 
-	od_counter_litem_t *next;
-};
+od_static_assert((int)OD_ROUTER_STATUS_MAX <= (int)OD_COUNTER_MAX,
+                 "router statuses do not fit into counter");
 
-struct od_hash_llist
-{
-	size_t count;
-	od_counter_litem_t *list;
-};
-
-extern od_counter_llist_t *
-od_counter_llist_create(void);
+typedef size_t od_counter_item_t;
+typedef uint64_t od_count_t;
 
-extern void
-od_counter_llist_add(od_counter_llist_t *llist, const od_counter_item_t *it);
+typedef struct od_counter_slot od_counter_slot_t;
+typedef struct od_counter od_counter_t;
 
-extern od_retcode_t
-od_counter_llist_free(od_counter_llist_t *l);
+struct od_counter_slot
+{
+	od_atomic_u64_t values[OD_COUNTER_MAX];
+} __attribute__((aligned(OD_COUNTER_ALIGN)));
 
-#define OD_DEFAULT_HASH_TABLE_SIZE 15
-typedef struct od_counter od_counter_t;
 struct od_counter
 {
-	od_counter_llist_t **buckets;
-	pthread_mutex_t *bucket_mutex;
-	size_t size;
+	od_counter_slot_t slots[OD_COUNTER_SLOTS];
 };
 
-extern od_counter_t *
-od_counter_create(size_t sz);
-
-extern od_counter_t *
-od_counter_create_default(void);
-
-extern od_retcode_t
-od_counter_free(od_counter_t *t);
-
-extern od_count_t
-od_counter_get_count(od_counter_t *t, od_counter_item_t value);
-
-extern od_retcode_t
-od_counter_reset(od_counter_t *t, od_counter_item_t value);
-
-extern od_retcode_t
-od_counter_reset_all(od_counter_t *t);
-
-extern od_retcode_t
-od_counter_erase(od_counter_t *t,
-                 od_hash_table_key_t key,
-                 od_counter_llist_t *item);
-
-extern void
-od_counter_inc(od_counter_t *t, od_counter_item_t item);
-
-static inline od_counter_item_t
-od_hash_item(od_counter_t *t, od_counter_item_t item)
+static inline void
+od_counter_init(od_counter_t *counter)
 {
-	/*
-	 * How to get hash of number in range 0 to MAXINT ?
-	 * there are many ways, we choose simplest one
-	 */
-	return item % t->size;
+	memset(counter, 0, sizeof(od_counter_t));
 }
 
-/* these are function to perform dynamic counter resize in case of overfit
- * TODO: implement them
- * */
+extern void
+od_counter_inc(od_counter_t *counter, od_counter_item_t item);
 
-extern od_retcode_t
-od_counter_resize_up(od_counter_t *t);
+extern od_count_t
+od_counter_get_count(od_counter_t *counter, od_counter_item_t item);
 
-extern od_retcode_t
-od_counter_resize_down(od_counter_t *t);
+/* move counted values into values[OD_COUNTER_MAX] and reset slots */
+extern void
+od_counter_drain(od_counter_t *counter, od_count_t *values);
 
 #endif // ODYSSEY_COUNTER_H
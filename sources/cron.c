@@ -13,11 +13,71 @@
 #include <ctype.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
 
 #include <machinarium.h>
 #include <kiwi.h>
 #include <odyssey.h>
 
+static inline void
+od_cron_stat_top(od_shm_stats_route_t *slot,
+                 od_sketch_t *sketch,
+                 od_shm_stats_top_type_t type)
+{
+	od_sketch_report_t *report;
+	report = malloc(sizeof(od_sketch_report_t) * od_sketch_report_max(sketch));
+	if (report == NULL)
+		return;
+	int count;
+	count = od_sketch_report(sketch, report);
+	if (count > OD_SHM_STATS_TOP_MAX)
+		count = OD_SHM_STATS_TOP_MAX;
+	int i;
+	for (i = 0; i < count; i++) {
+		od_shm_stats_top_t *top = &slot->top[slot->top_count++];
+		top->type               = type;
+		top->connections        = report[i].values[OD_SKETCH_CONNECTIONS];
+		top->queries            = report[i].values[OD_SKETCH_QUERIES];
+		top->bytes              = report[i].values[OD_SKETCH_BYTES];
+		memcpy(top->key, report[i].key.value, report[i].key.len + 1);
+	}
+	free(report);
+}
+
+static inline void
+od_cron_stat_history(od_shm_stats_route_t *slot, od_stats_history_t *history)
+{
+	uint32_t count = history->count;
+	uint32_t start = 0;
+	if (count > OD_SHM_STATS_HISTORY_MAX) {
+		start = count - OD_SHM_STATS_HISTORY_MAX;
+		count = OD_SHM_STATS_HISTORY_MAX;
+	}
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		uint32_t n = start + i;
+		slot->history_time[i] =
+		  od_stats_history_of(history, OD_STATS_HISTORY_TIME, n);
+		slot->history_tps[i] =
+		  od_stats_history_of(history, OD_STATS_HISTORY_TPS, n);
+		slot->history_qps[i] =
+		  od_stats_history_of(history, OD_STATS_HISTORY_QPS, n);
+		slot->history_tx_time[i] =
+		  od_stats_history_of(history, OD_STATS_HISTORY_TX_TIME, n);
+		slot->history_query_time[i] =
+		  od_stats_history_of(history, OD_STATS_HISTORY_QUERY_TIME, n);
+		slot->history_queue[i] =
+		  od_stats_history_of(history, OD_STATS_HISTORY_QUEUE, n);
+		slot->history_tx_p99[i] =
+		  od_stats_history_of(history, OD_STATS_HISTORY_TX_P99, n);
+		slot->history_query_p99[i] =
+		  od_stats_history_of(history, OD_STATS_HISTORY_QUERY_P99, n);
+	}
+	slot->history_count = count;
+}
+
 static int
 od_cron_stat_cb(od_route_t *route,
                 od_stat_t *current,
@@ -25,7 +85,7 @@ od_cron_stat_cb(od_route_t *route,
                 void **argv)
 {
 	od_instance_t *instance = argv[0];
-	(void)current;
+	od_cron_t *cron         = argv[1];
 
 	struct
 	{
@@ -72,6 +132,54 @@ od_cron_stat_cb(od_route_t *route,
 
 	od_route_unlock(route);
 
+	/* publish into shared memory segment */
+	if (od_shm_stats_is_open(&cron->shm_stats)) {
+		od_shm_stats_header_t *header = cron->shm_stats.header;
+		uint32_t *routes_count        = argv[2];
+		if (*routes_count < header->routes_max) {
+			od_shm_stats_route_t *slot;
+			slot = od_shm_stats_route_of(header, *routes_count);
+			(*routes_count)++;
+			memset(slot, 0, sizeof(*slot));
+			int len = info.database_len;
+			if (len >= (int)sizeof(slot->database))
+				len = sizeof(slot->database) - 1;
+			memcpy(slot->database, info.database, len);
+			len = info.user_len;
+			if (len >= (int)sizeof(slot->user))
+				len = sizeof(slot->user) - 1;
+			memcpy(slot->user, info.user, len);
+			slot->obsolete           = info.obsolete;
+			slot->client_pool_total  = info.client_pool_total;
+			slot->server_pool_active = info.server_pool_active;
+			slot->server_pool_idle   = info.server_pool_idle;
+			slot->count_query        = current->count_query;
+			slot->count_tx           = current->count_tx;
+			slot->query_time         = current->query_time;
+			slot->tx_time            = current->tx_time;
+			slot->recv_client        = current->recv_client;
+			slot->recv_server        = current->recv_server;
+			slot->avg_count_query    = info.avg_count_query;
+			slot->avg_count_tx       = info.avg_count_tx;
+			slot->avg_query_time     = info.avg_query_time;
+			slot->avg_tx_time        = info.avg_tx_time;
+			slot->avg_recv_client    = info.avg_recv_client;
+			slot->avg_recv_server    = info.avg_recv_server;
+			if (route->top_addr) {
+				od_cron_stat_top(
+				  slot, route->top_addr, OD_SHM_STATS_TOP_ADDR);
+				od_cron_stat_top(
+				  slot, route->top_appname, OD_SHM_STATS_TOP_APPNAME);
+			}
+			if (route->history)
+				od_cron_stat_history(slot, route->history);
+		}
+		header->global.routes++;
+	}
+
+	if (!instance->config.log_stats)
+		return 0;
+
 	od_log(&instance->logger,
 	       "stats",
 	       NULL,
@@ -107,8 +215,9 @@ od_cron_stat(od_cron_t *cron)
 	od_router_t *router           = cron->global->router;
 	od_instance_t *instance       = cron->global->instance;
 	od_worker_pool_t *worker_pool = cron->global->worker_pool;
+	od_shm_stats_header_t *header = cron->shm_stats.header;
 
-	if (instance->config.log_stats) {
+	if (instance->config.log_stats || header) {
 		/* system worker stats */
 		uint64_t count_coroutine       = 0;
 		uint64_t count_coroutine_cache = 0;
@@ -125,50 +234,288 @@ od_cron_stat(od_cron_t *cron)
 		             &msg_cache_count,
 		             &msg_cache_gc_count,
 		             &msg_cache_size);
-		od_log(&instance->logger,
-		       "stats",
-		       NULL,
-		       NULL,
-		       "system worker: msg (%" PRIu64 " allocated, %" PRIu64
-		       " cached, %" PRIu64 " freed, %" PRIu64 " cache_size), "
-		       "coroutines (%" PRIu64 " active, %" PRIu64
-		       " cached) startup errors %" PRIu64,
-		       msg_allocated,
-		       msg_cache_count,
-		       msg_cache_gc_count,
-		       msg_cache_size,
-		       count_coroutine,
-		       count_coroutine_cache,
-		       startup_errors);
+		if (instance->config.log_stats)
+			od_log(&instance->logger,
+			       "stats",
+			       NULL,
+			       NULL,
+			       "system worker: msg (%" PRIu64 " allocated, %" PRIu64
+			       " cached, %" PRIu64 " freed, %" PRIu64 " cache_size), "
+			       "coroutines (%" PRIu64 " active, %" PRIu64
+			       " cached) startup errors %" PRIu64,
+			       msg_allocated,
+			       msg_cache_count,
+			       msg_cache_gc_count,
+			       msg_cache_size,
+			       count_coroutine,
+			       count_coroutine_cache,
+			       startup_errors);
+
+		if (instance->config.log_stats && instance->config.huge_pages) {
+			uint64_t count_hugetlb = 0;
+			uint64_t count_thp     = 0;
+			uint64_t count_regular = 0;
+			uint64_t used          = 0;
+			machine_hugepage_stat(
+			  &count_hugetlb, &count_thp, &count_regular, &used);
+			od_log(&instance->logger,
+			       "stats",
+			       NULL,
+			       NULL,
+			       "huge pages: chunks (%" PRIu64 " hugetlb, %" PRIu64
+			       " thp, %" PRIu64 " regular), %" PRIu64 " bytes used",
+			       count_hugetlb,
+			       count_thp,
+			       count_regular,
+			       used);
+		}
+
+		if (instance->config.log_stats && instance->config.memory_limit) {
+			od_memory_usage_t usage;
+			od_memory_usage(&usage);
+			od_log(&instance->logger,
+			       "stats",
+			       NULL,
+			       NULL,
+			       "memory: msg %" PRIu64 ", iov %" PRIu64
+			       ", stack %" PRIu64 ", readahead %" PRIu64
+			       ", total %" PRIu64 " of %" PRIu64 " bytes",
+			       usage.msg,
+			       usage.iov,
+			       usage.stack,
+			       usage.readahead,
+			       usage.total,
+			       od_memory.limit);
+		}
 
 		/* request stats per worker */
 		int i;
 		for (i = 0; i < worker_pool->count; i++) {
-			od_worker_t *worker = &worker_pool->pool[i];
+			od_worker_t *worker     = &worker_pool->pool[i];
+			od_worker_state_t state = od_worker_state(worker);
+			if (state != OD_WORKER_RUNNING && state != OD_WORKER_DRAINING)
+				continue;
 			machine_msg_t *msg;
 			msg = machine_msg_create(0);
 			machine_msg_set_type(msg, OD_MSG_STAT);
 			machine_channel_write(worker->task_channel, msg);
 		}
 
-		od_log(&instance->logger,
-		       "stats",
-		       NULL,
-		       NULL,
-		       "clients %d",
-		       od_atomic_u32_of(&router->clients));
+		if (instance->config.log_stats)
+			od_log(&instance->logger,
+			       "stats",
+			       NULL,
+			       NULL,
+			       "clients %d",
+			       od_atomic_u32_of(&router->clients));
+
+		if (header) {
+			od_shm_stats_global_t *global = &header->global;
+			od_shm_stats_write_begin(&header->seq);
+			global->clients               = od_atomic_u32_of(&router->clients);
+			global->routes                = 0;
+			global->msg_allocated         = msg_allocated;
+			global->msg_cache_count       = msg_cache_count;
+			global->msg_cache_gc_count    = msg_cache_gc_count;
+			global->msg_cache_size        = msg_cache_size;
+			global->count_coroutine       = count_coroutine;
+			global->count_coroutine_cache = count_coroutine_cache;
+			global->startup_errors += startup_errors;
+		}
 	}
 
 	/* update stats per route and print info */
 	od_route_pool_stat_cb_t stat_cb;
 	stat_cb = od_cron_stat_cb;
-	if (!instance->config.log_stats)
+	if (!instance->config.log_stats && !header)
 		stat_cb = NULL;
-	void *argv[] = { instance };
+	uint32_t routes_count = 0;
+	void *argv[]          = { instance, cron, &routes_count };
 	od_router_stat(router, cron->stat_time_us, 1, stat_cb, argv);
 
 	/* update current stat time mark */
 	cron->stat_time_us = machine_time_us();
+
+	if (header) {
+		header->routes_count   = routes_count;
+		header->workers_count  = worker_pool->count;
+		header->update_time_us = od_shm_stats_time_us();
+		od_shm_stats_write_end(&header->seq);
+	}
+}
+
+static inline uint64_t
+od_cron_history_quantile(td_histogram_t *hgram, double q)
+{
+	double value = td_value_at(hgram, q);
+	if (isnan(value))
+		return 0;
+	return (uint64_t)value;
+}
+
+typedef struct
+{
+	od_route_t *route;
+	int quantiles;
+	uint64_t values[4];
+} od_cron_history_route_t;
+
+static inline int
+od_cron_history_snapshot_cb(od_route_t *route, void **argv)
+{
+	od_cron_history_route_t **routes = argv[0];
+	int *count                       = argv[1];
+	int *size                        = argv[2];
+	if (*count == *size) {
+		int size_new = *size > 0 ? *size * 2 : 64;
+		od_cron_history_route_t *routes_new;
+		routes_new =
+		  realloc(*routes, sizeof(od_cron_history_route_t) * size_new);
+		if (routes_new == NULL)
+			return -1;
+		*routes = routes_new;
+		*size   = size_new;
+	}
+	od_cron_history_route_t *item = &(*routes)[*count];
+	item->route                   = route;
+	item->quantiles               = 0;
+	(*count)++;
+	return 0;
+}
+
+/* quantiles over the route quantiles window, not over the last second */
+static inline void
+od_cron_history_quantiles(od_cron_history_route_t *item,
+                          td_histogram_t **hgram)
+{
+	od_route_t *route = item->route;
+	if (!route->stats.enable_quantiles)
+		return;
+	if (hgram[0] == NULL) {
+		hgram[0] = td_new(QUANTILES_COMPRESSION);
+		hgram[1] = td_new(QUANTILES_COMPRESSION);
+		hgram[2] = td_new(QUANTILES_COMPRESSION);
+	}
+	if (hgram[0] == NULL || hgram[1] == NULL || hgram[2] == NULL)
+		return;
+	td_reset(hgram[0]);
+	td_reset(hgram[1]);
+	int i;
+	for (i = 0; i < QUANTILES_WINDOW; i++) {
+		td_copy(hgram[2], route->stats.transaction_hgram[i]);
+		td_merge(hgram[0], hgram[2]);
+		td_copy(hgram[2], route->stats.query_hgram[i]);
+		td_merge(hgram[1], hgram[2]);
+	}
+	item->values[0] = od_cron_history_quantile(hgram[0], 0.5);
+	item->values[1] = od_cron_history_quantile(hgram[0], 0.99);
+	item->values[2] = od_cron_history_quantile(hgram[1], 0.5);
+	item->values[3] = od_cron_history_quantile(hgram[1], 0.99);
+	item->quantiles = 1;
+}
+
+static inline void
+od_cron_history_add(od_cron_history_route_t *item, uint32_t size)
+{
+	od_route_t *route = item->route;
+
+	/* history size changed by reload */
+	if (route->history && route->history->size != size) {
+		od_stats_history_free(route->history);
+		route->history = NULL;
+	}
+	if (size == 0)
+		return;
+
+	od_stat_t current;
+	od_stat_init(&current);
+	od_stat_copy(&current, &route->stats);
+
+	od_stats_history_t *history = route->history;
+	if (history == NULL) {
+		/* first sample is taken on the next tick */
+		history = od_stats_history_allocate(size);
+		if (history == NULL)
+			return;
+		od_stat_copy(&history->prev, &current);
+		history->prev_time_us = machine_time_us();
+		route->history        = history;
+		return;
+	}
+
+	od_stat_t avg;
+	od_stat_init(&avg);
+	od_stat_average(&avg, &current, &history->prev, history->prev_time_us);
+	od_stat_copy(&history->prev, &current);
+	history->prev_time_us = machine_time_us();
+
+	uint64_t values[OD_STATS_HISTORY_MAX];
+	memset(values, 0, sizeof(values));
+	values[OD_STATS_HISTORY_TIME]        = time(NULL);
+	values[OD_STATS_HISTORY_TPS]         = avg.count_tx;
+	values[OD_STATS_HISTORY_QPS]         = avg.count_query;
+	values[OD_STATS_HISTORY_TX_TIME]     = avg.tx_time;
+	values[OD_STATS_HISTORY_QUERY_TIME]  = avg.query_time;
+	values[OD_STATS_HISTORY_RECV_CLIENT] = avg.recv_client;
+	values[OD_STATS_HISTORY_RECV_SERVER] = avg.recv_server;
+
+	od_route_lock(route);
+	od_client_pool_t *clients = &route->client_pool;
+	od_server_pool_t *servers = &route->server_pool;
+	values[OD_STATS_HISTORY_CLIENTS]        = od_client_pool_total(clients);
+	values[OD_STATS_HISTORY_SERVERS_ACTIVE] = servers->count_active;
+	values[OD_STATS_HISTORY_SERVERS_IDLE]   = servers->count_idle;
+	values[OD_STATS_HISTORY_QUEUE]          = clients->count_queue;
+	od_route_unlock(route);
+
+	if (item->quantiles) {
+		values[OD_STATS_HISTORY_TX_P50]    = item->values[0];
+		values[OD_STATS_HISTORY_TX_P99]    = item->values[1];
+		values[OD_STATS_HISTORY_QUERY_P50] = item->values[2];
+		values[OD_STATS_HISTORY_QUERY_P99] = item->values[3];
+	}
+
+	od_stats_history_add(history, values);
+}
+
+static inline void
+od_cron_history(od_cron_t *cron)
+{
+	od_router_t *router     = cron->global->router;
+	od_instance_t *instance = cron->global->instance;
+	uint32_t size           = instance->config.stats_history;
+
+	/* routes are freed only by od_router_gc() called by cron itself, so
+	 * the snapshot stays valid after the router lock is released */
+	od_cron_history_route_t *routes = NULL;
+	int routes_count                = 0;
+	int routes_size                 = 0;
+	void *argv[] = { &routes, &routes_count, &routes_size };
+	int rc;
+	rc = od_router_foreach(router, od_cron_history_snapshot_cb, argv);
+	if (rc == -1) {
+		free(routes);
+		return;
+	}
+
+	/* merge of the quantile digests is done without the router lock */
+	int i;
+	if (size > 0) {
+		td_histogram_t *hgram[3] = { NULL, NULL, NULL };
+		for (i = 0; i < routes_count; i++)
+			od_cron_history_quantiles(&routes[i], hgram);
+		td_safe_free(hgram[0]);
+		td_safe_free(hgram[1]);
+		td_safe_free(hgram[2]);
+	}
+
+	/* history is read by console under the router lock */
+	od_router_lock(router);
+	for (i = 0; i < routes_count; i++)
+		od_cron_history_add(&routes[i], size);
+	od_router_unlock(router);
+
+	free(routes);
 }
 
 static inline void
@@ -225,6 +572,39 @@ od_cron_err_stat(od_cron_t *cron)
 	od_err_logger_inc_interval(router->router_err_logger);
 }
 
+static inline void
+od_cron_shm_open(od_cron_t *cron, char *path)
+{
+	od_instance_t *instance = cron->global->instance;
+	int rc;
+	rc = od_shm_stats_open(&cron->shm_stats,
+	                       path,
+	                       instance->config.workers_max,
+	                       instance->config.stats_shm_routes_max,
+	                       instance->config.stats_interval);
+	if (rc == -1)
+		od_error(&instance->logger,
+		         "cron",
+		         NULL,
+		         NULL,
+		         "failed to create stats segment '%s': %s",
+		         path,
+		         strerror(errno));
+}
+
+static inline void
+od_cron_shm_apply(od_cron_t *cron)
+{
+	pthread_mutex_lock(&cron->shm_lock);
+	if (cron->shm_reload) {
+		od_shm_stats_close(&cron->shm_stats);
+		if (cron->shm_path)
+			od_cron_shm_open(cron, cron->shm_path);
+		cron->shm_reload = 0;
+	}
+	pthread_mutex_unlock(&cron->shm_lock);
+}
+
 static void
 od_cron(void *arg)
 {
@@ -233,11 +613,37 @@ od_cron(void *arg)
 
 	cron->stat_time_us = machine_time_us();
 
-	int stats_tick = 0;
+	int stats_tick      = 0;
+	int stats_history   = 0;
+	int memory_pressure = 0;
 	for (;;) {
+		/* switch stats segment changed by reload */
+		od_cron_shm_apply(cron);
+
 		/* mark and sweep expired idle server connections */
 		od_cron_expire(cron);
 
+		/* update memory pressure flag, memory_limit is in megabytes */
+		uint64_t limit = (uint64_t)instance->config.memory_limit << 20;
+		int pressure   = od_memory_update(limit);
+		if (pressure != memory_pressure) {
+			od_log(&instance->logger,
+			       "memory",
+			       NULL,
+			       NULL,
+			       pressure ? "usage is close to memory_limit, "
+			                  "rejecting logins"
+			                : "usage is below memory_limit");
+			memory_pressure = pressure;
+		}
+
+		/* sample per second statistics history, also drops rings
+		 * once stats_history is disabled by reload */
+		if (instance->config.stats_history > 0 || stats_history) {
+			od_cron_history(cron);
+			stats_history = instance->config.stats_history;
+		}
+
 		/* update statistics */
 		if (++stats_tick >= instance->config.stats_interval) {
 			od_cron_stat(cron);
@@ -246,6 +652,19 @@ od_cron(void *arg)
 
 		od_cron_err_stat(cron);
 
+		/* write out buffered transaction traces */
+		uint64_t dropped = od_tracer_flush(&instance->tracer);
+		if (dropped > 0)
+			od_log(&instance->logger,
+			       "tracer",
+			       NULL,
+			       NULL,
+			       "trace buffer is full, %" PRIu64 " records dropped",
+			       dropped);
+
+		/* start or retire workers */
+		od_worker_pool_scale(cron->global->worker_pool);
+
 		/* 1 second soft interval */
 		machine_sleep(1000);
 	}
@@ -257,6 +676,10 @@ od_cron_init(od_cron_t *cron)
 	cron->stat_time_us   = 0;
 	cron->global         = NULL;
 	cron->startup_errors = 0;
+	cron->shm_path       = NULL;
+	cron->shm_reload     = 0;
+	pthread_mutex_init(&cron->shm_lock, NULL);
+	od_shm_stats_init(&cron->shm_stats);
 }
 
 int
@@ -264,6 +687,15 @@ od_cron_start(od_cron_t *cron, od_global_t *global)
 {
 	cron->global            = global;
 	od_instance_t *instance = global->instance;
+
+	/* create shared memory stats segment */
+	if (instance->config.stats_shm_path) {
+		cron->shm_path = strdup(instance->config.stats_shm_path);
+		if (cron->shm_path == NULL)
+			return -1;
+		od_cron_shm_open(cron, cron->shm_path);
+	}
+
 	int64_t coroutine_id;
 	coroutine_id = machine_coroutine_create(od_cron, cron);
 	if (coroutine_id == -1) {
@@ -276,3 +708,29 @@ od_cron_start(od_cron_t *cron, od_global_t *global)
 	}
 	return 0;
 }
+
+void
+od_cron_stop(od_cron_t *cron)
+{
+	pthread_mutex_lock(&cron->shm_lock);
+	od_shm_stats_close(&cron->shm_stats);
+	pthread_mutex_unlock(&cron->shm_lock);
+}
+
+/* segment is switched by cron on its next tick */
+void
+od_cron_shm_reload(od_cron_t *cron, char *path)
+{
+	char *copy = NULL;
+	if (path) {
+		copy = strdup(path);
+		if (copy == NULL)
+			return;
+	}
+	pthread_mutex_lock(&cron->shm_lock);
+	if (cron->shm_path)
+		free(cron->shm_path);
+	cron->shm_path   = copy;
+	cron->shm_reload = 1;
+	pthread_mutex_unlock(&cron->shm_lock);
+}
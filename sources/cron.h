@@ -14,11 +14,21 @@ struct od_cron
 	uint64_t stat_time_us;
 	od_global_t *global;
 	od_atomic_u64_t startup_errors;
+	/* segment is mapped and unmapped under the lock, workers hold
+	 * it while writing their slots */
+	pthread_mutex_t shm_lock;
+	od_shm_stats_t shm_stats;
+	char *shm_path;
+	int shm_reload;
 };
 
 void
 od_cron_init(od_cron_t *);
 int
 od_cron_start(od_cron_t *, od_global_t *);
+void
+od_cron_stop(od_cron_t *);
+void
+od_cron_shm_reload(od_cron_t *, char *);
 
 #endif /* ODYSSEY_CRON_H */
@@ -34,8 +34,8 @@ od_deploy(od_client_t *client, char *context)
 
 	char query[512];
 	int query_size;
-	query_size =
-	  kiwi_vars_cas(&client->vars, &server->vars, query, sizeof(query) - 1);
+	query_size = kiwi_vars_cas(
+	  &client->cold->vars, &server->cold->vars, query, sizeof(query) - 1);
 	if (query_size > 0) {
 		query[query_size] = 0;
 		query_size++;
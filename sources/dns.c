@@ -21,7 +21,7 @@
 #include <kiwi.h>
 #include <odyssey.h>
 
-static int
+int
 od_getsockaddrname(struct sockaddr *sa,
                    char *buf,
                    int size,
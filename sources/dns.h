@@ -7,6 +7,8 @@
  * Scalable PostgreSQL connection pooler.
  */
 
+int
+od_getsockaddrname(struct sockaddr *, char *, int, int, int);
 int
 od_getaddrname(struct addrinfo *, char *, int, int, int);
 int
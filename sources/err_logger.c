@@ -1,41 +1,46 @@
 
-#include "err_logger.h"
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
 
 od_error_logger_t *
 od_err_logger_create(size_t intervals_count)
 {
-	od_error_logger_t *err_logger = malloc(sizeof(od_error_logger_t));
-	if (err_logger == NULL) {
+	od_error_logger_t *err_logger = NULL;
+	int rc;
+	rc = posix_memalign(
+	  (void **)&err_logger, OD_COUNTER_ALIGN, sizeof(od_error_logger_t));
+	if (rc != 0) {
 		return NULL;
 	}
+	od_counter_init(&err_logger->pending);
 
 	err_logger->intercals_cnt        = intervals_count;
 	err_logger->current_interval_num = 0;
 
-	err_logger->interval_counters =
-	  malloc(sizeof(od_counter_t) * intervals_count);
-
-	for (size_t i = 0; i < intervals_count; ++i) {
-		err_logger->interval_counters[i] = od_counter_create_default();
-		if (err_logger->interval_counters[i] == NULL)
-			return NULL;
+	err_logger->intervals =
+	  calloc(intervals_count * OD_COUNTER_MAX, sizeof(od_count_t));
+	if (err_logger->intervals == NULL) {
+		free(err_logger);
+		return NULL;
 	}
 
-	pthread_mutex_init(&err_logger->lock, NULL);
-
 	return err_logger;
 }
 
 od_retcode_t
 od_err_logger_free(od_error_logger_t *err_logger)
 {
-	for (size_t i = 0; i < err_logger->intercals_cnt; ++i) {
-		int rc = od_counter_free(err_logger->interval_counters[i]);
-		if (rc != OK_RESPONSE)
-			return rc;
-	}
-
-	pthread_mutex_destroy(&err_logger->lock);
+	free(err_logger->intervals);
 	free(err_logger);
 
 	return OK_RESPONSE;
@@ -44,6 +49,6 @@ od_err_logger_free(od_error_logger_t *err_logger)
 od_retcode_t
 od_error_logger_store_err(od_error_logger_t *l, size_t err_t)
 {
-	od_counter_inc(l->interval_counters[l->current_interval_num], err_t);
+	od_counter_inc(&l->pending, err_t);
 	return OK_RESPONSE;
 }
@@ -16,10 +16,12 @@ typedef struct od_error_logger od_error_logger_t;
 
 struct od_error_logger
 {
-	size_t intercals_cnt;
-	od_counter_t **interval_counters;
+	/* errors of the current interval, counted by workers */
+	od_counter_t pending;
 
-	pthread_mutex_t lock;
+	/* ring of per interval counts, written only by cron */
+	size_t intercals_cnt;
+	od_count_t *intervals;
 
 	size_t current_interval_num;
 };
@@ -39,17 +41,24 @@ od_err_logger_create_default()
 extern od_retcode_t
 od_err_logger_free(od_error_logger_t *err_logger);
 
+static inline od_count_t *
+od_err_logger_interval(od_error_logger_t *l, size_t interval)
+{
+	return &l->intervals[interval * OD_COUNTER_MAX];
+}
+
 static inline od_retcode_t
 od_err_logger_inc_interval(od_error_logger_t *l)
 {
-	pthread_mutex_lock(&l->lock);
-	{
-		++l->current_interval_num;
-		l->current_interval_num %= l->intercals_cnt;
+	od_count_t *current;
+	current = od_err_logger_interval(l, l->current_interval_num);
+	od_counter_drain(&l->pending, current);
 
-		od_counter_reset_all(l->interval_counters[l->current_interval_num]);
-	}
-	pthread_mutex_unlock(&l->lock);
+	size_t next = (l->current_interval_num + 1) % l->intercals_cnt;
+	memset(od_err_logger_interval(l, next),
+	       0,
+	       sizeof(od_count_t) * OD_COUNTER_MAX);
+	l->current_interval_num = next;
 
 	return OK_RESPONSE;
 }
@@ -57,9 +66,10 @@ od_err_logger_inc_interval(od_error_logger_t *l)
 static inline size_t
 od_err_logger_get_aggr_errors_count(od_error_logger_t *l, size_t err_t)
 {
-	size_t ret_val = 0;
+	assert(err_t < OD_COUNTER_MAX);
+	size_t ret_val = od_counter_get_count(&l->pending, err_t);
 	for (size_t i = 0; i < l->intercals_cnt; ++i) {
-		ret_val += od_counter_get_count(l->interval_counters[i], err_t);
+		ret_val += od_err_logger_interval(l, i)[err_t];
 	}
 	return ret_val;
 }
@@ -25,6 +25,14 @@ od_frontend_close(od_client_t *client)
 	od_router_t *router = client->global->router;
 	od_atomic_u32_dec(&router->clients);
 
+	/* drop relayed LISTEN subscriptions */
+	if (client->notify_queue)
+		od_notify_relay_request(
+		  client->global->notify_relay, client, OD_NOTIFY_UNLISTEN_ALL, NULL);
+
+	/* must be unregistered before notify io is closed */
+	od_registry_remove(&od_registry_clients, &client->registry);
+
 	od_io_close(&client->io);
 	if (client->notify_io) {
 		machine_close(client->notify_io);
@@ -106,6 +114,15 @@ od_frontend_error_is_too_many_connections(od_client_t *client)
 
 #define MAX_STARTUP_ATTEMPTS 7
 
+/* startup packet is kept to extract shard key of the route */
+static inline void
+od_frontend_startup_keep(od_client_t *client, machine_msg_t *msg)
+{
+	if (client->cold->startup_msg)
+		machine_msg_free(client->cold->startup_msg);
+	client->cold->startup_msg = msg;
+}
+
 static int
 od_frontend_startup(od_client_t *client)
 {
@@ -121,13 +138,13 @@ od_frontend_startup(od_client_t *client)
 
 		int rc = kiwi_be_read_startup(machine_msg_data(msg),
 		                              machine_msg_size(msg),
-		                              &client->startup,
-		                              &client->vars);
-		machine_msg_free(msg);
+		                              &client->cold->startup,
+		                              &client->cold->vars);
+		od_frontend_startup_keep(client, msg);
 		if (rc == -1)
 			goto error;
 
-		if (!client->startup.unsupported_request)
+		if (!client->cold->startup.unsupported_request)
 			break;
 		/* not supported 'N' */
 		msg = machine_msg_create(sizeof(uint8_t));
@@ -158,21 +175,21 @@ od_frontend_startup(od_client_t *client)
 	if (rc == -1)
 		return -1;
 
-	if (!client->startup.is_ssl_request)
+	if (!client->cold->startup.is_ssl_request)
 		return 0;
 
 	/* read startup-cancel message followed after ssl
 	 * negotiation */
-	assert(client->startup.is_ssl_request);
+	assert(client->cold->startup.is_ssl_request);
 	msg =
 	  od_read_startup(&client->io, client->config_listen->client_login_timeout);
 	if (msg == NULL)
 		return -1;
 	rc = kiwi_be_read_startup(machine_msg_data(msg),
 	                          machine_msg_size(msg),
-	                          &client->startup,
-	                          &client->vars);
-	machine_msg_free(msg);
+	                          &client->cold->startup,
+	                          &client->cold->vars);
+	od_frontend_startup_keep(client, msg);
 	if (rc == -1)
 		goto error;
 	return 0;
@@ -185,6 +202,80 @@ error:
 	return -1;
 }
 
+/*
+ * Reject the request which failed to start a transaction in transaction
+ * pooling, the session goes on. No server is attached and the client
+ * output is flushed, so the reply is written directly. The request must
+ * be read up to its end (Query, FunctionCall or Sync), otherwise the
+ * session is closed.
+ */
+static inline od_frontend_status_t
+od_frontend_throttle_reject_attach(od_client_t *client)
+{
+	od_instance_t *instance   = client->global->instance;
+	od_readahead_t *readahead = &client->io.readahead;
+
+	od_frontend_status_t status;
+	status = od_relay_read(&client->relay);
+	if (status != OD_OK)
+		return status;
+
+	char *pos  = od_readahead_pos_read(readahead);
+	int unread = od_readahead_unread(readahead);
+	int size   = 0;
+	for (;;) {
+		if (unread - size < (int)sizeof(kiwi_header_t))
+			return OD_ETHROTTLED;
+		char *data = pos + size;
+		uint32_t body;
+		int rc;
+		rc = kiwi_validate_header(data, sizeof(kiwi_header_t), &body);
+		if (rc != 0)
+			return OD_ETHROTTLED;
+		size += sizeof(kiwi_header_t) + body - sizeof(uint32_t);
+		if (size > unread)
+			return OD_ETHROTTLED;
+		kiwi_fe_type_t type = *data;
+		if (type == KIWI_FE_TERMINATE)
+			return OD_ETHROTTLED;
+		if (type == KIWI_FE_QUERY || type == KIWI_FE_FUNCTION_CALL ||
+		    type == KIWI_FE_SYNC)
+			break;
+	}
+
+	od_log(&instance->logger,
+	       "main",
+	       client,
+	       NULL,
+	       "route limit exceeded, transaction rejected");
+
+	od_readahead_pos_read_advance(readahead, size);
+	if (od_readahead_unread(readahead) == 0) {
+		/* reset retry signal, nothing left to attach for */
+		machine_cond_try(client->io.on_read);
+	}
+	od_readahead_reuse(readahead);
+
+	machine_msg_t *msg;
+	msg = od_frontend_errorf(client,
+	                         NULL,
+	                         KIWI_CONFIGURATION_LIMIT_EXCEEDED,
+	                         "rate limit exceeded for route %s.%s",
+	                         client->cold->startup.database.value,
+	                         client->cold->startup.user.value);
+	if (msg == NULL)
+		return OD_EOOM;
+	if (kiwi_be_write_ready(msg, 'I') == NULL) {
+		machine_msg_free(msg);
+		return OD_EOOM;
+	}
+	int rc;
+	rc = od_write(&client->io, msg);
+	if (rc == -1)
+		return OD_ECLIENT_WRITE;
+	return OD_SKIP;
+}
+
 static inline od_frontend_status_t
 od_frontend_attach(od_client_t *client,
                    char *context,
@@ -197,8 +288,17 @@ od_frontend_attach(od_client_t *client,
 	bool wait_for_idle = false;
 	for (;;) {
 		od_router_status_t status;
+		od_probe3(attach__start,
+		          client->id.id,
+		          route->id.database,
+		          route->id.user);
 		status =
 		  od_router_attach(router, &instance->config, client, wait_for_idle);
+		od_probe4(attach__end,
+		          client->id.id,
+		          route->id.database,
+		          route->id.user,
+		          status);
 		if (status != OD_ROUTER_OK) {
 			if (status == OD_ROUTER_ERROR_TIMEDOUT) {
 				od_error(&instance->logger,
@@ -208,8 +308,22 @@ od_frontend_attach(od_client_t *client,
 				         "server pool wait timed out, closing");
 				return OD_EATTACH_TOO_MANY_CONNECTIONS;
 			}
+			if (status == OD_ROUTER_ERROR_SHED) {
+				od_error(&instance->logger,
+				         "router",
+				         client,
+				         NULL,
+				         "server queue wait shed, closing");
+				return OD_ETHROTTLED;
+			}
+			if (status == OD_ROUTER_ERROR_THROTTLED) {
+				if (route_params)
+					return OD_ETHROTTLED;
+				return od_frontend_throttle_reject_attach(client);
+			}
 			return OD_EATTACH;
 		}
+		od_trace_mark(&client->trace, OD_TRACE_SERVER_ATTACHED);
 
 		od_server_t *server = client->server;
 		if (server->io.io && !machine_connected(server->io.io)) {
@@ -221,6 +335,23 @@ od_frontend_attach(od_client_t *client,
 			od_router_close(router, client);
 			continue;
 		}
+
+		/* check server which was idle for too long */
+		int check_delay = route->rule->server_check_delay;
+		if (server->io.io && check_delay > 0 &&
+		    machine_time_us() - server->idle_since_us >
+		      (uint64_t)check_delay * 1000 &&
+		    !od_backend_alive(server)) {
+			od_log(&instance->logger,
+			       context,
+			       client,
+			       server,
+			       "idle server check failed, close connection and retry "
+			       "attach");
+			od_atomic_u64_inc(&route->count_check_failed);
+			od_router_close(router, client);
+			continue;
+		}
 		od_debug(&instance->logger,
 		         context,
 		         client,
@@ -275,6 +406,8 @@ od_frontend_attach_and_deploy(od_client_t *client, char *context)
 
 	/* set number of replies to discard */
 	client->server->deploy_sync = rc;
+	if (rc > 0)
+		od_trace_mark(&client->trace, OD_TRACE_DEPLOY_SENT);
 
 	od_server_sync_request(server, server->deploy_sync);
 	return OD_OK;
@@ -283,9 +416,11 @@ od_frontend_attach_and_deploy(od_client_t *client, char *context)
 static inline od_frontend_status_t
 od_frontend_setup_params(od_client_t *client)
 {
-	od_instance_t *instance = client->global->instance;
-	od_router_t *router     = client->global->router;
-	od_route_t *route       = client->route;
+	od_router_t *router = client->global->router;
+	od_route_t *route   = client->route;
+
+	if (od_likely(od_handshake_is_ready(&route->handshake)))
+		return OD_OK;
 
 	/* ensure route has cached server parameters */
 	int rc;
@@ -300,7 +435,15 @@ od_frontend_setup_params(od_client_t *client)
 			kiwi_params_free(&route_params);
 			return status;
 		}
-		od_router_close(router, client);
+
+		/* discovery connection is authenticated and idle, keep it in
+		 * the pool for the next attach */
+		if (route->id.physical_rep || route->id.logical_rep) {
+			od_router_close(router, client);
+		} else {
+			od_instance_t *instance = client->global->instance;
+			od_router_detach(router, &instance->config, client);
+		}
 
 		/* There is possible race here, so we will discard our
 		 * attempt if params are already set */
@@ -309,64 +452,10 @@ od_frontend_setup_params(od_client_t *client)
 			kiwi_params_free(&route_params);
 	}
 
-	od_debug(&instance->logger, "setup", client, NULL, "sending params:");
-
-	/* send parameters set by client or cached by the route */
-	kiwi_param_t *param = route->params.params.list;
-
-	machine_msg_t *stream = machine_msg_create(0);
-	if (stream == NULL)
-		return OD_EOOM;
-
-	while (param) {
-		kiwi_var_type_t type;
-		type = kiwi_vars_find(
-		  &client->vars, kiwi_param_name(param), param->name_len);
-		kiwi_var_t *var;
-		var = kiwi_vars_get(&client->vars, type);
-
-		machine_msg_t *msg;
-		if (var) {
-			msg = kiwi_be_write_parameter_status(
-			  stream, var->name, var->name_len, var->value, var->value_len);
-
-			od_debug(&instance->logger,
-			         "setup",
-			         client,
-			         NULL,
-			         " %.*s = %.*s",
-			         var->name_len,
-			         var->name,
-			         var->value_len,
-			         var->value);
-		} else {
-			msg = kiwi_be_write_parameter_status(stream,
-			                                     kiwi_param_name(param),
-			                                     param->name_len,
-			                                     kiwi_param_value(param),
-			                                     param->value_len);
-
-			od_debug(&instance->logger,
-			         "setup",
-			         client,
-			         NULL,
-			         " %.*s = %.*s",
-			         param->name_len,
-			         kiwi_param_name(param),
-			         param->value_len,
-			         kiwi_param_value(param));
-		}
-		if (msg == NULL) {
-			machine_msg_free(stream);
-			return OD_EOOM;
-		}
-
-		param = param->next;
-	}
-
-	rc = od_write(&client->io, stream);
+	/* serialize route parameters once */
+	rc = od_handshake_build(&route->handshake, &route->params);
 	if (rc == -1)
-		return OD_ECLIENT_WRITE;
+		return OD_EOOM;
 
 	return OD_OK;
 }
@@ -375,6 +464,7 @@ static inline od_frontend_status_t
 od_frontend_setup(od_client_t *client)
 {
 	od_instance_t *instance = client->global->instance;
+	od_route_t *route       = client->route;
 
 	/* set paremeters */
 	od_frontend_status_t status;
@@ -382,14 +472,35 @@ od_frontend_setup(od_client_t *client)
 	if (status != OD_OK)
 		return status;
 
-	/* write key data message */
 	machine_msg_t *stream;
+	stream = machine_msg_create(0);
+	if (stream == NULL)
+		return OD_EOOM;
+
+	/* send parameters cached by the route or set by client */
 	machine_msg_t *msg;
+	if (od_handshake_is_ready(&route->handshake)) {
+		od_debug(&instance->logger,
+		         "setup",
+		         client,
+		         NULL,
+		         "sending params (%d bytes cached)",
+		         route->handshake.size);
+		msg = od_handshake_write(
+		  &route->handshake, stream, &client->cold->vars);
+		if (msg == NULL) {
+			machine_msg_free(stream);
+			return OD_EOOM;
+		}
+	}
+
+	/* write key data message */
 	msg = kiwi_be_write_backend_key_data(
-	  NULL, client->key.key_pid, client->key.key);
-	if (msg == NULL)
+	  stream, client->key.key_pid, client->key.key);
+	if (msg == NULL) {
+		machine_msg_free(stream);
 		return OD_EOOM;
-	stream = msg;
+	}
 
 	/* write ready message */
 	msg = kiwi_be_write_ready(stream, 'I');
@@ -538,6 +649,34 @@ od_frontend_local(od_client_t *client)
 	return OD_OK;
 }
 
+static inline od_frontend_status_t
+od_frontend_timeout_error(od_relay_t *relay, char *data, int size)
+{
+	od_client_t *client = relay->on_packet_arg;
+	od_server_t *server = client->server;
+
+	kiwi_fe_error_t error;
+	int rc;
+	rc = kiwi_fe_read_error(data, size, &error);
+	if (rc == -1 || strcmp(error.code, KIWI_QUERY_CANCELED) != 0)
+		return OD_OK;
+	server->timeout = OD_SERVER_TIMEOUT_NONE;
+
+	/* replace cancel error with the reason of cancel */
+	machine_msg_t *msg;
+	msg = od_frontend_errorf(client,
+	                         NULL,
+	                         KIWI_QUERY_CANCELED,
+	                         "query_timeout %d ms exceeded, query canceled",
+	                         client->rule->query_timeout);
+	if (msg == NULL)
+		return OD_EOOM;
+	rc = machine_iov_add(relay->iov, msg);
+	if (rc == -1)
+		return OD_EOOM;
+	return OD_SKIP;
+}
+
 static od_frontend_status_t
 od_frontend_remote_server(od_relay_t *relay, char *data, int size)
 {
@@ -562,6 +701,8 @@ od_frontend_remote_server(od_relay_t *relay, char *data, int size)
 	switch (type) {
 		case KIWI_BE_ERROR_RESPONSE:
 			od_backend_error(server, "main", data, size);
+			if (server->timeout == OD_SERVER_TIMEOUT_CANCEL)
+				return od_frontend_timeout_error(relay, data, size);
 			break;
 		case KIWI_BE_PARAMETER_STATUS:
 			rc = od_backend_update_parameter(server, "main", data, size, 0);
@@ -579,12 +720,20 @@ od_frontend_remote_server(od_relay_t *relay, char *data, int size)
 			is_ready_for_query = 1;
 			od_backend_ready(server, data, size);
 
+			/* query finished before the timeout cancel got to it,
+			 * the cancel may still hit the next query */
+			if (server->timeout == OD_SERVER_TIMEOUT_CANCEL)
+				server->timeout = OD_SERVER_TIMEOUT_CLOSE;
+
 			/* update server stats */
 			int64_t query_time = 0;
 			od_stat_query_end(&route->stats,
 			                  &server->stats_state,
 			                  server->is_transaction,
 			                  &query_time);
+			if (query_time > 0)
+				od_route_top_add(route, client, OD_SKETCH_QUERIES, 1);
+			od_probe3(query__end, client->id.id, server->id.id, query_time);
 			if (instance->config.log_debug && query_time > 0) {
 				od_debug(&instance->logger,
 				         "main",
@@ -594,8 +743,15 @@ od_frontend_remote_server(od_relay_t *relay, char *data, int size)
 				         query_time);
 			}
 
-			if (is_deploy)
+			if (is_deploy) {
 				server->deploy_sync--;
+				if (server->deploy_sync == 0)
+					od_trace_mark(&client->trace, OD_TRACE_DEPLOY_ACKED);
+			} else if (!server->is_transaction) {
+				od_router_throttle_tx_end(client->global->router, client);
+				od_trace_mark(&client->trace, OD_TRACE_READY);
+				od_trace_skip_end(&client->trace);
+			}
 
 			break;
 		}
@@ -607,6 +763,8 @@ od_frontend_remote_server(od_relay_t *relay, char *data, int size)
 	if (is_deploy)
 		return OD_SKIP;
 
+	od_trace_mark(&client->trace, OD_TRACE_SERVER_READ);
+
 	/* handle transaction pooling */
 	if (is_ready_for_query) {
 		if (route->rule->pool == OD_RULE_POOL_TRANSACTION &&
@@ -635,6 +793,150 @@ od_frontend_log_query(od_instance_t *instance,
 	od_log(&instance->logger, "query", client, NULL, "%.*s", query_len, query);
 }
 
+static inline od_frontend_status_t
+od_frontend_throttle(od_client_t *client, kiwi_fe_type_t type, int size)
+{
+	od_router_t *router = client->global->router;
+	od_route_t *route   = client->route;
+	if (!route->limit.enabled)
+		return OD_OK;
+
+	/* extended query is charged by its first message, messages up
+	 * to Sync are relayed or rejected together */
+	bool query = true;
+	bool batch = false;
+	switch (type) {
+		case KIWI_FE_PARSE:
+		case KIWI_FE_BIND:
+		case KIWI_FE_DESCRIBE:
+		case KIWI_FE_EXECUTE:
+		case KIWI_FE_CLOSE:
+			batch = true;
+			break;
+		case KIWI_FE_QUERY:
+		case KIWI_FE_FUNCTION_CALL:
+		case KIWI_FE_SYNC:
+			break;
+		default:
+			query = false;
+			break;
+	}
+
+	od_router_status_t status = OD_ROUTER_OK;
+	if (query && !client->limit_batch) {
+		status = od_router_throttle_tx(router, client);
+		if (status == OD_ROUTER_OK)
+			status = od_router_throttle(router, client, OD_LIMIT_QUERIES, 1);
+	}
+	if (status == OD_ROUTER_OK)
+		status = od_router_throttle(router, client, OD_LIMIT_BYTES, size);
+	if (status != OD_ROUTER_OK)
+		return OD_ETHROTTLED;
+	if (query)
+		client->limit_batch = batch;
+	return OD_OK;
+}
+
+static inline od_frontend_status_t
+od_frontend_throttle_ready(od_client_t *client, machine_msg_t *msg)
+{
+	od_server_t *server = client->server;
+	msg = kiwi_be_write_ready(msg, server->is_transaction ? 'T' : 'I');
+	if (msg == NULL)
+		return OD_EOOM;
+	/* server is released if the rejected request was to start a
+	 * transaction */
+	od_route_t *route = client->route;
+	if (route->rule->pool == OD_RULE_POOL_TRANSACTION &&
+	    !server->is_transaction)
+		client->limit_detach = true;
+	return OD_OK;
+}
+
+/*
+ * Reject the request exceeding route limits, the session goes on.
+ *
+ * The error is queued to the client after server output relayed so
+ * far, so it is sent in order only if the server has no requests in
+ * progress. Part of extended query or copy already relayed cannot be
+ * taken back either. Otherwise the session is closed.
+ */
+static inline od_frontend_status_t
+od_frontend_throttle_reject(od_client_t *client, kiwi_fe_type_t type)
+{
+	od_server_t *server = client->server;
+	if (!od_server_synchronized(server) || client->limit_batch ||
+	    server->is_copy)
+		return OD_ETHROTTLED;
+
+	od_instance_t *instance = client->global->instance;
+	od_log(&instance->logger,
+	       "main",
+	       client,
+	       server,
+	       "route limit exceeded, %s rejected",
+	       kiwi_fe_type_to_string(type));
+
+	machine_msg_t *msg;
+	msg = od_frontend_errorf(client,
+	                         NULL,
+	                         KIWI_CONFIGURATION_LIMIT_EXCEEDED,
+	                         "rate limit exceeded for route %s.%s",
+	                         client->cold->startup.database.value,
+	                         client->cold->startup.user.value);
+	if (msg == NULL)
+		return OD_EOOM;
+
+	od_frontend_status_t status = OD_OK;
+	switch (type) {
+		case KIWI_FE_QUERY:
+		case KIWI_FE_FUNCTION_CALL:
+		case KIWI_FE_SYNC:
+			status = od_frontend_throttle_ready(client, msg);
+			break;
+		default:
+			/* extended protocol messages are discarded until Sync */
+			client->limit_skip = true;
+			break;
+	}
+	if (status != OD_OK) {
+		machine_msg_free(msg);
+		return status;
+	}
+
+	int rc;
+	rc = machine_iov_add(server->relay.iov, msg);
+	if (rc == -1)
+		return OD_EOOM;
+	machine_cond_signal(client->io.on_write);
+	return OD_SKIP;
+}
+
+static inline od_frontend_status_t
+od_frontend_throttle_skip(od_client_t *client, kiwi_fe_type_t type)
+{
+	if (type != KIWI_FE_SYNC)
+		return OD_SKIP;
+	client->limit_skip = false;
+
+	machine_msg_t *msg;
+	msg = machine_msg_create(0);
+	if (msg == NULL)
+		return OD_EOOM;
+	od_frontend_status_t status;
+	status = od_frontend_throttle_ready(client, msg);
+	if (status != OD_OK) {
+		machine_msg_free(msg);
+		return status;
+	}
+	int rc;
+	rc = machine_iov_add(client->server->relay.iov, msg);
+	if (rc == -1)
+		return OD_EOOM;
+	machine_cond_signal(client->io.on_write);
+	return OD_SKIP;
+}
+
 static od_frontend_status_t
 od_frontend_remote_client(od_relay_t *relay, char *data, int size)
 {
@@ -659,6 +961,16 @@ od_frontend_remote_client(od_relay_t *relay, char *data, int size)
 		         "%s",
 		         kiwi_fe_type_to_string(type));
 
+	/* apply route rate and concurrency limits */
+	if (client->limit_skip)
+		return od_frontend_throttle_skip(client, type);
+	od_frontend_status_t status;
+	status = od_frontend_throttle(client, type, size);
+	if (status == OD_ETHROTTLED)
+		return od_frontend_throttle_reject(client, type);
+	if (status != OD_OK)
+		return status;
+
 	switch (type) {
 		case KIWI_FE_COPY_DONE:
 		case KIWI_FE_COPY_FAIL:
@@ -681,6 +993,11 @@ od_frontend_remote_client(od_relay_t *relay, char *data, int size)
 
 	/* update server stats */
 	od_stat_query_start(&server->stats_state);
+	od_probe3(query__start, client->id.id, server->id.id, type);
+
+	/* next transaction starts on session server */
+	od_tracer_begin(&instance->tracer, &client->trace);
+	od_trace_mark(&client->trace, OD_TRACE_SERVER_WRITE);
 	return OD_OK;
 }
 
@@ -694,8 +1011,155 @@ od_frontend_remote_server_on_read(od_relay_t *relay, int size)
 static void
 od_frontend_remote_client_on_read(od_relay_t *relay, int size)
 {
-	od_stat_t *stats = relay->on_read_arg;
-	od_stat_recv_client(stats, size);
+	od_client_t *client = relay->on_read_arg;
+	od_route_t *route   = client->route;
+	od_stat_recv_client(&route->stats, size);
+	od_route_top_add(route, client, OD_SKETCH_BYTES, size);
+}
+
+static inline od_frontend_status_t
+od_frontend_notify_deliver(od_client_t *client)
+{
+	if (client->notify_queue == NULL)
+		return OD_OK;
+
+	od_list_t list;
+	od_list_init(&list);
+	int count;
+	count = od_notify_queue_pop_all(client->notify_queue, &list);
+	if (count == 0)
+		return OD_OK;
+
+	machine_msg_t *msg = NULL;
+	od_list_t *i, *n;
+	od_list_foreach_safe(&list, i, n)
+	{
+		od_notify_queue_msg_t *notify;
+		notify = od_container_of(i, od_notify_queue_msg_t, link);
+		int offset = 0;
+		if (msg)
+			offset = machine_msg_size(msg);
+		machine_msg_t *next;
+		next = machine_msg_create_or_advance(msg, notify->size);
+		if (next) {
+			msg = next;
+			memcpy((char *)machine_msg_data(msg) + offset,
+			       notify->data,
+			       notify->size);
+		}
+		free(notify);
+	}
+	if (msg == NULL)
+		return OD_EOOM;
+
+	/* keep order with output spooled before */
+	int rc;
+	od_spool_t *spool = &client->cold->spool;
+	if (od_spool_pending(spool) > 0) {
+		rc = od_spool_append(
+		  spool, machine_msg_data(msg), machine_msg_size(msg));
+		machine_msg_free(msg);
+		if (rc == -1)
+			return OD_EOOM;
+		return OD_OK;
+	}
+	rc = od_write(&client->io, msg);
+	if (rc == -1)
+		return OD_ECLIENT_WRITE;
+	return OD_OK;
+}
+
+/* handle LISTEN and UNLISTEN without attaching a server */
+static inline od_frontend_status_t
+od_frontend_notify_intercept(od_client_t *client)
+{
+	od_relay_t *relay           = &client->relay;
+	od_readahead_t *readahead   = &client->io.readahead;
+	od_notify_relay_t *notifier = client->global->notify_relay;
+
+	od_frontend_status_t status;
+	status = od_relay_read(relay);
+	if (status != OD_OK)
+		return status;
+
+	int unread = od_readahead_unread(readahead);
+	if (unread == 0) {
+		/* reset retry signal, nothing to attach for */
+		machine_cond_try(client->io.on_read);
+		return OD_SKIP;
+	}
+
+	/* expect exactly one simple query in buffer */
+	if (od_readahead_left(readahead) == 0 ||
+	    unread < (int)sizeof(kiwi_header_t))
+		return OD_ATTACH;
+	char *data = od_readahead_pos_read(readahead);
+	if (*data != KIWI_FE_QUERY)
+		return OD_ATTACH;
+	uint32_t size;
+	int rc;
+	rc = kiwi_validate_header(data, sizeof(kiwi_header_t), &size);
+	if (rc != 0 || (int)(sizeof(kiwi_header_t) + size - sizeof(uint32_t)) !=
+	                 unread)
+		return OD_ATTACH;
+
+	od_notify_op_t op;
+	char channel[OD_NOTIFY_CHANNEL_MAX];
+	rc = od_notify_parse(data + sizeof(kiwi_header_t),
+	                     unread - sizeof(kiwi_header_t),
+	                     &op,
+	                     channel);
+	if (rc == -1)
+		return OD_ATTACH;
+
+	od_readahead_pos_read_advance(readahead, unread);
+	od_readahead_reuse(readahead);
+
+	if (client->notify_queue == NULL) {
+		if (op != OD_NOTIFY_LISTEN)
+			goto reply;
+		client->notify_queue = od_notify_queue_create();
+		if (client->notify_queue == NULL)
+			return OD_EOOM;
+	}
+	rc = od_notify_relay_request(notifier, client, op, channel);
+	if (rc == -1) {
+		rc = od_frontend_error(client,
+		                       KIWI_SYSTEM_ERROR,
+		                       "failed to relay %s",
+		                       op == OD_NOTIFY_LISTEN ? "LISTEN" : "UNLISTEN");
+		if (rc == -1)
+			return OD_ECLIENT_WRITE;
+		machine_msg_t *msg;
+		msg = kiwi_be_write_ready(NULL, 'I');
+		if (msg == NULL)
+			return OD_EOOM;
+		rc = od_write(&client->io, msg);
+		if (rc == -1)
+			return OD_ECLIENT_WRITE;
+		return OD_SKIP;
+	}
+
+reply:;
+	machine_msg_t *msg;
+	msg = machine_msg_create(0);
+	if (msg == NULL)
+		return OD_EOOM;
+	if (op == OD_NOTIFY_LISTEN)
+		rc = kiwi_be_write_complete(msg, "LISTEN", 7);
+	else
+		rc = kiwi_be_write_complete(msg, "UNLISTEN", 9);
+	if (rc == -1) {
+		machine_msg_free(msg);
+		return OD_EOOM;
+	}
+	msg = kiwi_be_write_ready(msg, 'I');
+	if (msg == NULL)
+		return OD_EOOM;
+	rc = od_write(&client->io, msg);
+	if (rc == -1)
+		return OD_ECLIENT_WRITE;
+	return OD_SKIP;
 }
 
 static od_frontend_status_t
@@ -707,6 +1171,289 @@ od_frontend_ctl(od_client_t *client)
 		od_client_notify_read(client);
 		return OD_STOP;
 	}
+	if (op & OD_CLIENT_OP_NOTIFY) {
+		od_client_ctl_unset(client, OD_CLIENT_OP_NOTIFY);
+		od_client_notify_read(client);
+		/* delivered after transaction otherwise */
+		if (client->server == NULL)
+			return od_frontend_notify_deliver(client);
+	}
+	return OD_OK;
+}
+
+static inline void
+od_frontend_trace_end(od_client_t *client, od_id_t *server_id)
+{
+	od_instance_t *instance = client->global->instance;
+	od_route_t *route       = client->route;
+	od_tracer_end(&instance->tracer,
+	              &client->trace,
+	              &client->id,
+	              server_id,
+	              route->id.database,
+	              route->id.user);
+}
+
+/* time given to timeout cancel before the server is closed */
+#define OD_FRONTEND_CANCEL_WAIT_US 1000000
+
+/* time to wait until the nearest query or transaction deadline */
+static inline uint32_t
+od_frontend_timeout_wait(od_client_t *client)
+{
+	od_server_t *server = client->server;
+	od_rule_t *rule     = client->rule;
+	if (server == NULL)
+		return UINT32_MAX;
+	if (rule->query_timeout == 0 && rule->transaction_timeout == 0)
+		return UINT32_MAX;
+
+	od_stat_state_t *state = &server->stats_state;
+	uint64_t deadline      = UINT64_MAX;
+	if (server->timeout == OD_SERVER_TIMEOUT_CANCEL) {
+		deadline = server->timeout_cancel_us + OD_FRONTEND_CANCEL_WAIT_US;
+	} else if (rule->query_timeout && state->query_time_start) {
+		deadline = state->query_time_start + rule->query_timeout * 1000ull;
+	}
+	if (rule->transaction_timeout && state->tx_time_start) {
+		uint64_t tx_deadline;
+		tx_deadline =
+		  state->tx_time_start + rule->transaction_timeout * 1000ull;
+		if (tx_deadline < deadline)
+			deadline = tx_deadline;
+	}
+	if (deadline == UINT64_MAX)
+		return UINT32_MAX;
+
+	uint64_t now = machine_time_us();
+	if (deadline <= now)
+		return 0;
+	return (deadline - now + 999) / 1000;
+}
+
+static inline void
+od_frontend_timeout_cancel(od_client_t *client, od_server_t *server)
+{
+	od_route_t *route = client->route;
+	server->timeout_cancel_us = machine_time_us();
+
+	/* storage can be retargeted by console, cancel using a copy */
+	od_rule_storage_t *storage;
+	storage = od_rules_storage_copy(route->storage);
+	if (storage == NULL)
+		return;
+	od_cancel_dispatch(client->global->cancel_dispatcher,
+	                   storage,
+	                   &server->key,
+	                   &server->id);
+	od_rules_storage_free(storage);
+}
+
+/* the server is closed with the transaction state of the client, so
+ * the client is disconnected too after the error */
+static inline od_frontend_status_t
+od_frontend_timeout_close(od_client_t *client,
+                          od_server_t *server,
+                          char *code,
+                          char *reason,
+                          int timeout)
+{
+	od_instance_t *instance = client->global->instance;
+	od_log(&instance->logger,
+	       "main",
+	       client,
+	       server,
+	       "%s %d ms exceeded, closing",
+	       reason,
+	       timeout);
+	server->timeout = OD_SERVER_TIMEOUT_CLOSE;
+
+	/* error follows replies already queued for the client */
+	machine_msg_t *msg;
+	msg = od_frontend_errorf(client,
+	                         NULL,
+	                         code,
+	                         "%s %d ms exceeded, connection closed",
+	                         reason,
+	                         timeout);
+	if (msg == NULL)
+		return OD_EOOM;
+	int rc;
+	rc = machine_iov_add(server->relay.iov, msg);
+	if (rc == -1) {
+		machine_msg_free(msg);
+		return OD_EOOM;
+	}
+	return OD_STOP;
+}
+
+/*
+ * Enforce rule query_timeout and transaction_timeout.
+ *
+ * Expired query is canceled in background and the client gets an error
+ * instead of the cancel reply. If cancel does not stop the query, the
+ * server connection is closed. Expired transaction closes both client
+ * and server connections.
+ */
+static od_frontend_status_t
+od_frontend_timeout(od_client_t *client)
+{
+	od_server_t *server = client->server;
+	od_route_t *route   = client->route;
+	od_rule_t *rule     = client->rule;
+	if (server == NULL)
+		return OD_OK;
+	if (rule->query_timeout == 0 && rule->transaction_timeout == 0)
+		return OD_OK;
+
+	od_stat_state_t *state = &server->stats_state;
+	uint64_t now           = machine_time_us();
+
+	/* cancel did not stop the query */
+	if (server->timeout == OD_SERVER_TIMEOUT_CANCEL) {
+		if (now - server->timeout_cancel_us < OD_FRONTEND_CANCEL_WAIT_US)
+			return OD_OK;
+		return od_frontend_timeout_close(client,
+		                                 server,
+		                                 KIWI_QUERY_CANCELED,
+		                                 "query_timeout",
+		                                 rule->query_timeout);
+	}
+
+	if (rule->transaction_timeout && state->tx_time_start &&
+	    now - state->tx_time_start >=
+	      (uint64_t)rule->transaction_timeout * 1000) {
+		od_atomic_u64_inc(&route->count_transaction_timeout);
+		if (state->query_time_start)
+			od_frontend_timeout_cancel(client, server);
+		return od_frontend_timeout_close(client,
+		                                 server,
+		                                 KIWI_TRANSACTION_TIMEOUT,
+		                                 "transaction_timeout",
+		                                 rule->transaction_timeout);
+	}
+
+	if (rule->query_timeout && state->query_time_start &&
+	    now - state->query_time_start >=
+	      (uint64_t)rule->query_timeout * 1000) {
+		od_atomic_u64_inc(&route->count_query_timeout);
+		od_instance_t *instance = client->global->instance;
+		od_log(&instance->logger,
+		       "main",
+		       client,
+		       server,
+		       "query_timeout %d ms exceeded, canceling query",
+		       rule->query_timeout);
+		server->timeout = OD_SERVER_TIMEOUT_CANCEL;
+		od_frontend_timeout_cancel(client, server);
+	}
+	return OD_OK;
+}
+
+/* route transaction to the shard of its first query hint */
+static od_frontend_status_t
+od_frontend_shard_hint(od_client_t *client)
+{
+	od_route_t *route         = client->route;
+	od_readahead_t *readahead = &client->io.readahead;
+
+	od_frontend_status_t status;
+	status = od_relay_read(&client->relay);
+	if (status != OD_OK)
+		return status;
+
+	int unread = od_readahead_unread(readahead);
+	if (unread == 0) {
+		/* reset retry signal, nothing to attach for */
+		machine_cond_try(client->io.on_read);
+		return OD_SKIP;
+	}
+
+	/* do not attach just to terminate */
+	char *data = od_readahead_pos_read(readahead);
+	if (*data == KIWI_FE_TERMINATE)
+		return OD_STOP;
+
+	int shard = client->cold->shard;
+	if (unread > (int)sizeof(kiwi_header_t) &&
+	    (*data == KIWI_FE_QUERY || *data == KIWI_FE_PARSE)) {
+		uint32_t size;
+		int rc;
+		rc = kiwi_validate_header(data, sizeof(kiwi_header_t), &size);
+		if (rc == 0) {
+			/* hint must be in the part of message already read */
+			int len = unread - sizeof(kiwi_header_t);
+			if ((int)(size - sizeof(uint32_t)) < len)
+				len = size - sizeof(uint32_t);
+			char *key;
+			int key_len;
+			rc = od_shard_hint(
+			  data + sizeof(kiwi_header_t), len, &key, &key_len);
+			if (rc == 0)
+				shard =
+				  od_shard_map_lookup(route->rule->shard_map, key, key_len);
+		}
+	}
+	if (shard == route->id.shard)
+		return OD_ATTACH;
+
+	od_router_t *router = client->global->router;
+	od_router_status_t router_status;
+	router_status = od_router_reroute(router, client, shard);
+	if (router_status != OD_ROUTER_OK)
+		return OD_EOOM;
+	return OD_ATTACH;
+}
+
+static inline od_spool_t *
+od_frontend_spool(od_client_t *client)
+{
+	od_instance_t *instance = client->global->instance;
+	od_route_t *route       = client->route;
+	od_rule_t *rule         = route->rule;
+	if (!rule->pool_spool)
+		return NULL;
+	od_spool_t *spool = &client->cold->spool;
+	od_spool_set(spool,
+	             instance->config.spool_dir,
+	             rule->pool_spool_memory,
+	             rule->pool_spool_max);
+	return spool;
+}
+
+/* output spooled for a released server is written to the client before
+ * anything else, client input waits until it is drained */
+static inline od_frontend_status_t
+od_frontend_spool_drain(od_client_t *client)
+{
+	od_spool_t *spool = &client->cold->spool;
+	if (od_spool_pending(spool) == 0)
+		return OD_OK;
+
+	machine_cond_try(client->io.on_write);
+	int rc;
+	rc = od_spool_write(spool, client->io.io);
+	if (rc == -1)
+		return OD_ECLIENT_WRITE;
+
+	if (od_spool_pending(spool) > 0) {
+		rc = od_io_read_stop(&client->io);
+		if (rc == -1)
+			return OD_ECLIENT_READ;
+		rc = od_io_write_start(&client->io);
+		if (rc == -1)
+			return OD_ECLIENT_WRITE;
+		return OD_OK;
+	}
+
+	rc = od_io_write_stop(&client->io);
+	if (rc == -1)
+		return OD_ECLIENT_WRITE;
+	rc = od_io_read_start(&client->io);
+	if (rc == -1)
+		return OD_ECLIENT_READ;
+	/* retry input arrived meanwhile */
+	machine_cond_signal(client->io.on_read);
 	return OD_OK;
 }
 
@@ -733,7 +1480,7 @@ od_frontend_remote(od_client_t *client)
 	                 OD_ECLIENT_READ,
 	                 OD_ESERVER_WRITE,
 	                 od_frontend_remote_client_on_read,
-	                 &route->stats,
+	                 client,
 	                 od_frontend_remote_client,
 	                 client);
 	if (status != OD_OK) {
@@ -742,19 +1489,52 @@ od_frontend_remote(od_client_t *client)
 
 	od_server_t *server;
 	for (;;) {
-		machine_cond_wait(client->cond, UINT32_MAX);
+		machine_cond_wait(client->cond, od_frontend_timeout_wait(client));
 
 		/* client operations */
 		status = od_frontend_ctl(client);
 		if (status != OD_OK)
 			break;
 
+		/* query and transaction timeouts */
+		status = od_frontend_timeout(client);
+		if (status != OD_OK)
+			break;
+
 		server = client->server;
+		if (server == NULL) {
+			status = od_frontend_spool_drain(client);
+			if (status != OD_OK)
+				break;
+			if (od_spool_pending(&client->cold->spool) > 0)
+				continue;
+		}
+
 		/* attach */
 		status = od_relay_step(&client->relay);
 		if (status == OD_ATTACH) {
 			assert(server == NULL);
+			if (route->rule->notify_relay) {
+				status = od_frontend_notify_intercept(client);
+				if (status == OD_SKIP)
+					continue;
+				if (status != OD_ATTACH)
+					break;
+			}
+			if (route->rule->shard_hint) {
+				status = od_frontend_shard_hint(client);
+				if (status == OD_SKIP)
+					continue;
+				if (status != OD_ATTACH)
+					break;
+				route = client->route;
+			}
+			od_instance_t *instance = client->global->instance;
+			od_tracer_begin(&instance->tracer, &client->trace);
+			od_trace_mark(&client->trace, OD_TRACE_QUEUE_ENTER);
 			status = od_frontend_attach_and_deploy(client, "main");
+			if (status == OD_SKIP)
+				continue;
 			if (status != OD_OK)
 				break;
 			server = client->server;
@@ -768,6 +1548,7 @@ od_frontend_remote(od_client_t *client)
 			                        client);
 			if (status != OD_OK)
 				break;
+			server->relay.spool = od_frontend_spool(client);
 			od_relay_attach(&client->relay, &server->io);
 			od_relay_attach(&server->relay, &client->io);
 
@@ -781,12 +1562,20 @@ od_frontend_remote(od_client_t *client)
 			continue;
 
 		status = od_relay_step(&server->relay);
+		if (status == OD_OK && client->limit_detach)
+			status = OD_DETACH;
 		if (status == OD_DETACH) {
-			/* write any pending data to server first */
+			client->limit_detach = false;
+
+			/* write any pending data to client first, output the
+			 * client has not read yet is left in the spool */
 			od_frontend_status_t flush_status;
-			flush_status = od_relay_flush(&server->relay);
+			flush_status = od_relay_flush_spool(&server->relay);
 			if (flush_status != OD_OK)
 				break;
+			if (od_relay_spooled(&server->relay))
+				od_spool_stat_released();
+			od_trace_mark(&client->trace, OD_TRACE_CLIENT_FLUSH);
 			od_relay_detach(&client->relay);
 			od_relay_stop(&server->relay);
 
@@ -797,16 +1586,40 @@ od_frontend_remote(od_client_t *client)
 				break;
 			}
 
-			/* push server connection back to route pool */
+			/* push server connection back to route pool, or close it
+			 * if it cannot be reused */
 			od_router_t *router     = client->global->router;
 			od_instance_t *instance = client->global->instance;
-			od_router_detach(router, &instance->config, client);
+			od_id_t server_id       = server->id;
+			if (rc == 0)
+				od_router_close(router, client);
+			else
+				od_router_detach(router, &instance->config, client);
+			od_trace_mark(&client->trace, OD_TRACE_DETACH);
+			od_frontend_trace_end(client, &server_id);
 			server = NULL;
+
+			/* notifications queued during transaction */
+			status = od_frontend_notify_deliver(client);
+			if (status != OD_OK)
+				break;
+
+			status = od_frontend_spool_drain(client);
+			if (status != OD_OK)
+				break;
 		} else if (status != OD_OK) {
 			break;
+		} else if (od_trace_is_marked(&client->trace, OD_TRACE_READY) &&
+		           !machine_iov_pending(server->relay.iov)) {
+			/* session server stays attached, transaction ends on flush */
+			od_trace_mark(&client->trace, OD_TRACE_CLIENT_FLUSH);
+			od_frontend_trace_end(client, &server->id);
 		}
 	}
 
+	/* drop unfinished transaction trace */
+	od_trace_init(&client->trace);
+
 	if (client->server) {
 		od_server_t *curr_server = client->server;
 
@@ -890,12 +1703,33 @@ od_frontend_cleanup(od_client_t *client,
 			                  KIWI_TOO_MANY_CONNECTIONS,
 			                  "too many active clients for user (pool_size for "
 			                  "user %s.%s reached %d)",
-			                  client->startup.database.value,
-			                  client->startup.user.value,
+			                  client->cold->startup.database.value,
+			                  client->cold->startup.user.value,
 			                  client->rule != NULL ? client->rule->pool_size
 			                                       : -1);
 			break;
 
+		case OD_ETHROTTLED:
+			od_log(&instance->logger,
+			       context,
+			       client,
+			       server,
+			       "route limit exceeded, closing");
+			od_frontend_error(client,
+			                  KIWI_CONFIGURATION_LIMIT_EXCEEDED,
+			                  "rate limit exceeded for route %s.%s",
+			                  client->cold->startup.database.value,
+			                  client->cold->startup.user.value);
+			if (!client->server)
+				break;
+			rc = od_reset(server);
+			if (rc != 1) {
+				od_router_close(router, client);
+				break;
+			}
+			od_router_detach(router, &instance->config, client);
+			break;
+
 		case OD_ECLIENT_READ:
 		case OD_ECLIENT_WRITE:
 			/* close client connection and reuse server
@@ -970,6 +1804,7 @@ od_frontend_cleanup(od_client_t *client,
 		case OD_ATTACH:
 		case OD_DETACH:
 		case OD_ESYNC_BROKEN:
+		case OD_FRONTEND_STATUS_MAX:
 			od_error(&instance->logger,
 			         context,
 			         client,
@@ -1002,7 +1837,7 @@ od_application_name_add_host(od_client_t *client)
 	int app_name_len = 7;
 	char *app_name   = "unknown";
 	kiwi_var_t *app_name_var =
-	  kiwi_vars_get(&client->vars, KIWI_VAR_APPLICATION_NAME);
+	  kiwi_vars_get(&client->cold->vars, KIWI_VAR_APPLICATION_NAME);
 	if (app_name_var != NULL) {
 		app_name_len = app_name_var->value_len;
 		app_name     = app_name_var->value;
@@ -1016,12 +1851,36 @@ od_application_name_add_host(od_client_t *client)
 	                         app_name_len,
 	                         app_name,
 	                         peer_name);
-	kiwi_vars_set(&client->vars,
+	kiwi_vars_set(&client->cold->vars,
 	              KIWI_VAR_APPLICATION_NAME,
 	              app_name_with_host,
 	              length + 1); // return code ignored
 }
 
+static void
+od_frontend_top_connect(od_client_t *client, od_route_t *route)
+{
+	if (route->top_addr == NULL)
+		return;
+
+	/* client address */
+	char peer[128];
+	od_getpeername(client->io.io, peer, sizeof(peer), 1, 0);
+	od_sketch_key_set(&client->top_addr, peer, strlen(peer));
+
+	/* application_name, as sent by client */
+	kiwi_var_t *app_name_var =
+	  kiwi_vars_get(&client->cold->vars, KIWI_VAR_APPLICATION_NAME);
+	if (app_name_var != NULL && app_name_var->value_len > 0)
+		od_sketch_key_set(&client->top_appname,
+		                  app_name_var->value,
+		                  strnlen(app_name_var->value, app_name_var->value_len));
+	else
+		od_sketch_key_set(&client->top_appname, "", 0);
+
+	od_route_top_add(route, client, OD_SKETCH_CONNECTIONS, 1);
+}
+
 void
 od_frontend(void *arg)
 {
@@ -1072,6 +1931,9 @@ od_frontend(void *arg)
 		return;
 	}
 
+	/* make client visible to console commands */
+	od_registry_add(&od_registry_clients, &client->registry);
+
 	/* ensure global client_max limit */
 	uint32_t clients = od_atomic_u32_inc(&router->clients);
 	if (instance->config.client_max_set &&
@@ -1094,13 +1956,16 @@ od_frontend(void *arg)
 	}
 
 	/* handle cancel request */
-	if (client->startup.is_cancel) {
+	if (client->cold->startup.is_cancel) {
 		od_log(&instance->logger, "startup", client, NULL, "cancel request");
 		od_router_cancel_t cancel;
 		od_router_cancel_init(&cancel);
-		rc = od_router_cancel(router, &client->startup.key, &cancel);
+		rc = od_router_cancel(router, &client->cold->startup.key, &cancel);
 		if (rc == 0) {
-			od_cancel(client->global, cancel.storage, &cancel.key, &cancel.id);
+			od_cancel_dispatch(client->global->cancel_dispatcher,
+			                   cancel.storage,
+			                   &cancel.key,
+			                   &cancel.id);
 			od_router_cancel_free(&cancel);
 		}
 		od_frontend_close(client);
@@ -1122,12 +1987,18 @@ od_frontend(void *arg)
 	/* route client */
 	od_router_status_t router_status;
 	router_status = od_router_route(router, &instance->config, client);
+	od_probe4(route__match,
+	          client->id.id,
+	          client->cold->startup.database.value,
+	          client->cold->startup.user.value,
+	          router_status);
 
 	/* routing is over */
 	od_atomic_u32_dec(&router->clients_routing);
 
 	if (router_status == OD_ROUTER_OK) {
 		od_route_t *route = client->route;
+		od_frontend_top_connect(client, route);
 		if (route->rule->application_name_add_host)
 			od_application_name_add_host(client);
 		if (instance->config.log_session) {
@@ -1136,8 +2007,8 @@ od_frontend(void *arg)
 			       client,
 			       NULL,
 			       "route '%s.%s' to '%s.%s'",
-			       client->startup.database.value,
-			       client->startup.user.value,
+			       client->cold->startup.database.value,
+			       client->cold->startup.user.value,
 			       route->rule->db_name,
 			       route->rule->user_name);
 		}
@@ -1167,14 +2038,14 @@ od_frontend(void *arg)
 				  client,
 				  NULL,
 				  "route for '%s.%s' is not found for '%s' client, closing",
-				  client->startup.database.value,
-				  client->startup.user.value,
+				  client->cold->startup.database.value,
+				  client->cold->startup.user.value,
 				  peer);
 				od_frontend_error(client,
 				                  KIWI_UNDEFINED_DATABASE,
 				                  "route for '%s.%s' is not found",
-				                  client->startup.database.value,
-				                  client->startup.user.value);
+				                  client->cold->startup.database.value,
+				                  client->cold->startup.user.value);
 				break;
 			case OD_ROUTER_ERROR_LIMIT:
 				od_error(
@@ -1203,8 +2074,8 @@ od_frontend(void *arg)
 				  KIWI_TOO_MANY_CONNECTIONS,
 				  "too many client tcp connections (client_max for user %s.%s "
 				  "%d)",
-				  client->startup.database.value,
-				  client->startup.user.value,
+				  client->cold->startup.database.value,
+				  client->cold->startup.user.value,
 				  client->rule != NULL ? client->rule->client_max : -1);
 				break;
 			case OD_ROUTER_ERROR_REPLICATION:
@@ -1230,6 +2101,23 @@ od_frontend(void *arg)
 		return;
 	}
 
+	/* reject logins while memory usage is close to the limit,
+	 * console stays available */
+	if (od_memory.limit > 0 && od_memory_refresh() &&
+	    client->rule->storage->storage_type == OD_RULE_STORAGE_REMOTE) {
+		od_memory_inc(OD_MEMORY_LOGIN_REJECTED);
+		od_error(&instance->logger,
+		         "startup",
+		         client,
+		         NULL,
+		         "memory limit reached, closing");
+		od_frontend_error(
+		  client, KIWI_OUT_OF_MEMORY, "odyssey memory limit reached");
+		od_router_unroute(router, client);
+		od_frontend_close(client);
+		return;
+	}
+
 	/* pre-auth callback */
 	od_list_t *i;
 	od_list_foreach(&modules->link, i)
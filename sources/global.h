@@ -17,6 +17,8 @@ struct od_global
 	void *cron;
 	void *worker_pool;
 	void *modules;
+	void *cancel_dispatcher;
+	void *notify_relay;
 };
 
 static inline void
@@ -26,14 +28,18 @@ od_global_init(od_global_t *global,
                void *router,
                void *cron,
                void *worker_pool,
-               void *modules)
+               void *modules,
+               void *cancel_dispatcher,
+               void *notify_relay)
 {
-	global->instance    = instance;
-	global->system      = system;
-	global->router      = router;
-	global->cron        = cron;
-	global->worker_pool = worker_pool;
-	global->modules     = modules;
+	global->instance          = instance;
+	global->system            = system;
+	global->router            = router;
+	global->cron              = cron;
+	global->worker_pool       = worker_pool;
+	global->modules           = modules;
+	global->cancel_dispatcher = cancel_dispatcher;
+	global->notify_relay      = notify_relay;
 }
 
 #endif /* ODYSSEY_GLOBAL_H */
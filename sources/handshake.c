@@ -0,0 +1,130 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+static inline int
+od_handshake_is_var(od_handshake_t *handshake, kiwi_param_t *param)
+{
+	kiwi_var_type_t type;
+	type = kiwi_vars_find(
+	  &handshake->vars, kiwi_param_name(param), param->name_len);
+	return kiwi_vars_get(&handshake->vars, type) != NULL;
+}
+
+int
+od_handshake_build(od_handshake_t *handshake, kiwi_params_lock_t *params)
+{
+	pthread_mutex_lock(&handshake->lock);
+	if (handshake->ready) {
+		pthread_mutex_unlock(&handshake->lock);
+		return 0;
+	}
+
+	pthread_mutex_lock(&params->lock);
+
+	/* not discovered yet */
+	if (params->params.count == 0) {
+		pthread_mutex_unlock(&params->lock);
+		pthread_mutex_unlock(&handshake->lock);
+		return 0;
+	}
+
+	/* split client vars and calculate size of the rest */
+	int size            = 0;
+	kiwi_param_t *param = params->params.list;
+	for (; param; param = param->next) {
+		kiwi_var_type_t type;
+		type = kiwi_vars_find(
+		  &handshake->vars, kiwi_param_name(param), param->name_len);
+		if (type != KIWI_VAR_UNDEF) {
+			int rc;
+			rc = kiwi_vars_set(&handshake->vars,
+			                   type,
+			                   kiwi_param_value(param),
+			                   param->value_len);
+			if (rc == 0)
+				continue;
+		}
+		size += sizeof(kiwi_header_t) + param->name_len + param->value_len;
+	}
+
+	char *data = NULL;
+	if (size > 0) {
+		data = malloc(size);
+		if (data == NULL) {
+			pthread_mutex_unlock(&params->lock);
+			pthread_mutex_unlock(&handshake->lock);
+			return -1;
+		}
+	}
+
+	char *pos = data;
+	param     = params->params.list;
+	for (; param; param = param->next) {
+		if (od_handshake_is_var(handshake, param))
+			continue;
+		kiwi_write8(&pos, KIWI_BE_PARAMETER_STATUS);
+		kiwi_write32(&pos,
+		             sizeof(uint32_t) + param->name_len + param->value_len);
+		kiwi_write(&pos, kiwi_param_name(param), param->name_len);
+		kiwi_write(&pos, kiwi_param_value(param), param->value_len);
+	}
+	pthread_mutex_unlock(&params->lock);
+
+	handshake->data = data;
+	handshake->size = size;
+	__sync_synchronize();
+	handshake->ready = 1;
+
+	pthread_mutex_unlock(&handshake->lock);
+	return 0;
+}
+
+machine_msg_t *
+od_handshake_write(od_handshake_t *handshake,
+                   machine_msg_t *stream,
+                   kiwi_vars_t *client_vars)
+{
+	/* prebuilt route parameters */
+	if (handshake->size > 0) {
+		int offset = 0;
+		if (stream)
+			offset = machine_msg_size(stream);
+		stream = machine_msg_create_or_advance(stream, handshake->size);
+		if (stream == NULL)
+			return NULL;
+		memcpy((char *)machine_msg_data(stream) + offset,
+		       handshake->data,
+		       handshake->size);
+	}
+
+	/* client vars override route values */
+	kiwi_var_type_t type = KIWI_VAR_CLIENT_ENCODING;
+	for (; type < KIWI_VAR_MAX; type++) {
+		kiwi_var_t *var;
+		var = kiwi_vars_get(&handshake->vars, type);
+		if (var == NULL)
+			continue;
+		kiwi_var_t *client_var;
+		client_var = kiwi_vars_get(client_vars, type);
+		if (client_var)
+			var = client_var;
+		stream = kiwi_be_write_parameter_status(
+		  stream, var->name, var->name_len, var->value, var->value_len);
+		if (stream == NULL)
+			return NULL;
+	}
+	return stream;
+}
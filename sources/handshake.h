@@ -0,0 +1,61 @@
+#ifndef ODYSSEY_HANDSHAKE_H
+#define ODYSSEY_HANDSHAKE_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Route login handshake.
+ *
+ * ParameterStatus messages of the route are serialized once, when
+ * server parameters are discovered. Parameters which can be set by
+ * client (kiwi vars) are kept aside and written on each login using
+ * client value if it is set.
+ */
+
+typedef struct od_handshake od_handshake_t;
+
+struct od_handshake
+{
+	pthread_mutex_t lock;
+	volatile int ready;
+	char *data;
+	int size;
+	kiwi_vars_t vars;
+};
+
+static inline void
+od_handshake_init(od_handshake_t *handshake)
+{
+	pthread_mutex_init(&handshake->lock, NULL);
+	handshake->ready = 0;
+	handshake->data  = NULL;
+	handshake->size  = 0;
+	kiwi_vars_init(&handshake->vars);
+}
+
+static inline void
+od_handshake_free(od_handshake_t *handshake)
+{
+	pthread_mutex_destroy(&handshake->lock);
+	if (handshake->data)
+		free(handshake->data);
+}
+
+static inline int
+od_handshake_is_ready(od_handshake_t *handshake)
+{
+	int ready = handshake->ready;
+	__sync_synchronize();
+	return ready;
+}
+
+int
+od_handshake_build(od_handshake_t *, kiwi_params_lock_t *);
+machine_msg_t *
+od_handshake_write(od_handshake_t *, machine_msg_t *, kiwi_vars_t *);
+
+#endif /* ODYSSEY_HANDSHAKE_H */
@@ -29,7 +29,11 @@ od_instance_init(od_instance_t *instance)
 {
 	od_pid_init(&instance->pid);
 	od_logger_init(&instance->logger, &instance->pid);
+	od_tracer_init(&instance->tracer);
 	od_config_init(&instance->config);
+	od_registry_init(&od_registry_clients);
+	od_registry_init(&od_registry_servers);
+	od_memory_init();
 	instance->config_file        = NULL;
 	instance->shutdown_worker_id = -1;
 
@@ -49,6 +53,12 @@ od_instance_free(od_instance_t *instance)
 	if (instance->config.pid_file)
 		od_pid_unlink(&instance->pid, instance->config.pid_file);
 	od_config_free(&instance->config);
+	if (instance->config_file)
+		free(instance->config_file);
+	od_tracer_close(&instance->tracer);
+	int i;
+	for (i = 0; i < OD_SLAB_MAX; i++)
+		od_slab_free(&od_slabs[i]);
 	od_log(&instance->logger, "shutdown", NULL, NULL, "Stopping Odyssey");
 	od_logger_close(&instance->logger);
 	machinarium_free();
@@ -77,6 +87,8 @@ od_instance_main(od_instance_t *instance, int argc, char **argv)
 	od_cron_t cron;
 	od_worker_pool_t worker_pool;
 	od_module_t modules;
+	od_cancel_dispatcher_t cancel_dispatcher;
+	od_notify_relay_t notify_relay;
 	od_global_t global;
 
 	od_log(&instance->logger, "startup", NULL, NULL, "Starting Odyssey");
@@ -86,8 +98,17 @@ od_instance_main(od_instance_t *instance, int argc, char **argv)
 	od_cron_init(&cron);
 	od_worker_pool_init(&worker_pool);
 	od_modules_init(&modules);
-	od_global_init(
-	  &global, instance, &system, &router, &cron, &worker_pool, &modules);
+	od_cancel_dispatcher_init(&cancel_dispatcher);
+	od_notify_relay_init(&notify_relay);
+	od_global_init(&global,
+	               instance,
+	               &system,
+	               &router,
+	               &cron,
+	               &worker_pool,
+	               &modules,
+	               &cancel_dispatcher,
+	               &notify_relay);
 
 	/* validate command line options */
 	if (argc != 2) {
@@ -99,7 +120,10 @@ od_instance_main(od_instance_t *instance, int argc, char **argv)
 		od_router_free(&router);
 		return 0;
 	}
-	instance->config_file = argv[1];
+	/* argv is overwritten by process title, path is needed for reload */
+	instance->config_file = strdup(argv[1]);
+	if (instance->config_file == NULL)
+		goto error;
 
 	/* read config file */
 	od_error_t error;
@@ -156,6 +180,22 @@ od_instance_main(od_instance_t *instance, int argc, char **argv)
 		}
 	}
 
+	/* transaction tracing */
+	if (instance->config.trace_file) {
+		rc = od_tracer_open(&instance->tracer,
+		                    instance->config.trace_file,
+		                    instance->config.trace_sample_rate);
+		if (rc == -1) {
+			od_error(&instance->logger,
+			         "init",
+			         NULL,
+			         NULL,
+			         "failed to open trace file '%s'",
+			         instance->config.trace_file);
+			goto error;
+		}
+	}
+
 	/* syslog */
 	if (instance->config.log_syslog) {
 		od_logger_open_syslog(&instance->logger,
@@ -204,6 +244,8 @@ od_instance_main(od_instance_t *instance, int argc, char **argv)
 	machinarium_set_pool_size(instance->config.resolvers);
 	machinarium_set_coroutine_cache_size(instance->config.cache_coroutine);
 	machinarium_set_msg_cache_gc_size(instance->config.cache_msg_gc_size);
+	machinarium_set_huge_pages(instance->config.huge_pages);
+	machinarium_set_huge_pages_stacks(instance->config.huge_pages_stacks);
 	rc = machinarium_init();
 	if (rc == -1) {
 		od_error(
@@ -15,6 +15,7 @@ struct od_instance
 	od_pid_t pid;
 	od_pid_t watchdog_pid;
 	od_logger_t logger;
+	od_tracer_t tracer;
 	char *config_file;
 	od_config_t config;
 	char *orig_argv_ptr;
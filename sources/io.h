@@ -10,6 +10,7 @@
 #include "macro.h"
 
 typedef struct od_io od_io_t;
+typedef struct od_packet od_packet_t;
 
 struct od_io
 {
@@ -19,6 +20,20 @@ struct od_io
 	machine_io_t *io;
 };
 
+/*
+ * Packet view returned by od_read_packet().
+ *
+ * Data points into the readahead buffer and stays valid until the next
+ * read from the same io. Packets larger than the buffer are read into
+ * a message instead.
+ */
+struct od_packet
+{
+	char *data;
+	uint32_t size;
+	machine_msg_t *msg;
+};
+
 static inline void
 od_io_init(od_io_t *io)
 {
@@ -252,6 +267,117 @@ od_read(od_io_t *io, uint32_t time_ms)
 	return msg;
 }
 
+/* wait until readahead holds at least size unread bytes */
+static inline int
+od_io_read_ahead(od_io_t *io, int size, uint32_t time_ms)
+{
+	od_readahead_t *readahead = &io->readahead;
+	if (od_readahead_unread(readahead) >= size)
+		return 0;
+	if (od_readahead_left(readahead) < size - od_readahead_unread(readahead))
+		od_readahead_compact(readahead);
+
+	int read_started = 0;
+	int rc;
+	machine_cond_signal(io->on_read);
+	while (od_readahead_unread(readahead) < size) {
+		rc = machine_cond_wait(io->on_read, time_ms);
+		if (rc == -1)
+			return -1;
+
+		rc = machine_read_raw(io->io,
+		                      od_readahead_pos(readahead),
+		                      od_readahead_left(readahead));
+		if (rc <= 0) {
+			/* retry using read condition wait */
+			int errno_ = machine_errno();
+			if (errno_ == EAGAIN || errno_ == EWOULDBLOCK ||
+			    errno_ == EINTR) {
+				if (!read_started) {
+					rc = od_io_read_start(io);
+					if (rc == -1)
+						return -1;
+					read_started = 1;
+				}
+				continue;
+			}
+			/* error or unexpected eof */
+			return -1;
+		}
+		od_readahead_pos_advance(readahead, rc);
+	}
+
+	if (read_started) {
+		rc = od_io_read_stop(io);
+		if (rc == -1)
+			return -1;
+	}
+	return 0;
+}
+
+static inline int
+od_read_packet(od_io_t *io, od_packet_t *packet, uint32_t time_ms)
+{
+	od_readahead_t *readahead = &io->readahead;
+	packet->msg               = NULL;
+
+	int rc;
+	rc = od_io_read_ahead(io, sizeof(kiwi_header_t), time_ms);
+	if (rc == -1)
+		return -1;
+
+	/* pre-validate packet header */
+	uint32_t size;
+	rc = kiwi_validate_header(
+	  od_readahead_pos_read(readahead), sizeof(kiwi_header_t), &size);
+	if (rc == -1)
+		return -1;
+	size += sizeof(kiwi_header_t) - sizeof(uint32_t);
+
+	/* packet does not fit into readahead buffer */
+	if (size > (uint32_t)readahead->size) {
+		packet->msg = od_read(io, time_ms);
+		if (packet->msg == NULL)
+			return -1;
+		packet->data = machine_msg_data(packet->msg);
+		packet->size = machine_msg_size(packet->msg);
+		return 0;
+	}
+
+	rc = od_io_read_ahead(io, size, time_ms);
+	if (rc == -1)
+		return -1;
+	packet->data = od_readahead_pos_read(readahead);
+	packet->size = size;
+	od_readahead_pos_read_advance(readahead, size);
+	return 0;
+}
+
+static inline void
+od_packet_free(od_packet_t *packet)
+{
+	if (packet->msg) {
+		machine_msg_free(packet->msg);
+		packet->msg = NULL;
+	}
+}
+
+/* copy packet which has to outlive the readahead buffer */
+static inline machine_msg_t *
+od_packet_copy(od_packet_t *packet)
+{
+	machine_msg_t *msg = packet->msg;
+	if (msg) {
+		packet->msg = NULL;
+		return msg;
+	}
+	msg = machine_msg_create(packet->size);
+	if (msg == NULL)
+		return NULL;
+	memcpy(machine_msg_data(msg), packet->data, packet->size);
+	return msg;
+}
+
 static inline int
 od_write(od_io_t *io, machine_msg_t *msg)
 {
@@ -0,0 +1,185 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <machinarium.h>
+
+#include "macro.h"
+#include "limit.h"
+
+void
+od_limit_init(od_limit_t *limit, int qps, int tps, int bytes, int tx_max)
+{
+	memset(limit, 0, sizeof(od_limit_t));
+	int rate[OD_LIMIT_CONCURRENCY];
+	rate[OD_LIMIT_QUERIES]      = qps;
+	rate[OD_LIMIT_TRANSACTIONS] = tps;
+	rate[OD_LIMIT_BYTES]        = bytes;
+	int i;
+	for (i = 0; i < OD_LIMIT_CONCURRENCY; i++) {
+		od_limit_bucket_t *bucket = &limit->bucket[i];
+		mm_sleeplock_init(&bucket->lock);
+		bucket->rate    = rate[i];
+		bucket->tokens  = (int64_t)rate[i] * OD_LIMIT_SCALE;
+		bucket->time_us = 0;
+	}
+	limit->tx_max  = tx_max;
+	limit->enabled = qps > 0 || tps > 0 || bytes > 0 || tx_max > 0;
+	pthread_mutex_init(&limit->tx_lock, NULL);
+	od_list_init(&limit->tx_waiters);
+}
+
+void
+od_limit_free(od_limit_t *limit)
+{
+	pthread_mutex_destroy(&limit->tx_lock);
+}
+
+static inline void
+od_limit_bucket_refill(od_limit_bucket_t *bucket, uint64_t now_us)
+{
+	int64_t capacity = bucket->rate * OD_LIMIT_SCALE;
+	if (bucket->time_us == 0 || now_us <= bucket->time_us) {
+		if (bucket->time_us == 0)
+			bucket->time_us = now_us;
+		return;
+	}
+	uint64_t elapsed = now_us - bucket->time_us;
+	bucket->time_us  = now_us;
+	/* whole second of refill always fills the bucket up */
+	if (elapsed >= 1000000) {
+		bucket->tokens = capacity;
+		return;
+	}
+	bucket->tokens += (int64_t)elapsed * bucket->rate;
+	if (bucket->tokens > capacity)
+		bucket->tokens = capacity;
+}
+
+/*
+ * Charge amount tokens and return number of microseconds the caller
+ * has to wait before proceeding, or -1 if the wait exceeds max_wait_us.
+ * Rejected request is not charged.
+ */
+int64_t
+od_limit_reserve(od_limit_t *limit,
+                 od_limit_type_t type,
+                 uint64_t amount,
+                 uint64_t now_us,
+                 uint64_t max_wait_us)
+{
+	od_limit_bucket_t *bucket = &limit->bucket[type];
+	if (bucket->rate <= 0)
+		return 0;
+
+	mm_sleeplock_lock(&bucket->lock);
+	od_limit_bucket_refill(bucket, now_us);
+
+	/* requests larger than the bucket wait only for a full bucket */
+	int64_t need = (int64_t)amount * OD_LIMIT_SCALE;
+	if (need > bucket->rate * OD_LIMIT_SCALE)
+		need = bucket->rate * OD_LIMIT_SCALE;
+
+	int64_t wait_us = 0;
+	if (bucket->tokens < need)
+		wait_us = (need - bucket->tokens + bucket->rate - 1) / bucket->rate;
+	if ((uint64_t)wait_us > max_wait_us) {
+		mm_sleeplock_unlock(&bucket->lock);
+		return -1;
+	}
+	bucket->tokens -= (int64_t)amount * OD_LIMIT_SCALE;
+
+	mm_sleeplock_unlock(&bucket->lock);
+	return wait_us;
+}
+
+int
+od_limit_tx_acquire(od_limit_t *limit)
+{
+	if (limit->tx_max <= 0) {
+		__sync_fetch_and_add(&limit->tx_active, 1);
+		return 0;
+	}
+	int rc = -1;
+	pthread_mutex_lock(&limit->tx_lock);
+	/* do not overtake waiters */
+	if (limit->tx_active < (uint32_t)limit->tx_max &&
+	    od_list_empty(&limit->tx_waiters)) {
+		limit->tx_active++;
+		rc = 0;
+	}
+	pthread_mutex_unlock(&limit->tx_lock);
+	return rc;
+}
+
+/*
+ * Wait in the queue for a transaction slot, released slot is handed
+ * over by od_limit_tx_release(). Returns -1 on timeout.
+ */
+int
+od_limit_tx_wait(od_limit_t *limit, od_limit_waiter_t *waiter, uint32_t time_ms)
+{
+	/* waiters are woken up by other workers */
+	waiter->granted = 0;
+	waiter->channel = machine_channel_create(1);
+	if (waiter->channel == NULL)
+		return -1;
+	od_list_init(&waiter->link);
+
+	pthread_mutex_lock(&limit->tx_lock);
+	if (limit->tx_active < (uint32_t)limit->tx_max &&
+	    od_list_empty(&limit->tx_waiters)) {
+		limit->tx_active++;
+		waiter->granted = 1;
+	} else {
+		od_list_append(&limit->tx_waiters, &waiter->link);
+	}
+	pthread_mutex_unlock(&limit->tx_lock);
+
+	if (!waiter->granted) {
+		machine_msg_t *msg;
+		msg = machine_channel_read(waiter->channel, time_ms);
+		if (msg)
+			machine_msg_free(msg);
+		pthread_mutex_lock(&limit->tx_lock);
+		if (!waiter->granted)
+			od_list_unlink(&waiter->link);
+		pthread_mutex_unlock(&limit->tx_lock);
+	}
+
+	machine_channel_free(waiter->channel);
+	waiter->channel = NULL;
+	return waiter->granted ? 0 : -1;
+}
+
+void
+od_limit_tx_release(od_limit_t *limit)
+{
+	if (limit->tx_max <= 0) {
+		__sync_fetch_and_sub(&limit->tx_active, 1);
+		return;
+	}
+	pthread_mutex_lock(&limit->tx_lock);
+	machine_msg_t *msg = NULL;
+	if (!od_list_empty(&limit->tx_waiters))
+		msg = machine_msg_create(0);
+	if (msg == NULL) {
+		limit->tx_active--;
+		pthread_mutex_unlock(&limit->tx_lock);
+		return;
+	}
+	od_limit_waiter_t *waiter;
+	waiter = od_container_of(limit->tx_waiters.next, od_limit_waiter_t, link);
+	od_list_unlink(&waiter->link);
+	waiter->granted = 1;
+	machine_channel_write(waiter->channel, msg);
+	pthread_mutex_unlock(&limit->tx_lock);
+}
@@ -0,0 +1,116 @@
+#ifndef ODYSSEY_LIMIT_H
+#define ODYSSEY_LIMIT_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Route rate and concurrency limits.
+ *
+ * Every rate limit is a token bucket refilled continuously at rate
+ * tokens per second, bucket capacity is one second worth of tokens.
+ * A request is reserved: it is told how long to wait until the bucket
+ * has its tokens. If the wait fits into the allowed time (zero for the
+ * reject policy) the request is charged right away, driving the bucket
+ * into debt, so later requests wait longer. This keeps waiters in
+ * arrival order without an explicit queue. A request that would wait
+ * too long is rejected and is not charged.
+ *
+ * Transactions over the concurrency limit wait in a FIFO queue, a
+ * finished transaction hands its slot to the first waiter.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "list.h"
+#include "sleep_lock.h"
+
+#define OD_LIMIT_SCALE 1000000LL
+
+typedef enum
+{
+	OD_LIMIT_QUERIES,
+	OD_LIMIT_TRANSACTIONS,
+	OD_LIMIT_BYTES,
+	OD_LIMIT_CONCURRENCY,
+	OD_LIMIT_MAX
+} od_limit_type_t;
+
+typedef struct od_limit_bucket od_limit_bucket_t;
+typedef struct od_limit_waiter od_limit_waiter_t;
+typedef struct od_limit od_limit_t;
+
+struct od_limit_bucket
+{
+	mm_sleeplock_t lock;
+	int64_t rate;
+	int64_t tokens;
+	uint64_t time_us;
+};
+
+struct od_limit_waiter
+{
+	int granted;
+	machine_channel_t *channel;
+	od_list_t link;
+};
+
+struct od_limit
+{
+	/* QUERIES, TRANSACTIONS and BYTES buckets */
+	od_limit_bucket_t bucket[OD_LIMIT_CONCURRENCY];
+	int enabled;
+	int tx_max;
+	pthread_mutex_t tx_lock;
+	volatile uint32_t tx_active;
+	od_list_t tx_waiters;
+	volatile uint64_t delayed[OD_LIMIT_MAX];
+	volatile uint64_t rejected[OD_LIMIT_MAX];
+};
+
+static inline char *
+od_limit_type_to_str(od_limit_type_t type)
+{
+	switch (type) {
+		case OD_LIMIT_QUERIES:
+			return "queries";
+		case OD_LIMIT_TRANSACTIONS:
+			return "transactions";
+		case OD_LIMIT_BYTES:
+			return "bytes";
+		case OD_LIMIT_CONCURRENCY:
+			return "concurrency";
+		default:
+			break;
+	}
+	return "unknown";
+}
+
+static inline int
+od_limit_is_set(od_limit_t *limit, od_limit_type_t type)
+{
+	if (type == OD_LIMIT_CONCURRENCY)
+		return limit->tx_max > 0;
+	return limit->bucket[type].rate > 0;
+}
+
+void
+od_limit_init(od_limit_t *, int, int, int, int);
+void
+od_limit_free(od_limit_t *);
+int64_t
+od_limit_reserve(od_limit_t *, od_limit_type_t, uint64_t, uint64_t, uint64_t);
+int
+od_limit_tx_acquire(od_limit_t *);
+int
+od_limit_tx_wait(od_limit_t *, od_limit_waiter_t *, uint32_t);
+void
+od_limit_tx_release(od_limit_t *);
+
+#endif /* ODYSSEY_LIMIT_H */
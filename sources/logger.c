@@ -264,10 +264,10 @@ od_logger_format(od_logger_t *logger,
 					break;
 				/* user name */
 				case 'u':
-					if (client && client->startup.user.value_len) {
+					if (client && client->cold->startup.user.value_len) {
 						len = od_snprintf(dst_pos,
 						                  dst_end - dst_pos,
-						                  client->startup.user.value);
+						                  client->cold->startup.user.value);
 						dst_pos += len;
 						break;
 					}
@@ -276,10 +276,10 @@ od_logger_format(od_logger_t *logger,
 					break;
 				/* database name */
 				case 'd':
-					if (client && client->startup.database.value_len) {
+					if (client && client->cold->startup.database.value_len) {
 						len = od_snprintf(dst_pos,
 						                  dst_end - dst_pos,
-						                  client->startup.database.value);
+						                  client->cold->startup.database.value);
 						dst_pos += len;
 						break;
 					}
@@ -14,6 +14,9 @@
 
 #define od_container_of(N, T, F) ((T *)((char *)(N) - __builtin_offsetof(T, F)))
 
+/* C11 static assertion, accepted by gcc and clang in C99 mode */
+#define od_static_assert(EXPR, MSG) __extension__ _Static_assert(EXPR, MSG)
+
 #define OK_RESPONSE 0
 #define NOT_OK_RESPONSE -1
 
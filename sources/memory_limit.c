@@ -0,0 +1,72 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+od_memory_t od_memory;
+
+void
+od_memory_init(void)
+{
+	od_memory.limit    = 0;
+	od_memory.pressure = 0;
+	od_counter_init(&od_memory.counter);
+}
+
+void
+od_memory_usage(od_memory_usage_t *usage)
+{
+	machine_memory_stat(
+	  &usage->msg, &usage->iov, &usage->stack, &usage->readahead);
+	usage->total = usage->msg + usage->iov + usage->stack + usage->readahead;
+}
+
+static inline int
+od_memory_set_pressure(uint64_t total)
+{
+	uint64_t limit = od_memory.limit;
+	int pressure   = 0;
+	if (limit > 0)
+		pressure = total >= limit / 100 * OD_MEMORY_PRESSURE_PERCENT;
+	__atomic_store_n(&od_memory.pressure, pressure, __ATOMIC_RELAXED);
+	return pressure;
+}
+
+int
+od_memory_refresh(void)
+{
+	if (od_memory.limit == 0)
+		return od_memory_set_pressure(0);
+	od_memory_usage_t usage;
+	od_memory_usage(&usage);
+	return od_memory_set_pressure(usage.total);
+}
+
+int
+od_memory_update(uint64_t limit)
+{
+	od_memory.limit = limit;
+	return od_memory_refresh();
+}
+
+int
+od_memory_reserve(uint64_t size)
+{
+	uint64_t limit = od_memory.limit;
+	if (limit == 0)
+		return 0;
+	od_memory_usage_t usage;
+	od_memory_usage(&usage);
+	od_memory_set_pressure(usage.total + size);
+	if (usage.total + size > limit) {
+		od_memory_inc(OD_MEMORY_PACKET_REJECTED);
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef ODYSSEY_MEMORY_LIMIT_H
+#define ODYSSEY_MEMORY_LIMIT_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include "counter.h"
+
+/*
+ * Global memory accounting.
+ *
+ * Message buffers, iov arrays, coroutine stacks and readahead buffers
+ * are accounted by machinarium in per-thread slots. Cron sums them up
+ * every second and raises the pressure flag when usage comes close to
+ * memory_limit. Under pressure new logins are rejected and relays
+ * holding copied packets stop reading until their queued output is
+ * written.
+ */
+
+#define OD_MEMORY_PRESSURE_PERCENT 90
+
+typedef struct od_memory_usage od_memory_usage_t;
+typedef struct od_memory od_memory_t;
+
+typedef enum
+{
+	OD_MEMORY_LOGIN_REJECTED,
+	OD_MEMORY_READ_PAUSED,
+	OD_MEMORY_PACKET_REJECTED,
+	OD_MEMORY_ITEM_MAX
+} od_memory_item_t;
+
+od_static_assert((int)OD_MEMORY_ITEM_MAX <= (int)OD_COUNTER_MAX,
+                 "memory events do not fit into counter");
+
+struct od_memory_usage
+{
+	uint64_t msg;
+	uint64_t iov;
+	uint64_t stack;
+	uint64_t readahead;
+	uint64_t total;
+};
+
+struct od_memory
+{
+	uint64_t limit;
+	int pressure;
+	od_counter_t counter;
+};
+
+extern od_memory_t od_memory;
+
+static inline void
+od_memory_inc(od_memory_item_t item)
+{
+	od_counter_inc(&od_memory.counter, item);
+}
+
+static inline int
+od_memory_pressure(void)
+{
+	return __atomic_load_n(&od_memory.pressure, __ATOMIC_RELAXED);
+}
+
+void
+od_memory_init(void);
+void
+od_memory_usage(od_memory_usage_t *);
+int
+od_memory_refresh(void);
+int
+od_memory_update(uint64_t);
+int
+od_memory_reserve(uint64_t);
+
+#endif /* ODYSSEY_MEMORY_LIMIT_H */
@@ -13,7 +13,9 @@
 #include "pid.h"
 #include "logger.h"
 #include "status.h"
+#include "memory_limit.h"
 #include "readahead.h"
+#include "spool.h"
 #include "io.h"
 #include "relay.h"
 
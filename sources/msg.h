@@ -10,7 +10,11 @@
 typedef enum
 {
 	OD_MSG_STAT,
-	OD_MSG_CLIENT_NEW
+	OD_MSG_CLIENT_NEW,
+	OD_MSG_CANCEL,
+	OD_MSG_NOTIFY,
+	OD_MSG_LOAD,
+	OD_MSG_RETIRE
 } od_msg_t;
 
 #endif /* ODYSSEY_MSG_H */
@@ -0,0 +1,97 @@
+#ifndef ODYSSEY_NOTIFY_QUEUE_H
+#define ODYSSEY_NOTIFY_QUEUE_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Client notification queue.
+ *
+ * NotificationResponse messages relayed by the notify machine are
+ * queued here and written by the client coroutine when client has no
+ * server attached.
+ */
+
+typedef struct od_notify_queue od_notify_queue_t;
+typedef struct od_notify_queue_msg od_notify_queue_msg_t;
+
+struct od_notify_queue_msg
+{
+	od_list_t link;
+	int size;
+	char data[];
+};
+
+struct od_notify_queue
+{
+	pthread_mutex_t lock;
+	od_list_t list;
+	int count;
+};
+
+static inline od_notify_queue_t *
+od_notify_queue_create(void)
+{
+	od_notify_queue_t *queue = malloc(sizeof(od_notify_queue_t));
+	if (queue == NULL)
+		return NULL;
+	pthread_mutex_init(&queue->lock, NULL);
+	od_list_init(&queue->list);
+	queue->count = 0;
+	return queue;
+}
+
+static inline void
+od_notify_queue_free(od_notify_queue_t *queue)
+{
+	od_list_t *i, *n;
+	od_list_foreach_safe(&queue->list, i, n)
+	{
+		od_notify_queue_msg_t *msg;
+		msg = od_container_of(i, od_notify_queue_msg_t, link);
+		free(msg);
+	}
+	pthread_mutex_destroy(&queue->lock);
+	free(queue);
+}
+
+static inline int
+od_notify_queue_push(od_notify_queue_t *queue, char *data, int size)
+{
+	od_notify_queue_msg_t *msg;
+	msg = malloc(sizeof(od_notify_queue_msg_t) + size);
+	if (msg == NULL)
+		return -1;
+	msg->size = size;
+	memcpy(msg->data, data, size);
+	od_list_init(&msg->link);
+
+	pthread_mutex_lock(&queue->lock);
+	od_list_append(&queue->list, &msg->link);
+	queue->count++;
+	pthread_mutex_unlock(&queue->lock);
+	return 0;
+}
+
+/* move all queued messages to the list */
+static inline int
+od_notify_queue_pop_all(od_notify_queue_t *queue, od_list_t *list)
+{
+	pthread_mutex_lock(&queue->lock);
+	int count = queue->count;
+	if (count > 0) {
+		list->next       = queue->list.next;
+		list->prev       = queue->list.prev;
+		list->next->prev = list;
+		list->prev->next = list;
+		od_list_init(&queue->list);
+		queue->count = 0;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return count;
+}
+
+#endif /* ODYSSEY_NOTIFY_QUEUE_H */
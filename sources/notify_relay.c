@@ -0,0 +1,794 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+void
+od_notify_relay_init(od_notify_relay_t *relay)
+{
+	relay->machine = -1;
+	relay->channel = NULL;
+	relay->global  = NULL;
+	pthread_mutex_init(&relay->lock, NULL);
+	od_list_init(&relay->listeners);
+	int i;
+	for (i = 0; i < OD_NOTIFY_CLIENTS; i++)
+		od_list_init(&relay->clients[i]);
+}
+
+static inline char *
+od_notify_skip_space(char *pos, char *end)
+{
+	while (pos < end && isspace((unsigned char)*pos))
+		pos++;
+	return pos;
+}
+
+static inline int
+od_notify_is_ident(char c)
+{
+	return isalnum((unsigned char)c) || c == '_' || c == '$' ||
+	       (unsigned char)c >= 0x80;
+}
+
+static inline char *
+od_notify_parse_keyword(char *pos, char *end, char *keyword)
+{
+	int len = strlen(keyword);
+	if (end - pos <= len)
+		return NULL;
+	if (strncasecmp(pos, keyword, len) != 0)
+		return NULL;
+	if (!isspace((unsigned char)pos[len]) && pos[len] != '"')
+		return NULL;
+	return pos + len;
+}
+
+/* channel name is normalized the same way postgres does for identifiers */
+int
+od_notify_parse(char *query, int size, od_notify_op_t *op, char *channel)
+{
+	char *pos = query;
+	char *end = query + size;
+	/* query string is zero terminated */
+	while (end > pos && end[-1] == 0)
+		end--;
+
+	pos = od_notify_skip_space(pos, end);
+	char *next;
+	next = od_notify_parse_keyword(pos, end, "listen");
+	if (next) {
+		*op = OD_NOTIFY_LISTEN;
+	} else {
+		next = od_notify_parse_keyword(pos, end, "unlisten");
+		if (next == NULL)
+			return -1;
+		*op = OD_NOTIFY_UNLISTEN;
+	}
+	pos = od_notify_skip_space(next, end);
+	if (pos == end)
+		return -1;
+
+	int len = 0;
+	if (*pos == '*') {
+		if (*op != OD_NOTIFY_UNLISTEN)
+			return -1;
+		*op = OD_NOTIFY_UNLISTEN_ALL;
+		pos++;
+	} else if (*pos == '"') {
+		pos++;
+		for (;;) {
+			if (pos == end)
+				return -1;
+			if (*pos == '"') {
+				if (pos + 1 < end && pos[1] == '"') {
+					pos++;
+				} else {
+					pos++;
+					break;
+				}
+			}
+			if (len < OD_NOTIFY_CHANNEL_MAX - 1)
+				channel[len++] = *pos;
+			pos++;
+		}
+	} else {
+		while (pos < end && od_notify_is_ident(*pos)) {
+			if (len < OD_NOTIFY_CHANNEL_MAX - 1)
+				channel[len++] = tolower((unsigned char)*pos);
+			pos++;
+		}
+	}
+	channel[len] = 0;
+	if (len == 0 && *op != OD_NOTIFY_UNLISTEN_ALL)
+		return -1;
+
+	/* single statement only */
+	pos = od_notify_skip_space(pos, end);
+	if (pos < end && *pos == ';')
+		pos = od_notify_skip_space(pos + 1, end);
+	if (pos != end)
+		return -1;
+	return 0;
+}
+
+static inline od_list_t *
+od_notify_relay_clients_of(od_notify_relay_t *relay, od_id_t *id)
+{
+	uint32_t hash = 0;
+	unsigned int i;
+	for (i = 0; i < sizeof(id->id); i++)
+		hash = hash * 31 + (unsigned char)id->id[i];
+	return &relay->clients[hash % OD_NOTIFY_CLIENTS];
+}
+
+static inline od_notify_client_t *
+od_notify_relay_client(od_notify_relay_t *relay, od_id_t *id)
+{
+	od_list_t *list = od_notify_relay_clients_of(relay, id);
+	od_list_t *i;
+	od_list_foreach(list, i)
+	{
+		od_notify_client_t *client;
+		client = od_container_of(i, od_notify_client_t, link);
+		if (od_id_cmp(&client->id, id))
+			return client;
+	}
+	return NULL;
+}
+
+static inline od_notify_channel_t *
+od_notify_listener_channel(od_notify_listener_t *listener, char *name)
+{
+	od_list_t *i;
+	od_list_foreach(&listener->channels, i)
+	{
+		od_notify_channel_t *channel;
+		channel = od_container_of(i, od_notify_channel_t, link);
+		if (strcmp(channel->name, name) == 0)
+			return channel;
+	}
+	return NULL;
+}
+
+static inline int
+od_notify_deliver_cb(od_registry_node_t *node, void **argv)
+{
+	char *data = argv[0];
+	int *size  = argv[1];
+	int *rc    = argv[2];
+
+	od_client_t *client;
+	client = od_container_of(node, od_client_t, registry);
+	if (client->notify_queue == NULL)
+		return 0;
+	if (od_notify_queue_push(client->notify_queue, data, *size) == -1)
+		return 0;
+	od_client_ctl_set(client, OD_CLIENT_OP_NOTIFY);
+	od_client_notify(client);
+	*rc = 1;
+	return 0;
+}
+
+static inline void
+od_notify_listener_fanout(od_notify_listener_t *listener,
+                          char *data,
+                          int size)
+{
+	/* NotificationResponse: pid, channel, payload */
+	uint32_t header_size = sizeof(kiwi_header_t) + sizeof(uint32_t);
+	if ((uint32_t)size <= header_size)
+		return;
+	char *name = data + header_size;
+	if (memchr(name, 0, size - header_size) == NULL)
+		return;
+
+	od_atomic_u64_inc(&listener->count_notify);
+
+	od_notify_channel_t *channel;
+	channel = od_notify_listener_channel(listener, name);
+	if (channel == NULL)
+		return;
+
+	od_list_t *i;
+	od_list_foreach(&channel->subs, i)
+	{
+		od_notify_sub_t *sub;
+		sub        = od_container_of(i, od_notify_sub_t, link_channel);
+		int rc     = 0;
+		void *argv[] = { data, &size, &rc };
+		od_registry_find(
+		  &od_registry_clients, &sub->client->id, od_notify_deliver_cb, argv);
+		if (rc)
+			od_atomic_u64_inc(&listener->count_delivered);
+		else
+			od_atomic_u64_inc(&listener->count_dropped);
+	}
+}
+
+static inline od_client_t *
+od_notify_listener_connect(od_notify_listener_t *listener)
+{
+	od_global_t *global     = listener->relay->global;
+	od_instance_t *instance = global->instance;
+	od_router_t *router     = global->router;
+
+	/* create internal listener client */
+	od_client_t *client;
+	client = od_client_allocate();
+	if (client == NULL)
+		return NULL;
+	client->global = global;
+	od_id_generate(&client->id, "n");
+
+	kiwi_var_set(&client->cold->startup.user,
+	             KIWI_VAR_UNDEF,
+	             listener->startup_user,
+	             strlen(listener->startup_user) + 1);
+
+	kiwi_var_set(&client->cold->startup.database,
+	             KIWI_VAR_UNDEF,
+	             listener->startup_database,
+	             strlen(listener->startup_database) + 1);
+
+	/* route */
+	od_router_status_t status;
+	status = od_router_route(router, &instance->config, client);
+	if (status != OD_ROUTER_OK) {
+		od_client_free(client);
+		return NULL;
+	}
+
+	/* attach */
+	status = od_router_attach(router, &instance->config, client, false);
+	if (status != OD_ROUTER_OK) {
+		od_router_unroute(router, client);
+		od_client_free(client);
+		return NULL;
+	}
+	od_server_t *server = client->server;
+
+	/* connect to server, if necessary */
+	if (server->io.io == NULL) {
+		int rc;
+		rc = od_backend_connect(server, "notify", NULL);
+		if (rc == -1) {
+			od_router_close(router, client);
+			od_router_unroute(router, client);
+			od_client_free(client);
+			return NULL;
+		}
+	}
+
+	od_log(&instance->logger,
+	       "notify",
+	       client,
+	       server,
+	       "listener for %s.%s connected",
+	       listener->storage,
+	       listener->database);
+	return client;
+}
+
+static inline void
+od_notify_listener_close(od_notify_listener_t *listener,
+                         od_client_t *client,
+                         int release)
+{
+	od_router_t *router     = listener->relay->global->router;
+	od_instance_t *instance = listener->relay->global->instance;
+	od_server_t *server     = client->server;
+
+	machine_cond_propagate(server->io.on_read, NULL);
+
+	/* connection is reusable after UNLISTEN and pending replies */
+	if (release) {
+		char query[] = "UNLISTEN *";
+		int rc;
+		rc = od_backend_query(server, "notify", query, sizeof(query), 1000);
+		while (rc != -1 && !od_server_synchronized(server))
+			rc = od_backend_ready_wait(server, "notify", 1, 1000);
+		if (rc == -1)
+			release = 0;
+	}
+	if (release) {
+		od_router_detach(router, &instance->config, client);
+	} else {
+		od_router_close(router, client);
+	}
+	od_router_unroute(router, client);
+	od_client_free(client);
+
+	listener->connected = 0;
+	od_list_t *i;
+	od_list_foreach(&listener->channels, i)
+	{
+		od_notify_channel_t *channel;
+		channel           = od_container_of(i, od_notify_channel_t, link);
+		channel->listened = 0;
+	}
+}
+
+static inline int
+od_notify_listener_send(od_server_t *server, char *command, char *name)
+{
+	/* quote channel as identifier */
+	char query[OD_NOTIFY_CHANNEL_MAX * 2 + 32];
+	int pos = od_snprintf(query, sizeof(query), "%s \"", command);
+	char *c = name;
+	for (; *c; c++) {
+		if (*c == '"')
+			query[pos++] = '"';
+		query[pos++] = *c;
+	}
+	query[pos++] = '"';
+	query[pos++] = 0;
+
+	machine_msg_t *msg;
+	msg = kiwi_fe_write_query(NULL, query, pos);
+	if (msg == NULL)
+		return -1;
+	od_server_sync_request(server, 1);
+	return od_write(&server->io, msg);
+}
+
+/* issue LISTEN and UNLISTEN to match subscribed channels */
+static inline int
+od_notify_listener_sync(od_notify_listener_t *listener, od_server_t *server)
+{
+	while (listener->dirty) {
+		listener->dirty = 0;
+		od_list_t *i, *n;
+		od_list_foreach_safe(&listener->channels, i, n)
+		{
+			od_notify_channel_t *channel;
+			channel = od_container_of(i, od_notify_channel_t, link);
+			int rc;
+			if (channel->subscribers > 0) {
+				if (channel->listened)
+					continue;
+				channel->listened = 1;
+				rc = od_notify_listener_send(server, "LISTEN", channel->name);
+				if (rc == -1)
+					return -1;
+				continue;
+			}
+			if (channel->listened) {
+				channel->listened = 0;
+				rc = od_notify_listener_send(server, "UNLISTEN", channel->name);
+				if (rc == -1)
+					return -1;
+				/* subscribed again while writing */
+				if (channel->subscribers > 0) {
+					listener->dirty = 1;
+					continue;
+				}
+			}
+			od_list_unlink(&channel->link);
+			free(channel);
+			od_atomic_u32_dec(&listener->count_channel);
+		}
+	}
+	return 0;
+}
+
+static inline int
+od_notify_listener_read(od_notify_listener_t *listener, od_server_t *server)
+{
+	od_instance_t *instance   = listener->relay->global->instance;
+	od_readahead_t *readahead = &server->io.readahead;
+
+	/* on_read may be signalled spuriously, read without blocking */
+	od_readahead_reuse(readahead);
+	int to_read = od_readahead_left(readahead);
+	if (to_read > 0) {
+		int rc;
+		rc = machine_read_raw(
+		  server->io.io, od_readahead_pos(readahead), to_read);
+		if (rc <= 0) {
+			int errno_ = machine_errno();
+			if (errno_ != EAGAIN && errno_ != EWOULDBLOCK &&
+			    errno_ != EINTR)
+				goto error;
+		} else {
+			od_readahead_pos_advance(readahead, rc);
+		}
+	}
+
+	/* process received packets, the rest of a started packet is
+	 * expected to arrive */
+	while (od_readahead_unread(readahead) >= (int)sizeof(kiwi_header_t)) {
+		od_packet_t packet;
+		int rc;
+		rc = od_read_packet(&server->io, &packet, UINT32_MAX);
+		if (rc == -1)
+			goto error;
+		kiwi_be_type_t type = *packet.data;
+		switch (type) {
+			case KIWI_BE_NOTIFICATION_RESPONSE:
+				od_notify_listener_fanout(listener, packet.data, packet.size);
+				break;
+			case KIWI_BE_READY_FOR_QUERY:
+				od_backend_ready(server, packet.data, packet.size);
+				break;
+			case KIWI_BE_ERROR_RESPONSE:
+				od_backend_error(server, "notify", packet.data, packet.size);
+				break;
+			default:
+				break;
+		}
+		od_packet_free(&packet);
+	}
+	return 0;
+
+error:
+	od_error(&instance->logger,
+	         "notify",
+	         NULL,
+	         server,
+	         "read error: %s",
+	         od_io_error(&server->io));
+	return -1;
+}
+
+static void
+od_notify_listener_main(void *arg)
+{
+	od_notify_listener_t *listener = arg;
+	od_client_t *client            = NULL;
+
+	for (;;) {
+		if (od_list_empty(&listener->channels)) {
+			if (client) {
+				od_notify_listener_close(listener, client, 1);
+				client = NULL;
+			}
+			machine_cond_wait(listener->cond, UINT32_MAX);
+			continue;
+		}
+
+		if (client == NULL) {
+			client = od_notify_listener_connect(listener);
+			if (client == NULL) {
+				machine_sleep(1000);
+				continue;
+			}
+			listener->connected = 1;
+			listener->dirty     = 1;
+			machine_cond_propagate(client->server->io.on_read,
+			                       listener->cond);
+		}
+		od_server_t *server = client->server;
+
+		int rc;
+		rc = od_notify_listener_sync(listener, server);
+		if (rc == -1)
+			goto error;
+		if (od_list_empty(&listener->channels))
+			continue;
+
+		/* wait for notifications or subscription changes */
+		rc = od_io_read_start(&server->io);
+		if (rc == -1)
+			goto error;
+		machine_cond_wait(listener->cond, UINT32_MAX);
+		rc = od_io_read_stop(&server->io);
+		if (rc == -1)
+			goto error;
+		if (!machine_cond_try(server->io.on_read))
+			continue;
+
+		rc = od_notify_listener_read(listener, server);
+		if (rc == -1)
+			goto error;
+		continue;
+	error:
+		od_notify_listener_close(listener, client, 0);
+		client = NULL;
+		machine_sleep(1000);
+	}
+}
+
+static inline od_notify_listener_t *
+od_notify_relay_listener(od_notify_relay_t *relay, od_notify_request_t *request)
+{
+	od_list_t *i;
+	od_list_foreach(&relay->listeners, i)
+	{
+		od_notify_listener_t *listener;
+		listener = od_container_of(i, od_notify_listener_t, link);
+		if (strcmp(listener->storage, request->storage) == 0 &&
+		    strcmp(listener->database, request->database) == 0)
+			return listener;
+	}
+
+	od_notify_listener_t *listener = calloc(1, sizeof(od_notify_listener_t));
+	if (listener == NULL)
+		return NULL;
+	listener->relay = relay;
+	listener->cond  = machine_cond_create();
+	if (listener->cond == NULL) {
+		free(listener);
+		return NULL;
+	}
+	/* listener takes ownership of request strings */
+	listener->storage          = request->storage;
+	listener->database         = request->database;
+	listener->startup_user     = request->startup_user;
+	listener->startup_database = request->startup_database;
+	request->storage           = NULL;
+	request->database          = NULL;
+	request->startup_user      = NULL;
+	request->startup_database  = NULL;
+	od_list_init(&listener->channels);
+	od_list_init(&listener->link);
+
+	int64_t coroutine_id;
+	coroutine_id = machine_coroutine_create(od_notify_listener_main, listener);
+	if (coroutine_id == -1) {
+		od_instance_t *instance = relay->global->instance;
+		od_error(&instance->logger,
+		         "notify",
+		         NULL,
+		         NULL,
+		         "failed to start listener coroutine");
+		/* keep listener in the list, subscriptions are not relayed */
+	}
+
+	pthread_mutex_lock(&relay->lock);
+	od_list_append(&relay->listeners, &listener->link);
+	pthread_mutex_unlock(&relay->lock);
+	return listener;
+}
+
+static inline void
+od_notify_relay_unsubscribe(od_notify_sub_t *sub)
+{
+	od_notify_channel_t *channel   = sub->channel;
+	od_notify_listener_t *listener = sub->client->listener;
+	od_list_unlink(&sub->link_channel);
+	od_list_unlink(&sub->link_client);
+	free(sub);
+
+	od_atomic_u32_dec(&listener->count_subscription);
+	channel->subscribers--;
+	if (channel->subscribers == 0) {
+		/* channel is removed by listener */
+		listener->dirty = 1;
+		machine_cond_signal(listener->cond);
+	}
+}
+
+static inline void
+od_notify_relay_listen(od_notify_relay_t *relay, od_notify_request_t *request)
+{
+	od_notify_client_t *client;
+	client = od_notify_relay_client(relay, &request->client_id);
+	if (client == NULL) {
+		od_notify_listener_t *listener;
+		listener = od_notify_relay_listener(relay, request);
+		if (listener == NULL)
+			return;
+		client = malloc(sizeof(od_notify_client_t));
+		if (client == NULL)
+			return;
+		client->id       = request->client_id;
+		client->listener = listener;
+		od_list_init(&client->subs);
+		od_list_init(&client->link);
+		od_list_append(od_notify_relay_clients_of(relay, &client->id),
+		               &client->link);
+	}
+	od_notify_listener_t *listener = client->listener;
+
+	/* already subscribed */
+	od_list_t *i;
+	od_list_foreach(&client->subs, i)
+	{
+		od_notify_sub_t *sub;
+		sub = od_container_of(i, od_notify_sub_t, link_client);
+		if (strcmp(sub->channel->name, request->channel) == 0)
+			return;
+	}
+
+	od_notify_channel_t *channel;
+	channel = od_notify_listener_channel(listener, request->channel);
+	if (channel == NULL) {
+		channel = malloc(sizeof(od_notify_channel_t));
+		if (channel == NULL)
+			return;
+		strcpy(channel->name, request->channel);
+		channel->listened    = 0;
+		channel->subscribers = 0;
+		od_list_init(&channel->subs);
+		od_list_init(&channel->link);
+		od_list_append(&listener->channels, &channel->link);
+		od_atomic_u32_inc(&listener->count_channel);
+	}
+
+	od_notify_sub_t *sub = malloc(sizeof(od_notify_sub_t));
+	if (sub == NULL)
+		return;
+	sub->client  = client;
+	sub->channel = channel;
+	od_list_init(&sub->link_channel);
+	od_list_init(&sub->link_client);
+	od_list_append(&channel->subs, &sub->link_channel);
+	od_list_append(&client->subs, &sub->link_client);
+	od_atomic_u32_inc(&listener->count_subscription);
+
+	channel->subscribers++;
+	if (!channel->listened) {
+		listener->dirty = 1;
+		machine_cond_signal(listener->cond);
+	}
+}
+
+static inline void
+od_notify_relay_unlisten(od_notify_relay_t *relay, od_notify_request_t *request)
+{
+	od_notify_client_t *client;
+	client = od_notify_relay_client(relay, &request->client_id);
+	if (client == NULL)
+		return;
+
+	od_list_t *i, *n;
+	od_list_foreach_safe(&client->subs, i, n)
+	{
+		od_notify_sub_t *sub;
+		sub = od_container_of(i, od_notify_sub_t, link_client);
+		if (request->op == OD_NOTIFY_UNLISTEN &&
+		    strcmp(sub->channel->name, request->channel) != 0)
+			continue;
+		od_notify_relay_unsubscribe(sub);
+	}
+
+	if (od_list_empty(&client->subs)) {
+		od_list_unlink(&client->link);
+		free(client);
+	}
+}
+
+static inline void
+od_notify_request_free(od_notify_request_t *request)
+{
+	free(request->storage);
+	free(request->database);
+	free(request->startup_user);
+	free(request->startup_database);
+	free(request);
+}
+
+static inline void
+od_notify_relay_main(void *arg)
+{
+	od_notify_relay_t *relay = arg;
+	for (;;) {
+		machine_msg_t *msg;
+		msg = machine_channel_read(relay->channel, UINT32_MAX);
+		if (msg == NULL)
+			continue;
+		assert(machine_msg_type(msg) == OD_MSG_NOTIFY);
+		od_notify_request_t *request;
+		request = *(od_notify_request_t **)machine_msg_data(msg);
+		machine_msg_free(msg);
+		switch (request->op) {
+			case OD_NOTIFY_LISTEN:
+				od_notify_relay_listen(relay, request);
+				break;
+			case OD_NOTIFY_UNLISTEN:
+			case OD_NOTIFY_UNLISTEN_ALL:
+				od_notify_relay_unlisten(relay, request);
+				break;
+		}
+		od_notify_request_free(request);
+	}
+}
+
+int
+od_notify_relay_start(od_notify_relay_t *relay, od_global_t *global)
+{
+	od_instance_t *instance = global->instance;
+	relay->global           = global;
+	relay->channel          = machine_channel_create(1);
+	if (relay->channel == NULL) {
+		od_error(&instance->logger,
+		         "notify",
+		         NULL,
+		         NULL,
+		         "failed to create notify channel");
+		return -1;
+	}
+	relay->machine = machine_create("notify", od_notify_relay_main, relay);
+	if (relay->machine == -1) {
+		machine_channel_free(relay->channel);
+		relay->channel = NULL;
+		od_error(&instance->logger,
+		         "notify",
+		         NULL,
+		         NULL,
+		         "failed to start notify relay");
+		return -1;
+	}
+	return 0;
+}
+
+int
+od_notify_relay_request(od_notify_relay_t *relay,
+                        od_client_t *client,
+                        od_notify_op_t op,
+                        char *channel)
+{
+	if (relay->channel == NULL)
+		return -1;
+
+	od_route_t *route            = client->route;
+	od_notify_request_t *request = calloc(1, sizeof(od_notify_request_t));
+	if (request == NULL)
+		return -1;
+	request->op        = op;
+	request->client_id = client->id;
+	if (op == OD_NOTIFY_LISTEN) {
+		kiwi_be_startup_t *startup = &client->cold->startup;
+		request->storage           = strdup(route->rule->storage->name);
+		request->database          = strdup(route->id.database);
+		request->startup_user      = strdup(startup->user.value);
+		request->startup_database  = strdup(startup->database.value);
+		if (request->storage == NULL || request->database == NULL ||
+		    request->startup_user == NULL ||
+		    request->startup_database == NULL) {
+			od_notify_request_free(request);
+			return -1;
+		}
+	}
+	if (channel)
+		strcpy(request->channel, channel);
+
+	machine_msg_t *msg;
+	msg = machine_msg_create(sizeof(od_notify_request_t *));
+	if (msg == NULL) {
+		od_notify_request_free(request);
+		return -1;
+	}
+	machine_msg_set_type(msg, OD_MSG_NOTIFY);
+	memcpy(machine_msg_data(msg), &request, sizeof(od_notify_request_t *));
+	machine_channel_write(relay->channel, msg);
+	return 0;
+}
+
+int
+od_notify_relay_foreach(od_notify_relay_t *relay,
+                        od_notify_listener_cb_t callback,
+                        void **argv)
+{
+	pthread_mutex_lock(&relay->lock);
+	od_list_t *i;
+	od_list_foreach(&relay->listeners, i)
+	{
+		od_notify_listener_t *listener;
+		listener = od_container_of(i, od_notify_listener_t, link);
+		int rc;
+		rc = callback(listener, argv);
+		if (rc == -1) {
+			pthread_mutex_unlock(&relay->lock);
+			return -1;
+		}
+	}
+	pthread_mutex_unlock(&relay->lock);
+	return 0;
+}
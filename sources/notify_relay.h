@@ -0,0 +1,120 @@
+#ifndef ODYSSEY_NOTIFY_RELAY_H
+#define ODYSSEY_NOTIFY_RELAY_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * LISTEN/NOTIFY relay.
+ *
+ * LISTEN and UNLISTEN sent by clients of notify_relay routes are not
+ * forwarded to servers. Instead, the notify machine keeps one listener
+ * server connection per storage and database, which listens for the
+ * union of subscribed channels. Received notifications are queued to
+ * subscribed clients and written by them between transactions.
+ */
+
+#define OD_NOTIFY_CHANNEL_MAX 64
+#define OD_NOTIFY_CLIENTS 256
+
+typedef struct od_notify_sub od_notify_sub_t;
+typedef struct od_notify_channel od_notify_channel_t;
+typedef struct od_notify_client od_notify_client_t;
+typedef struct od_notify_listener od_notify_listener_t;
+typedef struct od_notify_request od_notify_request_t;
+typedef struct od_notify_relay od_notify_relay_t;
+
+typedef enum
+{
+	OD_NOTIFY_LISTEN,
+	OD_NOTIFY_UNLISTEN,
+	OD_NOTIFY_UNLISTEN_ALL
+} od_notify_op_t;
+
+struct od_notify_sub
+{
+	od_notify_client_t *client;
+	od_notify_channel_t *channel;
+	od_list_t link_channel;
+	od_list_t link_client;
+};
+
+struct od_notify_channel
+{
+	char name[OD_NOTIFY_CHANNEL_MAX];
+	int listened;
+	int subscribers;
+	od_list_t subs;
+	od_list_t link;
+};
+
+struct od_notify_client
+{
+	od_id_t id;
+	od_notify_listener_t *listener;
+	od_list_t subs;
+	od_list_t link;
+};
+
+struct od_notify_listener
+{
+	char *storage;
+	char *database;
+	char *startup_user;
+	char *startup_database;
+	int connected;
+	int dirty;
+	machine_cond_t *cond;
+	od_notify_relay_t *relay;
+	od_list_t channels;
+	od_atomic_u32_t count_channel;
+	od_atomic_u32_t count_subscription;
+	od_atomic_u64_t count_notify;
+	od_atomic_u64_t count_delivered;
+	od_atomic_u64_t count_dropped;
+	od_list_t link;
+};
+
+struct od_notify_request
+{
+	od_notify_op_t op;
+	od_id_t client_id;
+	char *storage;
+	char *database;
+	char *startup_user;
+	char *startup_database;
+	char channel[OD_NOTIFY_CHANNEL_MAX];
+};
+
+struct od_notify_relay
+{
+	int64_t machine;
+	machine_channel_t *channel;
+	od_global_t *global;
+	pthread_mutex_t lock;
+	od_list_t listeners;
+	od_list_t clients[OD_NOTIFY_CLIENTS];
+};
+
+void
+od_notify_relay_init(od_notify_relay_t *);
+int
+od_notify_relay_start(od_notify_relay_t *, od_global_t *);
+
+int
+od_notify_parse(char *, int, od_notify_op_t *, char *);
+int
+od_notify_relay_request(od_notify_relay_t *,
+                        od_client_t *,
+                        od_notify_op_t,
+                        char *);
+
+typedef int (*od_notify_listener_cb_t)(od_notify_listener_t *, void **);
+
+int
+od_notify_relay_foreach(od_notify_relay_t *, od_notify_listener_cb_t, void **);
+
+#endif /* ODYSSEY_NOTIFY_RELAY_H */
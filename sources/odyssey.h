@@ -9,6 +9,7 @@
 
 #include "sources/macro.h"
 #include "sources/build.h"
+#include "sources/usdt.h"
 #include "sources/atomic.h"
 #include "sources/util.h"
 
@@ -25,6 +26,7 @@
 #include "sources/parser.h"
 
 #include "sources/config.h"
+#include "sources/shard.h"
 #include "sources/rules.h"
 #include "sources/od_dlsym.h"
 #include "sources/config_common.h"
@@ -36,8 +38,20 @@
 #include "sources/msg.h"
 #include "sources/global.h"
 #include "sources/stat.h"
+#include "sources/stats_history.h"
+#include "sources/shm_stats.h"
+#include "sources/sketch.h"
+#include "sources/limit.h"
+#include "sources/wait_queue.h"
+#include "sources/tracer.h"
+#include "sources/slab.h"
+#include "sources/registry.h"
+#include "sources/notify_queue.h"
 #include "sources/status.h"
+#include "sources/counter.h"
+#include "sources/memory_limit.h"
 #include "sources/readahead.h"
+#include "sources/spool.h"
 #include "sources/io.h"
 #include "sources/relay.h"
 #include "sources/dns.h"
@@ -48,10 +62,10 @@
 #include "sources/client.h"
 #include "sources/client_pool.h"
 
-#include "sources/counter.h"
 #include "sources/err_logger.h"
 
 #include "sources/route_id.h"
+#include "sources/handshake.h"
 #include "sources/route.h"
 #include "sources/route_pool.h"
 #include "sources/router_cancel.h"
@@ -68,6 +82,8 @@
 #include "sources/auth_query.h"
 #include "sources/auth.h"
 #include "sources/cancel.h"
+#include "sources/cancel_dispatcher.h"
+#include "sources/notify_relay.h"
 #include "sources/console.h"
 #include "sources/reset.h"
 #include "sources/pam.h"
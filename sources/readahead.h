@@ -11,7 +11,8 @@ typedef struct od_readahead od_readahead_t;
 
 struct od_readahead
 {
-	machine_msg_t *buf;
+	char *buf;
+	int hugepage;
 	int size;
 	int pos;
 	int pos_read;
@@ -21,6 +22,7 @@ static inline void
 od_readahead_init(od_readahead_t *readahead)
 {
 	readahead->buf      = NULL;
+	readahead->hugepage = 0;
 	readahead->size     = 0;
 	readahead->pos      = 0;
 	readahead->pos_read = 0;
@@ -29,17 +31,29 @@ od_readahead_init(od_readahead_t *readahead)
 static inline void
 od_readahead_free(od_readahead_t *readahead)
 {
-	if (readahead->buf)
-		machine_msg_free(readahead->buf);
+	if (readahead->buf == NULL)
+		return;
+	machine_memory_buf_add(-(int64_t)readahead->size);
+	if (readahead->hugepage)
+		machine_hugepage_free(readahead->buf, readahead->size);
+	else
+		free(readahead->buf);
 }
 
 static inline int
 od_readahead_prepare(od_readahead_t *readahead, int size)
 {
 	readahead->size = size;
-	readahead->buf  = machine_msg_create(size);
+	readahead->buf  = machine_hugepage_alloc(size);
+	if (readahead->buf) {
+		readahead->hugepage = 1;
+		goto done;
+	}
+	readahead->buf = malloc(size);
 	if (readahead->buf == NULL)
 		return -1;
+done:
+	machine_memory_buf_add(size);
 	return 0;
 }
 
@@ -59,13 +73,13 @@ od_readahead_unread(od_readahead_t *readahead)
 static inline char *
 od_readahead_pos(od_readahead_t *readahead)
 {
-	return (char *)machine_msg_data(readahead->buf) + readahead->pos;
+	return readahead->buf + readahead->pos;
 }
 
 static inline char *
 od_readahead_pos_read(od_readahead_t *readahead)
 {
-	return (char *)machine_msg_data(readahead->buf) + readahead->pos_read;
+	return readahead->buf + readahead->pos_read;
 }
 
 static inline void
@@ -92,7 +106,19 @@ od_readahead_reuse(od_readahead_t *readahead)
 		return;
 	}
 	/* save next packet header */
-	char *data = machine_msg_data(readahead->buf);
+	char *data = readahead->buf;
+	memmove(data, data + readahead->pos_read, unread);
+	readahead->pos      = unread;
+	readahead->pos_read = 0;
+}
+
+static inline void
+od_readahead_compact(od_readahead_t *readahead)
+{
+	if (readahead->pos_read == 0)
+		return;
+	int unread = od_readahead_unread(readahead);
+	char *data = readahead->buf;
 	memmove(data, data + readahead->pos_read, unread);
 	readahead->pos      = unread;
 	readahead->pos_read = 0;
@@ -0,0 +1,97 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+od_registry_t od_registry_clients;
+od_registry_t od_registry_servers;
+
+static inline od_registry_bucket_t *
+od_registry_bucket_of(od_registry_t *registry, od_id_t *id)
+{
+	/* fnv-1a over id string */
+	uint32_t hash = 2166136261u;
+	unsigned int i;
+	for (i = 0; i < sizeof(id->id); i++) {
+		hash ^= (unsigned char)id->id[i];
+		hash *= 16777619u;
+	}
+	return &registry->buckets[hash % OD_REGISTRY_BUCKETS];
+}
+
+void
+od_registry_init(od_registry_t *registry)
+{
+	registry->count = 0;
+	int i;
+	for (i = 0; i < OD_REGISTRY_BUCKETS; i++) {
+		mm_sleeplock_init(&registry->buckets[i].lock);
+		od_list_init(&registry->buckets[i].list);
+	}
+}
+
+void
+od_registry_add(od_registry_t *registry, od_registry_node_t *node)
+{
+	assert(!od_registry_node_is_registered(node));
+	od_registry_bucket_t *bucket;
+	bucket = od_registry_bucket_of(registry, node->id);
+	mm_sleeplock_lock(&bucket->lock);
+	od_list_append(&bucket->list, &node->link);
+	mm_sleeplock_unlock(&bucket->lock);
+	od_atomic_u64_inc(&registry->count);
+}
+
+void
+od_registry_remove(od_registry_t *registry, od_registry_node_t *node)
+{
+	/* node is added and removed only by its owner */
+	if (!od_registry_node_is_registered(node))
+		return;
+	od_registry_bucket_t *bucket;
+	bucket = od_registry_bucket_of(registry, node->id);
+	mm_sleeplock_lock(&bucket->lock);
+	od_list_unlink(&node->link);
+	od_list_init(&node->link);
+	mm_sleeplock_unlock(&bucket->lock);
+	od_atomic_u64_dec(&registry->count);
+}
+
+int
+od_registry_find(od_registry_t *registry,
+                 od_id_t *id,
+                 od_registry_cb_t callback,
+                 void **argv)
+{
+	od_registry_bucket_t *bucket;
+	bucket = od_registry_bucket_of(registry, id);
+	mm_sleeplock_lock(&bucket->lock);
+	od_list_t *i;
+	od_list_foreach(&bucket->list, i)
+	{
+		od_registry_node_t *node;
+		node = od_container_of(i, od_registry_node_t, link);
+		if (!od_id_cmp(node->id, id))
+			continue;
+		int rc = 0;
+		if (callback)
+			rc = callback(node, argv);
+		mm_sleeplock_unlock(&bucket->lock);
+		if (rc == -1)
+			return -1;
+		return 1;
+	}
+	mm_sleeplock_unlock(&bucket->lock);
+	return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef ODYSSEY_REGISTRY_H
+#define ODYSSEY_REGISTRY_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Global id to object registry.
+ *
+ * Clients and servers are registered by their id while they are alive,
+ * so console commands can find them without walking routes and taking
+ * route locks. Each bucket has its own lock, lookup callback is called
+ * under it and the object can not be freed until the callback returns.
+ */
+
+#include "sleep_lock.h"
+
+#define OD_REGISTRY_BUCKETS 1024
+
+typedef struct od_registry_node od_registry_node_t;
+typedef struct od_registry_bucket od_registry_bucket_t;
+typedef struct od_registry od_registry_t;
+
+struct od_registry_node
+{
+	od_id_t *id;
+	od_id_t link_id;
+	od_list_t link;
+};
+
+struct od_registry_bucket
+{
+	mm_sleeplock_t lock;
+	od_list_t list;
+};
+
+struct od_registry
+{
+	od_atomic_u64_t count;
+	od_registry_bucket_t buckets[OD_REGISTRY_BUCKETS];
+};
+
+extern od_registry_t od_registry_clients;
+extern od_registry_t od_registry_servers;
+
+typedef int (*od_registry_cb_t)(od_registry_node_t *, void **);
+
+static inline void
+od_registry_node_init(od_registry_node_t *node, od_id_t *id)
+{
+	node->id = id;
+	memset(&node->link_id, 0, sizeof(node->link_id));
+	od_list_init(&node->link);
+}
+
+static inline int
+od_registry_node_is_registered(od_registry_node_t *node)
+{
+	return !od_list_empty(&node->link);
+}
+
+/* peer id snapshot, set on attach and cleared on detach */
+static inline void
+od_registry_node_set_link(od_registry_node_t *node, od_id_t *id)
+{
+	if (id == NULL) {
+		memset(&node->link_id, 0, sizeof(node->link_id));
+		return;
+	}
+	node->link_id = *id;
+}
+
+void
+od_registry_init(od_registry_t *);
+void
+od_registry_add(od_registry_t *, od_registry_node_t *);
+void
+od_registry_remove(od_registry_t *, od_registry_node_t *);
+int
+od_registry_find(od_registry_t *, od_id_t *, od_registry_cb_t, void **);
+
+#endif /* ODYSSEY_REGISTRY_H */
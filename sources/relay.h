@@ -7,6 +7,8 @@
  * Scalable PostgreSQL connection pooler.
  */
 
+#include "usdt.h"
+
 typedef struct od_relay od_relay_t;
 
 typedef od_frontend_status_t (*od_relay_on_packet_t)(od_relay_t *,
@@ -20,6 +22,7 @@ struct od_relay
 	int packet_skip;
 	machine_msg_t *packet_full;
 	int packet_full_pos;
+	int packet_held;
 	machine_iov_t *iov;
 	machine_cond_t *base;
 	od_io_t *src;
@@ -30,18 +33,21 @@ struct od_relay
 	void *on_packet_arg;
 	od_relay_on_read_t on_read;
 	void *on_read_arg;
+	od_spool_t *spool;
+	od_id_t *id;
 };
 
 static inline od_frontend_status_t
 od_relay_read(od_relay_t *relay);
 
 static inline void
-od_relay_init(od_relay_t *relay, od_io_t *io)
+od_relay_init(od_relay_t *relay, od_io_t *io, od_id_t *id)
 {
 	relay->packet          = 0;
 	relay->packet_skip     = 0;
 	relay->packet_full     = NULL;
 	relay->packet_full_pos = 0;
+	relay->packet_held     = 0;
 	relay->iov             = NULL;
 	relay->base            = NULL;
 	relay->src             = io;
@@ -52,6 +58,8 @@ od_relay_init(od_relay_t *relay, od_io_t *io)
 	relay->on_packet_arg   = NULL;
 	relay->on_read         = NULL;
 	relay->on_read_arg     = NULL;
+	relay->spool           = NULL;
+	relay->id              = id;
 }
 
 static inline void
@@ -139,9 +147,38 @@ od_relay_stop(od_relay_t *relay)
 {
 	od_relay_detach(relay);
 	od_io_read_stop(relay->src);
+	relay->spool = NULL;
 	return 0;
 }
 
+static inline int
+od_relay_spooled(od_relay_t *relay)
+{
+	return relay->spool && od_spool_pending(relay->spool) > 0;
+}
+
+static inline int
+od_relay_pending(od_relay_t *relay)
+{
+	return machine_iov_pending(relay->iov) || od_relay_spooled(relay);
+}
+
+/* move output the destination has not accepted yet to the spool, so
+ * that reading goes on; left in iov if the spool is full */
+static inline void
+od_relay_spool(od_relay_t *relay)
+{
+	if (relay->spool == NULL || !machine_iov_pending(relay->iov))
+		return;
+	if (!od_spool_fits(relay->spool, machine_iov_size(relay->iov)))
+		return;
+	int rc;
+	rc = od_spool_append_iov(relay->spool, relay->iov);
+	if (rc == -1)
+		return;
+	relay->packet_held = 0;
+}
+
 static inline int
 od_relay_full_packet_required(char *data)
 {
@@ -167,6 +204,7 @@ od_relay_on_packet_msg(od_relay_t *relay, machine_msg_t *msg)
 			rc = machine_iov_add(relay->iov, msg);
 			if (rc == -1)
 				return OD_EOOM;
+			relay->packet_held += machine_msg_size(msg);
 			break;
 		case OD_SKIP:
 			status = OD_OK;
@@ -234,6 +272,13 @@ od_relay_process(od_relay_t *relay, int *progress, char *data, int size)
 		if (!rc)
 			return od_relay_on_packet(relay, data, size);
 
+		/* do not trust packet header beyond the memory limit */
+		if (total > relay->src->readahead.size) {
+			rc = od_memory_reserve(total);
+			if (rc == -1)
+				return OD_EOOM;
+		}
+
 		relay->packet_full = machine_msg_create(total);
 		if (relay->packet_full == NULL)
 			return OD_EOOM;
@@ -317,6 +362,8 @@ od_relay_read(od_relay_t *relay)
 
 	od_readahead_pos_advance(&relay->src->readahead, rc);
 
+	od_probe3(relay__read, relay->id->id_prefix, relay->id->id, rc);
+
 	/* update recv stats */
 	relay->on_read(relay, rc);
 
@@ -328,10 +375,20 @@ od_relay_write(od_relay_t *relay)
 {
 	assert(relay->dst);
 
+	/* spooled output goes first */
+	int rc;
+	if (od_relay_spooled(relay)) {
+		rc = od_spool_write(relay->spool, relay->dst->io);
+		if (rc == -1)
+			return relay->error_write;
+		od_probe3(relay__write, relay->id->id_prefix, relay->id->id, rc);
+		if (od_relay_spooled(relay))
+			return OD_OK;
+	}
+
 	if (!machine_iov_pending(relay->iov))
 		return OD_OK;
 
-	int rc;
 	rc = machine_writev_raw(relay->dst->io, relay->iov);
 	if (rc < 0) {
 		/* retry or error */
@@ -341,9 +398,25 @@ od_relay_write(od_relay_t *relay)
 		return relay->error_write;
 	}
 
+	od_probe3(relay__write, relay->id->id_prefix, relay->id->id, rc);
+
 	return OD_OK;
 }
 
+static inline int
+od_relay_paused(od_relay_t *relay)
+{
+	/* under memory pressure, relays holding more copied packets than
+	 * their readahead size wait for queued output to be written */
+	if (relay->packet_held <= relay->src->readahead.size)
+		return 0;
+	if (!od_memory_pressure())
+		return 0;
+	if (!machine_iov_pending(relay->iov))
+		return 0;
+	return 1;
+}
+
 static inline od_frontend_status_t
 od_relay_step(od_relay_t *relay)
 {
@@ -356,19 +429,34 @@ od_relay_step(od_relay_t *relay)
 			return OD_ATTACH;
 		}
 
-		rc = od_relay_read(relay);
-		if (rc != OD_OK)
-			return rc;
-
-		rc = od_relay_pipeline(relay);
-		if (rc != OD_OK)
-			return rc;
-
-		if (machine_iov_pending(relay->iov)) {
-			/* try to optimize write path and handle it right-away */
+		if (od_relay_paused(relay)) {
+			/* reading is restarted once iov is written */
+			od_memory_inc(OD_MEMORY_READ_PAUSED);
+			rc = od_io_read_stop(relay->src);
+			if (rc == -1)
+				return relay->error_read;
 			machine_cond_signal(relay->dst->on_write);
 		} else {
-			od_readahead_reuse(&relay->src->readahead);
+			rc = od_relay_read(relay);
+			if (rc != OD_OK)
+				return rc;
+
+			rc = od_relay_pipeline(relay);
+			if (rc != OD_OK)
+				return rc;
+
+			/* keep output order while spooled data is pending */
+			if (od_relay_spooled(relay))
+				od_relay_spool(relay);
+
+			if (od_relay_pending(relay)) {
+				/* try to optimize write path and handle it right-away */
+				machine_cond_signal(relay->dst->on_write);
+			}
+			if (!machine_iov_pending(relay->iov)) {
+				relay->packet_held = 0;
+				od_readahead_reuse(&relay->src->readahead);
+			}
 		}
 	}
 
@@ -381,8 +469,16 @@ od_relay_step(od_relay_t *relay)
 		if (rc != OD_OK)
 			return rc;
 
+		/* destination is slow, do not hold the source on it */
+		od_relay_spool(relay);
+
 		if (!machine_iov_pending(relay->iov)) {
-			rc = od_io_write_stop(relay->dst);
+			relay->packet_held = 0;
+
+			if (od_relay_spooled(relay))
+				rc = od_io_write_start(relay->dst);
+			else
+				rc = od_io_write_stop(relay->dst);
 			if (rc == -1)
 				return relay->error_write;
 
@@ -407,7 +503,7 @@ od_relay_flush(od_relay_t *relay)
 	if (relay->dst == NULL)
 		return OD_OK;
 
-	if (!machine_iov_pending(relay->iov))
+	if (!od_relay_pending(relay))
 		return OD_OK;
 
 	int rc;
@@ -415,7 +511,7 @@ od_relay_flush(od_relay_t *relay)
 	if (rc != OD_OK)
 		return rc;
 
-	if (!machine_iov_pending(relay->iov))
+	if (!od_relay_pending(relay))
 		return OD_OK;
 
 	rc = od_io_write_start(relay->dst);
@@ -423,7 +519,7 @@ od_relay_flush(od_relay_t *relay)
 		return relay->error_write;
 
 	for (;;) {
-		if (!machine_iov_pending(relay->iov))
+		if (!od_relay_pending(relay))
 			break;
 
 		machine_cond_wait(relay->dst->on_write, UINT32_MAX);
@@ -435,6 +531,8 @@ od_relay_flush(od_relay_t *relay)
 		}
 	}
 
+	relay->packet_held = 0;
+
 	rc = od_io_write_stop(relay->dst);
 	if (rc == -1)
 		return relay->error_write;
@@ -442,4 +540,25 @@ od_relay_flush(od_relay_t *relay)
 	return OD_OK;
 }
 
+/* write what the destination accepts right away and spool the rest,
+ * waits for the destination only if the spool is full */
+static inline od_frontend_status_t
+od_relay_flush_spool(od_relay_t *relay)
+{
+	if (relay->dst == NULL || relay->spool == NULL)
+		return od_relay_flush(relay);
+
+	int rc;
+	rc = od_relay_write(relay);
+	if (rc != OD_OK)
+		return rc;
+
+	od_relay_spool(relay);
+	if (machine_iov_pending(relay->iov))
+		return od_relay_flush(relay);
+
+	relay->packet_held = 0;
+	return OD_OK;
+}
+
 #endif /* ODYSSEY_RELAY_H */
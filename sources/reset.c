@@ -24,6 +24,8 @@ od_reset(od_server_t *server)
 	od_instance_t *instance = server->global->instance;
 	od_route_t *route       = server->route;
 
+	od_probe3(reset__start, server->id.id, route->id.database, route->id.user);
+
 	/* server left in copy mode */
 	if (server->is_copy) {
 		od_log(&instance->logger,
@@ -34,6 +36,27 @@ od_reset(od_server_t *server)
 		goto drop;
 	}
 
+	/* query was not stopped by cancel or transaction timed out */
+	if (server->timeout == OD_SERVER_TIMEOUT_CLOSE) {
+		od_log(&instance->logger,
+		       "reset",
+		       server->client,
+		       server,
+		       "timed out, closing");
+		goto drop;
+	}
+
+	/* storage was retargeted after server connected */
+	if (route->wait_queue &&
+	    server->storage_epoch != od_wait_queue_epoch(route->wait_queue)) {
+		od_log(&instance->logger,
+		       "reset",
+		       server->client,
+		       server,
+		       "storage retargeted, closing");
+		goto drop;
+	}
+
 	/* support route rollback off */
 	if (!route->rule->pool_rollback) {
 		if (server->is_transaction) {
@@ -116,8 +139,10 @@ od_reset(od_server_t *server)
 			       "not responded, cancel (#%d)",
 			       wait_try_cancel);
 			wait_try_cancel++;
-			rc = od_cancel(
-			  server->global, route->rule->storage, &server->key, &server->id);
+			rc = od_cancel_dispatch(server->global->cancel_dispatcher,
+			                        route->storage,
+			                        &server->key,
+			                        &server->id);
 			if (rc == -1)
 				goto error;
 			continue;
@@ -157,9 +182,12 @@ od_reset(od_server_t *server)
 	}
 
 	/* ready */
+	od_probe2(reset__end, server->id.id, 1);
 	return 1;
 drop:
+	od_probe2(reset__end, server->id.id, 0);
 	return 0;
 error:
+	od_probe2(reset__end, server->id.id, -1);
 	return -1;
 }
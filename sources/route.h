@@ -14,16 +14,28 @@ typedef struct od_route od_route_t;
 struct od_route
 {
 	od_rule_t *rule;
+	od_rule_storage_t *storage;
 	od_route_id_t id;
 
 	od_stat_t stats;
 	od_stat_t stats_prev;
 	bool stats_mark_db;
+	od_stats_history_t *history;
+
+	od_sketch_t *top_addr;
+	od_sketch_t *top_appname;
+
+	od_limit_t limit;
 
 	od_server_pool_t server_pool;
 	od_client_pool_t client_pool;
 	kiwi_params_lock_t params;
-	machine_channel_t *wait_bus;
+	od_handshake_t handshake;
+	od_wait_queue_t *wait_queue;
+	od_atomic_u64_t count_shed;
+	od_atomic_u64_t count_query_timeout;
+	od_atomic_u64_t count_transaction_timeout;
+	od_atomic_u64_t count_check_failed;
 	pthread_mutex_t lock;
 
 	od_error_logger_t *frontend_err_logger;
@@ -35,13 +47,17 @@ struct od_route
 static inline void
 od_route_init(od_route_t *route, bool extra_route_logging)
 {
-	route->rule = NULL;
+	route->rule    = NULL;
+	route->storage = NULL;
 	od_route_id_init(&route->id);
 	od_server_pool_init(&route->server_pool);
 	od_client_pool_init(&route->client_pool);
 
 	/* stat init */
 	route->stats_mark_db         = false;
+	route->top_addr              = NULL;
+	route->top_appname           = NULL;
+	od_limit_init(&route->limit, 0, 0, 0, 0);
 	route->extra_logging_enabled = extra_route_logging;
 	if (extra_route_logging) {
 		/* error logging */;
@@ -53,8 +69,14 @@ od_route_init(od_route_t *route, bool extra_route_logging)
 	od_stat_init(&route->stats);
 	od_stat_init(&route->stats_prev);
 	kiwi_params_lock_init(&route->params);
+	od_handshake_init(&route->handshake);
 	od_list_init(&route->link);
-	route->wait_bus = NULL;
+	route->wait_queue                = NULL;
+	route->count_shed                = 0;
+	route->count_query_timeout       = 0;
+	route->count_transaction_timeout = 0;
+	route->count_check_failed        = 0;
+	route->history                   = NULL;
 	pthread_mutex_init(&route->lock, NULL);
 }
 
@@ -64,8 +86,7 @@ od_route_free(od_route_t *route)
 	od_route_id_free(&route->id);
 	od_server_pool_free(&route->server_pool);
 	kiwi_params_lock_free(&route->params);
-	if (route->wait_bus)
-		machine_channel_free(route->wait_bus);
+	od_handshake_free(&route->handshake);
 	if (route->stats.enable_quantiles) {
 		for (size_t i = 0; i < QUANTILES_WINDOW; ++i) {
 			td_free(route->stats.transaction_hgram[i]);
@@ -73,26 +94,30 @@ od_route_free(od_route_t *route)
 		}
 	}
 
+	if (route->history)
+		od_stats_history_free(route->history);
+
+	if (route->top_addr)
+		od_sketch_free(route->top_addr);
+	if (route->top_appname)
+		od_sketch_free(route->top_appname);
+
 	if (route->extra_logging_enabled) {
 		od_err_logger_free(route->frontend_err_logger);
 	}
 
+	od_limit_free(&route->limit);
 	pthread_mutex_destroy(&route->lock);
 	free(route);
 }
 
 static inline od_route_t *
-od_route_allocate(int is_shared)
+od_route_allocate(void)
 {
 	od_route_t *route = malloc(sizeof(*route));
 	if (route == NULL)
 		return NULL;
 	od_route_init(route, false);
-	route->wait_bus = machine_channel_create(is_shared);
-	if (route->wait_bus == NULL) {
-		od_route_free(route);
-		return NULL;
-	}
 	return route;
 }
 
@@ -147,15 +172,6 @@ od_route_match_client(od_route_t *route, od_id_t *id)
 	return NULL;
 }
 
-static inline void
-od_route_kill_client(od_route_t *route, od_id_t *id)
-{
-	od_client_t *client;
-	client = od_route_match_client(route, id);
-	if (client)
-		od_client_kill(client);
-}
-
 static inline int
 od_route_kill_cb(od_client_t *client, void **argv)
 {
@@ -175,27 +191,16 @@ od_route_kill_client_pool(od_route_t *route)
 	  &route->client_pool, OD_CLIENT_QUEUE, od_route_kill_cb, NULL);
 }
 
-static inline int
-od_route_wait(od_route_t *route, uint32_t time_ms)
-{
-	machine_msg_t *msg;
-	msg = machine_channel_read(route->wait_bus, time_ms);
-	if (msg) {
-		machine_msg_free(msg);
-		return 0;
-	}
-	return -1;
-}
-
-static inline int
-od_route_signal(od_route_t *route)
+static inline void
+od_route_top_add(od_route_t *route,
+                 od_client_t *client,
+                 od_sketch_metric_t metric,
+                 uint64_t value)
 {
-	machine_msg_t *msg;
-	msg = machine_msg_create(0);
-	if (msg == NULL)
-		return -1;
-	machine_channel_write(route->wait_bus, msg);
-	return 0;
+	if (route->top_addr == NULL)
+		return;
+	od_sketch_add(route->top_addr, &client->top_addr, metric, value);
+	od_sketch_add(route->top_appname, &client->top_appname, metric, value);
 }
 
 #endif /* ODYSSEY_ROUTE_H */
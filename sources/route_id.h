@@ -17,6 +17,7 @@ struct od_route_id
 	int database_len;
 	bool physical_rep;
 	bool logical_rep;
+	int shard;
 };
 
 static inline void
@@ -28,6 +29,7 @@ od_route_id_init(od_route_id_t *id)
 	id->database_len = 0;
 	id->physical_rep = false;
 	id->logical_rep  = false;
+	id->shard        = OD_SHARD_NONE;
 }
 
 static inline void
@@ -57,6 +59,7 @@ od_route_id_copy(od_route_id_t *dest, od_route_id_t *id)
 	dest->user_len     = id->user_len;
 	dest->physical_rep = id->physical_rep;
 	dest->logical_rep  = id->logical_rep;
+	dest->shard        = id->shard;
 	return 0;
 }
 
@@ -66,7 +69,7 @@ od_route_id_compare(od_route_id_t *a, od_route_id_t *b)
 	if (a->database_len == b->database_len && a->user_len == b->user_len) {
 		if (memcmp(a->database, b->database, a->database_len) == 0 &&
 		    memcmp(a->user, b->user, a->user_len) == 0 &&
-		    a->logical_rep == b->logical_rep)
+		    a->logical_rep == b->logical_rep && a->shard == b->shard)
 			if (a->physical_rep == b->physical_rep)
 				return 1;
 	}
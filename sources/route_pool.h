@@ -59,12 +59,9 @@ od_route_pool_free(od_route_pool_t *pool)
 }
 
 static inline od_route_t *
-od_route_pool_new(od_route_pool_t *pool,
-                  int is_shared,
-                  od_route_id_t *id,
-                  od_rule_t *rule)
+od_route_pool_new(od_route_pool_t *pool, od_route_id_t *id, od_rule_t *rule)
 {
-	od_route_t *route = od_route_allocate(is_shared);
+	od_route_t *route = od_route_allocate();
 	if (route == NULL)
 		return NULL;
 	int rc;
@@ -73,7 +70,10 @@ od_route_pool_new(od_route_pool_t *pool,
 		od_route_free(route);
 		return NULL;
 	}
-	route->rule = rule;
+	route->rule    = rule;
+	route->storage = rule->storage;
+	if (id->shard != OD_SHARD_NONE)
+		route->storage = rule->shard_map->storages[id->shard];
 	if (rule->quantiles_count) {
 		route->stats.enable_quantiles = true;
 		for (size_t i = 0; i < QUANTILES_WINDOW; ++i) {
@@ -81,6 +81,19 @@ od_route_pool_new(od_route_pool_t *pool,
 			route->stats.query_hgram[i]       = td_new(QUANTILES_COMPRESSION);
 		}
 	}
+	if (rule->top_clients) {
+		route->top_addr    = od_sketch_create(rule->top_clients);
+		route->top_appname = od_sketch_create(rule->top_clients);
+		if (route->top_addr == NULL || route->top_appname == NULL) {
+			od_route_free(route);
+			return NULL;
+		}
+	}
+	od_limit_init(&route->limit,
+	              rule->limit_qps,
+	              rule->limit_tps,
+	              rule->limit_bytes_per_sec,
+	              rule->limit_tx_max);
 	od_list_append(&pool->list, &route->link);
 	pool->count++;
 	return route;
@@ -25,6 +25,7 @@ od_router_init(od_router_t *router)
 	pthread_mutex_init(&router->lock, NULL);
 	od_rules_init(&router->rules);
 	od_list_init(&router->servers);
+	od_list_init(&router->wait_queues);
 	od_route_pool_init(&router->route_pool);
 	router->clients         = 0;
 	router->clients_routing = 0;
@@ -37,6 +38,13 @@ void
 od_router_free(od_router_t *router)
 {
 	od_route_pool_free(&router->route_pool);
+	od_list_t *i, *n;
+	od_list_foreach_safe(&router->wait_queues, i, n)
+	{
+		od_wait_queue_t *queue;
+		queue = od_container_of(i, od_wait_queue_t, link);
+		od_wait_queue_free(queue);
+	}
 	od_rules_free(&router->rules);
 	pthread_mutex_destroy(&router->lock);
 	od_err_logger_free(router->router_err_logger);
@@ -91,6 +99,7 @@ od_router_expire_server_cb(od_server_t *server, void **argv)
 
 	/* remove server for server pool */
 	od_server_pool_set(&route->server_pool, server, OD_SERVER_UNDEF);
+	od_registry_remove(&od_registry_servers, &server->registry);
 
 	od_list_append(expire_list, &server->link);
 	(*count)++;
@@ -119,11 +128,12 @@ od_router_expire_server_tick_cb(od_server_t *server, void **argv)
 	 * Do not expire more servers than we are allowed to connect at one time
 	 * This avoids need to re-launch lot of connections together
 	 */
-	if (*count > route->rule->storage->server_max_routing)
+	if (*count > route->storage->server_max_routing)
 		return 0;
 
 	/* remove server for server pool */
 	od_server_pool_set(&route->server_pool, server, OD_SERVER_UNDEF);
+	od_registry_remove(&od_registry_servers, &server->registry);
 
 	/* add to expire list */
 	od_list_append(expire_list, &server->link);
@@ -132,11 +142,30 @@ od_router_expire_server_tick_cb(od_server_t *server, void **argv)
 	return 0;
 }
 
+static inline int
+od_router_expire_server_target_cb(od_server_t *server, void **argv)
+{
+	od_route_t *route = server->route;
+
+	/* servers of paused storage, or connected before retarget */
+	if (!od_wait_queue_paused(route->wait_queue) &&
+	    server->storage_epoch == od_wait_queue_epoch(route->wait_queue))
+		return 0;
+
+	return od_router_expire_server_cb(server, argv);
+}
+
 static inline int
 od_router_expire_cb(od_route_t *route, void **argv)
 {
 	od_route_lock(route);
 
+	if (route->wait_queue)
+		od_server_pool_foreach(&route->server_pool,
+		                       OD_SERVER_IDLE,
+		                       od_router_expire_server_target_cb,
+		                       argv);
+
 	/* expire by config obsoletion */
 	if (route->rule->obsolete && !od_client_pool_total(&route->client_pool)) {
 		od_server_pool_foreach(&route->server_pool,
@@ -221,10 +250,81 @@ od_router_stat(od_router_t *router,
 	od_router_unlock(router);
 }
 
+static inline od_wait_queue_t *
+od_router_wait_queue(od_router_t *router, od_rule_storage_t *storage)
+{
+	/* rules keep own copies of storages, queues are matched by name */
+	od_wait_queue_t *queue;
+	od_list_t *i;
+	od_list_foreach(&router->wait_queues, i)
+	{
+		queue = od_container_of(i, od_wait_queue_t, link);
+		if (strcmp(queue->storage, storage->name) == 0)
+			goto done;
+	}
+	queue = od_wait_queue_allocate(storage->name);
+	if (queue == NULL)
+		return NULL;
+	od_list_append(&router->wait_queues, &queue->link);
+done:
+	od_wait_queue_configure(
+	  queue, storage->server_queue_target, storage->server_queue_interval);
+	return queue;
+}
+
+static inline int
+od_router_shard(od_rule_t *rule, od_client_t *client)
+{
+	if (rule->shard_map == NULL || rule->shard_key == NULL)
+		return OD_SHARD_NONE;
+	kiwi_be_startup_t *startup = &client->cold->startup;
+	if (strcmp(rule->shard_key, "database") == 0)
+		return od_shard_map_lookup(rule->shard_map,
+		                           startup->database.value,
+		                           startup->database.value_len - 1);
+	if (strcmp(rule->shard_key, "user") == 0)
+		return od_shard_map_lookup(rule->shard_map,
+		                           startup->user.value,
+		                           startup->user.value_len - 1);
+
+	machine_msg_t *msg = client->cold->startup_msg;
+	if (msg == NULL)
+		return OD_SHARD_NONE;
+	char *key;
+	int key_len;
+	key = od_shard_startup_param(
+	  machine_msg_data(msg), machine_msg_size(msg), rule->shard_key, &key_len);
+	if (key == NULL)
+		return OD_SHARD_NONE;
+	return od_shard_map_lookup(rule->shard_map, key, key_len);
+}
+
+static inline od_route_t *
+od_router_route_get(od_router_t *router, od_route_id_t *id, od_rule_t *rule)
+{
+	od_route_t *route;
+	route = od_route_pool_match(&router->route_pool, id, rule);
+	if (route)
+		return route;
+	od_rule_storage_t *storage = rule->storage;
+	if (id->shard != OD_SHARD_NONE)
+		storage = rule->shard_map->storages[id->shard];
+	od_wait_queue_t *queue;
+	queue = od_router_wait_queue(router, storage);
+	if (queue == NULL)
+		return NULL;
+	route = od_route_pool_new(&router->route_pool, id, rule);
+	if (route == NULL)
+		return NULL;
+	route->wait_queue = queue;
+	return route;
+}
+
 od_router_status_t
 od_router_route(od_router_t *router, od_config_t *config, od_client_t *client)
 {
-	kiwi_be_startup_t *startup = &client->startup;
+	(void)config;
+	kiwi_be_startup_t *startup = &client->cold->startup;
 
 	/* match route */
 	assert(startup->database.value_len);
@@ -247,7 +347,8 @@ od_router_route(od_router_t *router, od_config_t *config, od_client_t *client)
 		                 .database_len = startup->database.value_len,
 		                 .user_len     = startup->user.value_len,
 		                 .physical_rep = false,
-		                 .logical_rep  = false };
+		                 .logical_rep  = false,
+		                 .shard        = OD_SHARD_NONE };
 	if (rule->storage_db) {
 		id.database     = rule->storage_db;
 		id.database_len = strlen(rule->storage_db) + 1;
@@ -265,17 +366,16 @@ od_router_route(od_router_t *router, od_config_t *config, od_client_t *client)
 		}
 	}
 
+	/* match shard by startup key */
+	id.shard            = od_router_shard(rule, client);
+	client->cold->shard = id.shard;
+
 	/* match or create dynamic route */
 	od_route_t *route;
-	route = od_route_pool_match(&router->route_pool, &id, rule);
+	route = od_router_route_get(router, &id, rule);
 	if (route == NULL) {
-		int is_shared;
-		is_shared = od_config_is_multi_workers(config);
-		route = od_route_pool_new(&router->route_pool, is_shared, &id, rule);
-		if (route == NULL) {
-			od_router_unlock(router);
-			return OD_ROUTER_ERROR;
-		}
+		od_router_unlock(router);
+		return OD_ROUTER_ERROR;
 	}
 	od_rules_ref(rule);
 
@@ -310,27 +410,162 @@ od_router_route(od_router_t *router, od_config_t *config, od_client_t *client)
 void
 od_router_unroute(od_router_t *router, od_client_t *client)
 {
-	(void)router;
 	/* detach client from route */
 	assert(client->route);
 	assert(client->server == NULL);
 
 	od_route_t *route = client->route;
+	od_router_throttle_tx_end(router, client);
+
 	od_route_lock(route);
 	od_client_pool_set(&route->client_pool, client, OD_CLIENT_UNDEF);
 	client->route = NULL;
 	od_route_unlock(route);
 }
 
+static inline od_router_status_t
+od_router_acquire_slot(od_router_t *router, od_client_t *client)
+{
+	(void)router;
+	od_route_t *route          = client->route;
+	od_rule_storage_t *storage = route->storage;
+	if (storage->server_max_active == 0 || client->storage_slot)
+		return OD_ROUTER_OK;
+
+	int rc;
+	rc = od_wait_queue_try_acquire(route->wait_queue,
+	                               storage->server_max_active);
+	if (rc == 0) {
+		client->storage_slot = true;
+		return OD_ROUTER_OK;
+	}
+
+	/* wait for a slot released by any route of the storage */
+	bool restart_read = (bool)od_io_read_active(&client->io);
+	rc                = od_io_read_stop(&client->io);
+	if (rc == -1)
+		return OD_ROUTER_ERROR;
+
+	uint32_t timeout = route->rule->pool_timeout;
+	if (timeout == 0)
+		timeout = UINT32_MAX;
+	od_waiter_t waiter;
+	od_waiter_init(&waiter,
+	               route,
+	               route->rule->pool_priority,
+	               OD_WAITER_SLOT,
+	               &route->count_shed);
+	od_waiter_state_t state;
+	state = od_wait_queue_acquire(
+	  route->wait_queue, &waiter, storage->server_max_active, timeout);
+	od_waiter_free(&waiter);
+	switch (state) {
+		case OD_WAITER_WAKE:
+			break;
+		case OD_WAITER_SHED:
+			return OD_ROUTER_ERROR_SHED;
+		default:
+			return OD_ROUTER_ERROR_TIMEDOUT;
+	}
+	client->storage_slot = true;
+
+	if (restart_read)
+		od_io_read_start(&client->io);
+	return OD_ROUTER_OK;
+}
+
+static inline void
+od_router_release_slot(od_router_t *router, od_client_t *client)
+{
+	(void)router;
+	if (!client->storage_slot)
+		return;
+	od_route_t *route = client->route;
+	od_wait_queue_release(route->wait_queue);
+	client->storage_slot = false;
+}
+
 od_router_status_t
-od_router_attach(od_router_t *router,
-                 od_config_t *config,
-                 od_client_t *client,
-                 bool wait_for_idle)
+od_router_reroute(od_router_t *router, od_client_t *client, int shard)
+{
+	/* move client to the route of another shard */
+	assert(client->route);
+	assert(client->server == NULL);
+
+	od_route_t *route = client->route;
+	od_router_throttle_tx_end(router, client);
+	od_router_release_slot(router, client);
+
+	od_router_lock(router);
+	od_route_id_t id = route->id;
+	id.shard         = shard;
+	od_route_t *next;
+	next = od_router_route_get(router, &id, route->rule);
+	if (next == NULL) {
+		od_router_unlock(router);
+		return OD_ROUTER_ERROR;
+	}
+	od_rules_ref(route->rule);
+
+	od_route_lock(route);
+	od_client_pool_set(&route->client_pool, client, OD_CLIENT_UNDEF);
+	od_route_unlock(route);
+
+	od_route_lock(next);
+	od_client_pool_set(&next->client_pool, client, OD_CLIENT_PENDING);
+	client->route = next;
+	od_route_unlock(next);
+
+	od_router_unlock(router);
+	return OD_ROUTER_OK;
+}
+
+static inline od_router_status_t
+od_router_hold(od_router_t *router, od_client_t *client)
 {
 	(void)router;
 	od_route_t *route = client->route;
-	assert(route != NULL);
+
+	/* new transactions wait for paused storage to be resumed */
+	bool restart_read = (bool)od_io_read_active(&client->io);
+	int rc;
+	rc = od_io_read_stop(&client->io);
+	if (rc == -1)
+		return OD_ROUTER_ERROR;
+
+	uint32_t timeout = route->rule->pool_timeout;
+	if (timeout == 0)
+		timeout = UINT32_MAX;
+	od_waiter_t waiter;
+	od_waiter_init(&waiter,
+	               route,
+	               route->rule->pool_priority,
+	               OD_WAITER_PAUSE,
+	               &route->count_shed);
+	od_waiter_state_t state;
+	state = od_wait_queue_hold(route->wait_queue, &waiter, timeout);
+	od_waiter_free(&waiter);
+	if (state != OD_WAITER_WAKE)
+		return OD_ROUTER_ERROR_TIMEDOUT;
+
+	if (restart_read)
+		od_io_read_start(&client->io);
+	return OD_ROUTER_OK;
+}
+
+static inline od_router_status_t
+od_router_attach_server(od_router_t *router,
+                        od_config_t *config,
+                        od_client_t *client,
+                        bool wait_for_idle)
+{
+	od_route_t *route = client->route;
+
+	/* storage wide limit of attached servers */
+	od_router_status_t status;
+	status = od_router_acquire_slot(router, client);
+	if (status != OD_ROUTER_OK)
+		return status;
 
 	od_route_lock(route);
 
@@ -340,9 +575,27 @@ od_router_attach(od_router_t *router,
 	/* get client server from route server pool */
 	bool restart_read = false;
 	od_server_t *server;
+	od_waiter_t waiter;
+	od_waiter_init(&waiter,
+	               route,
+	               route->rule->pool_priority,
+	               OD_WAITER_SERVER,
+	               &route->count_shed);
 	int busyloop_sleep = 0;
 	int busyloop_retry = 0;
 	for (;;) {
+		if (od_wait_queue_paused(route->wait_queue)) {
+			od_route_unlock(route);
+			od_router_status_t status;
+			status = od_router_hold(router, client);
+			if (status != OD_ROUTER_OK) {
+				od_waiter_free(&waiter);
+				od_router_release_slot(router, client);
+				return status;
+			}
+			od_route_lock(route);
+		}
+
 		server = od_server_pool_next(&route->server_pool, OD_SERVER_IDLE);
 		if (server)
 			goto attach;
@@ -352,6 +605,8 @@ od_router_attach(od_router_t *router,
 			 * and do not want to start a new one */
 			if (route->server_pool.count_active == 0) {
 				od_route_unlock(route);
+				od_waiter_free(&waiter);
+				od_router_release_slot(router, client);
 				return OD_ROUTER_ERROR_TIMEDOUT;
 			}
 		} else {
@@ -361,7 +616,7 @@ od_router_attach(od_router_t *router,
 			    od_server_pool_total(&route->server_pool) <
 			      route->rule->pool_size) {
 				if (od_atomic_u32_of(&router->servers_routing) >=
-				    (uint32_t)route->rule->storage->server_max_routing) {
+				    (uint32_t)route->storage->server_max_routing) {
 					// concurrent server connection in progress.
 					od_route_unlock(route);
 					machine_sleep(busyloop_sleep);
@@ -382,24 +637,44 @@ od_router_attach(od_router_t *router,
 		 * for an available server
 		 */
 		restart_read = restart_read || (bool)od_io_read_active(&client->io);
+
+		/* queue the client before the route is unlocked, so a server
+		 * returned in between is not missed */
+		int rc = od_wait_queue_add(route->wait_queue, &waiter);
 		od_route_unlock(route);
+		if (rc == -1) {
+			od_waiter_free(&waiter);
+			od_router_release_slot(router, client);
+			return OD_ROUTER_ERROR;
+		}
 
-		int rc = od_io_read_stop(&client->io);
-		if (rc == -1)
+		rc = od_io_read_stop(&client->io);
+		if (rc == -1) {
+			od_wait_queue_remove(route->wait_queue, &waiter);
+			od_waiter_free(&waiter);
+			od_router_release_slot(router, client);
 			return OD_ROUTER_ERROR;
+		}
 
 		/*
-		 * Wait wakeup condition for pool_timeout milliseconds.
+		 * Wait for pool_timeout milliseconds.
 		 *
-		 * The condition triggered when a server connection
-		 * put into idle state by DETACH events.
+		 * The waiter is woken up when a server connection of the route
+		 * is put into idle state by DETACH events or closed. Waiters
+		 * may be shed early, if storage queue delay stays too high.
 		 */
 		uint32_t timeout = route->rule->pool_timeout;
 		if (timeout == 0)
 			timeout = UINT32_MAX;
-		rc = od_route_wait(route, timeout);
-		if (rc == -1)
+		od_waiter_state_t state;
+		state = od_wait_queue_wait(route->wait_queue, &waiter, timeout);
+		if (state != OD_WAITER_WAKE) {
+			od_waiter_free(&waiter);
+			od_router_release_slot(router, client);
+			if (state == OD_WAITER_SHED)
+				return OD_ROUTER_ERROR_SHED;
 			return OD_ROUTER_ERROR_TIMEDOUT;
+		}
 
 		od_route_lock(route);
 	}
@@ -408,15 +683,20 @@ od_router_attach(od_router_t *router,
 
 	/* create new server object */
 	server = od_server_allocate();
-	if (server == NULL)
+	if (server == NULL) {
+		od_waiter_free(&waiter);
+		od_router_release_slot(router, client);
 		return OD_ROUTER_ERROR;
+	}
 	od_id_generate(&server->id, "s");
 	server->global = client->global;
 	server->route  = route;
+	od_registry_add(&od_registry_servers, &server->registry);
 
 	od_route_lock(route);
 
 attach:
+	od_waiter_free(&waiter);
 	od_server_pool_set(&route->server_pool, server, OD_SERVER_ACTIVE);
 	od_client_pool_set(&route->client_pool, client, OD_CLIENT_ACTIVE);
 
@@ -424,6 +704,8 @@ attach:
 	server->client     = client;
 	server->idle_time  = 0;
 	server->key_client = client->key;
+	od_registry_node_set_link(&client->registry, &server->id);
+	od_registry_node_set_link(&server->registry, &client->id);
 
 	od_route_unlock(route);
 
@@ -438,10 +720,33 @@ attach:
 	return OD_ROUTER_OK;
 }
 
+od_router_status_t
+od_router_attach(od_router_t *router,
+                 od_config_t *config,
+                 od_client_t *client,
+                 bool wait_for_idle)
+{
+	od_route_t *route = client->route;
+	assert(route != NULL);
+
+	/* in transaction pooling every attach starts a new transaction */
+	od_router_status_t status;
+	if (route->rule->pool == OD_RULE_POOL_TRANSACTION) {
+		status = od_router_throttle_tx(router, client);
+		if (status != OD_ROUTER_OK)
+			return status;
+	}
+
+	/* transaction slot is kept only by attached client */
+	status = od_router_attach_server(router, config, client, wait_for_idle);
+	if (status != OD_ROUTER_OK)
+		od_router_throttle_tx_end(router, client);
+	return status;
+}
+
 void
 od_router_detach(od_router_t *router, od_config_t *config, od_client_t *client)
 {
-	(void)router;
 	od_route_t *route = client->route;
 	assert(route != NULL);
 
@@ -450,31 +755,45 @@ od_router_detach(od_router_t *router, od_config_t *config, od_client_t *client)
 	if (od_config_is_multi_workers(config))
 		od_io_detach(&server->io);
 
+	od_router_throttle_tx_end(router, client);
+	od_probe4(detach,
+	          client->id.id,
+	          server->id.id,
+	          route->id.database,
+	          route->id.user);
+
 	od_route_lock(route);
 
 	client->server = NULL;
 	server->client = NULL;
+	od_registry_node_set_link(&client->registry, NULL);
+	od_registry_node_set_link(&server->registry, NULL);
+	server->idle_since_us = machine_time_us();
 	od_server_pool_set(&route->server_pool, server, OD_SERVER_IDLE);
 	od_client_pool_set(&route->client_pool, client, OD_CLIENT_PENDING);
 
 	int signal = route->client_pool.count_queue > 0;
 	od_route_unlock(route);
 
+	od_router_release_slot(router, client);
+
 	/* notify waiters */
 	if (signal)
-		od_route_signal(route);
+		od_wait_queue_wake(route->wait_queue, route);
 }
 
 void
 od_router_close(od_router_t *router, od_client_t *client)
 {
-	(void)router;
 	od_route_t *route = client->route;
 	assert(route != NULL);
 
 	od_server_t *server = client->server;
+	od_registry_remove(&od_registry_servers, &server->registry);
 	od_backend_close_connection(server);
 
+	od_router_throttle_tx_end(router, client);
+
 	od_route_lock(route);
 
 	od_client_pool_set(&route->client_pool, client, OD_CLIENT_PENDING);
@@ -482,13 +801,108 @@ od_router_close(od_router_t *router, od_client_t *client)
 	client->server = NULL;
 	server->client = NULL;
 	server->route  = NULL;
+	od_registry_node_set_link(&client->registry, NULL);
 
+	int signal = route->client_pool.count_queue > 0;
 	od_route_unlock(route);
 
+	od_router_release_slot(router, client);
+
+	/* closed server leaves room for a new connection */
+	if (signal)
+		od_wait_queue_wake(route->wait_queue, route);
+
 	assert(server->io.io == NULL);
 	od_server_free(server);
 }
 
+static inline uint64_t
+od_router_throttle_timeout(od_rule_t *rule)
+{
+	if (rule->limit_policy == OD_RULE_LIMIT_REJECT)
+		return 0;
+	if (rule->limit_timeout == 0)
+		return UINT64_MAX;
+	return (uint64_t)rule->limit_timeout * 1000;
+}
+
+od_router_status_t
+od_router_throttle(od_router_t *router,
+                   od_client_t *client,
+                   od_limit_type_t type,
+                   uint64_t amount)
+{
+	(void)router;
+	od_route_t *route = client->route;
+	od_limit_t *limit = &route->limit;
+	if (!od_limit_is_set(limit, type))
+		return OD_ROUTER_OK;
+
+	int64_t wait_us;
+	wait_us = od_limit_reserve(limit,
+	                           type,
+	                           amount,
+	                           machine_time_us(),
+	                           od_router_throttle_timeout(route->rule));
+	if (wait_us == -1) {
+		od_atomic_u64_inc(&limit->rejected[type]);
+		return OD_ROUTER_ERROR_THROTTLED;
+	}
+	if (wait_us > 0) {
+		od_atomic_u64_inc(&limit->delayed[type]);
+		machine_sleep((wait_us + 999) / 1000);
+	}
+	return OD_ROUTER_OK;
+}
+
+od_router_status_t
+od_router_throttle_tx(od_router_t *router, od_client_t *client)
+{
+	od_route_t *route = client->route;
+	od_limit_t *limit = &route->limit;
+	if (!limit->enabled || client->limit_tx)
+		return OD_ROUTER_OK;
+
+	od_router_status_t status;
+	status = od_router_throttle(router, client, OD_LIMIT_TRANSACTIONS, 1);
+	if (status != OD_ROUTER_OK)
+		return status;
+
+	if (od_limit_is_set(limit, OD_LIMIT_CONCURRENCY) &&
+	    od_limit_tx_acquire(limit) == -1) {
+		/* wait for a free transaction slot */
+		uint64_t timeout = od_router_throttle_timeout(route->rule);
+		int rc = -1;
+		if (timeout > 0) {
+			od_atomic_u64_inc(&limit->delayed[OD_LIMIT_CONCURRENCY]);
+			uint32_t time_ms = UINT32_MAX;
+			if (timeout / 1000 < UINT32_MAX)
+				time_ms = timeout / 1000;
+			od_limit_waiter_t waiter;
+			rc = od_limit_tx_wait(limit, &waiter, time_ms);
+		}
+		if (rc == -1) {
+			od_atomic_u64_inc(&limit->rejected[OD_LIMIT_CONCURRENCY]);
+			return OD_ROUTER_ERROR_THROTTLED;
+		}
+	}
+
+	client->limit_tx = true;
+	return OD_ROUTER_OK;
+}
+
+void
+od_router_throttle_tx_end(od_router_t *router, od_client_t *client)
+{
+	(void)router;
+	if (!client->limit_tx)
+		return;
+	od_route_t *route = client->route;
+	if (od_limit_is_set(&route->limit, OD_LIMIT_CONCURRENCY))
+		od_limit_tx_release(&route->limit);
+	client->limit_tx = false;
+}
+
 static inline int
 od_router_cancel_cmp(od_server_t *server, void **argv)
 {
@@ -509,7 +923,7 @@ od_router_cancel_cb(od_route_t *route, void **argv)
 		od_router_cancel_t *cancel = argv[1];
 		cancel->id                 = server->id;
 		cancel->key                = server->key;
-		cancel->storage = od_rules_storage_copy(route->rule->storage);
+		cancel->storage = od_rules_storage_copy(route->storage);
 		od_route_unlock(route);
 		if (cancel->storage == NULL)
 			return -1;
@@ -535,17 +949,144 @@ od_router_cancel(od_router_t *router,
 }
 
 static inline int
-od_router_kill_cb(od_route_t *route, void **argv)
+od_router_kill_cb(od_registry_node_t *node, void **argv)
 {
-	od_route_lock(route);
-	od_route_kill_client(route, argv[0]);
-	od_route_unlock(route);
+	(void)argv;
+	od_client_t *client;
+	client = od_container_of(node, od_client_t, registry);
+	od_client_kill(client);
 	return 0;
 }
 
-void
+int
 od_router_kill(od_router_t *router, od_id_t *id)
 {
-	void *argv[] = { id };
-	od_router_foreach(router, od_router_kill_cb, argv);
+	(void)router;
+	return od_registry_find(&od_registry_clients, id, od_router_kill_cb, NULL);
+}
+
+static inline int
+od_router_storage_is(od_rule_storage_t *storage, char *name)
+{
+	return storage->storage_type == OD_RULE_STORAGE_REMOTE &&
+	       strcmp(storage->name, name) == 0;
+}
+
+static inline od_rule_storage_t *
+od_router_storage_match(od_router_t *router, char *name)
+{
+	/* rules keep own copies of storages */
+	od_list_t *i;
+	od_list_foreach(&router->rules.rules, i)
+	{
+		od_rule_t *rule = od_container_of(i, od_rule_t, link);
+		if (rule->obsolete || rule->storage == NULL)
+			continue;
+		if (od_router_storage_is(rule->storage, name))
+			return rule->storage;
+		if (rule->shard_map == NULL)
+			continue;
+		int j;
+		for (j = 0; j < rule->shard_map->count; j++) {
+			if (od_router_storage_is(rule->shard_map->storages[j], name))
+				return rule->shard_map->storages[j];
+		}
+	}
+	return NULL;
+}
+
+od_router_status_t
+od_router_pause(od_router_t *router, char *name)
+{
+	od_router_lock(router);
+	od_rule_storage_t *storage;
+	storage = od_router_storage_match(router, name);
+	if (storage == NULL) {
+		od_router_unlock(router);
+		return OD_ROUTER_ERROR_NOT_FOUND;
+	}
+	od_wait_queue_t *queue;
+	queue = od_router_wait_queue(router, storage);
+	if (queue == NULL) {
+		od_router_unlock(router);
+		return OD_ROUTER_ERROR;
+	}
+	od_wait_queue_pause(queue);
+	od_router_unlock(router);
+	return OD_ROUTER_OK;
+}
+
+od_router_status_t
+od_router_resume(od_router_t *router, char *name)
+{
+	od_router_lock(router);
+	od_rule_storage_t *storage;
+	storage = od_router_storage_match(router, name);
+	if (storage == NULL) {
+		od_router_unlock(router);
+		return OD_ROUTER_ERROR_NOT_FOUND;
+	}
+	od_wait_queue_t *queue;
+	queue = od_router_wait_queue(router, storage);
+	if (queue == NULL) {
+		od_router_unlock(router);
+		return OD_ROUTER_ERROR;
+	}
+	od_wait_queue_resume(queue);
+	od_router_unlock(router);
+	return OD_ROUTER_OK;
+}
+
+static inline int
+od_router_storage_retarget(od_rule_storage_t *storage,
+                           char *name,
+                           char *host,
+                           int port)
+{
+	if (storage == NULL || strcmp(storage->name, name) != 0)
+		return 0;
+	return od_rules_storage_retarget(storage, host, port);
+}
+
+od_router_status_t
+od_router_retarget(od_router_t *router, char *name, char *host, int port)
+{
+	od_router_lock(router);
+	od_rule_storage_t *storage;
+	storage = od_router_storage_match(router, name);
+	if (storage == NULL) {
+		od_router_unlock(router);
+		return OD_ROUTER_ERROR_NOT_FOUND;
+	}
+	od_wait_queue_t *queue;
+	queue = od_router_wait_queue(router, storage);
+	if (queue == NULL || !od_wait_queue_paused(queue)) {
+		od_router_unlock(router);
+		return OD_ROUTER_ERROR;
+	}
+
+	/* obsolete rules too, their routes may still have clients */
+	od_list_t *i;
+	od_list_foreach(&router->rules.rules, i)
+	{
+		od_rule_t *rule = od_container_of(i, od_rule_t, link);
+		int rc;
+		rc = od_router_storage_retarget(rule->storage, name, host, port);
+		if (rc == 0 && rule->shard_map) {
+			int j;
+			for (j = 0; j < rule->shard_map->count && rc == 0; j++)
+				rc = od_router_storage_retarget(
+				  rule->shard_map->storages[j], name, host, port);
+		}
+		if (rc == -1) {
+			od_router_unlock(router);
+			return OD_ROUTER_ERROR;
+		}
+	}
+
+	/* servers connected to the previous host are not reused */
+	od_atomic_u32_inc(&queue->epoch);
+
+	od_router_unlock(router);
+	return OD_ROUTER_OK;
 }
@@ -14,6 +14,7 @@ struct od_router
 	pthread_mutex_t lock;
 	od_rules_t rules;
 	od_list_t servers;
+	od_list_t wait_queues;
 	od_route_pool_t route_pool;
 	od_atomic_u32_t clients;
 	od_atomic_u32_t clients_routing;
@@ -55,6 +56,9 @@ od_router_route(od_router_t *router, od_config_t *config, od_client_t *client);
 void
 od_router_unroute(od_router_t *, od_client_t *);
 
+od_router_status_t
+od_router_reroute(od_router_t *, od_client_t *, int);
+
 od_router_status_t
 od_router_attach(od_router_t *, od_config_t *, od_client_t *, bool);
 
@@ -65,11 +69,29 @@ void
 od_router_close(od_router_t *, od_client_t *);
 
 od_router_status_t
-od_router_cancel(od_router_t *, kiwi_key_t *, od_router_cancel_t *);
+od_router_throttle(od_router_t *, od_client_t *, od_limit_type_t, uint64_t);
+
+od_router_status_t
+od_router_throttle_tx(od_router_t *, od_client_t *);
 
 void
+od_router_throttle_tx_end(od_router_t *, od_client_t *);
+
+od_router_status_t
+od_router_cancel(od_router_t *, kiwi_key_t *, od_router_cancel_t *);
+
+int
 od_router_kill(od_router_t *, od_id_t *);
 
+od_router_status_t
+od_router_pause(od_router_t *, char *);
+
+od_router_status_t
+od_router_resume(od_router_t *, char *);
+
+od_router_status_t
+od_router_retarget(od_router_t *, char *, char *, int);
+
 static inline int
 od_route_pool_stat_err_router(od_router_t *router,
                               od_route_pool_stat_route_error_cb_t callback,
@@ -51,6 +51,8 @@ od_rules_storage_allocate(void)
 	if (storage == NULL)
 		return NULL;
 	memset(storage, 0, sizeof(*storage));
+	storage->server_queue_interval = 100;
+	pthread_mutex_init(&storage->lock, NULL);
 	od_list_init(&storage->link);
 	return storage;
 }
@@ -74,6 +76,7 @@ od_rules_storage_free(od_rule_storage_t *storage)
 		free(storage->tls_cert_file);
 	if (storage->tls_protocols)
 		free(storage->tls_protocols);
+	pthread_mutex_destroy(&storage->lock);
 	od_list_unlink(&storage->link);
 	free(storage);
 }
@@ -110,20 +113,21 @@ od_rules_storage_copy(od_rule_storage_t *storage)
 	copy = od_rules_storage_allocate();
 	if (copy == NULL)
 		return NULL;
-	copy->storage_type       = storage->storage_type;
-	copy->name               = strdup(storage->name);
-	copy->server_max_routing = storage->server_max_routing;
+	copy->storage_type          = storage->storage_type;
+	copy->name                  = strdup(storage->name);
+	copy->server_max_routing    = storage->server_max_routing;
+	copy->server_max_active     = storage->server_max_active;
+	copy->server_queue_target   = storage->server_queue_target;
+	copy->server_queue_interval = storage->server_queue_interval;
 	if (copy->name == NULL)
 		goto error;
 	copy->type = strdup(storage->type);
 	if (copy->type == NULL)
 		goto error;
-	if (storage->host) {
-		copy->host = strdup(storage->host);
-		if (copy->host == NULL)
-			goto error;
-	}
-	copy->port     = storage->port;
+	int rc;
+	rc = od_rules_storage_target(storage, &copy->host, &copy->port);
+	if (rc == -1)
+		goto error;
 	copy->tls_mode = storage->tls_mode;
 	if (storage->tls) {
 		copy->tls = strdup(storage->tls);
@@ -156,6 +160,39 @@ error:
 	return NULL;
 }
 
+int
+od_rules_storage_target(od_rule_storage_t *storage, char **host, int *port)
+{
+	pthread_mutex_lock(&storage->lock);
+	*host = NULL;
+	if (storage->host) {
+		*host = strdup(storage->host);
+		if (*host == NULL) {
+			pthread_mutex_unlock(&storage->lock);
+			return -1;
+		}
+	}
+	*port = storage->port;
+	pthread_mutex_unlock(&storage->lock);
+	return 0;
+}
+
+int
+od_rules_storage_retarget(od_rule_storage_t *storage, char *host, int port)
+{
+	char *copy = strdup(host);
+	if (copy == NULL)
+		return -1;
+	pthread_mutex_lock(&storage->lock);
+	char *prev    = storage->host;
+	storage->host = copy;
+	storage->port = port;
+	pthread_mutex_unlock(&storage->lock);
+	if (prev)
+		free(prev);
+	return 0;
+}
+
 od_rule_auth_t *
 od_rules_auth_add(od_rule_t *rule)
 {
@@ -202,9 +239,15 @@ od_rules_add(od_rules_t *rules)
 	memset(rule, 0, sizeof(*rule));
 	rule->pool_size                = 0;
 	rule->pool_timeout             = 0;
+	rule->pool_priority            = 0;
+	rule->query_timeout            = 0;
+	rule->transaction_timeout      = 0;
+	rule->server_check_delay       = 0;
 	rule->pool_discard             = 1;
 	rule->pool_cancel              = 1;
 	rule->pool_rollback            = 1;
+	rule->pool_spool_memory        = 1048576;
+	rule->pool_spool_max           = 104857600;
 	rule->obsolete                 = 0;
 	rule->mark                     = 0;
 	rule->refs                     = 0;
@@ -247,8 +290,23 @@ od_rules_rule_free(od_rule_t *rule)
 		free(rule->storage_user);
 	if (rule->storage_password)
 		free(rule->storage_password);
+	if (rule->shard_map) {
+		int j;
+		for (j = 0; j < rule->shard_map->count; j++)
+			if (rule->shard_map->storages[j])
+				od_rules_storage_free(rule->shard_map->storages[j]);
+		od_shard_map_free(rule->shard_map);
+	}
+	if (rule->shards)
+		free(rule->shards);
+	if (rule->shard_ranges)
+		free(rule->shard_ranges);
+	if (rule->shard_key)
+		free(rule->shard_key);
 	if (rule->pool_sz)
 		free(rule->pool_sz);
+	if (rule->limit_policy_sz)
+		free(rule->limit_policy_sz);
 	od_list_t *i, *n;
 	od_list_foreach_safe(&rule->auth_common_names, i, n)
 	{
@@ -369,6 +427,18 @@ od_rules_storage_compare(od_rule_storage_t *a, od_rule_storage_t *b)
 	if (a->server_max_routing != b->server_max_routing)
 		return 0;
 
+	/* server_max_active */
+	if (a->server_max_active != b->server_max_active)
+		return 0;
+
+	/* server_queue_target */
+	if (a->server_queue_target != b->server_queue_target)
+		return 0;
+
+	/* server_queue_interval */
+	if (a->server_queue_interval != b->server_queue_interval)
+		return 0;
+
 	/* host */
 	if (a->host && b->host) {
 		if (strcmp(a->host, b->host) != 0)
@@ -420,6 +490,34 @@ od_rules_storage_compare(od_rule_storage_t *a, od_rule_storage_t *b)
 	return 1;
 }
 
+static inline int
+od_rules_sz_compare(char *a, char *b)
+{
+	if (a && b)
+		return strcmp(a, b) == 0;
+	return a == b;
+}
+
+static inline int
+od_rules_shards_compare(od_rule_t *a, od_rule_t *b)
+{
+	if (!od_rules_sz_compare(a->shards, b->shards) ||
+	    !od_rules_sz_compare(a->shard_ranges, b->shard_ranges) ||
+	    !od_rules_sz_compare(a->shard_key, b->shard_key))
+		return 0;
+	if (a->shard_hint != b->shard_hint)
+		return 0;
+	if (a->shard_map == NULL || b->shard_map == NULL)
+		return a->shard_map == b->shard_map;
+	int i;
+	for (i = 0; i < a->shard_map->count; i++) {
+		if (!od_rules_storage_compare(a->shard_map->storages[i],
+		                              b->shard_map->storages[i]))
+			return 0;
+	}
+	return 1;
+}
+
 int
 od_rules_rule_compare(od_rule_t *a, od_rule_t *b)
 {
@@ -503,6 +601,10 @@ od_rules_rule_compare(od_rule_t *a, od_rule_t *b)
 	if (!od_rules_storage_compare(a->storage, b->storage))
 		return 0;
 
+	/* shards */
+	if (!od_rules_shards_compare(a, b))
+		return 0;
+
 	/* storage_db */
 	if (a->storage_db && b->storage_db) {
 		if (strcmp(a->storage_db, b->storage_db) != 0)
@@ -539,10 +641,26 @@ od_rules_rule_compare(od_rule_t *a, od_rule_t *b)
 	if (a->pool_timeout != b->pool_timeout)
 		return 0;
 
+	/* pool_priority */
+	if (a->pool_priority != b->pool_priority)
+		return 0;
+
+	/* query_timeout */
+	if (a->query_timeout != b->query_timeout)
+		return 0;
+
+	/* transaction_timeout */
+	if (a->transaction_timeout != b->transaction_timeout)
+		return 0;
+
 	/* pool_ttl */
 	if (a->pool_ttl != b->pool_ttl)
 		return 0;
 
+	/* server_check_delay */
+	if (a->server_check_delay != b->server_check_delay)
+		return 0;
+
 	/* pool_discard */
 	if (a->pool_discard != b->pool_discard)
 		return 0;
@@ -555,6 +673,18 @@ od_rules_rule_compare(od_rule_t *a, od_rule_t *b)
 	if (a->pool_rollback != b->pool_rollback)
 		return 0;
 
+	/* notify_relay */
+	if (a->notify_relay != b->notify_relay)
+		return 0;
+
+	/* pool_spool */
+	if (a->pool_spool != b->pool_spool)
+		return 0;
+	if (a->pool_spool_memory != b->pool_spool_memory)
+		return 0;
+	if (a->pool_spool_max != b->pool_spool_max)
+		return 0;
+
 	/* client_fwd_error */
 	if (a->client_fwd_error != b->client_fwd_error)
 		return 0;
@@ -563,6 +693,24 @@ od_rules_rule_compare(od_rule_t *a, od_rule_t *b)
 	if (a->client_max != b->client_max)
 		return 0;
 
+	/* top_clients */
+	if (a->top_clients != b->top_clients)
+		return 0;
+
+	/* limits */
+	if (a->limit_qps != b->limit_qps)
+		return 0;
+	if (a->limit_tps != b->limit_tps)
+		return 0;
+	if (a->limit_bytes_per_sec != b->limit_bytes_per_sec)
+		return 0;
+	if (a->limit_tx_max != b->limit_tx_max)
+		return 0;
+	if (a->limit_policy != b->limit_policy)
+		return 0;
+	if (a->limit_timeout != b->limit_timeout)
+		return 0;
+
 	return 1;
 }
 
@@ -637,6 +785,69 @@ od_rules_merge(od_rules_t *rules, od_rules_t *src)
 	return count_new + count_mark + count_deleted;
 }
 
+static inline int
+od_rules_validate_shards(od_rules_t *rules,
+                         od_rule_t *rule,
+                         od_logger_t *logger)
+{
+	od_shard_map_t *map;
+	map = od_shard_map_create(rule->shards, rule->shard_ranges);
+	if (map == NULL) {
+		od_error(logger,
+		         "rules",
+		         NULL,
+		         NULL,
+		         "rule '%s.%s': bad shard map",
+		         rule->db_name,
+		         rule->user_name);
+		return -1;
+	}
+	rule->shard_map = map;
+
+	int i;
+	for (i = 0; i < map->count; i++) {
+		od_rule_storage_t *storage;
+		storage = od_rules_storage_match(rules, map->names[i]);
+		if (storage == NULL ||
+		    storage->storage_type != OD_RULE_STORAGE_REMOTE) {
+			od_error(logger,
+			         "rules",
+			         NULL,
+			         NULL,
+			         "rule '%s.%s': no remote shard storage '%s' found",
+			         rule->db_name,
+			         rule->user_name,
+			         map->names[i]);
+			return -1;
+		}
+		map->storages[i] = od_rules_storage_copy(storage);
+		if (map->storages[i] == NULL)
+			return -1;
+	}
+
+	if (rule->shard_key == NULL && !rule->shard_hint) {
+		od_error(logger,
+		         "rules",
+		         NULL,
+		         NULL,
+		         "rule '%s.%s': shard_key or shard_hint is required",
+		         rule->db_name,
+		         rule->user_name);
+		return -1;
+	}
+	if (rule->notify_relay) {
+		od_error(logger,
+		         "rules",
+		         NULL,
+		         NULL,
+		         "rule '%s.%s': notify_relay is not supported with shards",
+		         rule->db_name,
+		         rule->user_name);
+		return -1;
+	}
+	return 0;
+}
+
 int
 od_rules_validate(od_rules_t *rules, od_config_t *config, od_logger_t *logger)
 {
@@ -696,6 +907,17 @@ od_rules_validate(od_rules_t *rules, od_config_t *config, od_logger_t *logger)
 				return -1;
 			}
 		}
+		if (storage->server_max_active < 0 ||
+		    storage->server_queue_target < 0 ||
+		    storage->server_queue_interval <= 0) {
+			od_error(logger,
+			         "rules",
+			         NULL,
+			         NULL,
+			         "storage '%s': bad server queue settings",
+			         storage->name);
+			return -1;
+		}
 	}
 
 	/* rules */
@@ -732,6 +954,10 @@ od_rules_validate(od_rules_t *rules, od_config_t *config, od_logger_t *logger)
 		if (rule->storage == NULL)
 			return -1;
 
+		/* shards */
+		if (rule->shards && od_rules_validate_shards(rules, rule, logger) == -1)
+			return -1;
+
 		/* pooling mode */
 		if (!rule->pool_sz) {
 			od_error(logger,
@@ -758,6 +984,94 @@ od_rules_validate(od_rules_t *rules, od_config_t *config, od_logger_t *logger)
 			return -1;
 		}
 
+		/* notify_relay */
+		if (rule->notify_relay && rule->pool != OD_RULE_POOL_TRANSACTION) {
+			od_error(logger,
+			         "rules",
+			         NULL,
+			         NULL,
+			         "rule '%s.%s': notify_relay requires transaction pooling",
+			         rule->db_name,
+			         rule->user_name);
+			return -1;
+		}
+
+		/* pool_spool */
+		if (rule->pool_spool && rule->pool != OD_RULE_POOL_TRANSACTION) {
+			od_error(logger,
+			         "rules",
+			         NULL,
+			         NULL,
+			         "rule '%s.%s': pool_spool requires transaction pooling",
+			         rule->db_name,
+			         rule->user_name);
+			return -1;
+		}
+		if (rule->pool_spool_memory <= 0 || rule->pool_spool_max < 0) {
+			od_error(logger,
+			         "rules",
+			         NULL,
+			         NULL,
+			         "rule '%s.%s': bad pool_spool_memory or pool_spool_max",
+			         rule->db_name,
+			         rule->user_name);
+			return -1;
+		}
+
+		/* top_clients */
+		if (rule->top_clients < 0) {
+			od_error(logger,
+			         "rules",
+			         NULL,
+			         NULL,
+			         "rule '%s.%s': bad top_clients number",
+			         rule->db_name,
+			         rule->user_name);
+			return -1;
+		}
+
+		/* timeouts */
+		if (rule->query_timeout < 0 || rule->transaction_timeout < 0 ||
+		    rule->server_check_delay < 0) {
+			od_error(logger,
+			         "rules",
+			         NULL,
+			         NULL,
+			         "rule '%s.%s': bad timeout value",
+			         rule->db_name,
+			         rule->user_name);
+			return -1;
+		}
+
+		/* limits */
+		if (rule->limit_qps < 0 || rule->limit_tps < 0 ||
+		    rule->limit_bytes_per_sec < 0 || rule->limit_tx_max < 0 ||
+		    rule->limit_timeout < 0) {
+			od_error(logger,
+			         "rules",
+			         NULL,
+			         NULL,
+			         "rule '%s.%s': bad limit value",
+			         rule->db_name,
+			         rule->user_name);
+			return -1;
+		}
+		if (rule->limit_policy_sz == NULL ||
+		    strcmp(rule->limit_policy_sz, "delay") == 0) {
+			rule->limit_policy = OD_RULE_LIMIT_DELAY;
+		} else if (strcmp(rule->limit_policy_sz, "reject") == 0) {
+			rule->limit_policy = OD_RULE_LIMIT_REJECT;
+		} else {
+			od_error(logger,
+			         "rules",
+			         NULL,
+			         NULL,
+			         "rule '%s.%s': unknown limit_policy",
+			         rule->db_name,
+			         rule->user_name);
+			return -1;
+		}
+
 		/* auth */
 		if (!rule->auth) {
 			od_error(logger,
@@ -947,8 +1261,36 @@ od_rules_print(od_rules_t *rules, od_logger_t *logger)
 		       NULL,
 		       "  pool_timeout     %d",
 		       rule->pool_timeout);
+		if (rule->pool_priority)
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  pool_priority    %d",
+			       rule->pool_priority);
+		if (rule->query_timeout)
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  query_timeout    %d",
+			       rule->query_timeout);
+		if (rule->transaction_timeout)
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  transaction_timeout %d",
+			       rule->transaction_timeout);
 		od_log(
 		  logger, "rules", NULL, NULL, "  pool_ttl         %d", rule->pool_ttl);
+		if (rule->server_check_delay)
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  server_check_delay %d",
+			       rule->server_check_delay);
 		od_log(logger,
 		       "rules",
 		       NULL,
@@ -967,6 +1309,27 @@ od_rules_print(od_rules_t *rules, od_logger_t *logger)
 		       NULL,
 		       "  pool_rollback    %s",
 		       rule->pool_rollback ? "yes" : "no");
+		od_log(logger,
+		       "rules",
+		       NULL,
+		       NULL,
+		       "  notify_relay     %s",
+		       od_rules_yes_no(rule->notify_relay));
+		if (rule->pool_spool) {
+			od_log(logger, "rules", NULL, NULL, "  pool_spool       yes");
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  pool_spool_memory %d",
+			       rule->pool_spool_memory);
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  pool_spool_max   %d",
+			       rule->pool_spool_max);
+		}
 		if (rule->client_max_set)
 			od_log(logger,
 			       "rules",
@@ -1053,6 +1416,85 @@ od_rules_print(od_rules_t *rules, od_logger_t *logger)
 			       NULL,
 			       "  storage_user     %s",
 			       rule->storage_user);
+		if (rule->shards) {
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  shards           %s",
+			       rule->shards);
+			if (rule->shard_ranges)
+				od_log(logger,
+				       "rules",
+				       NULL,
+				       NULL,
+				       "  shard_ranges     %s",
+				       rule->shard_ranges);
+			if (rule->shard_key)
+				od_log(logger,
+				       "rules",
+				       NULL,
+				       NULL,
+				       "  shard_key        %s",
+				       rule->shard_key);
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  shard_hint       %s",
+			       od_rules_yes_no(rule->shard_hint));
+		}
+		if (rule->top_clients)
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  top_clients      %d",
+			       rule->top_clients);
+		if (rule->limit_qps)
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  limit_qps        %d",
+			       rule->limit_qps);
+		if (rule->limit_tps)
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  limit_tps        %d",
+			       rule->limit_tps);
+		if (rule->limit_bytes_per_sec)
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  limit_bytes_per_sec %d",
+			       rule->limit_bytes_per_sec);
+		if (rule->limit_tx_max)
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  limit_tx_max     %d",
+			       rule->limit_tx_max);
+		if (rule->limit_qps || rule->limit_tps || rule->limit_bytes_per_sec ||
+		    rule->limit_tx_max) {
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  limit_policy     %s",
+			       rule->limit_policy == OD_RULE_LIMIT_REJECT ? "reject"
+			                                                  : "delay");
+			od_log(logger,
+			       "rules",
+			       NULL,
+			       NULL,
+			       "  limit_timeout    %d",
+			       rule->limit_timeout);
+		}
 		od_log(logger,
 		       "rules",
 		       NULL,
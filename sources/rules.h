@@ -1,8 +1,11 @@
 #ifndef ODYSSEY_RULES_H
 #define ODYSSEY_RULES_H
 
+#include <pthread.h>
+
 #include "pam.h"
 #include "config.h"
+#include "shard.h"
 
 /*
  * Odyssey.
@@ -41,6 +44,12 @@ typedef enum
 	OD_RULE_POOL_TRANSACTION
 } od_rule_pool_type_t;
 
+typedef enum
+{
+	OD_RULE_LIMIT_DELAY,
+	OD_RULE_LIMIT_REJECT
+} od_rule_limit_policy_t;
+
 typedef enum
 {
 	OD_RULE_STORAGE_REMOTE,
@@ -52,6 +61,8 @@ struct od_rule_storage
 	char *name;
 	char *type;
 	od_rule_storage_type_t storage_type;
+	/* host and port can be changed by RETARGET */
+	pthread_mutex_t lock;
 	char *host;
 	int port;
 	od_rule_tls_t tls_mode;
@@ -61,6 +72,9 @@ struct od_rule_storage
 	char *tls_cert_file;
 	char *tls_protocols;
 	int server_max_routing;
+	int server_max_active;
+	int server_queue_target;
+	int server_queue_interval;
 	od_list_t link;
 };
 
@@ -108,15 +122,29 @@ struct od_rule
 	int storage_user_len;
 	char *storage_password;
 	int storage_password_len;
+	/* shards */
+	char *shards;
+	char *shard_ranges;
+	char *shard_key;
+	int shard_hint;
+	od_shard_map_t *shard_map;
 	/* pool */
 	od_rule_pool_type_t pool;
 	char *pool_sz;
 	int pool_size;
 	int pool_timeout;
+	int pool_priority;
+	int query_timeout;
+	int transaction_timeout;
 	int pool_ttl;
+	int server_check_delay;
 	int pool_discard;
 	int pool_cancel;
 	int pool_rollback;
+	int notify_relay;
+	int pool_spool;
+	int pool_spool_memory;
+	int pool_spool_max;
 	/* misc */
 	int client_fwd_error;
 	int application_name_add_host;
@@ -125,6 +153,15 @@ struct od_rule
 	int log_debug;
 	double *quantiles;
 	int quantiles_count;
+	int top_clients;
+	/* limits */
+	int limit_qps;
+	int limit_tps;
+	int limit_bytes_per_sec;
+	int limit_tx_max;
+	char *limit_policy_sz;
+	od_rule_limit_policy_t limit_policy;
+	int limit_timeout;
 	uint64_t server_lifetime_us;
 	od_list_t link;
 };
@@ -172,6 +209,12 @@ od_rules_storage_match(od_rules_t *, char *);
 od_rule_storage_t *
 od_rules_storage_copy(od_rule_storage_t *);
 
+int
+od_rules_storage_target(od_rule_storage_t *, char **, int *);
+
+int
+od_rules_storage_retarget(od_rule_storage_t *, char *, int);
+
 void
 od_rules_storage_free(od_rule_storage_t *);
 
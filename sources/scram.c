@@ -10,8 +10,232 @@
 #include <odyssey.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
 #include "attribute.h"
 
+/*
+ * Salted password derivation costs thousands of HMAC-SHA-256 rounds and
+ * dominates login storms, when many clients and servers authenticate
+ * with the same credentials at once. Derived keys are cached by digest
+ * of password, salt and iteration count. Misses are derived by OpenSSL
+ * PBKDF2, which keeps HMAC pads precomputed between rounds and uses
+ * SHA extensions of the CPU where available.
+ *
+ * Derivation runs by the task pool, so worker keeps serving other
+ * coroutines. Concurrent misses of the same key wait for the first one
+ * to finish instead of deriving it again.
+ *
+ * Cached keys are enough to authenticate, so they expire after
+ * OD_SCRAM_CACHE_TTL and are dropped on config reload.
+ */
+
+typedef struct
+{
+	machine_channel_t *channel;
+	bool woken;
+	od_list_t link;
+} od_scram_cache_waiter_t;
+
+typedef struct
+{
+	uint8_t key[SHA256_DIGEST_LENGTH];
+	uint8_t salted_password[SCRAM_KEY_LEN];
+	uint64_t time_us;
+	bool used;
+	uint8_t pending_key[SHA256_DIGEST_LENGTH];
+	bool pending;
+	od_list_t waiters;
+} od_scram_cache_entry_t;
+
+static od_scram_cache_entry_t od_scram_cache[OD_SCRAM_CACHE_SIZE];
+static uint64_t od_scram_cache_version = 0;
+static pthread_mutex_t od_scram_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_once_t od_scram_secret_once = PTHREAD_ONCE_INIT;
+static uint8_t od_scram_secret[SHA256_DIGEST_LENGTH];
+
+static void
+od_scram_secret_init(void)
+{
+	RAND_bytes(od_scram_secret, sizeof(od_scram_secret));
+}
+
+static inline int
+od_scram_cache_key(const char *password,
+                   const char *salt,
+                   int salt_len,
+                   int iterations,
+                   uint8_t *key)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+	if (ctx == NULL)
+		return -1;
+	int rc;
+	rc = EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) &&
+	     EVP_DigestUpdate(ctx, password, strlen(password) + 1) &&
+	     EVP_DigestUpdate(ctx, salt, salt_len) &&
+	     EVP_DigestUpdate(ctx, &iterations, sizeof(iterations)) &&
+	     EVP_DigestFinal_ex(ctx, key, NULL);
+	EVP_MD_CTX_free(ctx);
+	return rc ? 0 : -1;
+}
+
+static inline void
+od_scram_cache_entry_clear(od_scram_cache_entry_t *entry)
+{
+	OPENSSL_cleanse(entry->key, sizeof(entry->key));
+	OPENSSL_cleanse(entry->salted_password, sizeof(entry->salted_password));
+	entry->used = false;
+}
+
+void
+od_scram_cache_reset(void)
+{
+	pthread_mutex_lock(&od_scram_cache_lock);
+	int i;
+	for (i = 0; i < OD_SCRAM_CACHE_SIZE; i++)
+		od_scram_cache_entry_clear(&od_scram_cache[i]);
+	/* keys being derived now are not cached either */
+	od_scram_cache_version++;
+	pthread_mutex_unlock(&od_scram_cache_lock);
+}
+
+static inline void
+od_scram_cache_wait(od_scram_cache_entry_t *entry)
+{
+	od_scram_cache_waiter_t waiter;
+	waiter.woken   = false;
+	waiter.channel = machine_channel_create(1);
+	od_list_init(&waiter.link);
+	if (waiter.channel == NULL) {
+		pthread_mutex_unlock(&od_scram_cache_lock);
+		machine_sleep(1);
+		pthread_mutex_lock(&od_scram_cache_lock);
+		return;
+	}
+	od_list_append(&entry->waiters, &waiter.link);
+	pthread_mutex_unlock(&od_scram_cache_lock);
+
+	/* wakeup is not guaranteed, key is checked again anyway */
+	machine_msg_t *msg;
+	msg = machine_channel_read(waiter.channel, 100);
+	if (msg)
+		machine_msg_free(msg);
+
+	pthread_mutex_lock(&od_scram_cache_lock);
+	if (!waiter.woken)
+		od_list_unlink(&waiter.link);
+	machine_channel_free(waiter.channel);
+}
+
+static inline void
+od_scram_cache_wakeup(od_scram_cache_entry_t *entry)
+{
+	od_list_t *i, *n;
+	od_list_foreach_safe(&entry->waiters, i, n)
+	{
+		od_scram_cache_waiter_t *waiter;
+		waiter = od_container_of(i, od_scram_cache_waiter_t, link);
+		od_list_unlink(&waiter->link);
+		waiter->woken = true;
+		machine_msg_t *msg = machine_msg_create(0);
+		if (msg)
+			machine_channel_write(waiter->channel, msg);
+	}
+}
+
+typedef struct
+{
+	const char *password;
+	const char *salt;
+	int salt_len;
+	int iterations;
+	uint8_t *result;
+	int rc;
+} od_scram_derive_task_t;
+
+static void
+od_scram_derive_task(void *arg)
+{
+	od_scram_derive_task_t *task = arg;
+	task->rc = PKCS5_PBKDF2_HMAC(task->password,
+	                             strlen(task->password),
+	                             (const unsigned char *)task->salt,
+	                             task->salt_len,
+	                             task->iterations,
+	                             EVP_sha256(),
+	                             SCRAM_KEY_LEN,
+	                             task->result);
+}
+
+int
+od_scram_salted_password(const char *password,
+                         const char *salt,
+                         int salt_len,
+                         int iterations,
+                         uint8_t *result)
+{
+	uint8_t key[SHA256_DIGEST_LENGTH];
+	int rc;
+	rc = od_scram_cache_key(password, salt, salt_len, iterations, key);
+	if (rc == -1)
+		return -1;
+
+	uint32_t hash;
+	memcpy(&hash, key, sizeof(hash));
+	od_scram_cache_entry_t *entry;
+	entry = &od_scram_cache[hash % OD_SCRAM_CACHE_SIZE];
+
+	pthread_mutex_lock(&od_scram_cache_lock);
+	for (;;) {
+		if (entry->used && memcmp(entry->key, key, sizeof(key)) == 0) {
+			uint64_t age_us = machine_time_us() - entry->time_us;
+			if (age_us < OD_SCRAM_CACHE_TTL * 1000000ULL) {
+				memcpy(result, entry->salted_password, SCRAM_KEY_LEN);
+				pthread_mutex_unlock(&od_scram_cache_lock);
+				return 0;
+			}
+			od_scram_cache_entry_clear(entry);
+		}
+		/* wait for the same key derived by another coroutine */
+		if (!entry->pending ||
+		    memcmp(entry->pending_key, key, sizeof(key)) != 0)
+			break;
+		od_scram_cache_wait(entry);
+	}
+	bool owner = !entry->pending;
+	if (owner) {
+		memcpy(entry->pending_key, key, sizeof(key));
+		entry->pending = true;
+		od_list_init(&entry->waiters);
+	}
+	uint64_t version = od_scram_cache_version;
+	pthread_mutex_unlock(&od_scram_cache_lock);
+
+	od_scram_derive_task_t task = {
+		password, salt, salt_len, iterations, result, 0
+	};
+	rc = machine_task(od_scram_derive_task, &task);
+	if (rc == -1)
+		task.rc = 0;
+
+	/* slot is filled only by the coroutine which claimed it */
+	if (owner) {
+		pthread_mutex_lock(&od_scram_cache_lock);
+		if (task.rc == 1 && version == od_scram_cache_version) {
+			memcpy(entry->key, key, sizeof(key));
+			memcpy(entry->salted_password, result, SCRAM_KEY_LEN);
+			entry->time_us = machine_time_us();
+			entry->used    = true;
+		}
+		entry->pending = false;
+		od_scram_cache_wakeup(entry);
+		pthread_mutex_unlock(&od_scram_cache_lock);
+	}
+	return task.rc == 1 ? 0 : -1;
+}
+
 int
 od_scram_parse_verifier(od_scram_state_t *scram_state, char *verifier)
 {
@@ -120,9 +344,12 @@ error:
 
 int
 od_scram_init_from_plain_password(od_scram_state_t *scram_state,
-                                  char *plain_password)
+                                  char *plain_password,
+                                  char *user,
+                                  char *database)
 {
 	char *prep_password = NULL;
+	char *salt_input    = NULL;
 
 	pg_saslprep_rc rc = pg_saslprep(plain_password, &prep_password);
 	if (rc == SASLPREP_OOM)
@@ -134,8 +361,32 @@ od_scram_init_from_plain_password(od_scram_state_t *scram_state,
 	else
 		password = plain_password;
 
+	/* salt is stable for the route user and password during process
+	 * lifetime, same as stored verifier of postgres, so that salted
+	 * password is cached. User and database are part of the input, so
+	 * equal passwords of different users get different salts */
+	pthread_once(&od_scram_secret_once, od_scram_secret_init);
+	size_t user_len       = strlen(user) + 1;
+	size_t database_len   = strlen(database) + 1;
+	size_t password_len   = strlen(password);
+	size_t salt_input_len = user_len + database_len + password_len;
+	salt_input            = malloc(salt_input_len);
+	if (salt_input == NULL)
+		goto error;
+	memcpy(salt_input, user, user_len);
+	memcpy(salt_input + user_len, database, database_len);
+	memcpy(salt_input + user_len + database_len, password, password_len);
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+	if (HMAC(EVP_sha256(),
+	         od_scram_secret,
+	         sizeof(od_scram_secret),
+	         (const unsigned char *)salt_input,
+	         salt_input_len,
+	         digest,
+	         NULL) == NULL)
+		goto error;
 	char salt[SCRAM_DEFAULT_SALT_LEN];
-	RAND_bytes((uint8_t *)salt, sizeof(salt));
+	memcpy(salt, digest, sizeof(salt));
 
 	scram_state->iterations = SCRAM_DEFAULT_ITERATIONS;
 
@@ -149,14 +400,18 @@ od_scram_init_from_plain_password(od_scram_state_t *scram_state,
 	scram_state->salt[base64_salt_len] = '\0';
 
 	uint8_t salted_password[SCRAM_KEY_LEN];
-	scram_SaltedPassword(
+	int rc_salt;
+	rc_salt = od_scram_salted_password(
 	  password, salt, sizeof(salt), scram_state->iterations, salted_password);
+	if (rc_salt == -1)
+		goto error;
 	scram_ClientKey(salted_password, scram_state->stored_key);
 	scram_H(scram_state->stored_key, SCRAM_KEY_LEN, scram_state->stored_key);
 	scram_ServerKey(salted_password, scram_state->server_key);
 
 	if (prep_password)
 		free(prep_password);
+	free(salt_input);
 
 	return 0;
 
@@ -164,6 +419,7 @@ error:
 
 	if (prep_password)
 		free(prep_password);
+	free(salt_input);
 
 	return -1;
 }
@@ -314,11 +570,12 @@ calculate_client_proof(od_scram_state_t *scram_state,
 
 	scram_HMAC_ctx ctx;
 
-	scram_SaltedPassword(prepared_password,
-	                     salt,
-	                     strlen(salt),
-	                     iterations,
-	                     scram_state->salted_password);
+	if (od_scram_salted_password(prepared_password,
+	                             salt,
+	                             strlen(salt),
+	                             iterations,
+	                             scram_state->salted_password) == -1)
+		goto error;
 
 	uint8_t client_key[SCRAM_KEY_LEN];
 	scram_ClientKey(scram_state->salted_password, client_key);
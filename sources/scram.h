@@ -19,6 +19,9 @@
  * Scalable PostgreSQL connection pooler.
  */
 
+#define OD_SCRAM_CACHE_SIZE 64
+#define OD_SCRAM_CACHE_TTL  60 /* seconds */
+
 typedef struct od_scram_state od_scram_state_t;
 
 struct od_scram_state
@@ -88,12 +91,24 @@ od_scram_verify_final_nonce(od_scram_state_t *scram_state,
 int
 od_scram_verify_client_proof(od_scram_state_t *scram_state, char *client_proof);
 
+int
+od_scram_salted_password(const char *password,
+                         const char *salt,
+                         int salt_len,
+                         int iterations,
+                         uint8_t *result);
+
+void
+od_scram_cache_reset(void);
+
 int
 od_scram_parse_verifier(od_scram_state_t *scram_state, char *verifier);
 
 int
 od_scram_init_from_plain_password(od_scram_state_t *scram_state,
-                                  char *plain_password);
+                                  char *plain_password,
+                                  char *user,
+                                  char *database);
 
 int
 od_scram_read_client_first_message(od_scram_state_t *scram_state,
@@ -10,7 +10,10 @@
 #include "scram.h"
 #include "global.h"
 #include "stat.h"
+#include "slab.h"
+#include "registry.h"
 
+typedef struct od_server_cold od_server_cold_t;
 typedef struct od_server od_server_t;
 
 typedef enum
@@ -20,10 +23,24 @@ typedef enum
 	OD_SERVER_ACTIVE
 } od_server_state_t;
 
+/* query_timeout and transaction_timeout enforcement */
+typedef enum
+{
+	OD_SERVER_TIMEOUT_NONE,
+	OD_SERVER_TIMEOUT_CANCEL,
+	OD_SERVER_TIMEOUT_CLOSE
+} od_server_timeout_t;
+
+/* authentication and parameters state, not used by relay */
+struct od_server_cold
+{
+	od_scram_state_t scram_state;
+	kiwi_vars_t vars;
+};
+
 struct od_server
 {
 	od_server_state_t state;
-	od_scram_state_t scram_state;
 	od_id_t id;
 	machine_tls_t *tls;
 	od_io_t io;
@@ -33,55 +50,78 @@ struct od_server
 	int is_copy;
 	int deploy_sync;
 	od_stat_state_t stats_state;
+	od_server_timeout_t timeout;
+	uint64_t timeout_cancel_us;
 	uint64_t sync_request;
 	uint64_t sync_reply;
 	int idle_time;
+	uint64_t idle_since_us;
 	kiwi_key_t key;
 	kiwi_key_t key_client;
-	kiwi_vars_t vars;
+	od_server_cold_t *cold;
 	machine_msg_t *error_connect;
 	void *client;
 	void *route;
 	od_global_t *global;
 	uint64_t init_time_us;
+	uint32_t storage_epoch;
+	od_registry_node_t registry;
 	od_list_t link;
 };
 
 static inline void
 od_server_init(od_server_t *server)
 {
-	server->state          = OD_SERVER_UNDEF;
-	server->route          = NULL;
-	server->client         = NULL;
-	server->global         = NULL;
-	server->tls            = NULL;
-	server->idle_time      = 0;
-	server->is_allocated   = 0;
-	server->is_transaction = 0;
-	server->is_copy        = 0;
-	server->deploy_sync    = 0;
-	server->sync_request   = 0;
-	server->sync_reply     = 0;
-	server->init_time_us   = machine_time_us();
-	server->error_connect  = NULL;
+	server->state             = OD_SERVER_UNDEF;
+	server->route             = NULL;
+	server->client            = NULL;
+	server->global            = NULL;
+	server->tls               = NULL;
+	server->idle_time         = 0;
+	server->idle_since_us     = 0;
+	server->is_allocated      = 0;
+	server->is_transaction    = 0;
+	server->is_copy           = 0;
+	server->deploy_sync       = 0;
+	server->timeout           = OD_SERVER_TIMEOUT_NONE;
+	server->timeout_cancel_us = 0;
+	server->sync_request      = 0;
+	server->sync_reply        = 0;
+	server->init_time_us      = machine_time_us();
+	server->storage_epoch     = 0;
+	server->error_connect     = NULL;
+	server->cold              = NULL;
 	od_stat_state_init(&server->stats_state);
-	od_scram_state_init(&server->scram_state);
 	kiwi_key_init(&server->key);
 	kiwi_key_init(&server->key_client);
-	kiwi_vars_init(&server->vars);
 	od_io_init(&server->io);
-	od_relay_init(&server->relay, &server->io);
+	od_relay_init(&server->relay, &server->io, &server->id);
+	od_registry_node_init(&server->registry, &server->id);
 	od_list_init(&server->link);
 	memset(&server->id, 0, sizeof(server->id));
 }
 
+static inline void
+od_server_cold_init(od_server_cold_t *cold)
+{
+	od_scram_state_init(&cold->scram_state);
+	kiwi_vars_init(&cold->vars);
+}
+
 static inline od_server_t *
 od_server_allocate(void)
 {
-	od_server_t *server = malloc(sizeof(*server));
+	od_server_t *server = od_slab_alloc_id(OD_SLAB_SERVER);
 	if (server == NULL)
 		return NULL;
+	od_server_cold_t *cold = od_slab_alloc_id(OD_SLAB_SERVER_COLD);
+	if (cold == NULL) {
+		od_slab_release_id(OD_SLAB_SERVER, server);
+		return NULL;
+	}
 	od_server_init(server);
+	od_server_cold_init(cold);
+	server->cold         = cold;
 	server->is_allocated = 1;
 	return server;
 }
@@ -89,8 +129,11 @@ od_server_allocate(void)
 static inline void
 od_server_free(od_server_t *server)
 {
-	if (server->is_allocated)
-		free(server);
+	if (!server->is_allocated)
+		return;
+	od_registry_remove(&od_registry_servers, &server->registry);
+	od_slab_release_id(OD_SLAB_SERVER_COLD, server->cold);
+	od_slab_release_id(OD_SLAB_SERVER, server);
 }
 
 static inline void
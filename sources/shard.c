@@ -0,0 +1,226 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "shard.h"
+
+static inline char *
+od_shard_trim(char *start, char *end)
+{
+	while (start < end && isspace((unsigned char)*start))
+		start++;
+	while (end > start && isspace((unsigned char)end[-1]))
+		end--;
+	int len    = end - start;
+	char *name = malloc(len + 1);
+	if (name == NULL)
+		return NULL;
+	memcpy(name, start, len);
+	name[len] = 0;
+	return name;
+}
+
+static inline int
+od_shard_map_ranges(od_shard_map_t *map, char *value)
+{
+	map->ranges = malloc(sizeof(int64_t) * map->count);
+	if (map->ranges == NULL)
+		return -1;
+	char *pos = value;
+	int i;
+	for (i = 0; i < map->count; i++) {
+		char *end;
+		errno           = 0;
+		long long bound = strtoll(pos, &end, 10);
+		if (end == pos || errno != 0)
+			return -1;
+		/* lower bounds must be strictly increasing */
+		if (i > 0 && bound <= map->ranges[i - 1])
+			return -1;
+		map->ranges[i] = bound;
+		while (isspace((unsigned char)*end))
+			end++;
+		if (i == map->count - 1)
+			return *end == 0 ? 0 : -1;
+		if (*end != ',')
+			return -1;
+		pos = end + 1;
+	}
+	return -1;
+}
+
+od_shard_map_t *
+od_shard_map_create(char *shards, char *ranges)
+{
+	od_shard_map_t *map = malloc(sizeof(od_shard_map_t));
+	if (map == NULL)
+		return NULL;
+	memset(map, 0, sizeof(od_shard_map_t));
+
+	int count = 1;
+	char *c;
+	for (c = shards; *c; c++)
+		if (*c == ',')
+			count++;
+	map->names    = malloc(sizeof(char *) * count);
+	map->storages = malloc(sizeof(struct od_rule_storage *) * count);
+	if (map->names == NULL || map->storages == NULL)
+		goto error;
+	memset(map->names, 0, sizeof(char *) * count);
+	memset(map->storages, 0, sizeof(struct od_rule_storage *) * count);
+
+	char *pos = shards;
+	for (;;) {
+		char *end = strchr(pos, ',');
+		if (end == NULL)
+			end = pos + strlen(pos);
+		char *name = od_shard_trim(pos, end);
+		if (name == NULL)
+			goto error;
+		map->names[map->count++] = name;
+		if (*name == 0)
+			goto error;
+		if (*end == 0)
+			break;
+		pos = end + 1;
+	}
+
+	if (ranges && od_shard_map_ranges(map, ranges) == -1)
+		goto error;
+	return map;
+error:
+	od_shard_map_free(map);
+	return NULL;
+}
+
+void
+od_shard_map_free(od_shard_map_t *map)
+{
+	int i;
+	for (i = 0; i < map->count; i++)
+		free(map->names[i]);
+	if (map->names)
+		free(map->names);
+	if (map->storages)
+		free(map->storages);
+	if (map->ranges)
+		free(map->ranges);
+	free(map);
+}
+
+static inline int
+od_shard_map_range(od_shard_map_t *map, char *key, int key_len)
+{
+	/* range maps use the trailing number of the key, so that
+	 * both '42' and 'tenant_42' keys map to the same shard */
+	int start = key_len;
+	while (start > 0 && isdigit((unsigned char)key[start - 1]))
+		start--;
+	if (start == key_len || key_len - start > 18)
+		return OD_SHARD_NONE;
+	int64_t value = 0;
+	int i;
+	for (i = start; i < key_len; i++)
+		value = value * 10 + (key[i] - '0');
+
+	/* find last lower bound not greater than the value */
+	if (value < map->ranges[0])
+		return OD_SHARD_NONE;
+	int left  = 0;
+	int right = map->count - 1;
+	while (left < right) {
+		int mid = (left + right + 1) / 2;
+		if (map->ranges[mid] <= value)
+			left = mid;
+		else
+			right = mid - 1;
+	}
+	return left;
+}
+
+int
+od_shard_map_lookup(od_shard_map_t *map, char *key, int key_len)
+{
+	if (key_len == 0)
+		return OD_SHARD_NONE;
+	if (map->ranges)
+		return od_shard_map_range(map, key, key_len);
+
+	/* fnv-1a */
+	uint64_t hash = 14695981039346656037ULL;
+	int i;
+	for (i = 0; i < key_len; i++) {
+		hash ^= (unsigned char)key[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash % map->count;
+}
+
+/* StartupMessage: length, protocol version and name-value pairs */
+char *
+od_shard_startup_param(char *data, int size, char *name, int *value_len)
+{
+	if (size < 8)
+		return NULL;
+	char *pos = data + 8;
+	char *end = data + size;
+	while (pos < end && *pos) {
+		char *param = pos;
+		pos         = memchr(pos, 0, end - pos);
+		if (pos == NULL)
+			return NULL;
+		pos++;
+		char *value = pos;
+		pos         = memchr(pos, 0, end - pos);
+		if (pos == NULL)
+			return NULL;
+		pos++;
+		if (strcmp(param, name) == 0) {
+			*value_len = pos - value - 1;
+			return value;
+		}
+	}
+	return NULL;
+}
+
+/* match shard=key hint in a comment anywhere in the query */
+int
+od_shard_hint(char *query, int size, char **key, int *key_len)
+{
+	char *pos = query;
+	char *end = query + size;
+	while (pos < end) {
+		pos = memchr(pos, '/', end - pos);
+		if (pos == NULL)
+			return -1;
+		pos++;
+		if (pos == end || *pos != '*')
+			continue;
+		pos++;
+		while (pos < end && isspace((unsigned char)*pos))
+			pos++;
+		if (end - pos < 6 || strncasecmp(pos, "shard=", 6) != 0)
+			continue;
+		pos += 6;
+		char *start = pos;
+		while (pos < end && *pos && *pos != '*' &&
+		       !isspace((unsigned char)*pos))
+			pos++;
+		if (pos == start || pos - start > OD_SHARD_KEY_MAX)
+			return -1;
+		*key     = start;
+		*key_len = pos - start;
+		return 0;
+	}
+	return -1;
+}
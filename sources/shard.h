@@ -0,0 +1,46 @@
+#ifndef ODYSSEY_SHARD_H
+#define ODYSSEY_SHARD_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Shard map.
+ *
+ * Maps a shard key taken from a startup parameter or from a
+ * shard hint comment to one of the rule storages. Hash maps use
+ * fnv-1a of the key modulo number of shards, range maps use the
+ * trailing number of the key and a sorted table of lower bounds.
+ */
+
+#include <stdint.h>
+
+#define OD_SHARD_NONE -1
+#define OD_SHARD_KEY_MAX 64
+
+typedef struct od_shard_map od_shard_map_t;
+
+struct od_shard_map
+{
+	int count;
+	char **names;
+	struct od_rule_storage **storages;
+	int64_t *ranges;
+};
+
+od_shard_map_t *
+od_shard_map_create(char *, char *);
+void
+od_shard_map_free(od_shard_map_t *);
+int
+od_shard_map_lookup(od_shard_map_t *, char *, int);
+
+char *
+od_shard_startup_param(char *, int, char *, int *);
+int
+od_shard_hint(char *, int, char **, int *);
+
+#endif /* ODYSSEY_SHARD_H */
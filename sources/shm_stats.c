@@ -0,0 +1,103 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shm_stats.h"
+
+void
+od_shm_stats_init(od_shm_stats_t *stats)
+{
+	stats->fd     = -1;
+	stats->size   = 0;
+	stats->header = NULL;
+}
+
+int
+od_shm_stats_open(od_shm_stats_t *stats,
+                  char *path,
+                  int workers_max,
+                  int routes_max,
+                  int stats_interval)
+{
+	/* always create new file, so that segment of the previous
+	 * instance (online restart) is never shared with this one */
+	unlink(path);
+
+	int fd;
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0640);
+	if (fd == -1)
+		return -1;
+
+	size_t size;
+	size = od_shm_stats_size(workers_max, routes_max);
+	int rc;
+	rc = ftruncate(fd, size);
+	if (rc == -1)
+		goto error;
+
+	void *ptr;
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+		goto error;
+	memset(ptr, 0, size);
+
+	od_shm_stats_header_t *header = ptr;
+	header->size                  = size;
+	header->pid                   = getpid();
+	header->workers_max           = workers_max;
+	header->routes_max            = routes_max;
+	header->stats_interval        = stats_interval;
+	header->version               = OD_SHM_STATS_VERSION;
+
+	/* magic is set last, readers ignore segment until it is ready */
+	__sync_synchronize();
+	header->magic = OD_SHM_STATS_MAGIC;
+
+	stats->fd     = fd;
+	stats->size   = size;
+	stats->header = header;
+	return 0;
+
+error:;
+	int errno_save = errno;
+	close(fd);
+	unlink(path);
+	errno = errno_save;
+	return -1;
+}
+
+void
+od_shm_stats_close(od_shm_stats_t *stats)
+{
+	if (stats->header) {
+		stats->header->stopped = 1;
+		__sync_synchronize();
+		munmap(stats->header, stats->size);
+	}
+	if (stats->fd != -1)
+		close(stats->fd);
+	od_shm_stats_init(stats);
+}
+
+uint64_t
+od_shm_stats_time_us(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_REALTIME, &t);
+	return t.tv_sec * (uint64_t)1000000 + t.tv_nsec / 1000;
+}
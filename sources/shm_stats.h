@@ -0,0 +1,226 @@
+#ifndef ODYSSEY_SHM_STATS_H
+#define ODYSSEY_SHM_STATS_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Shared memory statistics segment.
+ *
+ * Segment layout is a fixed header followed by workers_max worker
+ * slots and routes_max route slots. Header (including global and route
+ * counters) is written by cron only and protected by the header
+ * sequence counter, every worker slot is written by its own worker and
+ * protected by the slot sequence counter. Sequence counter is odd while
+ * update is in progress.
+ *
+ * The segment file is left in place when odyssey stops or switches to
+ * another path on reload (a new instance may already own the path),
+ * the header is marked stopped instead, so that readers do not report
+ * stale data of a dead process.
+ *
+ * This file is also used by external readers, so it must not depend
+ * on any other odyssey header.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define OD_SHM_STATS_MAGIC 0x5453444f /* ODST */
+#define OD_SHM_STATS_VERSION 4
+#define OD_SHM_STATS_NAME_MAX 64
+#define OD_SHM_STATS_TOP_MAX 8
+#define OD_SHM_STATS_HISTORY_MAX 60
+
+typedef struct od_shm_stats_global od_shm_stats_global_t;
+typedef struct od_shm_stats_worker od_shm_stats_worker_t;
+typedef struct od_shm_stats_top od_shm_stats_top_t;
+typedef struct od_shm_stats_route od_shm_stats_route_t;
+typedef struct od_shm_stats_header od_shm_stats_header_t;
+typedef struct od_shm_stats od_shm_stats_t;
+
+struct od_shm_stats_global
+{
+	uint64_t clients;
+	uint64_t routes;
+	uint64_t startup_errors;
+	uint64_t msg_allocated;
+	uint64_t msg_cache_count;
+	uint64_t msg_cache_gc_count;
+	uint64_t msg_cache_size;
+	uint64_t count_coroutine;
+	uint64_t count_coroutine_cache;
+};
+
+struct od_shm_stats_worker
+{
+	volatile uint64_t seq;
+	uint64_t update_time_us;
+	uint64_t clients_processed;
+	uint64_t msg_allocated;
+	uint64_t msg_cache_count;
+	uint64_t msg_cache_gc_count;
+	uint64_t msg_cache_size;
+	uint64_t count_coroutine;
+	uint64_t count_coroutine_cache;
+};
+
+typedef enum
+{
+	OD_SHM_STATS_TOP_ADDR,
+	OD_SHM_STATS_TOP_APPNAME
+} od_shm_stats_top_type_t;
+
+struct od_shm_stats_top
+{
+	uint32_t type;
+	uint32_t reserved;
+	char key[OD_SHM_STATS_NAME_MAX];
+	uint64_t connections;
+	uint64_t queries;
+	uint64_t bytes;
+};
+
+struct od_shm_stats_route
+{
+	char database[OD_SHM_STATS_NAME_MAX];
+	char user[OD_SHM_STATS_NAME_MAX];
+	uint32_t obsolete;
+	uint32_t client_pool_total;
+	uint32_t server_pool_active;
+	uint32_t server_pool_idle;
+	/* totals */
+	uint64_t count_query;
+	uint64_t count_tx;
+	uint64_t query_time;
+	uint64_t tx_time;
+	uint64_t recv_client;
+	uint64_t recv_server;
+	/* per second averages over last stats interval */
+	uint64_t avg_count_query;
+	uint64_t avg_count_tx;
+	uint64_t avg_query_time;
+	uint64_t avg_tx_time;
+	uint64_t avg_recv_client;
+	uint64_t avg_recv_server;
+	/* top clients by address and application_name (top_clients) */
+	uint32_t top_count;
+	uint32_t reserved;
+	od_shm_stats_top_t top[OD_SHM_STATS_TOP_MAX * 2];
+	/* latest per second samples, oldest first (stats_history) */
+	uint32_t history_count;
+	uint32_t history_reserved;
+	uint32_t history_time[OD_SHM_STATS_HISTORY_MAX];
+	uint32_t history_tps[OD_SHM_STATS_HISTORY_MAX];
+	uint32_t history_qps[OD_SHM_STATS_HISTORY_MAX];
+	uint32_t history_tx_time[OD_SHM_STATS_HISTORY_MAX];
+	uint32_t history_query_time[OD_SHM_STATS_HISTORY_MAX];
+	uint32_t history_queue[OD_SHM_STATS_HISTORY_MAX];
+	uint32_t history_tx_p99[OD_SHM_STATS_HISTORY_MAX];
+	uint32_t history_query_p99[OD_SHM_STATS_HISTORY_MAX];
+};
+
+struct od_shm_stats_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;
+	int64_t pid;
+	uint32_t workers_max;
+	uint32_t routes_max;
+	volatile uint64_t seq;
+	uint64_t update_time_us;
+	uint32_t stats_interval;
+	uint32_t workers_count;
+	uint32_t routes_count;
+	volatile uint32_t stopped;
+	od_shm_stats_global_t global;
+};
+
+struct od_shm_stats
+{
+	int fd;
+	size_t size;
+	od_shm_stats_header_t *header;
+};
+
+static inline size_t
+od_shm_stats_size(uint32_t workers_max, uint32_t routes_max)
+{
+	return sizeof(od_shm_stats_header_t) +
+	       sizeof(od_shm_stats_worker_t) * workers_max +
+	       sizeof(od_shm_stats_route_t) * routes_max;
+}
+
+static inline od_shm_stats_worker_t *
+od_shm_stats_worker_of(od_shm_stats_header_t *header, uint32_t id)
+{
+	od_shm_stats_worker_t *workers = (od_shm_stats_worker_t *)(header + 1);
+	return &workers[id];
+}
+
+static inline od_shm_stats_route_t *
+od_shm_stats_route_of(od_shm_stats_header_t *header, uint32_t id)
+{
+	od_shm_stats_route_t *routes;
+	routes = (od_shm_stats_route_t *)od_shm_stats_worker_of(
+	  header, header->workers_max);
+	return &routes[id];
+}
+
+/* seqlock */
+
+static inline void
+od_shm_stats_write_begin(volatile uint64_t *seq)
+{
+	*seq = *seq + 1;
+	__sync_synchronize();
+}
+
+static inline void
+od_shm_stats_write_end(volatile uint64_t *seq)
+{
+	__sync_synchronize();
+	*seq = *seq + 1;
+}
+
+static inline uint64_t
+od_shm_stats_read_begin(volatile uint64_t *seq)
+{
+	uint64_t value;
+	for (;;) {
+		value = *seq;
+		if (!(value & 1))
+			break;
+		__sync_synchronize();
+	}
+	__sync_synchronize();
+	return value;
+}
+
+static inline int
+od_shm_stats_read_retry(volatile uint64_t *seq, uint64_t value)
+{
+	__sync_synchronize();
+	return *seq != value;
+}
+
+static inline int
+od_shm_stats_is_open(od_shm_stats_t *stats)
+{
+	return stats->header != NULL;
+}
+
+void
+od_shm_stats_init(od_shm_stats_t *);
+int
+od_shm_stats_open(od_shm_stats_t *, char *, int, int, int);
+void
+od_shm_stats_close(od_shm_stats_t *);
+uint64_t
+od_shm_stats_time_us(void);
+
+#endif /* ODYSSEY_SHM_STATS_H */
@@ -44,6 +44,12 @@ od_system_cleanup(od_system_t *system)
 		            listen->port);
 		unlink(path);
 	}
+
+	/* mark stats segment stopped */
+	od_cron_stop(system->global->cron);
+
+	/* write out buffered traces */
+	od_tracer_close(&instance->tracer);
 }
 
 void
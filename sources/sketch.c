@@ -0,0 +1,224 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sketch.h"
+
+od_sketch_t *
+od_sketch_create(int top_max)
+{
+	od_sketch_t *sketch;
+	sketch = malloc(sizeof(od_sketch_t));
+	if (sketch == NULL)
+		return NULL;
+	memset(sketch, 0, sizeof(od_sketch_t));
+	mm_sleeplock_init(&sketch->lock);
+	sketch->top_max = top_max;
+	int i;
+	for (i = 0; i < OD_SKETCH_METRIC_MAX; i++) {
+		sketch->top[i] = malloc(sizeof(od_sketch_top_t) * top_max);
+		if (sketch->top[i] == NULL) {
+			od_sketch_free(sketch);
+			return NULL;
+		}
+	}
+	return sketch;
+}
+
+void
+od_sketch_free(od_sketch_t *sketch)
+{
+	int i;
+	for (i = 0; i < OD_SKETCH_METRIC_MAX; i++) {
+		if (sketch->top[i])
+			free(sketch->top[i]);
+	}
+	free(sketch);
+}
+
+static inline int
+od_sketch_index(od_sketch_key_t *key, int row)
+{
+	/* derive row hashes from a single key hash */
+	uint32_t h1 = (uint32_t)key->hash;
+	uint32_t h2 = (uint32_t)(key->hash >> 32) | 1;
+	return (h1 + row * h2) % OD_SKETCH_WIDTH;
+}
+
+static inline void
+od_sketch_top_swap(od_sketch_top_t *a, od_sketch_top_t *b)
+{
+	od_sketch_top_t tmp;
+	tmp = *a;
+	*a  = *b;
+	*b  = tmp;
+}
+
+static inline void
+od_sketch_top_sift_up(od_sketch_top_t *heap, int pos)
+{
+	while (pos > 0) {
+		int parent = (pos - 1) / 2;
+		if (heap[parent].count <= heap[pos].count)
+			break;
+		od_sketch_top_swap(&heap[parent], &heap[pos]);
+		pos = parent;
+	}
+}
+
+static inline void
+od_sketch_top_sift_down(od_sketch_top_t *heap, int count, int pos)
+{
+	for (;;) {
+		int min   = pos;
+		int left  = pos * 2 + 1;
+		int right = pos * 2 + 2;
+		if (left < count && heap[left].count < heap[min].count)
+			min = left;
+		if (right < count && heap[right].count < heap[min].count)
+			min = right;
+		if (min == pos)
+			break;
+		od_sketch_top_swap(&heap[min], &heap[pos]);
+		pos = min;
+	}
+}
+
+static inline void
+od_sketch_top_update(od_sketch_t *sketch,
+                     od_sketch_key_t *key,
+                     od_sketch_metric_t metric,
+                     uint64_t estimate)
+{
+	od_sketch_top_t *heap = sketch->top[metric];
+
+	/* unlocked check, the heap minimum only grows */
+	if (sketch->top_count[metric] == sketch->top_max &&
+	    estimate <= heap[0].count)
+		return;
+
+	mm_sleeplock_lock(&sketch->lock);
+
+	int count = sketch->top_count[metric];
+	int i;
+	for (i = 0; i < count; i++) {
+		if (!od_sketch_key_cmp(&heap[i].key, key))
+			continue;
+		if (estimate > heap[i].count) {
+			heap[i].count = estimate;
+			od_sketch_top_sift_down(heap, count, i);
+		}
+		mm_sleeplock_unlock(&sketch->lock);
+		return;
+	}
+
+	if (count < sketch->top_max) {
+		heap[count].key   = *key;
+		heap[count].count = estimate;
+		od_sketch_top_sift_up(heap, count);
+		sketch->top_count[metric]++;
+	} else if (estimate > heap[0].count) {
+		/* replace current minimum */
+		heap[0].key   = *key;
+		heap[0].count = estimate;
+		od_sketch_top_sift_down(heap, count, 0);
+	}
+
+	mm_sleeplock_unlock(&sketch->lock);
+}
+
+void
+od_sketch_add(od_sketch_t *sketch,
+              od_sketch_key_t *key,
+              od_sketch_metric_t metric,
+              uint64_t value)
+{
+	uint64_t estimate = UINT64_MAX;
+	int row;
+	for (row = 0; row < OD_SKETCH_DEPTH; row++) {
+		int column = od_sketch_index(key, row);
+		uint64_t counter;
+		counter =
+		  __sync_add_and_fetch(&sketch->counters[metric][row][column], value);
+		if (counter < estimate)
+			estimate = counter;
+	}
+	if (sketch->top_max > 0)
+		od_sketch_top_update(sketch, key, metric, estimate);
+}
+
+uint64_t
+od_sketch_estimate(od_sketch_t *sketch,
+                   od_sketch_key_t *key,
+                   od_sketch_metric_t metric)
+{
+	uint64_t estimate = UINT64_MAX;
+	int row;
+	for (row = 0; row < OD_SKETCH_DEPTH; row++) {
+		int column = od_sketch_index(key, row);
+		uint64_t counter;
+		counter = sketch->counters[metric][row][column];
+		if (counter < estimate)
+			estimate = counter;
+	}
+	return estimate;
+}
+
+static int
+od_sketch_report_cmp(const void *a_ptr, const void *b_ptr)
+{
+	/* order by queries, then bytes, then connections */
+	static const od_sketch_metric_t order[] = { OD_SKETCH_QUERIES,
+		                                        OD_SKETCH_BYTES,
+		                                        OD_SKETCH_CONNECTIONS };
+	const od_sketch_report_t *a = a_ptr;
+	const od_sketch_report_t *b = b_ptr;
+	size_t i;
+	for (i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+		od_sketch_metric_t metric = order[i];
+		if (a->values[metric] != b->values[metric])
+			return a->values[metric] < b->values[metric] ? 1 : -1;
+	}
+	return 0;
+}
+
+int
+od_sketch_report(od_sketch_t *sketch, od_sketch_report_t *report)
+{
+	/* merge top-K keys of every metric */
+	int count = 0;
+	mm_sleeplock_lock(&sketch->lock);
+	int metric;
+	for (metric = 0; metric < OD_SKETCH_METRIC_MAX; metric++) {
+		int i;
+		for (i = 0; i < sketch->top_count[metric]; i++) {
+			od_sketch_key_t *key = &sketch->top[metric][i].key;
+			int j;
+			for (j = 0; j < count; j++)
+				if (od_sketch_key_cmp(&report[j].key, key))
+					break;
+			if (j < count)
+				continue;
+			report[count].key = *key;
+			count++;
+		}
+	}
+	mm_sleeplock_unlock(&sketch->lock);
+
+	int i;
+	for (i = 0; i < count; i++) {
+		for (metric = 0; metric < OD_SKETCH_METRIC_MAX; metric++)
+			report[i].values[metric] =
+			  od_sketch_estimate(sketch, &report[i].key, metric);
+	}
+	qsort(report, count, sizeof(od_sketch_report_t), od_sketch_report_cmp);
+	return count;
+}
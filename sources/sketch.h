@@ -0,0 +1,124 @@
+#ifndef ODYSSEY_SKETCH_H
+#define ODYSSEY_SKETCH_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Heavy hitters sketch.
+ *
+ * Count-min sketch estimates counters of any key using fixed amount
+ * of memory, min-heap keeps top-K keys for every metric.
+ *
+ * Sketch counters are updated lock-free, top-K heap is updated under
+ * lock only when key estimate is large enough to get into the heap.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sleep_lock.h"
+
+#define OD_SKETCH_DEPTH 4
+#define OD_SKETCH_WIDTH 128
+#define OD_SKETCH_KEY_MAX 64
+
+typedef enum
+{
+	OD_SKETCH_CONNECTIONS,
+	OD_SKETCH_QUERIES,
+	OD_SKETCH_BYTES,
+	OD_SKETCH_METRIC_MAX
+} od_sketch_metric_t;
+
+typedef struct od_sketch_key od_sketch_key_t;
+typedef struct od_sketch_top od_sketch_top_t;
+typedef struct od_sketch_report od_sketch_report_t;
+typedef struct od_sketch od_sketch_t;
+
+struct od_sketch_key
+{
+	uint64_t hash;
+	int len;
+	char value[OD_SKETCH_KEY_MAX];
+};
+
+struct od_sketch_top
+{
+	od_sketch_key_t key;
+	uint64_t count;
+};
+
+struct od_sketch_report
+{
+	od_sketch_key_t key;
+	uint64_t values[OD_SKETCH_METRIC_MAX];
+};
+
+struct od_sketch
+{
+	volatile uint64_t counters[OD_SKETCH_METRIC_MAX][OD_SKETCH_DEPTH]
+	                          [OD_SKETCH_WIDTH];
+	mm_sleeplock_t lock;
+	int top_max;
+	int top_count[OD_SKETCH_METRIC_MAX];
+	od_sketch_top_t *top[OD_SKETCH_METRIC_MAX];
+};
+
+static inline void
+od_sketch_key_init(od_sketch_key_t *key)
+{
+	key->hash     = 0;
+	key->len      = 0;
+	key->value[0] = 0;
+}
+
+static inline void
+od_sketch_key_set(od_sketch_key_t *key, char *value, int len)
+{
+	if (len >= (int)sizeof(key->value))
+		len = sizeof(key->value) - 1;
+	memcpy(key->value, value, len);
+	key->value[len] = 0;
+	key->len        = len;
+
+	/* fnv-1a */
+	uint64_t hash = 14695981039346656037ULL;
+	int i;
+	for (i = 0; i < len; i++) {
+		hash ^= (unsigned char)value[i];
+		hash *= 1099511628211ULL;
+	}
+	key->hash = hash;
+}
+
+static inline int
+od_sketch_key_cmp(od_sketch_key_t *a, od_sketch_key_t *b)
+{
+	return a->hash == b->hash && a->len == b->len &&
+	       memcmp(a->value, b->value, a->len) == 0;
+}
+
+static inline int
+od_sketch_report_max(od_sketch_t *sketch)
+{
+	return sketch->top_max * OD_SKETCH_METRIC_MAX;
+}
+
+od_sketch_t *
+od_sketch_create(int);
+void
+od_sketch_free(od_sketch_t *);
+void
+od_sketch_add(od_sketch_t *, od_sketch_key_t *, od_sketch_metric_t, uint64_t);
+uint64_t
+od_sketch_estimate(od_sketch_t *, od_sketch_key_t *, od_sketch_metric_t);
+int
+od_sketch_report(od_sketch_t *, od_sketch_report_t *);
+
+#endif /* ODYSSEY_SKETCH_H */
@@ -0,0 +1,94 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+od_slab_t od_slabs[OD_SLAB_MAX] = {
+	[OD_SLAB_CLIENT]      = { .size     = sizeof(od_client_t),
+	                          .max_free = OD_SLAB_MAX_FREE },
+	[OD_SLAB_CLIENT_COLD] = { .size     = sizeof(od_client_cold_t),
+	                          .max_free = OD_SLAB_MAX_FREE },
+	[OD_SLAB_SERVER]      = { .size     = sizeof(od_server_t),
+	                          .max_free = OD_SLAB_MAX_FREE },
+	[OD_SLAB_SERVER_COLD] = { .size     = sizeof(od_server_cold_t),
+	                          .max_free = OD_SLAB_MAX_FREE }
+};
+
+void
+od_slab_init(od_slab_t *slab, int size, int max_free)
+{
+	mm_sleeplock_init(&slab->lock);
+	slab->size       = size;
+	slab->max_free   = max_free;
+	slab->free       = NULL;
+	slab->count_free = 0;
+	slab->count_used = 0;
+}
+
+void
+od_slab_free(od_slab_t *slab)
+{
+	mm_sleeplock_lock(&slab->lock);
+	void *ptr        = slab->free;
+	slab->free       = NULL;
+	slab->count_free = 0;
+	mm_sleeplock_unlock(&slab->lock);
+	while (ptr) {
+		void *next = *(void **)ptr;
+		free(ptr);
+		ptr = next;
+	}
+}
+
+void *
+od_slab_alloc(od_slab_t *slab)
+{
+	void *ptr = NULL;
+	mm_sleeplock_lock(&slab->lock);
+	if (slab->free) {
+		ptr        = slab->free;
+		slab->free = *(void **)ptr;
+		slab->count_free--;
+	}
+	slab->count_used++;
+	mm_sleeplock_unlock(&slab->lock);
+	if (ptr)
+		return ptr;
+
+	/* object size is rounded up to the cache line */
+	int size = (slab->size + OD_SLAB_ALIGN - 1) & ~(OD_SLAB_ALIGN - 1);
+	int rc   = posix_memalign(&ptr, OD_SLAB_ALIGN, size);
+	if (rc != 0) {
+		mm_sleeplock_lock(&slab->lock);
+		slab->count_used--;
+		mm_sleeplock_unlock(&slab->lock);
+		return NULL;
+	}
+	return ptr;
+}
+
+void
+od_slab_release(od_slab_t *slab, void *ptr)
+{
+	mm_sleeplock_lock(&slab->lock);
+	slab->count_used--;
+	if (slab->count_free < (uint64_t)slab->max_free) {
+		*(void **)ptr = slab->free;
+		slab->free    = ptr;
+		slab->count_free++;
+		ptr = NULL;
+	}
+	mm_sleeplock_unlock(&slab->lock);
+	if (ptr)
+		free(ptr);
+}
@@ -0,0 +1,88 @@
+#ifndef ODYSSEY_SLAB_H
+#define ODYSSEY_SLAB_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Fixed size object cache.
+ *
+ * Objects are cache line aligned. Released objects are kept in a free
+ * list (up to max_free) and reused by the next allocation, so client
+ * and server objects do not go through malloc on every connect.
+ */
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include "sleep_lock.h"
+
+#define OD_SLAB_ALIGN 64
+#define OD_SLAB_MAX_FREE 1024
+
+typedef enum
+{
+	OD_SLAB_CLIENT,
+	OD_SLAB_CLIENT_COLD,
+	OD_SLAB_SERVER,
+	OD_SLAB_SERVER_COLD,
+	OD_SLAB_MAX
+} od_slab_id_t;
+
+typedef struct od_slab od_slab_t;
+
+struct od_slab
+{
+	mm_sleeplock_t lock;
+	int size;
+	int max_free;
+	void *free;
+	uint64_t count_free;
+	uint64_t count_used;
+};
+
+extern od_slab_t od_slabs[OD_SLAB_MAX];
+
+static inline char *
+od_slab_id_to_str(od_slab_id_t id)
+{
+	switch (id) {
+		case OD_SLAB_CLIENT:
+			return "client";
+		case OD_SLAB_CLIENT_COLD:
+			return "client_cold";
+		case OD_SLAB_SERVER:
+			return "server";
+		case OD_SLAB_SERVER_COLD:
+			return "server_cold";
+		default:
+			break;
+	}
+	return "unknown";
+}
+
+void
+od_slab_init(od_slab_t *, int, int);
+void
+od_slab_free(od_slab_t *);
+void *
+od_slab_alloc(od_slab_t *);
+void
+od_slab_release(od_slab_t *, void *);
+
+static inline void *
+od_slab_alloc_id(od_slab_id_t id)
+{
+	return od_slab_alloc(&od_slabs[id]);
+}
+
+static inline void
+od_slab_release_id(od_slab_id_t id, void *ptr)
+{
+	od_slab_release(&od_slabs[id], ptr);
+}
+
+#endif /* ODYSSEY_SLAB_H */
@@ -0,0 +1,300 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+#define OD_SPOOL_CHUNK 8192
+
+od_spool_stat_t od_spool_stat;
+
+static inline void
+od_spool_buf_free(od_spool_t *spool)
+{
+	if (spool->buf == NULL)
+		return;
+	machine_memory_buf_add(-(int64_t)spool->buf_size);
+	od_atomic_u64_sub(&od_spool_stat.memory, spool->buf_size);
+	free(spool->buf);
+	spool->buf      = NULL;
+	spool->buf_size = 0;
+	spool->buf_pos  = 0;
+	spool->buf_end  = 0;
+}
+
+static inline int
+od_spool_buf_ensure(od_spool_t *spool, int size)
+{
+	if (spool->buf_size >= size)
+		return 0;
+	int buf_size = spool->buf_size > 0 ? spool->buf_size : OD_SPOOL_CHUNK;
+	while (buf_size < size)
+		buf_size *= 2;
+	if (buf_size > spool->memory)
+		buf_size = spool->memory;
+	char *buf = realloc(spool->buf, buf_size);
+	if (buf == NULL)
+		return -1;
+	machine_memory_buf_add(buf_size - spool->buf_size);
+	od_atomic_u64_add(&od_spool_stat.memory, buf_size - spool->buf_size);
+	spool->buf      = buf;
+	spool->buf_size = buf_size;
+	return 0;
+}
+
+static inline char *
+od_spool_reserve(od_spool_t *spool, int size)
+{
+	/* keep order, once spilled new data goes to the file until
+	 * it is read back */
+	if (spool->file_pos != spool->file_end)
+		return NULL;
+
+	/* compact only if less data is moved than freed */
+	int unread = spool->buf_end - spool->buf_pos;
+	if (spool->buf_end + size > spool->memory && spool->buf_pos >= unread) {
+		memmove(spool->buf, spool->buf + spool->buf_pos, unread);
+		spool->buf_pos = 0;
+		spool->buf_end = unread;
+	}
+	if (spool->buf_end + size > spool->memory)
+		return NULL;
+
+	int rc;
+	rc = od_spool_buf_ensure(spool, spool->buf_end + size);
+	if (rc == -1)
+		return NULL;
+	char *pos = spool->buf + spool->buf_end;
+	spool->buf_end += size;
+	return pos;
+}
+
+typedef struct
+{
+	od_spool_t *spool;
+	char *data;
+	int size;
+	int rc;
+} od_spool_task_t;
+
+/* file operations block, so they are run by the machinarium task
+ * pool while the client coroutine waits and the worker goes on */
+static void
+od_spool_spill_task(void *arg)
+{
+	od_spool_task_t *task = arg;
+	od_spool_t *spool     = task->spool;
+	task->rc              = -1;
+	if (spool->fd == -1) {
+		char path[PATH_MAX];
+		snprintf(path,
+		         sizeof(path),
+		         "%s/odyssey.spool.XXXXXX",
+		         spool->dir ? spool->dir : "/tmp");
+		int fd = mkstemp(path);
+		if (fd == -1)
+			return;
+		/* file is removed on close */
+		unlink(path);
+		spool->fd = fd;
+	}
+	int pos = 0;
+	while (pos < task->size) {
+		ssize_t rc;
+		rc = pwrite(spool->fd,
+		            task->data + pos,
+		            task->size - pos,
+		            spool->file_end + pos);
+		if (rc == -1) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		pos += rc;
+	}
+	task->rc = 0;
+}
+
+static void
+od_spool_refill_task(void *arg)
+{
+	od_spool_task_t *task = arg;
+	od_spool_t *spool     = task->spool;
+	task->rc              = -1;
+	int pos               = 0;
+	while (pos < task->size) {
+		ssize_t rc;
+		rc = pread(spool->fd,
+		           task->data + pos,
+		           task->size - pos,
+		           spool->file_pos + pos);
+		if (rc == -1 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			return;
+		pos += rc;
+	}
+	/* file is read back, reuse it from the start */
+	if (spool->file_pos + task->size == spool->file_end &&
+	    ftruncate(spool->fd, 0) == -1)
+		return;
+	task->rc = 0;
+}
+
+static inline int
+od_spool_spill(od_spool_t *spool, char *data, int size)
+{
+	od_spool_task_t task = { spool, data, size, -1 };
+	int rc;
+	rc = machine_task(od_spool_spill_task, &task);
+	if (rc == -1 || task.rc == -1)
+		return -1;
+	spool->file_end += size;
+	od_atomic_u64_add(&od_spool_stat.file, size);
+	return 0;
+}
+
+static inline int
+od_spool_refill(od_spool_t *spool)
+{
+	spool->buf_pos = 0;
+	spool->buf_end = 0;
+
+	uint64_t left = spool->file_end - spool->file_pos;
+	int size      = spool->memory;
+	if (left < (uint64_t)size)
+		size = left;
+	int rc;
+	rc = od_spool_buf_ensure(spool, size);
+	if (rc == -1)
+		return -1;
+
+	od_spool_task_t task = { spool, spool->buf, size, -1 };
+	rc = machine_task(od_spool_refill_task, &task);
+	if (rc == -1 || task.rc == -1)
+		return -1;
+	spool->buf_end = size;
+	spool->file_pos += size;
+	od_atomic_u64_sub(&od_spool_stat.file, size);
+	if (spool->file_pos == spool->file_end) {
+		spool->file_pos = 0;
+		spool->file_end = 0;
+	}
+	return 0;
+}
+
+void
+od_spool_free(od_spool_t *spool)
+{
+	od_spool_buf_free(spool);
+	if (spool->fd != -1) {
+		od_atomic_u64_sub(&od_spool_stat.file,
+		                  spool->file_end - spool->file_pos);
+		close(spool->fd);
+	}
+	od_spool_init(spool);
+}
+
+int
+od_spool_append(od_spool_t *spool, char *data, int size)
+{
+	char *dest = od_spool_reserve(spool, size);
+	if (dest) {
+		memcpy(dest, data, size);
+	} else {
+		int rc;
+		rc = od_spool_spill(spool, data, size);
+		if (rc == -1)
+			return -1;
+	}
+	od_atomic_u64_add(&od_spool_stat.spooled, size);
+	return 0;
+}
+
+int
+od_spool_append_iov(od_spool_t *spool, machine_iov_t *iov)
+{
+	int size   = machine_iov_size(iov);
+	char *dest = od_spool_reserve(spool, size);
+	if (dest) {
+		machine_iov_copy(iov, dest);
+	} else {
+		char *data = malloc(size);
+		if (data == NULL)
+			return -1;
+		machine_iov_copy(iov, data);
+		int rc;
+		rc = od_spool_spill(spool, data, size);
+		free(data);
+		if (rc == -1)
+			return -1;
+	}
+	od_atomic_u64_add(&od_spool_stat.spooled, size);
+	machine_iov_reset(iov);
+	return 0;
+}
+
+int
+od_spool_read(od_spool_t *spool, char **data)
+{
+	if (spool->buf_pos == spool->buf_end &&
+	    spool->file_pos != spool->file_end) {
+		int rc;
+		rc = od_spool_refill(spool);
+		if (rc == -1)
+			return -1;
+	}
+	*data = spool->buf + spool->buf_pos;
+	return spool->buf_end - spool->buf_pos;
+}
+
+void
+od_spool_advance(od_spool_t *spool, int size)
+{
+	spool->buf_pos += size;
+	if (spool->buf_pos < spool->buf_end)
+		return;
+	spool->buf_pos = 0;
+	spool->buf_end = 0;
+	/* do not keep memory of drained spools */
+	if (spool->file_pos == spool->file_end)
+		od_spool_buf_free(spool);
+}
+
+int
+od_spool_write(od_spool_t *spool, machine_io_t *io)
+{
+	int total = 0;
+	while (od_spool_pending(spool) > 0) {
+		char *data;
+		int size;
+		size = od_spool_read(spool, &data);
+		if (size == -1)
+			return -1;
+		ssize_t rc;
+		rc = machine_write_raw(io, data, size);
+		if (rc < 0) {
+			int errno_ = machine_errno();
+			if (errno_ == EAGAIN || errno_ == EWOULDBLOCK || errno_ == EINTR)
+				break;
+			return -1;
+		}
+		od_spool_advance(spool, rc);
+		total += rc;
+		if (rc < size)
+			break;
+	}
+	return total;
+}
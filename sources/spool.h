@@ -0,0 +1,111 @@
+#ifndef ODYSSEY_SPOOL_H
+#define ODYSSEY_SPOOL_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Client output spool.
+ *
+ * Server output a slow client does not accept is copied to the spool,
+ * so that the server relay keeps reading and the server can go back to
+ * the pool on ReadyForQuery. Spooled data is kept in a memory buffer
+ * of up to memory bytes, the rest goes to an unlinked temporary file.
+ * Once the file has data pending all new data is appended to the file,
+ * the memory buffer is refilled from it as the client reads.
+ *
+ * File operations are run by the machinarium task pool (resolver
+ * threads), only the client coroutine waits for them, so spooling
+ * must be done from a coroutine.
+ */
+
+#include <stdint.h>
+
+#include "atomic.h"
+
+typedef struct od_spool_stat od_spool_stat_t;
+typedef struct od_spool od_spool_t;
+
+struct od_spool_stat
+{
+	od_atomic_u64_t memory;
+	od_atomic_u64_t file;
+	od_atomic_u64_t spooled;
+	od_atomic_u64_t released;
+};
+
+struct od_spool
+{
+	char *buf;
+	int buf_size;
+	int buf_pos;
+	int buf_end;
+	int fd;
+	uint64_t file_pos;
+	uint64_t file_end;
+	int memory;
+	uint64_t max;
+	char *dir;
+};
+
+extern od_spool_stat_t od_spool_stat;
+
+static inline void
+od_spool_init(od_spool_t *spool)
+{
+	spool->buf      = NULL;
+	spool->buf_size = 0;
+	spool->buf_pos  = 0;
+	spool->buf_end  = 0;
+	spool->fd       = -1;
+	spool->file_pos = 0;
+	spool->file_end = 0;
+	spool->memory   = 0;
+	spool->max      = 0;
+	spool->dir      = NULL;
+}
+
+static inline void
+od_spool_set(od_spool_t *spool, char *dir, int memory, uint64_t max)
+{
+	spool->dir    = dir;
+	spool->memory = memory;
+	spool->max    = max;
+}
+
+static inline uint64_t
+od_spool_pending(od_spool_t *spool)
+{
+	return (spool->buf_end - spool->buf_pos) +
+	       (spool->file_end - spool->file_pos);
+}
+
+static inline int
+od_spool_fits(od_spool_t *spool, int size)
+{
+	return spool->max == 0 || od_spool_pending(spool) + size <= spool->max;
+}
+
+static inline void
+od_spool_stat_released(void)
+{
+	od_atomic_u64_inc(&od_spool_stat.released);
+}
+
+void
+od_spool_free(od_spool_t *);
+int
+od_spool_append(od_spool_t *, char *, int);
+int
+od_spool_append_iov(od_spool_t *, machine_iov_t *);
+int
+od_spool_read(od_spool_t *, char **);
+void
+od_spool_advance(od_spool_t *, int);
+int
+od_spool_write(od_spool_t *, machine_io_t *);
+
+#endif /* ODYSSEY_SPOOL_H */
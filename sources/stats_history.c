@@ -0,0 +1,62 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+od_stats_history_t *
+od_stats_history_allocate(uint32_t size)
+{
+	assert(size > 0);
+	od_stats_history_t *history;
+	size_t column_size = sizeof(uint32_t) * size;
+	history = malloc(sizeof(*history) + column_size * OD_STATS_HISTORY_MAX);
+	if (history == NULL)
+		return NULL;
+	history->size  = size;
+	history->count = 0;
+	history->head  = 0;
+	od_stat_init(&history->prev);
+	history->prev_time_us = 0;
+
+	/* columns follow the header in the same allocation */
+	char *data = (char *)(history + 1);
+	int i;
+	for (i = 0; i < OD_STATS_HISTORY_MAX; i++)
+		history->columns[i] = (uint32_t *)(data + column_size * i);
+	return history;
+}
+
+void
+od_stats_history_free(od_stats_history_t *history)
+{
+	free(history);
+}
+
+void
+od_stats_history_add(od_stats_history_t *history, uint64_t *values)
+{
+	uint32_t pos = history->head;
+	int i;
+	for (i = 0; i < OD_STATS_HISTORY_MAX; i++) {
+		uint64_t value = values[i];
+		if (value > UINT32_MAX)
+			value = UINT32_MAX;
+		history->columns[i][pos] = value;
+	}
+	history->head = (pos + 1) % history->size;
+	if (history->count < history->size)
+		history->count++;
+}
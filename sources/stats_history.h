@@ -0,0 +1,75 @@
+#ifndef ODYSSEY_STATS_HISTORY_H
+#define ODYSSEY_STATS_HISTORY_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Per route statistics history.
+ *
+ * Cron samples every route once a second into a fixed size ring of
+ * stats_history samples. Samples are stored column by column as
+ * 32-bit values, so the ring costs 4 bytes per column and second.
+ * Rings are written by cron and read by console, both under the
+ * router lock.
+ */
+
+typedef struct od_stats_history od_stats_history_t;
+
+typedef enum
+{
+	OD_STATS_HISTORY_TIME,
+	OD_STATS_HISTORY_TPS,
+	OD_STATS_HISTORY_QPS,
+	OD_STATS_HISTORY_TX_TIME,
+	OD_STATS_HISTORY_QUERY_TIME,
+	OD_STATS_HISTORY_RECV_CLIENT,
+	OD_STATS_HISTORY_RECV_SERVER,
+	OD_STATS_HISTORY_CLIENTS,
+	OD_STATS_HISTORY_SERVERS_ACTIVE,
+	OD_STATS_HISTORY_SERVERS_IDLE,
+	OD_STATS_HISTORY_QUEUE,
+	OD_STATS_HISTORY_TX_P50,
+	OD_STATS_HISTORY_TX_P99,
+	OD_STATS_HISTORY_QUERY_P50,
+	OD_STATS_HISTORY_QUERY_P99,
+	OD_STATS_HISTORY_MAX
+} od_stats_history_column_t;
+
+struct od_stats_history
+{
+	uint32_t size;
+	uint32_t count;
+	uint32_t head;
+	od_stat_t prev;
+	uint64_t prev_time_us;
+	uint32_t *columns[OD_STATS_HISTORY_MAX];
+};
+
+od_stats_history_t *
+od_stats_history_allocate(uint32_t);
+void
+od_stats_history_free(od_stats_history_t *);
+void
+od_stats_history_add(od_stats_history_t *, uint64_t *);
+
+/* ring position of the n-th sample, oldest first */
+static inline uint32_t
+od_stats_history_pos(od_stats_history_t *history, uint32_t n)
+{
+	return (history->head + history->size - history->count + n) %
+	       history->size;
+}
+
+static inline uint32_t
+od_stats_history_of(od_stats_history_t *history,
+                    od_stats_history_column_t column,
+                    uint32_t n)
+{
+	return history->columns[column][od_stats_history_pos(history, n)];
+}
+
+#endif /* ODYSSEY_STATS_HISTORY_H */
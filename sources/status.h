@@ -24,6 +24,8 @@ typedef enum
 	OD_ECLIENT_READ,
 	OD_ECLIENT_WRITE,
 	OD_ESYNC_BROKEN,
+	OD_ETHROTTLED,
+	OD_FRONTEND_STATUS_MAX
 } od_frontend_status_t;
 
 static inline char *
@@ -60,6 +62,10 @@ od_frontend_status_to_str(od_frontend_status_t status)
 			return "OD_ECLIENT_WRITE";
 		case OD_ESYNC_BROKEN:
 			return "OD_ESYNC_BROKEN";
+		case OD_ETHROTTLED:
+			return "OD_ETHROTTLED";
+		case OD_FRONTEND_STATUS_MAX:
+			break;
 	}
 	return "unkonown";
 }
@@ -74,6 +80,7 @@ static const od_frontend_status_t od_frontend_status_errs[] = {
 	OD_ECLIENT_WRITE,
 	OD_ECLIENT_READ,
 	OD_ESYNC_BROKEN,
+	OD_ETHROTTLED,
 };
 
 #define OD_FRONTEND_STATUS_ERRORS_TYPES_COUNT                                  \
@@ -99,6 +106,9 @@ typedef enum
 	OD_ROUTER_ERROR_LIMIT_ROUTE,
 	OD_ROUTER_ERROR_TIMEDOUT,
 	OD_ROUTER_ERROR_REPLICATION,
+	OD_ROUTER_ERROR_THROTTLED,
+	OD_ROUTER_ERROR_SHED,
+	OD_ROUTER_STATUS_MAX
 } od_router_status_t;
 
 static inline char *
@@ -119,6 +129,10 @@ od_router_status_to_str(od_router_status_t status)
 			return "OD_ROUTER_ERROR_TIMEDOUT";
 		case OD_ROUTER_ERROR_REPLICATION:
 			return "OD_ROUTER_ERROR_REPLICATION";
+		case OD_ROUTER_ERROR_THROTTLED:
+			return "OD_ROUTER_ERROR_THROTTLED";
+		case OD_ROUTER_ERROR_SHED:
+			return "OD_ROUTER_ERROR_SHED";
 		default:
 			return "unkonown";
 	}
@@ -121,6 +121,7 @@ od_system_server(void *arg)
 			continue;
 		}
 		od_id_generate(&client->id, "c");
+		od_probe1(client__accept, client->id.id);
 		rc = od_io_prepare(&client->io, client_io, instance->config.readahead);
 		if (rc == -1) {
 			od_error(&instance->logger,
@@ -430,8 +431,46 @@ od_system_config_reload(od_system_t *system)
 	}
 
 	rc = od_rules_validate(&rules, &config, &instance->logger);
+
+	int workers = instance->config.workers;
+	if (config.workers > instance->config.workers_max)
+		od_error(&instance->logger,
+		         "config",
+		         NULL,
+		         NULL,
+		         "workers %d exceeds workers_max %d set on start",
+		         config.workers,
+		         instance->config.workers_max);
+
+	/* stats segment is switched to the new path by cron */
+	char *shm_path = instance->config.stats_shm_path;
+	if ((shm_path == NULL) != (config.stats_shm_path == NULL) ||
+	    (shm_path && strcmp(shm_path, config.stats_shm_path) != 0)) {
+		od_cron_shm_reload(system->global->cron, config.stats_shm_path);
+		instance->config.stats_shm_path = config.stats_shm_path;
+		config.stats_shm_path           = shm_path;
+	}
 	od_config_reload(&instance->config, &config);
 
+	/* apply new number of workers, started or retired by cron */
+	if (instance->config.workers != workers) {
+		od_worker_pool_t *worker_pool = system->global->worker_pool;
+		if (od_worker_pool_resize(worker_pool, instance->config.workers) == -1)
+			od_error(&instance->logger,
+			         "config",
+			         NULL,
+			         NULL,
+			         "workers can not be changed without restart, "
+			         "unless workers_max is set");
+		else
+			od_log(&instance->logger,
+			       "config",
+			       NULL,
+			       NULL,
+			       "scaling to %d workers",
+			       instance->config.workers);
+	}
+
 	/* Reload TLS certificates */
 	od_list_t *i;
 	od_list_foreach(&router->servers, i)
@@ -466,6 +505,9 @@ od_system_config_reload(od_system_t *system)
 	int updates;
 	updates = od_router_reconfigure(router, &rules);
 
+	/* passwords might have changed, forget derived keys */
+	od_scram_cache_reset();
+
 	/* free unused rules */
 	od_rules_free(&rules);
 
@@ -492,8 +534,22 @@ od_system(void *arg)
 
 	/* start worker threads */
 	od_worker_pool_t *worker_pool = system->global->worker_pool;
-	rc                            = od_worker_pool_start(
-      worker_pool, system->global, instance->config.workers);
+
+	rc = od_worker_pool_start(worker_pool,
+	                          system->global,
+	                          instance->config.workers,
+	                          instance->config.workers_max);
+	if (rc == -1)
+		return;
+
+	/* start cancel dispatcher thread */
+	rc = od_cancel_dispatcher_start(system->global->cancel_dispatcher,
+	                                system->global);
+	if (rc == -1)
+		return;
+
+	/* start LISTEN/NOTIFY relay thread */
+	rc = od_notify_relay_start(system->global->notify_relay, system->global);
 	if (rc == -1)
 		return;
 
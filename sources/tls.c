@@ -62,7 +62,7 @@ od_tls_frontend_accept(od_client_t *client,
                        od_config_listen_t *config,
                        machine_tls_t *tls)
 {
-	if (client->startup.is_ssl_request) {
+	if (client->cold->startup.is_ssl_request) {
 		od_debug(logger, "tls", client, NULL, "ssl request");
 
 		int rc;
@@ -121,7 +121,7 @@ od_tls_frontend_accept(od_client_t *client,
 	}
 
 	/* Client sends cancel request without encryption */
-	if (client->startup.is_cancel)
+	if (client->cold->startup.is_cancel)
 		return 0;
 
 	switch (config->tls_mode) {
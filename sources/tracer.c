@@ -0,0 +1,337 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+#define OD_TRACER_BUF_SIZE   8192
+#define OD_TRACER_QUEUE_SIZE (1 << 20)
+
+typedef struct
+{
+	char *data;
+	int size;
+	int pos;
+} od_tracer_buf_t;
+
+typedef struct
+{
+	char *name;
+	od_trace_phase_t start;
+	od_trace_phase_t end;
+} od_tracer_span_t;
+
+/* child spans, each one is emitted only if both phases are reached */
+static od_tracer_span_t od_tracer_spans[] = {
+	{ "pool_wait", OD_TRACE_QUEUE_ENTER, OD_TRACE_SERVER_ATTACHED },
+	{ "deploy", OD_TRACE_DEPLOY_SENT, OD_TRACE_DEPLOY_ACKED },
+	{ "server_first_byte", OD_TRACE_SERVER_WRITE, OD_TRACE_SERVER_READ },
+	{ "server_execute", OD_TRACE_SERVER_WRITE, OD_TRACE_READY },
+	{ "client_write", OD_TRACE_READY, OD_TRACE_CLIENT_FLUSH },
+	{ "reset", OD_TRACE_CLIENT_FLUSH, OD_TRACE_DETACH },
+};
+
+void
+od_tracer_init(od_tracer_t *tracer)
+{
+	tracer->fd          = -1;
+	tracer->sample_rate = 0;
+	tracer->buf         = NULL;
+	tracer->buf_pos     = 0;
+	tracer->flush_buf   = NULL;
+	tracer->dropped     = 0;
+	pthread_mutex_init(&tracer->lock, NULL);
+}
+
+int
+od_tracer_open(od_tracer_t *tracer, char *path, int sample_rate)
+{
+	tracer->buf       = malloc(OD_TRACER_QUEUE_SIZE);
+	tracer->flush_buf = malloc(OD_TRACER_QUEUE_SIZE);
+	if (tracer->buf == NULL || tracer->flush_buf == NULL)
+		return -1;
+	int fd;
+	fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	if (fd == -1)
+		return -1;
+	tracer->fd          = fd;
+	tracer->sample_rate = sample_rate;
+	return 0;
+}
+
+static inline int
+od_tracer_write(int fd, char *data, int size)
+{
+	int pos = 0;
+	while (pos < size) {
+		ssize_t rc = write(fd, data + pos, size - pos);
+		if (rc == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		pos += rc;
+	}
+	return 0;
+}
+
+void
+od_tracer_close(od_tracer_t *tracer)
+{
+	/* write out what is left, nothing is traced afterwards */
+	pthread_mutex_lock(&tracer->lock);
+	if (tracer->fd != -1) {
+		od_tracer_write(tracer->fd, tracer->buf, tracer->buf_pos);
+		close(tracer->fd);
+	}
+	tracer->fd = -1;
+	free(tracer->buf);
+	free(tracer->flush_buf);
+	tracer->buf       = NULL;
+	tracer->flush_buf = NULL;
+	tracer->buf_pos   = 0;
+	pthread_mutex_unlock(&tracer->lock);
+}
+
+typedef struct
+{
+	int fd;
+	char *data;
+	int size;
+	int rc;
+} od_tracer_task_t;
+
+static void
+od_tracer_flush_task(void *arg)
+{
+	od_tracer_task_t *task = arg;
+	task->rc = od_tracer_write(task->fd, task->data, task->size);
+}
+
+/*
+ * Write buffered records by the resolver thread pool. Called by cron
+ * only, which owns flush buffer. Returns number of records dropped
+ * since the previous flush because of full buffer.
+ */
+uint64_t
+od_tracer_flush(od_tracer_t *tracer)
+{
+	pthread_mutex_lock(&tracer->lock);
+	if (tracer->fd == -1 || tracer->buf_pos == 0) {
+		pthread_mutex_unlock(&tracer->lock);
+		return 0;
+	}
+	od_tracer_task_t task = { tracer->fd, tracer->buf, tracer->buf_pos, 0 };
+	uint64_t dropped = tracer->dropped;
+	tracer->buf       = tracer->flush_buf;
+	tracer->flush_buf = task.data;
+	tracer->buf_pos   = 0;
+	tracer->dropped   = 0;
+	pthread_mutex_unlock(&tracer->lock);
+
+	machine_task(od_tracer_flush_task, &task);
+	return dropped;
+}
+
+void
+od_tracer_begin(od_tracer_t *tracer, od_trace_t *trace)
+{
+	if (od_likely(tracer->fd == -1))
+		return;
+	if (trace->state != OD_TRACE_IDLE)
+		return;
+	if (machine_lrand48() % tracer->sample_rate != 0) {
+		trace->state = OD_TRACE_SKIPPED;
+		return;
+	}
+	trace->state = OD_TRACE_ACTIVE;
+	trace->start = od_trace_now();
+	memset(trace->time, 0, sizeof(trace->time));
+}
+
+static inline void
+od_tracer_printf(od_tracer_buf_t *buf, char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	buf->pos +=
+	  od_vsnprintf(buf->data + buf->pos, buf->size - buf->pos, fmt, args);
+	va_end(args);
+}
+
+static inline void
+od_tracer_escape(od_tracer_buf_t *buf, char *value, int len)
+{
+	int i;
+	for (i = 0; i < len && buf->pos < buf->size - 8; i++) {
+		unsigned char c = value[i];
+		if (c == '"' || c == '\\') {
+			buf->data[buf->pos++] = '\\';
+			buf->data[buf->pos++] = c;
+		} else if (c < 0x20) {
+			buf->pos += od_snprintf(
+			  buf->data + buf->pos, buf->size - buf->pos, "\\u%04x", c);
+		} else {
+			buf->data[buf->pos++] = c;
+		}
+	}
+}
+
+static inline void
+od_tracer_id(char *dest, int bytes)
+{
+	static const char *hex = "0123456789abcdef";
+	int i;
+	for (i = 0; i < bytes; i++) {
+		int value       = machine_lrand48() & 0xff;
+		dest[i * 2]     = hex[value >> 4];
+		dest[i * 2 + 1] = hex[value & 0x0f];
+	}
+	dest[bytes * 2] = 0;
+}
+
+static inline void
+od_tracer_attr(od_tracer_buf_t *buf, char *name, char *value, int len)
+{
+	od_tracer_printf(buf, "{\"key\":\"%s\",\"value\":{\"stringValue\":\"", name);
+	od_tracer_escape(buf, value, len);
+	od_tracer_printf(buf, "\"}}");
+}
+
+static inline void
+od_tracer_span(od_tracer_buf_t *buf,
+               char *trace_id,
+               char *parent_id,
+               char *name,
+               uint64_t start,
+               uint64_t end)
+{
+	char span_id[17];
+	od_tracer_id(span_id, 8);
+	od_tracer_printf(buf,
+	                 ",{\"traceId\":\"%s\",\"spanId\":\"%s\","
+	                 "\"parentSpanId\":\"%s\",\"name\":\"%s\",\"kind\":1,"
+	                 "\"startTimeUnixNano\":\"%" PRIu64 "\","
+	                 "\"endTimeUnixNano\":\"%" PRIu64 "\"}",
+	                 trace_id,
+	                 span_id,
+	                 parent_id,
+	                 name,
+	                 start,
+	                 end);
+}
+
+void
+od_tracer_end(od_tracer_t *tracer,
+              od_trace_t *trace,
+              od_id_t *client_id,
+              od_id_t *server_id,
+              char *database,
+              char *user)
+{
+	if (od_likely(trace->state != OD_TRACE_ACTIVE)) {
+		trace->state = OD_TRACE_IDLE;
+		return;
+	}
+	trace->state = OD_TRACE_IDLE;
+
+	/* transaction ends at the last reached phase */
+	uint64_t end = trace->start;
+	int i;
+	for (i = 0; i < OD_TRACE_MAX; i++)
+		if (trace->time[i] > end)
+			end = trace->time[i];
+
+	char data[OD_TRACER_BUF_SIZE];
+	od_tracer_buf_t buf = { .data = data, .size = sizeof(data), .pos = 0 };
+
+	char trace_id[33];
+	char root_id[17];
+	od_tracer_id(trace_id, 16);
+	od_tracer_id(root_id, 8);
+
+	od_tracer_printf(&buf,
+	                 "{\"resourceSpans\":[{\"resource\":{\"attributes\":["
+	                 "{\"key\":\"service.name\",\"value\":{\"stringValue\":"
+	                 "\"odyssey\"}}]},\"scopeSpans\":[{\"scope\":{\"name\":"
+	                 "\"odyssey\"},\"spans\":[");
+
+	/* root span */
+	od_tracer_printf(&buf,
+	                 "{\"traceId\":\"%s\",\"spanId\":\"%s\","
+	                 "\"name\":\"transaction\",\"kind\":2,"
+	                 "\"startTimeUnixNano\":\"%" PRIu64 "\","
+	                 "\"endTimeUnixNano\":\"%" PRIu64 "\",\"attributes\":[",
+	                 trace_id,
+	                 root_id,
+	                 trace->start,
+	                 end);
+	od_tracer_attr(&buf, "db.name", database, strlen(database));
+	od_tracer_printf(&buf, ",");
+	od_tracer_attr(&buf, "db.user", user, strlen(user));
+	od_tracer_printf(&buf, ",");
+	od_tracer_attr(
+	  &buf, "odyssey.client_id", client_id->id, sizeof(client_id->id));
+	if (server_id) {
+		od_tracer_printf(&buf, ",");
+		od_tracer_attr(
+		  &buf, "odyssey.server_id", server_id->id, sizeof(server_id->id));
+	}
+	od_tracer_printf(&buf, "],\"events\":[");
+	int events = 0;
+	for (i = 0; i < OD_TRACE_MAX; i++) {
+		if (trace->time[i] == 0)
+			continue;
+		od_tracer_printf(&buf,
+		                 "%s{\"timeUnixNano\":\"%" PRIu64 "\",\"name\":\"%s\"}",
+		                 events > 0 ? "," : "",
+		                 trace->time[i],
+		                 od_trace_phase_to_str(i));
+		events++;
+	}
+	od_tracer_printf(&buf, "]}");
+
+	/* phase spans */
+	size_t j;
+	for (j = 0; j < sizeof(od_tracer_spans) / sizeof(od_tracer_spans[0]); j++) {
+		od_tracer_span_t *span = &od_tracer_spans[j];
+		uint64_t start         = trace->time[span->start];
+		uint64_t stop          = trace->time[span->end];
+		if (start == 0 || stop == 0 || stop < start)
+			continue;
+		od_tracer_span(&buf, trace_id, root_id, span->name, start, stop);
+	}
+
+	od_tracer_printf(&buf, "]}]}]}\n");
+
+	/* drop truncated record */
+	if (buf.pos >= buf.size - 1)
+		return;
+
+	pthread_mutex_lock(&tracer->lock);
+	if (tracer->fd != -1) {
+		if (tracer->buf_pos + buf.pos <= OD_TRACER_QUEUE_SIZE) {
+			memcpy(tracer->buf + tracer->buf_pos, buf.data, buf.pos);
+			tracer->buf_pos += buf.pos;
+		} else {
+			tracer->dropped++;
+		}
+	}
+	pthread_mutex_unlock(&tracer->lock);
+}
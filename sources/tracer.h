@@ -0,0 +1,148 @@
+#ifndef ODYSSEY_TRACER_H
+#define ODYSSEY_TRACER_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Sampled transaction tracing.
+ *
+ * Every sampled transaction records wall clock time of its phases and
+ * is written to trace_file as a single line of OTLP JSON
+ * (ExportTraceServiceRequest), one root span per transaction with
+ * child spans per phase. Records are buffered in memory and written
+ * out by cron.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "id.h"
+
+typedef enum
+{
+	OD_TRACE_QUEUE_ENTER,
+	OD_TRACE_SERVER_ATTACHED,
+	OD_TRACE_DEPLOY_SENT,
+	OD_TRACE_DEPLOY_ACKED,
+	OD_TRACE_SERVER_WRITE,
+	OD_TRACE_SERVER_READ,
+	OD_TRACE_READY,
+	OD_TRACE_CLIENT_FLUSH,
+	OD_TRACE_DETACH,
+	OD_TRACE_MAX
+} od_trace_phase_t;
+
+typedef enum
+{
+	OD_TRACE_IDLE,
+	OD_TRACE_ACTIVE,
+	OD_TRACE_SKIPPED
+} od_trace_state_t;
+
+typedef struct od_trace od_trace_t;
+typedef struct od_tracer od_tracer_t;
+
+struct od_trace
+{
+	od_trace_state_t state;
+	uint64_t start;
+	uint64_t time[OD_TRACE_MAX];
+};
+
+struct od_tracer
+{
+	int fd;
+	int sample_rate;
+	pthread_mutex_t lock;
+	char *buf;
+	int buf_pos;
+	char *flush_buf;
+	uint64_t dropped;
+};
+
+static inline void
+od_trace_init(od_trace_t *trace)
+{
+	trace->state = OD_TRACE_IDLE;
+	trace->start = 0;
+}
+
+static inline uint64_t
+od_trace_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void
+od_trace_mark(od_trace_t *trace, od_trace_phase_t phase)
+{
+	if (trace->state != OD_TRACE_ACTIVE)
+		return;
+	if (trace->time[phase] == 0)
+		trace->time[phase] = od_trace_now();
+}
+
+static inline int
+od_trace_is_marked(od_trace_t *trace, od_trace_phase_t phase)
+{
+	return trace->state == OD_TRACE_ACTIVE && trace->time[phase] != 0;
+}
+
+/* transaction is over for not sampled trace */
+static inline void
+od_trace_skip_end(od_trace_t *trace)
+{
+	if (trace->state == OD_TRACE_SKIPPED)
+		trace->state = OD_TRACE_IDLE;
+}
+
+static inline char *
+od_trace_phase_to_str(od_trace_phase_t phase)
+{
+	switch (phase) {
+		case OD_TRACE_QUEUE_ENTER:
+			return "queue_enter";
+		case OD_TRACE_SERVER_ATTACHED:
+			return "server_attached";
+		case OD_TRACE_DEPLOY_SENT:
+			return "deploy_sent";
+		case OD_TRACE_DEPLOY_ACKED:
+			return "deploy_acked";
+		case OD_TRACE_SERVER_WRITE:
+			return "first_byte_to_server";
+		case OD_TRACE_SERVER_READ:
+			return "first_byte_from_server";
+		case OD_TRACE_READY:
+			return "ready_for_query";
+		case OD_TRACE_CLIENT_FLUSH:
+			return "client_flush";
+		case OD_TRACE_DETACH:
+			return "detach";
+		default:
+			break;
+	}
+	return "unknown";
+}
+
+void
+od_tracer_init(od_tracer_t *);
+int
+od_tracer_open(od_tracer_t *, char *, int);
+void
+od_tracer_close(od_tracer_t *);
+void
+od_tracer_begin(od_tracer_t *, od_trace_t *);
+void
+od_tracer_end(od_tracer_t *, od_trace_t *, od_id_t *, od_id_t *, char *, char *);
+uint64_t
+od_tracer_flush(od_tracer_t *);
+
+#endif /* ODYSSEY_TRACER_H */
@@ -0,0 +1,38 @@
+#ifndef ODYSSEY_USDT_H
+#define ODYSSEY_USDT_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * USDT static tracepoints (provider "odyssey").
+ *
+ * Probes are compiled in only when sys/sdt.h is available, each probe
+ * is a single nop instruction until a tracer attaches to it.
+ * See documentation/tracing.md for probes list and arguments.
+ */
+
+#include "sources/build.h"
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define od_probe1(NAME, A1) DTRACE_PROBE1(odyssey, NAME, A1)
+#define od_probe2(NAME, A1, A2) DTRACE_PROBE2(odyssey, NAME, A1, A2)
+#define od_probe3(NAME, A1, A2, A3) DTRACE_PROBE3(odyssey, NAME, A1, A2, A3)
+#define od_probe4(NAME, A1, A2, A3, A4)                                        \
+	DTRACE_PROBE4(odyssey, NAME, A1, A2, A3, A4)
+#define od_probe5(NAME, A1, A2, A3, A4, A5)                                    \
+	DTRACE_PROBE5(odyssey, NAME, A1, A2, A3, A4, A5)
+#else
+#define od_probe1(NAME, A1)
+#define od_probe2(NAME, A1, A2)
+#define od_probe3(NAME, A1, A2, A3)
+#define od_probe4(NAME, A1, A2, A3, A4)
+#define od_probe5(NAME, A1, A2, A3, A4, A5)
+#endif
+
+#endif /* ODYSSEY_USDT_H */
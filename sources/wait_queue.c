@@ -0,0 +1,406 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <math.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+od_wait_queue_t *
+od_wait_queue_allocate(char *storage)
+{
+	od_wait_queue_t *queue = malloc(sizeof(od_wait_queue_t));
+	if (queue == NULL)
+		return NULL;
+	queue->storage = strdup(storage);
+	if (queue->storage == NULL) {
+		free(queue);
+		return NULL;
+	}
+	pthread_mutex_init(&queue->lock, NULL);
+	od_list_init(&queue->waiters);
+	od_list_init(&queue->link);
+	queue->count          = 0;
+	queue->active         = 0;
+	queue->target_us      = 0;
+	queue->interval_us    = 0;
+	queue->paused         = 0;
+	queue->epoch          = 0;
+	queue->dropping       = 0;
+	queue->drop_count     = 0;
+	queue->drop_next_us   = 0;
+	queue->first_above_us = 0;
+	return queue;
+}
+
+void
+od_wait_queue_free(od_wait_queue_t *queue)
+{
+	assert(od_list_empty(&queue->waiters));
+	pthread_mutex_destroy(&queue->lock);
+	free(queue->storage);
+	free(queue);
+}
+
+void
+od_wait_queue_configure(od_wait_queue_t *queue, int target_ms, int interval_ms)
+{
+	pthread_mutex_lock(&queue->lock);
+	queue->target_us   = (uint64_t)target_ms * 1000;
+	queue->interval_us = (uint64_t)interval_ms * 1000;
+	pthread_mutex_unlock(&queue->lock);
+}
+
+static inline void
+od_wait_queue_insert(od_wait_queue_t *queue, od_waiter_t *waiter)
+{
+	/* higher priority first, arrival order within the same priority */
+	od_list_t *i;
+	od_list_foreach(&queue->waiters, i)
+	{
+		od_waiter_t *next = od_container_of(i, od_waiter_t, link);
+		if (waiter->priority > next->priority)
+			break;
+		if (waiter->priority == next->priority &&
+		    waiter->time_us < next->time_us)
+			break;
+	}
+	od_list_append(i, &waiter->link);
+	queue->count++;
+}
+
+static inline void
+od_wait_queue_unlink(od_wait_queue_t *queue, od_waiter_t *waiter)
+{
+	od_list_unlink(&waiter->link);
+	od_list_init(&waiter->link);
+	queue->count--;
+}
+
+static inline void
+od_wait_queue_signal(od_wait_queue_t *queue,
+                     od_waiter_t *waiter,
+                     od_waiter_state_t state)
+{
+	od_wait_queue_unlink(queue, waiter);
+	waiter->state = state;
+	if (state == OD_WAITER_SHED && waiter->count_shed)
+		od_atomic_u64_inc(waiter->count_shed);
+	machine_msg_t *msg;
+	msg = machine_msg_create(0);
+	if (msg == NULL)
+		return;
+	machine_channel_write(waiter->channel, msg);
+}
+
+static inline uint64_t
+od_wait_queue_control_law(od_wait_queue_t *queue, uint64_t time_us)
+{
+	return time_us + queue->interval_us / sqrt(queue->drop_count);
+}
+
+/*
+ * CoDel drop decision, made every time a waiter leaves the queue or
+ * wakes up on its own. The sojourn time is the waiting time of that
+ * waiter.
+ */
+static inline int
+od_wait_queue_codel(od_wait_queue_t *queue, uint64_t sojourn_us, uint64_t now)
+{
+	if (queue->target_us == 0 || queue->interval_us == 0)
+		return 0;
+
+	int ok_to_drop = 0;
+	if (sojourn_us < queue->target_us) {
+		queue->first_above_us = 0;
+	} else if (queue->first_above_us == 0) {
+		queue->first_above_us = now + queue->interval_us;
+	} else if (now >= queue->first_above_us) {
+		ok_to_drop = 1;
+	}
+
+	if (queue->dropping) {
+		if (!ok_to_drop) {
+			queue->dropping = 0;
+			return 0;
+		}
+		if (now < queue->drop_next_us)
+			return 0;
+		queue->drop_count++;
+		queue->drop_next_us =
+		  od_wait_queue_control_law(queue, queue->drop_next_us);
+		return 1;
+	}
+
+	if (!ok_to_drop)
+		return 0;
+
+	/* restart from the previous drop rate if dropping stopped recently */
+	queue->dropping = 1;
+	if (queue->drop_count > 2 &&
+	    now - queue->drop_next_us < 16 * queue->interval_us)
+		queue->drop_count -= 2;
+	else
+		queue->drop_count = 1;
+	queue->drop_next_us = od_wait_queue_control_law(queue, now);
+	return 1;
+}
+
+static inline void
+od_wait_queue_shed(od_wait_queue_t *queue)
+{
+	/* waiters held by pause are not shed */
+	od_list_t *i;
+	for (i = queue->waiters.prev; i != &queue->waiters; i = i->prev) {
+		od_waiter_t *tail = od_container_of(i, od_waiter_t, link);
+		if (tail->kind == OD_WAITER_PAUSE)
+			continue;
+		od_wait_queue_signal(queue, tail, OD_WAITER_SHED);
+		return;
+	}
+}
+
+static inline int
+od_waiter_prepare(od_waiter_t *waiter)
+{
+	if (waiter->channel == NULL) {
+		/* waiters are woken up by other workers */
+		waiter->channel = machine_channel_create(1);
+		if (waiter->channel == NULL)
+			return -1;
+	}
+	/* requeued waiters keep their place */
+	waiter->state = OD_WAITER_WAIT;
+	if (waiter->time_us == 0)
+		waiter->time_us = machine_time_us();
+	return 0;
+}
+
+int
+od_wait_queue_add(od_wait_queue_t *queue, od_waiter_t *waiter)
+{
+	int rc;
+	rc = od_waiter_prepare(waiter);
+	if (rc == -1)
+		return -1;
+	pthread_mutex_lock(&queue->lock);
+	od_wait_queue_insert(queue, waiter);
+	pthread_mutex_unlock(&queue->lock);
+	return 0;
+}
+
+void
+od_wait_queue_remove(od_wait_queue_t *queue, od_waiter_t *waiter)
+{
+	pthread_mutex_lock(&queue->lock);
+	if (waiter->state == OD_WAITER_WAIT)
+		od_wait_queue_unlink(queue, waiter);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+od_waiter_state_t
+od_wait_queue_wait(od_wait_queue_t *queue,
+                   od_waiter_t *waiter,
+                   uint32_t time_ms)
+{
+	uint64_t deadline = UINT64_MAX;
+	if (time_ms != UINT32_MAX)
+		deadline = waiter->time_us + (uint64_t)time_ms * 1000;
+
+	for (;;) {
+		/* wake up every interval to shed waiters, even if no server is
+		 * returned to the pool */
+		uint64_t now     = machine_time_us();
+		uint64_t wait_us = deadline > now ? deadline - now : 0;
+		uint64_t tick_us = queue->interval_us;
+		if (tick_us > 0 && tick_us < wait_us)
+			wait_us = tick_us;
+		uint32_t wait_ms = UINT32_MAX;
+		if (wait_us < (uint64_t)UINT32_MAX * 1000)
+			wait_ms = (wait_us + 999) / 1000;
+
+		machine_msg_t *msg;
+		msg = machine_channel_read(waiter->channel, wait_ms);
+		if (msg) {
+			machine_msg_free(msg);
+			return waiter->state;
+		}
+
+		pthread_mutex_lock(&queue->lock);
+		if (waiter->state != OD_WAITER_WAIT) {
+			/* signalled right after the read timed out */
+			pthread_mutex_unlock(&queue->lock);
+			msg = machine_channel_read(waiter->channel, 0);
+			if (msg)
+				machine_msg_free(msg);
+			return waiter->state;
+		}
+		now = machine_time_us();
+		if (waiter->kind != OD_WAITER_PAUSE &&
+		    od_wait_queue_codel(queue, now - waiter->time_us, now)) {
+			od_wait_queue_shed(queue);
+			if (waiter->state == OD_WAITER_SHED) {
+				pthread_mutex_unlock(&queue->lock);
+				msg = machine_channel_read(waiter->channel, 0);
+				if (msg)
+					machine_msg_free(msg);
+				return OD_WAITER_SHED;
+			}
+		}
+		if (now >= deadline) {
+			od_wait_queue_unlink(queue, waiter);
+			pthread_mutex_unlock(&queue->lock);
+			return OD_WAITER_WAIT;
+		}
+		pthread_mutex_unlock(&queue->lock);
+	}
+}
+
+static inline void
+od_wait_queue_dequeue(od_wait_queue_t *queue,
+                      od_waiter_kind_t kind,
+                      void *owner)
+{
+	uint64_t now = machine_time_us();
+	for (;;) {
+		od_waiter_t *match = NULL;
+		od_list_t *i;
+		od_list_foreach(&queue->waiters, i)
+		{
+			od_waiter_t *waiter = od_container_of(i, od_waiter_t, link);
+			if (waiter->kind != kind)
+				continue;
+			if (kind == OD_WAITER_SLOT || waiter->owner == owner) {
+				match = waiter;
+				break;
+			}
+		}
+		if (match == NULL) {
+			/* released slot is returned to the queue */
+			if (kind == OD_WAITER_SLOT)
+				queue->active--;
+			return;
+		}
+		if (od_wait_queue_codel(queue, now - match->time_us, now)) {
+			od_wait_queue_shed(queue);
+			if (match->state == OD_WAITER_SHED)
+				continue;
+		}
+		od_wait_queue_signal(queue, match, OD_WAITER_WAKE);
+		return;
+	}
+}
+
+void
+od_wait_queue_wake(od_wait_queue_t *queue, void *owner)
+{
+	pthread_mutex_lock(&queue->lock);
+	od_wait_queue_dequeue(queue, OD_WAITER_SERVER, owner);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+int
+od_wait_queue_try_acquire(od_wait_queue_t *queue, int max)
+{
+	int rc = -1;
+	pthread_mutex_lock(&queue->lock);
+	if (queue->active < max) {
+		queue->active++;
+		rc = 0;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return rc;
+}
+
+od_waiter_state_t
+od_wait_queue_acquire(od_wait_queue_t *queue,
+                      od_waiter_t *waiter,
+                      int max,
+                      uint32_t time_ms)
+{
+	int prepared = 0;
+	pthread_mutex_lock(&queue->lock);
+	for (;;) {
+		if (queue->active < max) {
+			queue->active++;
+			pthread_mutex_unlock(&queue->lock);
+			return OD_WAITER_WAKE;
+		}
+		if (prepared)
+			break;
+		pthread_mutex_unlock(&queue->lock);
+		int rc;
+		rc = od_waiter_prepare(waiter);
+		if (rc == -1)
+			return OD_WAITER_WAIT;
+		prepared = 1;
+		pthread_mutex_lock(&queue->lock);
+	}
+
+	/* slot is handed over by od_wait_queue_release() */
+	od_wait_queue_insert(queue, waiter);
+	pthread_mutex_unlock(&queue->lock);
+
+	return od_wait_queue_wait(queue, waiter, time_ms);
+}
+
+void
+od_wait_queue_release(od_wait_queue_t *queue)
+{
+	pthread_mutex_lock(&queue->lock);
+	od_wait_queue_dequeue(queue, OD_WAITER_SLOT, NULL);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+od_waiter_state_t
+od_wait_queue_hold(od_wait_queue_t *queue,
+                   od_waiter_t *waiter,
+                   uint32_t time_ms)
+{
+	/* fast path, pause is rechecked under the lock */
+	if (!queue->paused)
+		return OD_WAITER_WAKE;
+
+	int rc;
+	rc = od_waiter_prepare(waiter);
+	if (rc == -1)
+		return OD_WAITER_WAIT;
+
+	pthread_mutex_lock(&queue->lock);
+	if (!queue->paused) {
+		pthread_mutex_unlock(&queue->lock);
+		return OD_WAITER_WAKE;
+	}
+	od_wait_queue_insert(queue, waiter);
+	pthread_mutex_unlock(&queue->lock);
+
+	return od_wait_queue_wait(queue, waiter, time_ms);
+}
+
+void
+od_wait_queue_pause(od_wait_queue_t *queue)
+{
+	pthread_mutex_lock(&queue->lock);
+	queue->paused = 1;
+	pthread_mutex_unlock(&queue->lock);
+}
+
+void
+od_wait_queue_resume(od_wait_queue_t *queue)
+{
+	pthread_mutex_lock(&queue->lock);
+	queue->paused = 0;
+	od_list_t *i, *n;
+	od_list_foreach_safe(&queue->waiters, i, n)
+	{
+		od_waiter_t *waiter = od_container_of(i, od_waiter_t, link);
+		if (waiter->kind == OD_WAITER_PAUSE)
+			od_wait_queue_signal(queue, waiter, OD_WAITER_WAKE);
+	}
+	pthread_mutex_unlock(&queue->lock);
+}
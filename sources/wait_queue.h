@@ -0,0 +1,140 @@
+#ifndef ODYSSEY_WAIT_QUEUE_H
+#define ODYSSEY_WAIT_QUEUE_H
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Storage wait queue.
+ *
+ * Clients waiting for a server of any route of a storage share one
+ * queue, ordered by rule pool_priority and then by arrival. A server
+ * returned to a route wakes the first waiter of that route, a released
+ * storage slot (server_max_active) is handed to the first slot waiter.
+ *
+ * Queue delay is controlled CoDel-style. Once waiting time stays above
+ * server_queue_target for server_queue_interval, waiters are shed from
+ * the queue tail (lowest priority, latest arrival) at an increasing
+ * rate, until waiting time drops below the target again.
+ *
+ * A paused storage holds new transactions in the queue, until it is
+ * resumed. Held waiters are never shed. Servers connected before the
+ * storage was retargeted are recognized by the queue epoch.
+ */
+
+typedef struct od_waiter od_waiter_t;
+typedef struct od_wait_queue od_wait_queue_t;
+
+typedef enum
+{
+	OD_WAITER_WAIT,
+	OD_WAITER_WAKE,
+	OD_WAITER_SHED
+} od_waiter_state_t;
+
+typedef enum
+{
+	OD_WAITER_SERVER,
+	OD_WAITER_SLOT,
+	OD_WAITER_PAUSE
+} od_waiter_kind_t;
+
+struct od_waiter
+{
+	od_waiter_state_t state;
+	void *owner;
+	int priority;
+	od_waiter_kind_t kind;
+	uint64_t time_us;
+	od_atomic_u64_t *count_shed;
+	machine_channel_t *channel;
+	od_list_t link;
+};
+
+struct od_wait_queue
+{
+	char *storage;
+	pthread_mutex_t lock;
+	od_list_t waiters;
+	int count;
+	int active;
+	uint64_t target_us;
+	uint64_t interval_us;
+	int paused;
+	od_atomic_u32_t epoch;
+	/* CoDel state */
+	int dropping;
+	uint32_t drop_count;
+	uint64_t drop_next_us;
+	uint64_t first_above_us;
+	od_list_t link;
+};
+
+static inline void
+od_waiter_init(od_waiter_t *waiter,
+               void *owner,
+               int priority,
+               od_waiter_kind_t kind,
+               od_atomic_u64_t *count_shed)
+{
+	waiter->state      = OD_WAITER_WAIT;
+	waiter->owner      = owner;
+	waiter->priority   = priority;
+	waiter->kind       = kind;
+	waiter->time_us    = 0;
+	waiter->count_shed = count_shed;
+	waiter->channel    = NULL;
+	od_list_init(&waiter->link);
+}
+
+static inline void
+od_waiter_free(od_waiter_t *waiter)
+{
+	if (waiter->channel)
+		machine_channel_free(waiter->channel);
+	waiter->channel = NULL;
+}
+
+od_wait_queue_t *
+od_wait_queue_allocate(char *);
+void
+od_wait_queue_free(od_wait_queue_t *);
+void
+od_wait_queue_configure(od_wait_queue_t *, int, int);
+int
+od_wait_queue_add(od_wait_queue_t *, od_waiter_t *);
+void
+od_wait_queue_remove(od_wait_queue_t *, od_waiter_t *);
+od_waiter_state_t
+od_wait_queue_wait(od_wait_queue_t *, od_waiter_t *, uint32_t);
+void
+od_wait_queue_wake(od_wait_queue_t *, void *);
+int
+od_wait_queue_try_acquire(od_wait_queue_t *, int);
+od_waiter_state_t
+od_wait_queue_acquire(od_wait_queue_t *, od_waiter_t *, int, uint32_t);
+void
+od_wait_queue_release(od_wait_queue_t *);
+od_waiter_state_t
+od_wait_queue_hold(od_wait_queue_t *, od_waiter_t *, uint32_t);
+void
+od_wait_queue_pause(od_wait_queue_t *);
+void
+od_wait_queue_resume(od_wait_queue_t *);
+
+static inline int
+od_wait_queue_paused(od_wait_queue_t *queue)
+{
+	return queue->paused;
+}
+
+static inline uint32_t
+od_wait_queue_epoch(od_wait_queue_t *queue)
+{
+	return od_atomic_u32_of(&queue->epoch);
+}
+
+#endif /* ODYSSEY_WAIT_QUEUE_H */
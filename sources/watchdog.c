@@ -8,6 +8,7 @@
 #include "kiwi.h"
 #include <sys/shm.h>
 
+#include "tracer.h"
 #include "instance.h"
 #include "debugprintf.h"
 #include "setproctitle.h"
@@ -18,6 +18,44 @@
 #include <kiwi.h>
 #include <odyssey.h>
 
+static __thread od_worker_t *od_worker_self = NULL;
+
+static void
+od_worker_client(void *arg)
+{
+	od_worker_t *worker = od_worker_self;
+	od_frontend(arg);
+
+	/* wake up retiring worker after its last client is gone */
+	uint32_t clients = od_atomic_u32_dec(&worker->clients) - 1;
+	if (worker->retiring && clients == 0) {
+		machine_msg_t *msg;
+		msg = machine_msg_create(0);
+		if (msg == NULL)
+			return;
+		machine_msg_set_type(msg, OD_MSG_RETIRE);
+		machine_channel_write(worker->task_channel, msg);
+	}
+}
+
+static inline void
+od_worker_load(od_worker_t *worker)
+{
+	uint64_t time_us = machine_time_us();
+	uint64_t wait_us;
+	machine_loop_stat(&wait_us);
+	uint64_t interval = time_us - worker->load_time_us;
+	uint64_t idle     = wait_us - worker->load_wait_us;
+	if (worker->load_time_us > 0 && interval > 0) {
+		uint32_t load = 0;
+		if (idle < interval)
+			load = (interval - idle) * 100 / interval;
+		__sync_lock_test_and_set(&worker->load, load);
+	}
+	worker->load_time_us = time_us;
+	worker->load_wait_us = wait_us;
+}
+
 static inline void
 od_worker(void *arg)
 {
@@ -25,6 +63,9 @@ od_worker(void *arg)
 	od_instance_t *instance = worker->global->instance;
 	od_router_t *router     = worker->global->router;
 
+	od_worker_self = worker;
+	od_worker_load(worker);
+
 	for (;;) {
 		machine_msg_t *msg;
 		msg = machine_channel_read(worker->task_channel, UINT32_MAX);
@@ -39,9 +80,12 @@ od_worker(void *arg)
 				client         = *(od_client_t **)machine_msg_data(msg);
 				client->global = worker->global;
 
+				od_atomic_u32_inc(&worker->clients);
 				int64_t coroutine_id;
-				coroutine_id = machine_coroutine_create(od_frontend, client);
+				coroutine_id =
+				  machine_coroutine_create(od_worker_client, client);
 				if (coroutine_id == -1) {
+					od_atomic_u32_dec(&worker->clients);
 					od_error(&instance->logger,
 					         "worker",
 					         client,
@@ -70,32 +114,74 @@ od_worker(void *arg)
 				             &msg_cache_count,
 				             &msg_cache_gc_count,
 				             &msg_cache_size);
-				od_log(&instance->logger,
-				       "stats",
-				       NULL,
-				       NULL,
-				       "worker[%d]: msg (%" PRIu64 " allocated, %" PRIu64
-				       " cached, %" PRIu64 " freed, %" PRIu64 " cache_size), "
-				       "coroutines (%" PRIu64 " active, %" PRIu64
-				       " cached), clients_processed: %" PRIu64,
-				       worker->id,
-				       msg_allocated,
-				       msg_cache_count,
-				       msg_cache_gc_count,
-				       msg_cache_size,
-				       count_coroutine,
-				       count_coroutine_cache,
-				       worker->clients_processed);
+				if (instance->config.log_stats)
+					od_log(&instance->logger,
+					       "stats",
+					       NULL,
+					       NULL,
+					       "worker[%d]: msg (%" PRIu64 " allocated, %" PRIu64
+					       " cached, %" PRIu64 " freed, %" PRIu64
+					       " cache_size), "
+					       "coroutines (%" PRIu64 " active, %" PRIu64
+					       " cached), clients_processed: %" PRIu64,
+					       worker->id,
+					       msg_allocated,
+					       msg_cache_count,
+					       msg_cache_gc_count,
+					       msg_cache_size,
+					       count_coroutine,
+					       count_coroutine_cache,
+					       worker->clients_processed);
+
+				/* publish into shared memory segment */
+				od_cron_t *cron = worker->global->cron;
+				pthread_mutex_lock(&cron->shm_lock);
+				if (od_shm_stats_is_open(&cron->shm_stats)) {
+					od_shm_stats_worker_t *slot;
+					slot = od_shm_stats_worker_of(cron->shm_stats.header,
+					                              worker->id);
+					od_shm_stats_write_begin(&slot->seq);
+					slot->update_time_us        = od_shm_stats_time_us();
+					slot->clients_processed     = worker->clients_processed;
+					slot->msg_allocated         = msg_allocated;
+					slot->msg_cache_count       = msg_cache_count;
+					slot->msg_cache_gc_count    = msg_cache_gc_count;
+					slot->msg_cache_size        = msg_cache_size;
+					slot->count_coroutine       = count_coroutine;
+					slot->count_coroutine_cache = count_coroutine_cache;
+					od_shm_stats_write_end(&slot->seq);
+				}
+				pthread_mutex_unlock(&cron->shm_lock);
 				break;
 			}
+			case OD_MSG_LOAD:
+				od_worker_load(worker);
+				break;
+			case OD_MSG_RETIRE:
+				worker->retiring = 1;
+				break;
 			default:
 				assert(0);
 				break;
 		}
 
 		machine_msg_free(msg);
+
+		/* retired worker stops once drained */
+		if (worker->retiring && od_atomic_u32_of(&worker->clients) == 0)
+			break;
 	}
 
+	if (worker->retiring) {
+		od_log(&instance->logger,
+		       "worker",
+		       NULL,
+		       NULL,
+		       "worker[%d] retired",
+		       worker->id);
+		od_worker_set_state(worker, OD_WORKER_STOPPED);
+		return;
+	}
 	od_log(&instance->logger, "worker", NULL, NULL, "stopped");
 }
 
@@ -106,6 +192,13 @@ od_worker_init(od_worker_t *worker, od_global_t *global, int id)
 	worker->id                = id;
 	worker->global            = global;
 	worker->clients_processed = 0;
+	worker->task_channel      = NULL;
+	worker->state             = OD_WORKER_IDLE;
+	worker->clients           = 0;
+	worker->load              = 0;
+	worker->load_time_us      = 0;
+	worker->load_wait_us      = 0;
+	worker->retiring          = 0;
 }
 
 int
@@ -151,5 +244,6 @@ od_worker_start(od_worker_t *worker)
 			return -1;
 		}
 	}
+	od_worker_set_state(worker, OD_WORKER_RUNNING);
 	return 0;
 }
@@ -7,17 +7,67 @@
  * Scalable PostgreSQL connection pooler.
  */
 
+/*
+ * Worker machine.
+ *
+ * A retired worker gets no new clients. It stops once its last client
+ * disconnects, then the slot is reclaimed by cron.
+ */
+
 typedef struct od_worker od_worker_t;
 
+typedef enum
+{
+	OD_WORKER_IDLE,
+	OD_WORKER_RUNNING,
+	OD_WORKER_DRAINING,
+	OD_WORKER_STOPPED
+} od_worker_state_t;
+
 struct od_worker
 {
 	int64_t machine;
 	int id;
 	machine_channel_t *task_channel;
 	uint64_t clients_processed;
+	od_atomic_u32_t state;
+	od_atomic_u32_t clients;
+	/* event loop utilisation in percent, sampled by cron */
+	od_atomic_u32_t load;
+	uint64_t load_time_us;
+	uint64_t load_wait_us;
+	int retiring;
 	od_global_t *global;
 };
 
+static inline od_worker_state_t
+od_worker_state(od_worker_t *worker)
+{
+	return od_atomic_u32_of(&worker->state);
+}
+
+static inline void
+od_worker_set_state(od_worker_t *worker, od_worker_state_t state)
+{
+	__sync_lock_test_and_set(&worker->state, state);
+}
+
+static inline char *
+od_worker_state_name(od_worker_state_t state)
+{
+	switch (state) {
+		case OD_WORKER_IDLE:
+			return "idle";
+		case OD_WORKER_RUNNING:
+			return "running";
+		case OD_WORKER_DRAINING:
+			return "draining";
+		case OD_WORKER_STOPPED:
+			return "stopped";
+	}
+	return "unknown";
+}
+
 void
 od_worker_init(od_worker_t *, od_global_t *, int);
 int
@@ -0,0 +1,226 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+
+static inline int
+od_worker_pool_add(od_worker_pool_t *pool, od_global_t *global)
+{
+	od_instance_t *instance = global->instance;
+
+	/* reuse the lowest free slot, slots of draining workers are busy
+	 * until they stop */
+	int id;
+	for (id = 0; id < pool->capacity; id++)
+		if (od_worker_state(&pool->pool[id]) == OD_WORKER_IDLE)
+			break;
+	if (id == pool->capacity)
+		return -1;
+
+	od_worker_t *worker = &pool->pool[id];
+	od_worker_init(worker, global, id);
+	int rc;
+	rc = od_worker_start(worker);
+	if (rc == -1)
+		return -1;
+	if (id >= pool->count)
+		pool->count = id + 1;
+	pool->active++;
+
+	od_log(&instance->logger, "worker", NULL, NULL, "worker[%d] started", id);
+	return 0;
+}
+
+static inline int
+od_worker_pool_retire(od_worker_pool_t *pool)
+{
+	/* retire the running worker with the highest id */
+	od_worker_t *worker = NULL;
+	int i;
+	for (i = pool->count - 1; i >= 0; i--) {
+		if (od_worker_state(&pool->pool[i]) == OD_WORKER_RUNNING) {
+			worker = &pool->pool[i];
+			break;
+		}
+	}
+	if (worker == NULL)
+		return -1;
+
+	machine_msg_t *msg;
+	msg = machine_msg_create(0);
+	if (msg == NULL)
+		return -1;
+	machine_msg_set_type(msg, OD_MSG_RETIRE);
+
+	od_instance_t *instance = worker->global->instance;
+	od_log(&instance->logger,
+	       "worker",
+	       NULL,
+	       NULL,
+	       "worker[%d] retiring, %" PRIu32 " clients left",
+	       worker->id,
+	       od_atomic_u32_of(&worker->clients));
+
+	/* no new clients are fed to the worker from now on, retire message
+	 * follows clients already queued to it */
+	od_worker_set_state(worker, OD_WORKER_DRAINING);
+	machine_channel_write(worker->task_channel, msg);
+	pool->active--;
+	return 0;
+}
+
+static inline void
+od_worker_pool_reap(od_worker_pool_t *pool)
+{
+	int i;
+	for (i = 0; i < pool->count; i++) {
+		od_worker_t *worker = &pool->pool[i];
+		if (od_worker_state(worker) != OD_WORKER_STOPPED)
+			continue;
+		machine_wait(worker->machine);
+		machine_channel_free(worker->task_channel);
+		worker->task_channel = NULL;
+		worker->machine      = -1;
+		od_worker_set_state(worker, OD_WORKER_IDLE);
+	}
+	while (pool->count > 0 &&
+	       od_worker_state(&pool->pool[pool->count - 1]) == OD_WORKER_IDLE)
+		pool->count--;
+}
+
+static inline void
+od_worker_pool_autoscale(od_worker_pool_t *pool, od_config_t *config)
+{
+	od_instance_t *instance = pool->pool->global->instance;
+
+	/* average event loop utilisation of running workers, sampled
+	 * on the previous tick */
+	uint32_t load = 0;
+	int i;
+	for (i = 0; i < pool->count; i++) {
+		od_worker_t *worker = &pool->pool[i];
+		if (od_worker_state(worker) == OD_WORKER_RUNNING)
+			load += od_atomic_u32_of(&worker->load);
+	}
+	if (pool->active > 0)
+		load /= pool->active;
+
+	/* load must stay beyond the threshold for the whole interval */
+	if (load >= (uint32_t)config->workers_scale_up)
+		pool->scale_ticks = pool->scale_ticks > 0 ? pool->scale_ticks + 1 : 1;
+	else if (load <= (uint32_t)config->workers_scale_down)
+		pool->scale_ticks = pool->scale_ticks < 0 ? pool->scale_ticks - 1 : -1;
+	else
+		pool->scale_ticks = 0;
+
+	int target = od_atomic_u32_of(&pool->target);
+	if (pool->scale_ticks >= config->workers_scale_interval &&
+	    target < config->workers_max) {
+		target++;
+	} else if (pool->scale_ticks <= -config->workers_scale_interval &&
+	           target > config->workers_min) {
+		/* do not retire a worker if the rest would be overloaded */
+		if (pool->active > 1 &&
+		    load * pool->active / (pool->active - 1) <
+		      (uint32_t)config->workers_scale_up)
+			target--;
+	}
+	if (target != (int)od_atomic_u32_of(&pool->target)) {
+		od_log(&instance->logger,
+		       "worker",
+		       NULL,
+		       NULL,
+		       "workers load %" PRIu32 "%%, scaling to %d workers",
+		       load,
+		       target);
+		__sync_lock_test_and_set(&pool->target, target);
+		pool->scale_ticks = 0;
+	}
+
+	/* request next load sample */
+	for (i = 0; i < pool->count; i++) {
+		od_worker_t *worker = &pool->pool[i];
+		if (od_worker_state(worker) != OD_WORKER_RUNNING)
+			continue;
+		machine_msg_t *msg;
+		msg = machine_msg_create(0);
+		if (msg == NULL)
+			return;
+		machine_msg_set_type(msg, OD_MSG_LOAD);
+		machine_channel_write(worker->task_channel, msg);
+	}
+}
+
+int
+od_worker_pool_start(od_worker_pool_t *pool,
+                     od_global_t *global,
+                     int count,
+                     int capacity)
+{
+	pool->pool = malloc(sizeof(od_worker_t) * capacity);
+	if (pool->pool == NULL)
+		return -1;
+	pool->capacity = capacity;
+	pool->target   = count;
+	int i;
+	for (i = 0; i < capacity; i++)
+		od_worker_init(&pool->pool[i], global, i);
+	for (i = 0; i < count; i++) {
+		int rc;
+		rc = od_worker_pool_add(pool, global);
+		if (rc == -1)
+			return -1;
+	}
+	return 0;
+}
+
+int
+od_worker_pool_resize(od_worker_pool_t *pool, int count)
+{
+	if (pool->capacity <= 1 || count < 1 || count > pool->capacity)
+		return -1;
+	__sync_lock_test_and_set(&pool->target, count);
+	return 0;
+}
+
+void
+od_worker_pool_scale(od_worker_pool_t *pool)
+{
+	if (pool->pool == NULL || pool->capacity <= 1)
+		return;
+	od_global_t *global     = pool->pool->global;
+	od_instance_t *instance = global->instance;
+
+	od_worker_pool_reap(pool);
+
+	if (instance->config.workers_auto)
+		od_worker_pool_autoscale(pool, &instance->config);
+
+	int target = od_atomic_u32_of(&pool->target);
+	while (pool->active < target) {
+		/* retry on the next tick, if all free slots are still
+		 * taken by draining workers */
+		int rc;
+		rc = od_worker_pool_add(pool, global);
+		if (rc == -1)
+			break;
+	}
+	while (pool->active > target) {
+		int rc;
+		rc = od_worker_pool_retire(pool);
+		if (rc == -1)
+			break;
+	}
+}
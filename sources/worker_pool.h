@@ -7,6 +7,15 @@
  * Scalable PostgreSQL connection pooler.
  */
 
+/*
+ * Worker pool.
+ *
+ * Slots for workers_max workers are allocated on start, so workers
+ * can be added and retired at runtime. Target number of workers is
+ * set by reload, console or by utilisation of worker event loops, and
+ * is applied by cron, which runs in the same machine as the acceptor.
+ */
+
 typedef struct od_worker_pool od_worker_pool_t;
 
 struct od_worker_pool
@@ -14,6 +23,10 @@ struct od_worker_pool
 	od_worker_t *pool;
 	int round_robin;
 	int count;
+	int capacity;
+	int active;
+	od_atomic_u32_t target;
+	int scale_ticks;
 };
 
 static inline void
@@ -22,26 +35,18 @@ od_worker_pool_init(od_worker_pool_t *pool)
 	pool->count       = 0;
 	pool->round_robin = 0;
 	pool->pool        = NULL;
+	pool->capacity    = 0;
+	pool->active      = 0;
+	pool->target      = 0;
+	pool->scale_ticks = 0;
 }
 
-static inline int
-od_worker_pool_start(od_worker_pool_t *pool, od_global_t *global, int count)
-{
-	pool->pool = malloc(sizeof(od_worker_t) * count);
-	if (pool->pool == NULL)
-		return -1;
-	pool->count = count;
-	int i;
-	for (i = 0; i < count; i++) {
-		od_worker_t *worker = &pool->pool[i];
-		od_worker_init(worker, global, i);
-		int rc;
-		rc = od_worker_start(worker);
-		if (rc == -1)
-			return -1;
-	}
-	return 0;
-}
+int
+od_worker_pool_start(od_worker_pool_t *, od_global_t *, int, int);
+int
+od_worker_pool_resize(od_worker_pool_t *, int);
+void
+od_worker_pool_scale(od_worker_pool_t *);
 
 static inline void
 od_worker_pool_stop(od_worker_pool_t *pool)
@@ -54,6 +59,8 @@ od_worker_pool_stop(od_worker_pool_t *pool)
 
 	for (int i = 0; i < pool->count; i++) {
 		od_worker_t *worker = &pool->pool[i];
+		if (od_worker_state(worker) == OD_WORKER_IDLE)
+			continue;
 		machine_stop(worker->machine);
 	}
 }
@@ -93,6 +100,8 @@ od_worker_pool_wait_gracefully_shutdown(od_worker_pool_t *pool)
 	//	machine_sleep(1);
 	for (int i = 0; i < pool->count; i++) {
 		od_worker_t *worker = &pool->pool[i];
+		if (od_worker_state(worker) == OD_WORKER_IDLE)
+			continue;
 		machine_wait(worker->machine);
 	}
 }
@@ -100,15 +109,20 @@ od_worker_pool_wait_gracefully_shutdown(od_worker_pool_t *pool)
 static inline void
 od_worker_pool_feed(od_worker_pool_t *pool, machine_msg_t *msg)
 {
-	int next = pool->round_robin;
-	if (pool->round_robin >= pool->count) {
-		pool->round_robin = 0;
-		next              = 0;
-	}
-	pool->round_robin++;
-
+	/* skip retired workers, at least one worker is always running */
 	od_worker_t *worker;
-	worker = &pool->pool[next];
+	for (;;) {
+		int next = pool->round_robin;
+		if (pool->round_robin >= pool->count) {
+			pool->round_robin = 0;
+			next              = 0;
+		}
+		pool->round_robin++;
+
+		worker = &pool->pool[next];
+		if (od_worker_state(worker) == OD_WORKER_RUNNING)
+			break;
+	}
 	machine_channel_write(worker->task_channel, msg);
 }
 
@@ -0,0 +1,208 @@
+
+/*
+ * Odyssey.
+ *
+ * Scalable PostgreSQL connection pooler.
+ */
+
+/*
+ * Authentication hashing microbenchmark.
+ *
+ * Measures cost of md5 password hashing and of SCRAM salted password
+ * derivation, both by generic HMAC loop, which recomputes HMAC pads on
+ * every round, and by OpenSSL PBKDF2, used by odyssey.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include <kiwi.h>
+
+#define BENCH_KEY_LEN 32
+
+static int bench_count      = 1000;
+static int bench_iterations = 4096;
+
+static char bench_password[] = "password";
+static char bench_user[]     = "user";
+static char bench_salt[]     = "0123456789abcdef";
+
+static inline uint64_t
+bench_time_us(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000ULL + t.tv_nsec / 1000;
+}
+
+static void
+bench_report(char *name, int count, uint64_t time_us)
+{
+	if (time_us == 0)
+		time_us = 1;
+	printf("%-16s %10d ops %10.2f us/op %12.0f ops/sec\n",
+	       name,
+	       count,
+	       (double)time_us / count,
+	       count * 1000000.0 / time_us);
+}
+
+static int
+bench_md5(void)
+{
+	char salt[4]   = { 1, 2, 3, 4 };
+	int count      = bench_count * 1000;
+	uint64_t start = bench_time_us();
+	int i;
+	for (i = 0; i < count; i++) {
+		kiwi_password_t pw;
+		kiwi_password_init(&pw);
+		int rc;
+		rc = kiwi_password_md5(&pw,
+		                       bench_user,
+		                       sizeof(bench_user) - 1,
+		                       bench_password,
+		                       sizeof(bench_password) - 1,
+		                       salt);
+		kiwi_password_free(&pw);
+		if (rc == -1)
+			return -1;
+	}
+	bench_report("md5", count, bench_time_us() - start);
+	return 0;
+}
+
+/* Hi() as defined by RFC 5802, HMAC is initialized on every round */
+static int
+bench_pbkdf2_generic(uint8_t *result)
+{
+	uint8_t block[sizeof(bench_salt) - 1 + 4];
+	memcpy(block, bench_salt, sizeof(bench_salt) - 1);
+	memcpy(block + sizeof(bench_salt) - 1, "\0\0\0\1", 4);
+
+	uint8_t u[BENCH_KEY_LEN];
+	if (HMAC(EVP_sha256(),
+	         bench_password,
+	         sizeof(bench_password) - 1,
+	         block,
+	         sizeof(block),
+	         u,
+	         NULL) == NULL)
+		return -1;
+	memcpy(result, u, BENCH_KEY_LEN);
+	int i;
+	for (i = 1; i < bench_iterations; i++) {
+		if (HMAC(EVP_sha256(),
+		         bench_password,
+		         sizeof(bench_password) - 1,
+		         u,
+		         sizeof(u),
+		         u,
+		         NULL) == NULL)
+			return -1;
+		int j;
+		for (j = 0; j < BENCH_KEY_LEN; j++)
+			result[j] ^= u[j];
+	}
+	return 0;
+}
+
+static int
+bench_pbkdf2_openssl(uint8_t *result)
+{
+	int rc;
+	rc = PKCS5_PBKDF2_HMAC(bench_password,
+	                       sizeof(bench_password) - 1,
+	                       (const unsigned char *)bench_salt,
+	                       sizeof(bench_salt) - 1,
+	                       bench_iterations,
+	                       EVP_sha256(),
+	                       BENCH_KEY_LEN,
+	                       result);
+	return rc == 1 ? 0 : -1;
+}
+
+static int
+bench_pbkdf2(void)
+{
+	uint8_t generic[BENCH_KEY_LEN];
+	uint8_t openssl[BENCH_KEY_LEN];
+
+	uint64_t start = bench_time_us();
+	int i;
+	for (i = 0; i < bench_count; i++)
+		if (bench_pbkdf2_generic(generic) == -1)
+			return -1;
+	bench_report("pbkdf2 generic", bench_count, bench_time_us() - start);
+
+	start = bench_time_us();
+	for (i = 0; i < bench_count; i++)
+		if (bench_pbkdf2_openssl(openssl) == -1)
+			return -1;
+	bench_report("pbkdf2 openssl", bench_count, bench_time_us() - start);
+
+	if (memcmp(generic, openssl, BENCH_KEY_LEN) != 0) {
+		fprintf(stderr, "error: salted password mismatch\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int
+bench_hmac(void)
+{
+	char message[] = "n=user,r=nonce,r=nonce,s=salt,i=4096,c=biws,r=nonce";
+	uint8_t key[BENCH_KEY_LEN];
+	memset(key, 'k', sizeof(key));
+	uint8_t result[BENCH_KEY_LEN];
+	int count      = bench_count * 100;
+	uint64_t start = bench_time_us();
+	int i;
+	for (i = 0; i < count; i++) {
+		if (HMAC(EVP_sha256(),
+		         key,
+		         sizeof(key),
+		         (const unsigned char *)message,
+		         sizeof(message) - 1,
+		         result,
+		         NULL) == NULL)
+			return -1;
+	}
+	bench_report("hmac-sha-256", count, bench_time_us() - start);
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int opt;
+	while ((opt = getopt(argc, argv, "n:i:")) != -1) {
+		switch (opt) {
+			/* number of operations */
+			case 'n':
+				bench_count = atoi(optarg);
+				break;
+			/* scram iterations */
+			case 'i':
+				bench_iterations = atoi(optarg);
+				break;
+			default:
+				printf("odyssey auth benchmark.\n\n");
+				printf("usage: %s [-n operations] [-i iterations]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (bench_count <= 0 || bench_iterations <= 0)
+		return 1;
+
+	if (bench_md5() == -1 || bench_hmac() == -1 || bench_pbkdf2() == -1)
+		return 1;
+	return 0;
+}
@@ -45,6 +45,13 @@ static stress_t stress;
 static od_histogram_t stress_histogram;
 static int stress_run;
 
+/* client-visible downtime: errors, lost connections and the longest
+ * time no query of any client completed */
+static int stress_errors;
+static int stress_disconnects;
+static int stress_last_done;
+static int stress_max_stall;
+
 static inline void
 stress_client_main(void *arg)
 {
@@ -153,18 +160,26 @@ stress_client_main(void *arg)
 				printf("client %d: read error: %s\n",
 				       client->id,
 				       machine_error(client->io.io));
+				stress_disconnects++;
 				return;
 			}
 			char type = *(char *)machine_msg_data(msg);
 			machine_msg_free(msg);
 
-			if (type == KIWI_BE_ERROR_RESPONSE)
-				break;
+			if (type == KIWI_BE_ERROR_RESPONSE) {
+				stress_errors++;
+				continue;
+			}
 
 			if (type == KIWI_BE_READY_FOR_QUERY) {
-				int execution_time = od_histogram_time_us() - start_time;
+				int done_time      = od_histogram_time_us();
+				int execution_time = done_time - start_time;
 				od_histogram_add(&stress_histogram, execution_time);
 				client->processed++;
+				if (stress_last_done &&
+				    done_time - stress_last_done > stress_max_stall)
+					stress_max_stall = done_time - stress_last_done;
+				stress_last_done = done_time;
 				break;
 			}
 		}
@@ -223,6 +238,9 @@ stress_main(void *arg)
 
 	/* result */
 	od_histogram_print(&stress_histogram, stress->clients, stress->time_to_run);
+	printf("errors            : %d\n", stress_errors);
+	printf("disconnects       : %d\n", stress_disconnects);
+	printf("max stall         : %d usec\n", stress_max_stall);
 }
 
 int
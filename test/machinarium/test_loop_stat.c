@@ -0,0 +1,43 @@
+
+#include <machinarium.h>
+#include <odyssey_test.h>
+
+static void
+test_coroutine(void *arg)
+{
+	(void)arg;
+	uint64_t start;
+	machine_loop_stat(&start);
+
+	/* sleeping machine waits in poll */
+	machine_sleep(100);
+	uint64_t wait_us;
+	machine_loop_stat(&wait_us);
+	test(wait_us - start >= 90 * 1000);
+
+	/* busy machine does not */
+	machine_loop_stat(&start);
+	uint64_t time_us = machine_time_us();
+	while (machine_time_us() - time_us < 50 * 1000)
+		machine_sleep(0);
+	machine_loop_stat(&wait_us);
+	test(wait_us - start < 25 * 1000);
+
+	machine_stop_current();
+}
+
+void
+machinarium_test_loop_stat(void)
+{
+	machinarium_init();
+
+	int id;
+	id = machine_create("test", test_coroutine, NULL);
+	test(id != -1);
+
+	int rc;
+	rc = machine_wait(id);
+	test(rc != -1);
+
+	machinarium_free();
+}
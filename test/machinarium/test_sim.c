@@ -0,0 +1,104 @@
+
+#include <machinarium.h>
+#include <odyssey_test.h>
+
+static uint64_t woken[3];
+static int woken_count = 0;
+
+static void
+test_sleeper(void *arg)
+{
+	uint32_t time_ms = *(uint32_t *)arg;
+	machine_sleep(time_ms);
+	woken[woken_count++] = machine_time_ms();
+}
+
+static void
+test_ready(void *arg)
+{
+	machine_io_t *io = arg;
+	machine_sleep(50);
+	int rc;
+	rc = machine_sim_ready(io, MACHINE_SIM_READ);
+	test(rc == 0);
+}
+
+static void
+test_sim(void *arg)
+{
+	(void)arg;
+
+	/* virtual time passes only by timers */
+	uint64_t start = machine_time_ms();
+	test(start != 0);
+	int i;
+	for (i = 0; i < 10; i++)
+		machine_sleep(1000);
+	test(machine_time_ms() == start + 10000);
+
+	int rc;
+	rc = machine_sim_advance(500);
+	test(rc == 0);
+	test(machine_time_ms() == start + 10500);
+
+	/* timers fire in order at exact time */
+	uint32_t intervals[3] = { 300, 100, 200 };
+	int64_t coroutines[3];
+	start = machine_time_ms();
+	for (i = 0; i < 3; i++) {
+		coroutines[i] = machine_coroutine_create(test_sleeper, &intervals[i]);
+		test(coroutines[i] != -1);
+	}
+	for (i = 0; i < 3; i++)
+		machine_join(coroutines[i]);
+	test(woken_count == 3);
+	test(woken[0] == start + 100);
+	test(woken[1] == start + 200);
+	test(woken[2] == start + 300);
+
+	/* scripted readiness */
+	machine_io_t *io = machine_io_create();
+	test(io != NULL);
+	rc = machine_eventfd(io);
+	test(rc == 0);
+	rc = machine_io_attach(io);
+	test(rc == 0);
+	machine_cond_t *cond = machine_cond_create();
+	test(cond != NULL);
+	rc = machine_read_start(io, cond);
+	test(rc == 0);
+
+	start = machine_time_ms();
+	int64_t id;
+	id = machine_coroutine_create(test_ready, io);
+	test(id != -1);
+	rc = machine_cond_wait(cond, 1000);
+	test(rc == 0);
+	test(machine_time_ms() == start + 50);
+	machine_join(id);
+
+	machine_read_stop(io);
+	machine_close(io);
+	machine_io_free(io);
+	machine_cond_free(cond);
+
+	machine_stop_current();
+}
+
+void
+machinarium_test_sim(void)
+{
+	machinarium_set_simulation(1);
+	machinarium_init();
+
+	int id;
+	id = machine_create("test", test_sim, NULL);
+	test(id != -1);
+
+	int rc;
+	rc = machine_wait(id);
+	test(rc != -1);
+
+	machinarium_free();
+	machinarium_set_simulation(0);
+}
@@ -0,0 +1,124 @@
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+#include <odyssey_test.h>
+
+static void
+test_od_limit_bucket(void)
+{
+	od_limit_t limit;
+	od_limit_init(&limit, 10, 0, 0, 0);
+	test(limit.enabled);
+	test(od_limit_is_set(&limit, OD_LIMIT_QUERIES));
+	test(!od_limit_is_set(&limit, OD_LIMIT_TRANSACTIONS));
+
+	/* unlimited bucket never waits */
+	test(od_limit_reserve(&limit, OD_LIMIT_BYTES, 1 << 30, 1000, 0) == 0);
+
+	/* full bucket allows a burst of one second worth of tokens */
+	uint64_t now = 1000000;
+	int i;
+	for (i = 0; i < 10; i++)
+		test(od_limit_reserve(&limit, OD_LIMIT_QUERIES, 1, now, 0) == 0);
+
+	/* empty bucket rejects without wait allowed */
+	test(od_limit_reserve(&limit, OD_LIMIT_QUERIES, 1, now, 0) == -1);
+
+	/* debt is queued: every waiter gets a later slot */
+	test(od_limit_reserve(&limit, OD_LIMIT_QUERIES, 1, now, 1000000) ==
+	     100000);
+	test(od_limit_reserve(&limit, OD_LIMIT_QUERIES, 1, now, 1000000) ==
+	     200000);
+	test(od_limit_reserve(&limit, OD_LIMIT_QUERIES, 1, now, 100000) == -1);
+
+	/* request larger than the bucket waits only for a full bucket */
+	now += 2000000;
+	test(od_limit_reserve(&limit, OD_LIMIT_QUERIES, 100, now, 0) == 0);
+	test(od_limit_reserve(&limit, OD_LIMIT_QUERIES, 1, now, 10000000) ==
+	     9100000);
+
+	/* bucket refills with time */
+	now += 2000000;
+	test(od_limit_reserve(&limit, OD_LIMIT_QUERIES, 1, now, 0) == 0);
+}
+
+static void
+test_od_limit_tx(void)
+{
+	od_limit_t limit;
+	od_limit_init(&limit, 0, 0, 0, 2);
+	test(od_limit_is_set(&limit, OD_LIMIT_CONCURRENCY));
+	test(od_limit_tx_acquire(&limit) == 0);
+	test(od_limit_tx_acquire(&limit) == 0);
+	test(od_limit_tx_acquire(&limit) == -1);
+	test(limit.tx_active == 2);
+	od_limit_tx_release(&limit);
+	test(od_limit_tx_acquire(&limit) == 0);
+	od_limit_free(&limit);
+}
+
+static od_limit_t test_limit;
+static int test_order[2];
+static int test_order_count;
+
+static void
+test_tx_waiter(void *arg)
+{
+	od_limit_waiter_t waiter;
+	test(od_limit_tx_wait(&test_limit, &waiter, UINT32_MAX) == 0);
+	test_order[test_order_count++] = (int)(intptr_t)arg;
+}
+
+static void
+test_tx_queue(void *arg)
+{
+	(void)arg;
+	od_limit_init(&test_limit, 0, 0, 0, 1);
+	test(od_limit_tx_acquire(&test_limit) == 0);
+
+	/* waiter times out while no slot is released */
+	od_limit_waiter_t waiter;
+	test(od_limit_tx_wait(&test_limit, &waiter, 10) == -1);
+	test(od_list_empty(&test_limit.tx_waiters));
+
+	machine_coroutine_create(test_tx_waiter, (void *)1);
+	machine_coroutine_create(test_tx_waiter, (void *)2);
+	machine_sleep(1);
+
+	/* queued waiters are not overtaken */
+	test(od_limit_tx_acquire(&test_limit) == -1);
+
+	/* released slot is handed over in arrival order */
+	od_limit_tx_release(&test_limit);
+	machine_sleep(1);
+	test(test_order_count == 1 && test_order[0] == 1);
+	test(test_limit.tx_active == 1);
+	od_limit_tx_release(&test_limit);
+	machine_sleep(1);
+	test(test_order_count == 2 && test_order[1] == 2);
+	od_limit_tx_release(&test_limit);
+	test(test_limit.tx_active == 0);
+	od_limit_free(&test_limit);
+}
+
+static void
+test_od_limit_tx_queue(void)
+{
+	machinarium_init();
+	int64_t id;
+	id = machine_create("limit", test_tx_queue, NULL);
+	test(id != -1);
+	int rc;
+	rc = machine_wait(id);
+	test(rc != -1);
+	machinarium_free();
+}
+
+void
+odyssey_test_limit(void)
+{
+	test_od_limit_bucket();
+	test_od_limit_tx();
+	test_od_limit_tx_queue();
+}
@@ -0,0 +1,19 @@
+source ${0%/*}/environment.sh
+
+# attach timed out waiting for the only server must give its transaction
+# slot back, otherwise the route runs out of limit_tx_max slots
+for i in 1 2 3; do
+    psql -h $ODYSSEY_HOST -p $ODYSSEY_PORT -c "SELECT pg_sleep(1)" limit_db > /dev/null 2>&1 &
+    sleep 0.3
+    psql -h $ODYSSEY_HOST -p $ODYSSEY_PORT -c "SELECT 1" limit_db 2>&1 | grep -q "rate limit exceeded" && {
+        echo "ERROR: transaction slot leaked by timed out attach"
+        wait
+        exit 1
+    }
+    wait
+done
+
+psql -h $ODYSSEY_HOST -p $ODYSSEY_PORT -c "SELECT 1" limit_db > /dev/null 2>&1 || {
+    echo "ERROR: no transaction slot left after timed out attach"
+    exit 1
+}
@@ -0,0 +1,83 @@
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+#include <odyssey_test.h>
+
+static void
+test_od_sketch_estimate(void)
+{
+	od_sketch_t *sketch = od_sketch_create(4);
+	test(sketch != NULL);
+
+	od_sketch_key_t key;
+	char name[32];
+	int i;
+	for (i = 0; i < 1000; i++) {
+		int len = snprintf(name, sizeof(name), "10.0.0.%d", i % 100);
+		od_sketch_key_set(&key, name, len);
+		od_sketch_add(sketch, &key, OD_SKETCH_QUERIES, 1);
+	}
+
+	/* count-min never underestimates */
+	for (i = 0; i < 100; i++) {
+		int len = snprintf(name, sizeof(name), "10.0.0.%d", i);
+		od_sketch_key_set(&key, name, len);
+		test(od_sketch_estimate(sketch, &key, OD_SKETCH_QUERIES) >= 10);
+	}
+	od_sketch_key_set(&key, "10.0.0.1", 8);
+	test(od_sketch_estimate(sketch, &key, OD_SKETCH_BYTES) == 0);
+
+	od_sketch_free(sketch);
+}
+
+static void
+test_od_sketch_top(void)
+{
+	od_sketch_t *sketch = od_sketch_create(2);
+	test(sketch != NULL);
+
+	od_sketch_key_t heavy;
+	od_sketch_key_set(&heavy, "batch", 5);
+	od_sketch_key_t bytes;
+	od_sketch_key_set(&bytes, "etl", 3);
+
+	od_sketch_key_t key;
+	char name[32];
+	int i;
+	for (i = 0; i < 200; i++) {
+		int len = snprintf(name, sizeof(name), "app_%d", i);
+		od_sketch_key_set(&key, name, len);
+		od_sketch_add(sketch, &key, OD_SKETCH_QUERIES, 1);
+		od_sketch_add(sketch, &heavy, OD_SKETCH_QUERIES, 1);
+	}
+	od_sketch_add(sketch, &bytes, OD_SKETCH_BYTES, 1 << 20);
+
+	od_sketch_report_t report[6];
+	test(od_sketch_report_max(sketch) == 6);
+	int count = od_sketch_report(sketch, report);
+	test(count >= 2 && count <= 3);
+
+	/* ordered by queries first */
+	test(od_sketch_key_cmp(&report[0].key, &heavy));
+	test(report[0].values[OD_SKETCH_QUERIES] >= 200);
+
+	/* heavy by bytes is reported too */
+	int found = 0;
+	for (i = 0; i < count; i++) {
+		if (!od_sketch_key_cmp(&report[i].key, &bytes))
+			continue;
+		test(report[i].values[OD_SKETCH_BYTES] >= (1 << 20));
+		found = 1;
+	}
+	test(found);
+
+	od_sketch_free(sketch);
+}
+
+void
+odyssey_test_sketch(void)
+{
+	test_od_sketch_estimate();
+	test_od_sketch_top();
+}
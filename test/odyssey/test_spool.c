@@ -0,0 +1,108 @@
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+#include <odyssey_test.h>
+
+static void
+test_spool_read(od_spool_t *spool, char *expected, int size)
+{
+	char *data;
+	int rc;
+	rc = od_spool_read(spool, &data);
+	test(rc == size);
+	test(memcmp(data, expected, size) == 0);
+	od_spool_advance(spool, size);
+}
+
+static void
+test_od_spool_order(void)
+{
+	od_spool_t spool;
+	od_spool_init(&spool);
+	od_spool_set(&spool, "/tmp", 16, 0);
+	test(od_spool_pending(&spool) == 0);
+
+	/* memory first, then the file */
+	test(od_spool_append(&spool, "0123456789", 10) == 0);
+	test(spool.fd == -1);
+	test(od_spool_append(&spool, "abcdefghij", 10) == 0);
+	test(spool.fd != -1);
+	test(od_atomic_u64_of(&od_spool_stat.file) == 10);
+
+	/* file has data pending, new data goes after it */
+	test(od_spool_append(&spool, "XY", 2) == 0);
+	test(od_spool_pending(&spool) == 22);
+
+	char *data;
+	test(od_spool_read(&spool, &data) == 10);
+	od_spool_advance(&spool, 4);
+	test_spool_read(&spool, "456789", 6);
+
+	/* memory is refilled from the file, the file is reused */
+	test_spool_read(&spool, "abcdefghijXY", 12);
+	test(spool.file_end == 0);
+	test(od_atomic_u64_of(&od_spool_stat.file) == 0);
+
+	/* drained spool releases its memory */
+	test(od_spool_pending(&spool) == 0);
+	test(spool.buf == NULL);
+	test(od_atomic_u64_of(&od_spool_stat.memory) == 0);
+
+	test(od_spool_append(&spool, "Z", 1) == 0);
+	test_spool_read(&spool, "Z", 1);
+	test(od_atomic_u64_of(&od_spool_stat.spooled) == 23);
+
+	od_spool_free(&spool);
+	test(spool.fd == -1);
+}
+
+static void
+test_od_spool_iov(void)
+{
+	od_spool_t spool;
+	od_spool_init(&spool);
+	od_spool_set(&spool, "/tmp", 4, 8);
+
+	machine_iov_t *iov = machine_iov_create();
+	test(iov != NULL);
+	test(machine_iov_add_pointer(iov, "abc", 3) == 0);
+	test(machine_iov_add_pointer(iov, "def", 3) == 0);
+	test(machine_iov_size(iov) == 6);
+	test(od_spool_fits(&spool, machine_iov_size(iov)));
+	test(od_spool_append_iov(&spool, iov) == 0);
+	test(!machine_iov_pending(iov));
+
+	/* spool is bounded by max */
+	test(!od_spool_fits(&spool, 3));
+	test(od_spool_fits(&spool, 2));
+
+	test_spool_read(&spool, "abcd", 4);
+	test_spool_read(&spool, "ef", 2);
+	test(od_spool_pending(&spool) == 0);
+
+	machine_iov_free(iov);
+	od_spool_free(&spool);
+}
+
+static void
+test_spool_main(void *arg)
+{
+	(void)arg;
+	test_od_spool_order();
+	test_od_spool_iov();
+}
+
+void
+odyssey_test_spool(void)
+{
+	/* spool file operations are run by the machinarium task pool */
+	machinarium_init();
+	int64_t id;
+	id = machine_create("spool", test_spool_main, NULL);
+	test(id != -1);
+	int rc;
+	rc = machine_wait(id);
+	test(rc != -1);
+	machinarium_free();
+}
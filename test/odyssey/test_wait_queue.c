@@ -0,0 +1,280 @@
+
+#include <math.h>
+
+#include <machinarium.h>
+#include <kiwi.h>
+#include <odyssey.h>
+#include <odyssey_test.h>
+
+typedef enum
+{
+	TEST_ARRIVAL_UNIFORM,
+	TEST_ARRIVAL_POISSON,
+	TEST_ARRIVAL_BURST
+} test_arrival_t;
+
+typedef struct
+{
+	char *name;
+	int clients;
+	int servers;
+	int requests;
+	test_arrival_t arrival;
+	int interarrival_ms;
+	int service_ms;
+	uint32_t pool_timeout;
+	int queue_target_ms;
+	int queue_interval_ms;
+} test_workload_t;
+
+typedef struct
+{
+	int served;
+	int shed;
+	int timedout;
+	uint64_t *waits;
+	uint64_t wait_total_us;
+	uint64_t wait_max_us;
+	uint64_t elapsed_ms;
+} test_report_t;
+
+typedef struct
+{
+	test_workload_t *workload;
+	test_report_t *report;
+	od_wait_queue_t *queue;
+	uint64_t seed;
+} test_client_t;
+
+static inline uint32_t
+test_random(uint64_t *seed)
+{
+	*seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return *seed >> 33;
+}
+
+static inline uint32_t
+test_interarrival(test_workload_t *workload, uint64_t *seed)
+{
+	int mean = workload->interarrival_ms;
+	switch (workload->arrival) {
+		case TEST_ARRIVAL_UNIFORM:
+			return test_random(seed) % (2 * mean + 1);
+		case TEST_ARRIVAL_POISSON: {
+			double u = (test_random(seed) + 1.0) / 2147483649.0;
+			return -log(u) * mean;
+		}
+		case TEST_ARRIVAL_BURST:
+			/* all clients arrive at the start of every period */
+			return mean - machine_time_ms() % mean;
+	}
+	return 0;
+}
+
+static void
+test_client(void *arg)
+{
+	test_client_t *client      = arg;
+	test_workload_t *workload  = client->workload;
+	test_report_t *report      = client->report;
+	int i;
+	for (i = 0; i < workload->requests; i++) {
+		machine_sleep(test_interarrival(workload, &client->seed));
+
+		uint32_t timeout = UINT32_MAX;
+		if (workload->pool_timeout > 0)
+			timeout = workload->pool_timeout;
+
+		od_waiter_t waiter;
+		od_waiter_init(&waiter, client, 0, OD_WAITER_SLOT, NULL);
+		uint64_t start = machine_time_us();
+		od_waiter_state_t state;
+		state = od_wait_queue_acquire(client->queue,
+		                              &waiter,
+		                              workload->servers,
+		                              timeout);
+		uint64_t wait = machine_time_us() - start;
+		od_waiter_free(&waiter);
+		switch (state) {
+			case OD_WAITER_WAKE:
+				report->waits[report->served++] = wait;
+				report->wait_total_us += wait;
+				if (wait > report->wait_max_us)
+					report->wait_max_us = wait;
+				machine_sleep(workload->service_ms);
+				od_wait_queue_release(client->queue);
+				break;
+			case OD_WAITER_SHED:
+				report->shed++;
+				break;
+			case OD_WAITER_WAIT:
+				report->timedout++;
+				break;
+		}
+	}
+}
+
+static void
+test_replay(void *arg)
+{
+	test_client_t *clients    = arg;
+	test_workload_t *workload = clients[0].workload;
+	od_wait_queue_t *queue    = clients[0].queue;
+	od_wait_queue_configure(
+	  queue, workload->queue_target_ms, workload->queue_interval_ms);
+
+	uint64_t start = machine_time_ms();
+	int64_t *ids   = malloc(sizeof(int64_t) * workload->clients);
+	test(ids != NULL);
+	int i;
+	for (i = 0; i < workload->clients; i++) {
+		ids[i] = machine_coroutine_create(test_client, &clients[i]);
+		test(ids[i] != -1);
+	}
+	for (i = 0; i < workload->clients; i++)
+		machine_join(ids[i]);
+	free(ids);
+	clients[0].report->elapsed_ms = machine_time_ms() - start;
+
+	machine_stop_current();
+}
+
+static int
+test_wait_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void
+test_run(test_workload_t *workload, test_report_t *report)
+{
+	int total = workload->clients * workload->requests;
+	memset(report, 0, sizeof(test_report_t));
+	report->waits = malloc(sizeof(uint64_t) * total);
+	test(report->waits != NULL);
+
+	od_wait_queue_t *queue = od_wait_queue_allocate(workload->name);
+	test(queue != NULL);
+	test_client_t *clients = malloc(sizeof(test_client_t) * workload->clients);
+	test(clients != NULL);
+	int i;
+	for (i = 0; i < workload->clients; i++) {
+		clients[i].workload = workload;
+		clients[i].report   = report;
+		clients[i].queue    = queue;
+		clients[i].seed     = i + 1;
+	}
+
+	machinarium_set_simulation(1);
+	machinarium_init();
+	int64_t id;
+	id = machine_create("replay", test_replay, clients);
+	test(id != -1);
+	int rc;
+	rc = machine_wait(id);
+	test(rc != -1);
+	machinarium_free();
+	machinarium_set_simulation(0);
+
+	od_wait_queue_free(queue);
+	free(clients);
+
+	test(report->served + report->shed + report->timedout == total);
+	qsort(report->waits, report->served, sizeof(uint64_t), test_wait_cmp);
+}
+
+static void
+test_print(test_workload_t *workload, test_report_t *report)
+{
+	uint64_t p99 = 0;
+	if (report->served > 0)
+		p99 = report->waits[(report->served - 1) * 99 / 100];
+	double avg = 0;
+	if (report->served > 0)
+		avg = (double)report->wait_total_us / report->served / 1000.0;
+	fprintf(stdout,
+	        "\n\t%-8s %6d served %5d shed %5d timed out, wait avg %.2f ms "
+	        "p99 %d ms max %d ms, %.1f tx/s",
+	        workload->name,
+	        report->served,
+	        report->shed,
+	        report->timedout,
+	        avg,
+	        (int)(p99 / 1000),
+	        (int)(report->wait_max_us / 1000),
+	        report->served * 1000.0 / report->elapsed_ms);
+}
+
+static void
+test_replay_workload(test_workload_t *workload, test_report_t *report)
+{
+	test_run(workload, report);
+	test_print(workload, report);
+
+	/* replay gives the same result */
+	test_report_t again;
+	test_run(workload, &again);
+	test(again.served == report->served);
+	test(again.shed == report->shed);
+	test(again.timedout == report->timedout);
+	test(again.wait_total_us == report->wait_total_us);
+	test(again.elapsed_ms == report->elapsed_ms);
+	free(again.waits);
+}
+
+/* workloads run on the virtual clock, so replay is deterministic and
+ * takes no real time */
+void
+odyssey_test_wait_queue(void)
+{
+	test_report_t report;
+
+	/* light load, mostly no waiting */
+	test_workload_t uniform = {
+		"uniform", 50, 10, 100, TEST_ARRIVAL_UNIFORM, 100, 5, 0, 0, 0
+	};
+	test_replay_workload(&uniform, &report);
+	test(report.served == 5000);
+	free(report.waits);
+
+	/* saturated pool, throughput is bounded by the servers */
+	test_workload_t poisson = {
+		"poisson", 100, 10, 100, TEST_ARRIVAL_POISSON, 50, 10, 0, 0, 0
+	};
+	test_replay_workload(&poisson, &report);
+	test(report.served == 10000);
+	test(report.served * 1000.0 / report.elapsed_ms <= 10 * 1000 / 10);
+	free(report.waits);
+
+	/* synchronized arrivals are served in arrival order, in rounds */
+	test_workload_t burst = {
+		"burst", 200, 20, 10, TEST_ARRIVAL_BURST, 1000, 20, 0, 0, 0
+	};
+	test_replay_workload(&burst, &report);
+	test(report.served == 2000);
+	test(report.wait_max_us == 9 * 20 * 1000);
+	free(report.waits);
+
+	/* overload with queue delay control sheds waiters */
+	test_workload_t shed = {
+		"shed", 200, 5, 20, TEST_ARRIVAL_POISSON, 10, 20, 0, 50, 100
+	};
+	test_replay_workload(&shed, &report);
+	test(report.shed > 0);
+	test(report.timedout == 0);
+	free(report.waits);
+
+	/* overload with pool_timeout */
+	test_workload_t timeout = {
+		"timeout", 100, 2, 10, TEST_ARRIVAL_POISSON, 10, 50, 200, 0, 0
+	};
+	test_replay_workload(&timeout, &report);
+	test(report.timedout > 0);
+	test(report.shed == 0);
+	test(report.waits[report.served - 1] <= 200 * 1000);
+	free(report.waits);
+
+	fprintf(stdout, "\n");
+}
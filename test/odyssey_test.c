@@ -34,6 +34,10 @@ machinarium_test_sleep_yield(void);
 extern void
 machinarium_test_sleep_cancel0(void);
 extern void
+machinarium_test_sim(void);
+extern void
+machinarium_test_loop_stat(void);
+extern void
 machinarium_test_join(void);
 extern void
 machinarium_test_condition0(void);
@@ -142,6 +146,14 @@ extern void
 odyssey_test_util(void);
 extern void
 odyssey_test_lock(void);
+extern void
+odyssey_test_sketch(void);
+extern void
+odyssey_test_limit(void);
+extern void
+odyssey_test_wait_queue(void);
+extern void
+odyssey_test_spool(void);
 
 int
 main(int argc, char *argv[])
@@ -157,6 +169,8 @@ main(int argc, char *argv[])
 	odyssey_test(machinarium_test_sleep_random);
 	odyssey_test(machinarium_test_sleep_yield);
 	odyssey_test(machinarium_test_sleep_cancel0);
+	odyssey_test(machinarium_test_sim);
+	odyssey_test(machinarium_test_loop_stat);
 	odyssey_test(machinarium_test_join);
 	odyssey_test(machinarium_test_condition0);
 	odyssey_test(machinarium_test_eventfd0);
@@ -211,10 +225,15 @@ main(int argc, char *argv[])
 	odyssey_test(odyssey_test_attribute);
 	odyssey_test(odyssey_test_util);
 	odyssey_test(odyssey_test_lock);
+	odyssey_test(odyssey_test_sketch);
+	odyssey_test(odyssey_test_limit);
+	odyssey_test(odyssey_test_wait_queue);
+	odyssey_test(odyssey_test_spool);
 
 	odyssey_shell_test("odyssey/setup", goto on_fail);
 	odyssey_shell_test("odyssey/test_scram_backend", goto on_fail);
 	odyssey_shell_test("odyssey/test_scram_frontend", goto on_fail);
+	odyssey_shell_test("odyssey/test_limit_tx", goto on_fail);
 	odyssey_shell_test("odyssey/teardown", goto on_fail);
 	return 0;
 on_fail:
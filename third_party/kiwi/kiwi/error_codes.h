@@ -146,6 +146,7 @@
 #define KIWI_NO_ACTIVE_SQL_TRANSACTION "25P01"
 #define KIWI_IN_FAILED_SQL_TRANSACTION "25P02"
 #define KIWI_IDLE_IN_TRANSACTION_SESSION_TIMEOUT "25P03"
+#define KIWI_TRANSACTION_TIMEOUT "25P04"
 
 /* Class 26 - Invalid SQL Statement Name */
 #define KIWI_INVALID_SQL_STATEMENT_NAME "26000"
@@ -14,14 +14,16 @@ struct mm_buf
 	char *start;
 	char *pos;
 	char *end;
+	int memory;
 };
 
 static inline void
-mm_buf_init(mm_buf_t *buf)
+mm_buf_init(mm_buf_t *buf, int memory)
 {
-	buf->start = NULL;
-	buf->pos   = NULL;
-	buf->end   = NULL;
+	buf->start  = NULL;
+	buf->pos    = NULL;
+	buf->end    = NULL;
+	buf->memory = memory;
 }
 
 static inline void
@@ -29,6 +31,7 @@ mm_buf_free(mm_buf_t *buf)
 {
 	if (buf->start == NULL)
 		return;
+	mm_memory_add(buf->memory, -(int64_t)(buf->end - buf->start));
 	free(buf->start);
 	buf->start = NULL;
 	buf->pos   = NULL;
@@ -72,6 +75,7 @@ mm_buf_ensure(mm_buf_t *buf, int size)
 	p = realloc(buf->start, sz);
 	if (p == NULL)
 		return -1;
+	mm_memory_add(buf->memory, sz - mm_buf_size(buf));
 	buf->pos   = p + (buf->pos - buf->start);
 	buf->end   = p + sz;
 	buf->start = p;
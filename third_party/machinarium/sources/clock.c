@@ -26,10 +26,11 @@ mm_clock_cmp(mm_timer_t *a, mm_timer_t *b)
 void
 mm_clock_init(mm_clock_t *clock)
 {
-	mm_buf_init(&clock->timers);
+	mm_buf_init(&clock->timers, MM_MEMORY_NONE);
 	clock->timers_count = 0;
 	clock->timers_seq   = 0;
 	clock->active       = 0;
+	clock->simulated    = 0;
 	clock->time_ms      = 0;
 	clock->time_ns      = 0;
 	clock->time_us      = 0;
@@ -169,7 +170,7 @@ mm_clock_step(mm_clock_t *clock)
 	return timers_hit;
 }
 
-static uint64_t
+uint64_t
 mm_clock_gettime(void)
 {
 	struct timespec t;
@@ -180,10 +181,28 @@ mm_clock_gettime(void)
 void
 mm_clock_update(mm_clock_t *clock)
 {
-	if (clock->time_cached)
+	if (clock->time_cached || clock->simulated)
 		return;
 	clock->time_ns     = mm_clock_gettime();
 	clock->time_ms     = clock->time_ns / 1000000;
 	clock->time_us     = clock->time_ns / 1000;
 	clock->time_cached = 1;
 }
+
+void
+mm_clock_simulate(mm_clock_t *clock)
+{
+	/* virtual time moves only by mm_clock_advance() */
+	clock->simulated = 1;
+	clock->time_ns   = MM_CLOCK_SIM_EPOCH;
+	clock->time_us   = clock->time_ns / 1000;
+	clock->time_ms   = clock->time_ns / 1000000;
+}
+
+void
+mm_clock_advance(mm_clock_t *clock, uint64_t time_ms)
+{
+	clock->time_ns += time_ms * 1000000;
+	clock->time_us = clock->time_ns / 1000;
+	clock->time_ms = clock->time_ns / 1000000;
+}
@@ -9,9 +9,13 @@
 
 typedef struct mm_clock mm_clock_t;
 
+/* virtual clock starts at one second, zero time is used as unset */
+#define MM_CLOCK_SIM_EPOCH 1000000000ULL
+
 struct mm_clock
 {
 	int active;
+	int simulated;
 	int time_cached;
 	uint64_t time_ms;
 	uint64_t time_us;
@@ -25,8 +29,14 @@ void
 mm_clock_init(mm_clock_t *);
 void
 mm_clock_free(mm_clock_t *);
+uint64_t
+mm_clock_gettime(void);
 void
 mm_clock_update(mm_clock_t *);
+void
+mm_clock_simulate(mm_clock_t *);
+void
+mm_clock_advance(mm_clock_t *, uint64_t);
 int
 mm_clock_step(mm_clock_t *);
 int
@@ -16,6 +16,19 @@ int
 mm_contextstack_create(mm_contextstack_t *stack, size_t size, size_t size_guard)
 {
 	char *base;
+	mm_hugepage_t *hugepage = &machinarium.hugepage;
+	stack->hugepage         = 0;
+	if (hugepage->enabled_stacks && size == hugepage->stacks.slot_size) {
+		/* guard page would split the huge page, so pooled stacks are
+		 * used only if explicitly enabled */
+		base = mm_hugepool_alloc(hugepage, &hugepage->stacks);
+		if (base) {
+			stack->hugepage = 1;
+			size_guard      = 0;
+			goto done;
+		}
+	}
+
 	base = mmap(0,
 	            size_guard + size,
 	            PROT_READ | PROT_WRITE | PROT_EXEC,
@@ -26,6 +39,8 @@ mm_contextstack_create(mm_contextstack_t *stack, size_t size, size_t size_guard)
 		return -1;
 	mprotect(base, size_guard, PROT_NONE);
 	base += size_guard;
+done:
+	mm_memory_add(MM_MEMORY_STACK, size + size_guard);
 	stack->pointer    = base;
 	stack->size       = size;
 	stack->size_guard = size_guard;
@@ -44,6 +59,12 @@ mm_contextstack_free(mm_contextstack_t *stack)
 #ifdef HAVE_VALGRIND
 	VALGRIND_STACK_DEREGISTER(stack->valgrind_stack);
 #endif
+	mm_memory_add(MM_MEMORY_STACK, -(int64_t)(stack->size + stack->size_guard));
+	if (stack->hugepage) {
+		mm_hugepool_free(
+		  &machinarium.hugepage, &machinarium.hugepage.stacks, stack->pointer);
+		return;
+	}
 	char *base = stack->pointer - stack->size_guard;
 	munmap(base, stack->size_guard + stack->size);
 }
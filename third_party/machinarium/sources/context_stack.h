@@ -14,6 +14,7 @@ struct mm_contextstack
 	char *pointer;
 	size_t size;
 	size_t size_guard;
+	int hugepage;
 #ifdef HAVE_VALGRIND
 	int valgrind_stack;
 #endif
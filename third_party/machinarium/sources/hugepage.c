@@ -0,0 +1,200 @@
+
+/*
+ * machinarium.
+ *
+ * cooperative multitasking engine.
+ */
+
+#include <machinarium.h>
+#include <machinarium_private.h>
+
+static inline void
+mm_hugepool_init(mm_hugepool_t *pool, size_t slot_size, int prot)
+{
+	mm_sleeplock_init(&pool->lock);
+	/* keep slots cache line aligned */
+	pool->slot_size = (slot_size + 63) & ~(size_t)63;
+	pool->prot      = prot;
+	pool->free      = NULL;
+	pool->pos       = NULL;
+	pool->end       = NULL;
+	pool->chunks    = NULL;
+}
+
+void
+mm_hugepage_init(mm_hugepage_t *hugepage,
+                 int enabled,
+                 int enabled_stacks,
+                 size_t stack_size)
+{
+	hugepage->enabled        = enabled;
+	hugepage->enabled_stacks = enabled && enabled_stacks;
+	hugepage->hugetlb        = 1;
+	hugepage->count_hugetlb  = 0;
+	hugepage->count_thp      = 0;
+	hugepage->count_regular  = 0;
+	hugepage->used           = 0;
+	mm_hugepool_init(
+	  &hugepage->stacks, stack_size, PROT_READ | PROT_WRITE | PROT_EXEC);
+	int i;
+	for (i = 0; i < MM_HUGEPAGE_CLASSES; i++)
+		mm_hugepool_init(&hugepage->bufs[i],
+		                 MM_HUGEPAGE_MIN << i,
+		                 PROT_READ | PROT_WRITE);
+}
+
+static inline void
+mm_hugepool_unmap(mm_hugepool_t *pool)
+{
+	void *chunk = pool->chunks;
+	while (chunk) {
+		void *next = *(void **)chunk;
+		munmap(chunk, MM_HUGEPAGE_SIZE);
+		chunk = next;
+	}
+	pool->chunks = NULL;
+}
+
+void
+mm_hugepage_free(mm_hugepage_t *hugepage)
+{
+	mm_hugepool_unmap(&hugepage->stacks);
+	int i;
+	for (i = 0; i < MM_HUGEPAGE_CLASSES; i++)
+		mm_hugepool_unmap(&hugepage->bufs[i]);
+}
+
+static inline char *
+mm_hugepage_map(mm_hugepage_t *hugepage, int prot)
+{
+	char *chunk;
+#ifdef MAP_HUGETLB
+	/* reserved huge pages, stop trying after the first failure */
+	if (hugepage->hugetlb) {
+		chunk = mmap(NULL,
+		             MM_HUGEPAGE_SIZE,
+		             prot,
+		             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+		             -1,
+		             0);
+		if (chunk != MAP_FAILED) {
+			__sync_fetch_and_add(&hugepage->count_hugetlb, 1);
+			return chunk;
+		}
+		hugepage->hugetlb = 0;
+	}
+#endif
+
+	/* map twice the size to align chunk by huge page boundary */
+	char *base;
+	base = mmap(NULL,
+	            MM_HUGEPAGE_SIZE * 2,
+	            prot,
+	            MAP_PRIVATE | MAP_ANONYMOUS,
+	            -1,
+	            0);
+	if (base == MAP_FAILED)
+		return NULL;
+	chunk = (char *)(((uintptr_t)base + MM_HUGEPAGE_SIZE - 1) &
+	                 ~((uintptr_t)MM_HUGEPAGE_SIZE - 1));
+	if (chunk > base)
+		munmap(base, chunk - base);
+	if (chunk + MM_HUGEPAGE_SIZE < base + MM_HUGEPAGE_SIZE * 2)
+		munmap(chunk + MM_HUGEPAGE_SIZE,
+		       base + MM_HUGEPAGE_SIZE * 2 - (chunk + MM_HUGEPAGE_SIZE));
+
+#ifdef MADV_HUGEPAGE
+	if (madvise(chunk, MM_HUGEPAGE_SIZE, MADV_HUGEPAGE) == 0) {
+		__sync_fetch_and_add(&hugepage->count_thp, 1);
+		return chunk;
+	}
+#endif
+	__sync_fetch_and_add(&hugepage->count_regular, 1);
+	return chunk;
+}
+
+void *
+mm_hugepool_alloc(mm_hugepage_t *hugepage, mm_hugepool_t *pool)
+{
+	if (pool->slot_size > MM_HUGEPAGE_SIZE - MM_HUGEPAGE_HEADER)
+		return NULL;
+
+	mm_sleeplock_lock(&pool->lock);
+	void *slot = pool->free;
+	if (slot) {
+		pool->free = *(void **)slot;
+		goto done;
+	}
+	if (pool->pos == NULL || pool->pos + pool->slot_size > pool->end) {
+		char *chunk = mm_hugepage_map(hugepage, pool->prot);
+		if (chunk == NULL) {
+			mm_sleeplock_unlock(&pool->lock);
+			return NULL;
+		}
+		/* chunk header links pool chunks */
+		*(void **)chunk = pool->chunks;
+		pool->chunks    = chunk;
+		pool->pos       = chunk + MM_HUGEPAGE_HEADER;
+		pool->end       = chunk + MM_HUGEPAGE_SIZE;
+	}
+	slot = pool->pos;
+	pool->pos += pool->slot_size;
+done:
+	mm_sleeplock_unlock(&pool->lock);
+	__sync_fetch_and_add(&hugepage->used, pool->slot_size);
+	return slot;
+}
+
+void
+mm_hugepool_free(mm_hugepage_t *hugepage, mm_hugepool_t *pool, void *slot)
+{
+	mm_sleeplock_lock(&pool->lock);
+	*(void **)slot = pool->free;
+	pool->free     = slot;
+	mm_sleeplock_unlock(&pool->lock);
+	__sync_fetch_and_sub(&hugepage->used, pool->slot_size);
+}
+
+static inline mm_hugepool_t *
+mm_hugepage_class(mm_hugepage_t *hugepage, size_t size)
+{
+	int i;
+	for (i = 0; i < MM_HUGEPAGE_CLASSES; i++)
+		if (size <= hugepage->bufs[i].slot_size)
+			return &hugepage->bufs[i];
+	return NULL;
+}
+
+MACHINE_API void *
+machine_hugepage_alloc(size_t size)
+{
+	mm_hugepage_t *hugepage = &machinarium.hugepage;
+	if (!hugepage->enabled)
+		return NULL;
+	mm_hugepool_t *pool = mm_hugepage_class(hugepage, size);
+	if (pool == NULL)
+		return NULL;
+	return mm_hugepool_alloc(hugepage, pool);
+}
+
+MACHINE_API void
+machine_hugepage_free(void *ptr, size_t size)
+{
+	mm_hugepage_t *hugepage = &machinarium.hugepage;
+	mm_hugepool_t *pool     = mm_hugepage_class(hugepage, size);
+	assert(pool != NULL);
+	mm_hugepool_free(hugepage, pool, ptr);
+}
+
+MACHINE_API void
+machine_hugepage_stat(uint64_t *count_hugetlb,
+                      uint64_t *count_thp,
+                      uint64_t *count_regular,
+                      uint64_t *used)
+{
+	mm_hugepage_t *hugepage = &machinarium.hugepage;
+	*count_hugetlb          = hugepage->count_hugetlb;
+	*count_thp              = hugepage->count_thp;
+	*count_regular          = hugepage->count_regular;
+	*used                   = hugepage->used;
+}
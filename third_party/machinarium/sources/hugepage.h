@@ -0,0 +1,63 @@
+#ifndef MM_HUGEPAGE_H
+#define MM_HUGEPAGE_H
+
+/*
+ * machinarium.
+ *
+ * cooperative multitasking engine.
+ */
+
+/*
+ * Huge page backed slab pools.
+ *
+ * Memory is mapped in chunks of huge page size, using MAP_HUGETLB when
+ * huge pages are reserved, transparent huge pages otherwise and regular
+ * pages as the last resort. Chunks are split into fixed size slots and
+ * are kept until machinarium_free().
+ *
+ * Coroutine stacks are pooled only on explicit request, pooled stacks
+ * have no guard page.
+ */
+
+#define MM_HUGEPAGE_SIZE    (2 * 1024 * 1024)
+#define MM_HUGEPAGE_HEADER  64
+#define MM_HUGEPAGE_CLASSES 5
+#define MM_HUGEPAGE_MIN     4096
+
+typedef struct mm_hugepool mm_hugepool_t;
+typedef struct mm_hugepage mm_hugepage_t;
+
+struct mm_hugepool
+{
+	mm_sleeplock_t lock;
+	size_t slot_size;
+	int prot;
+	void *free;
+	char *pos;
+	char *end;
+	void *chunks;
+};
+
+struct mm_hugepage
+{
+	int enabled;
+	int enabled_stacks;
+	int hugetlb;
+	mm_hugepool_t stacks;
+	mm_hugepool_t bufs[MM_HUGEPAGE_CLASSES];
+	uint64_t count_hugetlb;
+	uint64_t count_thp;
+	uint64_t count_regular;
+	uint64_t used;
+};
+
+void
+mm_hugepage_init(mm_hugepage_t *, int, int, size_t);
+void
+mm_hugepage_free(mm_hugepage_t *);
+void *
+mm_hugepool_alloc(mm_hugepage_t *, mm_hugepool_t *);
+void
+mm_hugepool_free(mm_hugepage_t *, mm_hugepool_t *, void *);
+
+#endif /* MM_HUGEPAGE_H */
@@ -217,6 +217,29 @@ machine_fd(machine_io_t *obj)
 	return io->fd;
 }
 
+MACHINE_API int
+machine_sim_ready(machine_io_t *obj, int events)
+{
+	mm_io_t *io = mm_cast(mm_io_t *, obj);
+	mm_errno_set(0);
+	if (!io->attached) {
+		mm_errno_set(ENOTCONN);
+		return -1;
+	}
+	int mask = 0;
+	if (events & MACHINE_SIM_READ)
+		mask |= MM_R;
+	if (events & MACHINE_SIM_WRITE)
+		mask |= MM_W;
+	int rc;
+	rc = mm_sim_ready(mm_self->loop.poll, &io->handle, mask);
+	if (rc == -1) {
+		mm_errno_set(EINVAL);
+		return -1;
+	}
+	return 0;
+}
+
 MACHINE_API int
 machine_set_nodelay(machine_io_t *obj, int enable)
 {
@@ -56,3 +56,24 @@ machine_iov_pending(machine_iov_t *obj)
 	mm_iov_t *iov = mm_cast(mm_iov_t *, obj);
 	return mm_iov_pending(iov);
 }
+
+MACHINE_API int
+machine_iov_size(machine_iov_t *obj)
+{
+	mm_iov_t *iov = mm_cast(mm_iov_t *, obj);
+	return mm_iov_size_of(mm_iov_pos(iov), iov->iov_count);
+}
+
+MACHINE_API void
+machine_iov_copy(machine_iov_t *obj, char *dest)
+{
+	mm_iov_t *iov = mm_cast(mm_iov_t *, obj);
+	mm_iovcpy(dest, mm_iov_pos(iov), iov->iov_count);
+}
+
+MACHINE_API void
+machine_iov_reset(machine_iov_t *obj)
+{
+	mm_iov_t *iov = mm_cast(mm_iov_t *, obj);
+	mm_iov_reset(iov);
+}
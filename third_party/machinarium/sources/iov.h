@@ -20,7 +20,7 @@ struct mm_iov
 static inline void
 mm_iov_init(mm_iov_t *iov)
 {
-	mm_buf_init(&iov->iov);
+	mm_buf_init(&iov->iov, MM_MEMORY_IOV);
 	mm_list_init(&iov->msg_list);
 	iov->write_pos = 0;
 	iov->iov_count = 0;
@@ -11,12 +11,18 @@
 int
 mm_loop_init(mm_loop_t *loop)
 {
-	loop->poll = mm_epoll_if.create();
+	if (machinarium.config.simulation)
+		loop->poll = mm_sim_if.create();
+	else
+		loop->poll = mm_epoll_if.create();
 	if (loop->poll == NULL)
 		return -1;
 	mm_clock_init(&loop->clock);
+	if (machinarium.config.simulation)
+		mm_clock_simulate(&loop->clock);
 	mm_clock_update(&loop->clock);
 	memset(&loop->idle, 0, sizeof(loop->idle));
+	loop->wait_ns = 0;
 	return 0;
 }
 
@@ -63,10 +69,19 @@ mm_loop_step(mm_loop_t *loop)
 	/* run timers */
 	mm_clock_step(&loop->clock);
 
-	/* poll for events */
+	/* poll for events, time spent blocked in poll is accounted as idle */
+	uint64_t wait_start = 0;
+	if (timeout != 0 && !loop->clock.simulated)
+		wait_start = mm_clock_gettime();
 	rc = loop->poll->iface->step(loop->poll, timeout);
+	if (wait_start)
+		loop->wait_ns += mm_clock_gettime() - wait_start;
 	if (rc == -1)
 		return -1;
 
+	/* jump to the next timer instead of waiting for it */
+	if (loop->clock.simulated && rc == 0 && next && timeout > 0)
+		mm_clock_advance(&loop->clock, timeout);
+
 	return 0;
 }
@@ -14,6 +14,7 @@ struct mm_loop
 	mm_clock_t clock;
 	mm_idle_t idle;
 	mm_poll_t *poll;
+	uint64_t wait_ns;
 };
 
 int
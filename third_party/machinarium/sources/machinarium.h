@@ -32,6 +32,8 @@ extern "C"
 
 	typedef void (*machine_coroutine_t)(void *arg);
 
+	typedef void (*machine_task_function_t)(void *arg);
+
 #define mm_yield machine_sleep(0);
 
 	/* library handles */
@@ -53,6 +55,14 @@ extern "C"
 
 	MACHINE_API void machinarium_set_msg_cache_gc_size(int size);
 
+	MACHINE_API void machinarium_set_huge_pages(int enable);
+
+	MACHINE_API void machinarium_set_huge_pages_stacks(int enable);
+
+	/* machines created with simulation enabled use virtual clock, which
+	 * jumps to the next timer when there is nothing to run */
+	MACHINE_API void machinarium_set_simulation(int enable);
+
 	/* main */
 
 	MACHINE_API int machinarium_init(void);
@@ -79,6 +89,11 @@ extern "C"
 
 	MACHINE_API uint64_t machine_time_us(void);
 
+	MACHINE_API int machine_sim_advance(uint32_t time_ms);
+
+	/* time machine event loop spent waiting for events */
+	MACHINE_API void machine_loop_stat(uint64_t *wait_us);
+
 	MACHINE_API void machine_stat(uint64_t *coroutine_count,
 	                              uint64_t *coroutine_cache_count,
 	                              uint64_t *msg_allocated,
@@ -86,6 +101,26 @@ extern "C"
 	                              uint64_t *msg_cache_gc_count,
 	                              uint64_t *msg_cache_size);
 
+	/* huge page backed buffers */
+
+	MACHINE_API void *machine_hugepage_alloc(size_t size);
+
+	MACHINE_API void machine_hugepage_free(void *ptr, size_t size);
+
+	MACHINE_API void machine_hugepage_stat(uint64_t *count_hugetlb,
+	                                       uint64_t *count_thp,
+	                                       uint64_t *count_regular,
+	                                       uint64_t *used);
+
+	/* memory accounting */
+
+	MACHINE_API void machine_memory_buf_add(int64_t size);
+
+	MACHINE_API void machine_memory_stat(uint64_t *msg,
+	                                     uint64_t *iov,
+	                                     uint64_t *stack,
+	                                     uint64_t *buf);
+
 	/* signals */
 
 	MACHINE_API int machine_signal_init(sigset_t *, sigset_t *);
@@ -201,6 +236,13 @@ extern "C"
 
 	MACHINE_API int machine_io_verify(machine_io_t *, char *common_name);
 
+	/* scripted readiness, simulation only */
+
+#define MACHINE_SIM_READ 1
+#define MACHINE_SIM_WRITE 2
+
+	MACHINE_API int machine_sim_ready(machine_io_t *, int events);
+
 	/* dns */
 
 	MACHINE_API int machine_getsockname(machine_io_t *,
@@ -217,6 +259,12 @@ extern "C"
 	                                    struct addrinfo **res,
 	                                    uint32_t time_ms);
 
+	/* blocking calls */
+
+	/* run function by the resolver thread pool, current coroutine
+	 * waits for it to complete */
+	MACHINE_API int machine_task(machine_task_function_t, void *arg);
+
 	/* io */
 
 	MACHINE_API int machine_connect(machine_io_t *,
@@ -253,6 +301,13 @@ extern "C"
 
 	MACHINE_API int machine_iov_pending(machine_iov_t *);
 
+	/* size and copy of data not written yet */
+	MACHINE_API int machine_iov_size(machine_iov_t *);
+
+	MACHINE_API void machine_iov_copy(machine_iov_t *, char *);
+
+	MACHINE_API void machine_iov_reset(machine_iov_t *);
+
 	/* read */
 
 	MACHINE_API int machine_read_active(machine_io_t *);
@@ -46,7 +46,9 @@
 #include "util.h"
 #include "sleep_lock.h"
 #include "list.h"
+#include "memory.h"
 #include "buf.h"
+#include "hugepage.h"
 
 #include "fd.h"
 #include "poll.h"
@@ -55,6 +57,7 @@
 #include "idle.h"
 #include "loop.h"
 #include "epoll.h"
+#include "sim.h"
 #include "socket.h"
 #include "bind.h"
 
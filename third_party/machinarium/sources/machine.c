@@ -267,6 +267,22 @@ machine_time_us(void)
 	return mm_self->loop.clock.time_us;
 }
 
+MACHINE_API void
+machine_loop_stat(uint64_t *wait_us)
+{
+	*wait_us = mm_self->loop.wait_ns / 1000;
+}
+
+MACHINE_API int
+machine_sim_advance(uint32_t time_ms)
+{
+	mm_clock_t *clock = &mm_self->loop.clock;
+	if (!clock->simulated)
+		return -1;
+	mm_clock_advance(clock, time_ms);
+	return 0;
+}
+
 MACHINE_API void
 machine_stat(uint64_t *coroutine_count,
              uint64_t *coroutine_cache_count,
@@ -0,0 +1,52 @@
+
+/*
+ * machinarium.
+ *
+ * cooperative multitasking engine.
+ */
+
+#include <machinarium.h>
+#include <machinarium_private.h>
+
+mm_memory_slot_t mm_memory[MM_MEMORY_SLOTS];
+__thread int mm_memory_slot_self = -1;
+
+static uint32_t mm_memory_slot_next = 0;
+
+int
+mm_memory_slot_assign(void)
+{
+	/* threads get slots in order of their first allocation */
+	uint32_t slot = __sync_fetch_and_add(&mm_memory_slot_next, 1);
+	return slot % MM_MEMORY_SLOTS;
+}
+
+static inline uint64_t
+mm_memory_sum(int type)
+{
+	int64_t sum = 0;
+	int i;
+	for (i = 0; i < MM_MEMORY_SLOTS; i++)
+		sum += __atomic_load_n(&mm_memory[i].values[type], __ATOMIC_RELAXED);
+	if (sum < 0)
+		return 0;
+	return sum;
+}
+
+MACHINE_API void
+machine_memory_buf_add(int64_t size)
+{
+	mm_memory_add(MM_MEMORY_BUF, size);
+}
+
+MACHINE_API void
+machine_memory_stat(uint64_t *msg,
+                    uint64_t *iov,
+                    uint64_t *stack,
+                    uint64_t *buf)
+{
+	*msg   = mm_memory_sum(MM_MEMORY_MSG);
+	*iov   = mm_memory_sum(MM_MEMORY_IOV);
+	*stack = mm_memory_sum(MM_MEMORY_STACK);
+	*buf   = mm_memory_sum(MM_MEMORY_BUF);
+}
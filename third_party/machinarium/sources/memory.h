@@ -0,0 +1,56 @@
+#ifndef MM_MEMORY_H
+#define MM_MEMORY_H
+
+/*
+ * machinarium.
+ *
+ * cooperative multitasking engine.
+ */
+
+/*
+ * Memory accounting.
+ *
+ * Buffers and stacks report size changes to the slot of the thread
+ * doing the allocation, application buffers are reported with
+ * machine_memory_buf_add(). Memory freed by another thread is
+ * subtracted from that thread slot, so a single slot may go negative
+ * while the sum over all slots stays exact.
+ */
+
+#define MM_MEMORY_SLOTS 32
+#define MM_MEMORY_ALIGN 64
+
+typedef enum
+{
+	MM_MEMORY_NONE = -1,
+	MM_MEMORY_MSG,
+	MM_MEMORY_IOV,
+	MM_MEMORY_STACK,
+	MM_MEMORY_BUF,
+	MM_MEMORY_MAX
+} mm_memory_type_t;
+
+typedef struct mm_memory_slot mm_memory_slot_t;
+
+struct mm_memory_slot
+{
+	int64_t values[MM_MEMORY_MAX];
+} __attribute__((aligned(MM_MEMORY_ALIGN)));
+
+extern mm_memory_slot_t mm_memory[MM_MEMORY_SLOTS];
+extern __thread int mm_memory_slot_self;
+
+int
+mm_memory_slot_assign(void);
+
+static inline void
+mm_memory_add(int type, int64_t size)
+{
+	if (type == MM_MEMORY_NONE)
+		return;
+	if (__builtin_expect(mm_memory_slot_self == -1, 0))
+		mm_memory_slot_self = mm_memory_slot_assign();
+	__sync_fetch_and_add(&mm_memory[mm_memory_slot_self].values[type], size);
+}
+
+#endif /* MM_MEMORY_H */
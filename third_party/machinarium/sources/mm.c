@@ -12,6 +12,9 @@ static int machinarium_stack_size           = 0;
 static int machinarium_pool_size            = 0;
 static int machinarium_coroutine_cache_size = 0;
 static int machinarium_msg_cache_gc_size    = 0;
+static int machinarium_huge_pages           = 0;
+static int machinarium_huge_pages_stacks    = 0;
+static int machinarium_simulation           = 0;
 static int machinarium_initialized          = 0;
 mm_t machinarium;
 
@@ -45,6 +48,24 @@ machinarium_set_msg_cache_gc_size(int size)
 	machinarium_msg_cache_gc_size = size;
 }
 
+MACHINE_API void
+machinarium_set_huge_pages(int enable)
+{
+	machinarium_huge_pages = enable;
+}
+
+MACHINE_API void
+machinarium_set_simulation(int enable)
+{
+	machinarium_simulation = enable;
+}
+
+MACHINE_API void
+machinarium_set_huge_pages_stacks(int enable)
+{
+	machinarium_huge_pages_stacks = enable;
+}
+
 MACHINE_API int
 machinarium_init(void)
 {
@@ -62,6 +83,15 @@ machinarium_init(void)
 	machinarium.config.pool_size            = machinarium_pool_size;
 	machinarium.config.coroutine_cache_size = machinarium_coroutine_cache_size;
 	machinarium.config.msg_cache_gc_size    = machinarium_msg_cache_gc_size;
+	machinarium.config.huge_pages           = machinarium_huge_pages;
+	machinarium.config.huge_pages_stacks    = machinarium_huge_pages_stacks;
+	machinarium.config.simulation           = machinarium_simulation;
+
+	mm_hugepage_init(&machinarium.hugepage,
+	                 machinarium.config.huge_pages,
+	                 machinarium.config.huge_pages_stacks,
+	                 machinarium.config.stack_size *
+	                   machinarium.config.page_size);
 
 	mm_machinemgr_init(&machinarium.machine_mgr);
 	mm_tls_engine_init();
@@ -79,5 +109,6 @@ machinarium_free(void)
 	mm_taskmgr_stop(&machinarium.task_mgr);
 	mm_machinemgr_free(&machinarium.machine_mgr);
 	mm_tls_engine_free();
+	mm_hugepage_free(&machinarium.hugepage);
 	machinarium_initialized = 0;
 }
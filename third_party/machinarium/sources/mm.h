@@ -17,6 +17,9 @@ struct mm_config
 	int pool_size;
 	int coroutine_cache_size;
 	int msg_cache_gc_size;
+	int huge_pages;
+	int huge_pages_stacks;
+	int simulation;
 };
 
 struct mm
@@ -24,6 +27,7 @@ struct mm
 	mm_config_t config;
 	mm_machinemgr_t machine_mgr;
 	mm_taskmgr_t task_mgr;
+	mm_hugepage_t hugepage;
 };
 
 extern mm_t machinarium;
@@ -24,7 +24,7 @@ mm_msg_init(mm_msg_t *msg, int type)
 	msg->refs       = 0;
 	msg->type       = type;
 	msg->machine_id = 0;
-	mm_buf_init(&msg->data);
+	mm_buf_init(&msg->data, MM_MEMORY_MSG);
 	mm_list_init(&msg->link);
 }
 
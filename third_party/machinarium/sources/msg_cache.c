@@ -60,7 +60,7 @@ mm_msgcache_pop(mm_msgcache_t *cache)
 	msg = malloc(sizeof(mm_msg_t));
 	if (msg == NULL)
 		return NULL;
-	mm_buf_init(&msg->data);
+	mm_buf_init(&msg->data, MM_MEMORY_MSG);
 init:
 	msg->machine_id = mm_self->id;
 	msg->refs       = 0;
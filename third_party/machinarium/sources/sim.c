@@ -0,0 +1,179 @@
+
+/*
+ * machinarium.
+ *
+ * cooperative multitasking engine.
+ */
+
+#include <machinarium.h>
+#include <machinarium_private.h>
+
+typedef struct mm_sim mm_sim_t;
+typedef struct mm_sim_event mm_sim_event_t;
+
+struct mm_sim_event
+{
+	mm_fd_t *fd;
+	int mask;
+};
+
+struct mm_sim
+{
+	mm_poll_t poll;
+	mm_poll_t *epoll;
+	mm_buf_t events;
+};
+
+static mm_poll_t *
+mm_sim_create(void)
+{
+	mm_sim_t *sim;
+	sim = malloc(sizeof(mm_sim_t));
+	if (sim == NULL)
+		return NULL;
+	sim->poll.iface = &mm_sim_if;
+	sim->epoll      = mm_epoll_if.create();
+	if (sim->epoll == NULL) {
+		free(sim);
+		return NULL;
+	}
+	mm_buf_init(&sim->events, MM_MEMORY_NONE);
+	return &sim->poll;
+}
+
+static void
+mm_sim_free(mm_poll_t *poll)
+{
+	mm_sim_t *sim = (mm_sim_t *)poll;
+	sim->epoll->iface->free(sim->epoll);
+	mm_buf_free(&sim->events);
+	free(poll);
+}
+
+static int
+mm_sim_shutdown(mm_poll_t *poll)
+{
+	mm_sim_t *sim = (mm_sim_t *)poll;
+	return sim->epoll->iface->shutdown(sim->epoll);
+}
+
+static inline int
+mm_sim_dispatch(mm_sim_t *sim)
+{
+	/* callbacks may script new events, they are left for the next step */
+	int count      = mm_buf_used(&sim->events) / sizeof(mm_sim_event_t);
+	int dispatched = 0;
+	int i;
+	for (i = 0; i < count; i++) {
+		mm_sim_event_t *event = (mm_sim_event_t *)sim->events.start + i;
+		mm_fd_t *fd           = event->fd;
+		int mask              = event->mask;
+		event->fd             = NULL;
+		if (fd == NULL)
+			continue;
+		if ((mask & MM_R) && fd->on_read)
+			fd->on_read(fd);
+		if ((mask & MM_W) && fd->on_write)
+			fd->on_write(fd);
+		dispatched++;
+	}
+	int left = mm_buf_used(&sim->events) - count * sizeof(mm_sim_event_t);
+	memmove(sim->events.start,
+	        sim->events.start + count * sizeof(mm_sim_event_t),
+	        left);
+	sim->events.pos = sim->events.start + left;
+	return dispatched;
+}
+
+static int
+mm_sim_step(mm_poll_t *poll, int timeout)
+{
+	mm_sim_t *sim = (mm_sim_t *)poll;
+	int count     = mm_sim_dispatch(sim);
+	/* time is advanced by the loop instead of waiting, block only if
+	 * there is no timer to advance to */
+	if (count > 0 || timeout != -1)
+		timeout = 0;
+	int rc;
+	rc = sim->epoll->iface->step(sim->epoll, timeout);
+	if (rc == -1)
+		return -1;
+	return count + rc;
+}
+
+static int
+mm_sim_add(mm_poll_t *poll, mm_fd_t *fd, int mask)
+{
+	mm_sim_t *sim = (mm_sim_t *)poll;
+	return sim->epoll->iface->add(sim->epoll, fd, mask);
+}
+
+static int
+mm_sim_read(mm_poll_t *poll,
+            mm_fd_t *fd,
+            mm_fd_callback_t on_read,
+            void *arg,
+            int enable)
+{
+	mm_sim_t *sim = (mm_sim_t *)poll;
+	return sim->epoll->iface->read(sim->epoll, fd, on_read, arg, enable);
+}
+
+static int
+mm_sim_write(mm_poll_t *poll,
+             mm_fd_t *fd,
+             mm_fd_callback_t on_write,
+             void *arg,
+             int enable)
+{
+	mm_sim_t *sim = (mm_sim_t *)poll;
+	return sim->epoll->iface->write(sim->epoll, fd, on_write, arg, enable);
+}
+
+static int
+mm_sim_read_write(mm_poll_t *poll,
+                  mm_fd_t *fd,
+                  mm_fd_callback_t on_event,
+                  void *arg,
+                  int enable)
+{
+	mm_sim_t *sim = (mm_sim_t *)poll;
+	return sim->epoll->iface->read_write(
+	  sim->epoll, fd, on_event, arg, enable);
+}
+
+static int
+mm_sim_del(mm_poll_t *poll, mm_fd_t *fd)
+{
+	mm_sim_t *sim = (mm_sim_t *)poll;
+	/* drop scripted events of the descriptor */
+	int count = mm_buf_used(&sim->events) / sizeof(mm_sim_event_t);
+	int i;
+	for (i = 0; i < count; i++) {
+		mm_sim_event_t *event = (mm_sim_event_t *)sim->events.start + i;
+		if (event->fd == fd)
+			event->fd = NULL;
+	}
+	return sim->epoll->iface->del(sim->epoll, fd);
+}
+
+int
+mm_sim_ready(mm_poll_t *poll, mm_fd_t *fd, int mask)
+{
+	if (poll->iface != &mm_sim_if)
+		return -1;
+	mm_sim_t *sim        = (mm_sim_t *)poll;
+	mm_sim_event_t event = { .fd = fd, .mask = mask };
+	return mm_buf_add(&sim->events, &event, sizeof(event));
+}
+
+mm_pollif_t mm_sim_if = { .name       = "sim",
+	                      .create     = mm_sim_create,
+	                      .free       = mm_sim_free,
+	                      .shutdown   = mm_sim_shutdown,
+	                      .step       = mm_sim_step,
+	                      .add        = mm_sim_add,
+	                      .read       = mm_sim_read,
+	                      .write      = mm_sim_write,
+	                      .read_write = mm_sim_read_write,
+	                      .del        = mm_sim_del };
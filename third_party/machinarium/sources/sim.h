@@ -0,0 +1,25 @@
+#ifndef MM_SIM_H
+#define MM_SIM_H
+
+/*
+ * machinarium.
+ *
+ * cooperative multitasking engine.
+ */
+
+/*
+ * Simulation poller.
+ *
+ * Used together with the virtual clock. Descriptors are still
+ * registered in epoll, but polled without blocking, so wakeups of
+ * condition variables and channels are delivered as usual. Readiness
+ * of descriptors can be scripted with mm_sim_ready(), the callbacks
+ * are invoked on the next loop step.
+ */
+
+extern mm_pollif_t mm_sim_if;
+
+int
+mm_sim_ready(mm_poll_t *, mm_fd_t *, int);
+
+#endif /* MM_SIM_H */
@@ -122,3 +122,9 @@ mm_taskmgr_new(mm_taskmgr_t *mgr,
 	machine_msg_free((machine_msg_t *)msg);
 	return 0;
 }
+
+MACHINE_API int
+machine_task(machine_task_function_t function, void *arg)
+{
+	return mm_taskmgr_new(&machinarium.task_mgr, function, arg, UINT32_MAX);
+}